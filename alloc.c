@@ -0,0 +1,341 @@
+/*
+ * alloc.c, derived from encode_only_ossl.c and decode_only_ossl.c
+ *
+ * Copyright 2019-2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+
+/**
+ * \file alloc.c
+ *
+ * \brief Heap allocations per phase of signing and verifying.
+ *
+ * This runs the steps of two_step_sign_example() and of the decode
+ * only verify flow one at a time and reports the heap allocations
+ * the crypto library makes in each. It is linked with
+ * tdv_alloc_ossl.c and tdv_keys_ossl.c to make alloc_ossl and with
+ * the psa versions to make alloc_psa.
+ *
+ * The first pass is reported separately because the crypto library
+ * does lazy set up on first use. The following passes are averaged
+ * to give the steady state cost per call, which is the budget to
+ * plan with. "net" is what is still allocated after the phase, which
+ * should be zero except for making a key, and "peak" is the most
+ * allocated at once during the phase.
+ *
+ * t_cose and QCBOR don't allocate so all the counts are the crypto
+ * library's.
+ */
+
+#include "t_cose/t_cose_common.h"
+#include "t_cose/t_cose_sign1_sign.h"
+#include "t_cose/t_cose_sign1_verify.h"
+#include "t_cose/q_useful_buf.h"
+
+#include "tdv_alloc.h"
+#include "tdv_keys.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* Number of passes after the first to average */
+#define ALLOC_PASSES 100
+
+
+/* State carried from one phase to the next */
+struct alloc_state {
+    int32_t                        cose_algorithm_id;
+    struct t_cose_key              key_pair;
+    struct t_cose_sign1_sign_ctx   sign_ctx;
+    QCBOREncodeContext             cbor_encode;
+    uint8_t                        signed_cose_buffer[300];
+    struct q_useful_buf_c          signed_cose;
+    struct t_cose_sign1_verify_ctx verify_ctx;
+    struct q_useful_buf_c          payload;
+};
+
+
+static enum t_cose_err_t phase_make_key(struct alloc_state *s)
+{
+    return make_ecdsa_key_pair(s->cose_algorithm_id, &s->key_pair);
+}
+
+
+static enum t_cose_err_t phase_sign_init(struct alloc_state *s)
+{
+    struct q_useful_buf out_buf;
+
+    out_buf.ptr = s->signed_cose_buffer;
+    out_buf.len = sizeof(s->signed_cose_buffer);
+    QCBOREncode_Init(&s->cbor_encode, out_buf);
+    t_cose_sign1_sign_init(&s->sign_ctx, 0, s->cose_algorithm_id);
+    t_cose_sign1_set_signing_key(&s->sign_ctx, s->key_pair, NULL_Q_USEFUL_BUF_C);
+    return T_COSE_SUCCESS;
+}
+
+
+static enum t_cose_err_t phase_encode_parameters(struct alloc_state *s)
+{
+    return t_cose_sign1_encode_parameters(&s->sign_ctx, &s->cbor_encode);
+}
+
+
+static enum t_cose_err_t phase_payload(struct alloc_state *s)
+{
+    QCBOREncode_OpenMap(&s->cbor_encode);
+    QCBOREncode_AddSZStringToMap(&s->cbor_encode, "BeingType", "Humanoid");
+    QCBOREncode_AddSZStringToMap(&s->cbor_encode, "Greeting", "We come in peace");
+    QCBOREncode_AddInt64ToMap(&s->cbor_encode, "ArmCount", 2);
+    QCBOREncode_AddInt64ToMap(&s->cbor_encode, "HeadCount", 1);
+    QCBOREncode_AddSZStringToMap(&s->cbor_encode, "BrainSize", "medium");
+    QCBOREncode_AddBoolToMap(&s->cbor_encode, "DrinksWater", true);
+    QCBOREncode_CloseMap(&s->cbor_encode);
+    return T_COSE_SUCCESS;
+}
+
+
+static enum t_cose_err_t phase_encode_signature(struct alloc_state *s)
+{
+    return t_cose_sign1_encode_signature(&s->sign_ctx, &s->cbor_encode);
+}
+
+
+static enum t_cose_err_t phase_finish(struct alloc_state *s)
+{
+    if(QCBOREncode_Finish(&s->cbor_encode, &s->signed_cose)) {
+        return T_COSE_ERR_CBOR_FORMATTING;
+    }
+    return T_COSE_SUCCESS;
+}
+
+
+static enum t_cose_err_t phase_verify_init(struct alloc_state *s)
+{
+    t_cose_sign1_verify_init(&s->verify_ctx, 0);
+    t_cose_sign1_set_verification_key(&s->verify_ctx, s->key_pair);
+    return T_COSE_SUCCESS;
+}
+
+
+static enum t_cose_err_t phase_verify(struct alloc_state *s)
+{
+    return t_cose_sign1_verify(&s->verify_ctx, s->signed_cose, &s->payload, NULL);
+}
+
+
+static enum t_cose_err_t phase_free_key(struct alloc_state *s)
+{
+    free_ecdsa_key_pair(s->key_pair);
+    return T_COSE_SUCCESS;
+}
+
+
+
+
+/* ------   Phases and their counts   ------ */
+
+struct phase {
+    const char         *label;
+    enum t_cose_err_t (*fn)(struct alloc_state *s);
+    /* Which of the per-operation budgets the phase is part of */
+    int                 in_sign;
+    int                 in_verify;
+};
+
+static const struct phase phases[] = {
+    {"make_ecdsa_key_pair()",            phase_make_key,         0, 0},
+    {"sign init and set key",            phase_sign_init,        1, 0},
+    {"t_cose_sign1_encode_parameters()", phase_encode_parameters, 1, 0},
+    {"payload QCBOREncode_xxx()",        phase_payload,          1, 0},
+    {"t_cose_sign1_encode_signature()",  phase_encode_signature, 1, 0},
+    {"QCBOREncode_Finish()",             phase_finish,           1, 0},
+    {"verify init and set key",          phase_verify_init,      0, 1},
+    {"t_cose_sign1_verify()",            phase_verify,           0, 1},
+    {"free_ecdsa_key_pair()",            phase_free_key,         0, 0},
+};
+
+#define NUM_PHASES (sizeof(phases) / sizeof(phases[0]))
+
+
+/* Counts for one phase summed over some passes */
+struct phase_counts {
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t bytes;
+    int64_t  net;
+    size_t   peak;
+};
+
+
+static void add_counts(struct phase_counts           *sum,
+                       const struct tdv_alloc_counts *before,
+                       const struct tdv_alloc_counts *after)
+{
+    size_t peak;
+
+    sum->allocs += (after->allocs + after->reallocs) - (before->allocs + before->reallocs);
+    sum->frees  += after->frees - before->frees;
+    sum->bytes  += after->bytes - before->bytes;
+    sum->net    += (int64_t)after->live_bytes - (int64_t)before->live_bytes;
+
+    /* Peak is the max over the passes, not a sum */
+    peak = after->peak_live_bytes - before->live_bytes;
+    if(peak > sum->peak) {
+        sum->peak = peak;
+    }
+}
+
+
+static void print_counts(const char *label, const struct phase_counts *first, const struct phase_counts *steady)
+{
+    printf("  %-34s %6llu %6llu %7llu %6lld %6zu  %8.1f %8.1f %9.1f %7.1f %6zu\n",
+           label,
+           (unsigned long long)first->allocs,
+           (unsigned long long)first->frees,
+           (unsigned long long)first->bytes,
+           (long long)first->net,
+           first->peak,
+           (double)steady->allocs / ALLOC_PASSES,
+           (double)steady->frees / ALLOC_PASSES,
+           (double)steady->bytes / ALLOC_PASSES,
+           (double)steady->net / ALLOC_PASSES,
+           steady->peak);
+}
+
+
+static void add_phase_counts(struct phase_counts *sum, const struct phase_counts *c)
+{
+    sum->allocs += c->allocs;
+    sum->frees  += c->frees;
+    sum->bytes  += c->bytes;
+    sum->net    += c->net;
+    if(c->peak > sum->peak) {
+        sum->peak = c->peak;
+    }
+}
+
+
+static const char *alg_name(int32_t cose_algorithm_id)
+{
+    switch(cose_algorithm_id) {
+    case T_COSE_ALGORITHM_ES256: return "ES256";
+    case T_COSE_ALGORITHM_ES384: return "ES384";
+    case T_COSE_ALGORITHM_ES512: return "ES512";
+    default:                     return "unknown";
+    }
+}
+
+
+static int alloc_for_alg(int32_t cose_algorithm_id)
+{
+    struct alloc_state     *s;
+    struct phase_counts     first[NUM_PHASES];
+    struct phase_counts     steady[NUM_PHASES];
+    struct phase_counts     sign_first, sign_steady;
+    struct phase_counts     verify_first, verify_steady;
+    struct tdv_alloc_counts before;
+    struct tdv_alloc_counts after;
+    enum t_cose_err_t       return_value;
+    unsigned                pass;
+    size_t                  i;
+
+    /* Big, so not on the stack */
+    s = calloc(1, sizeof(struct alloc_state));
+    if(s == NULL) {
+        return 1;
+    }
+    s->cose_algorithm_id = cose_algorithm_id;
+
+    memset(first, 0, sizeof(first));
+    memset(steady, 0, sizeof(steady));
+
+    for(pass = 0; pass <= ALLOC_PASSES; pass++) {
+        for(i = 0; i < NUM_PHASES; i++) {
+            tdv_alloc_reset_peak();
+            tdv_alloc_get(&before);
+            return_value = phases[i].fn(s);
+            tdv_alloc_get(&after);
+            if(return_value) {
+                printf("%s %s failed: %d\n", alg_name(cose_algorithm_id), phases[i].label, return_value);
+                if(i > 0) {
+                    free_ecdsa_key_pair(s->key_pair);
+                }
+                free(s);
+                return 1;
+            }
+            add_counts(pass == 0 ? &first[i] : &steady[i], &before, &after);
+        }
+    }
+
+    memset(&sign_first, 0, sizeof(sign_first));
+    memset(&sign_steady, 0, sizeof(sign_steady));
+    memset(&verify_first, 0, sizeof(verify_first));
+    memset(&verify_steady, 0, sizeof(verify_steady));
+
+    printf("%s\n", alg_name(cose_algorithm_id));
+    for(i = 0; i < NUM_PHASES; i++) {
+        print_counts(phases[i].label, &first[i], &steady[i]);
+        if(phases[i].in_sign) {
+            add_phase_counts(&sign_first, &first[i]);
+            add_phase_counts(&sign_steady, &steady[i]);
+        }
+        if(phases[i].in_verify) {
+            add_phase_counts(&verify_first, &first[i]);
+            add_phase_counts(&verify_steady, &steady[i]);
+        }
+    }
+    printf("  per operation, key not included:\n");
+    print_counts("sign", &sign_first, &sign_steady);
+    print_counts("verify", &verify_first, &verify_steady);
+
+    free(s);
+    return 0;
+}
+
+
+static const int32_t alloc_algs[] = {
+    T_COSE_ALGORITHM_ES256,
+#ifndef T_COSE_DISABLE_ES384
+    T_COSE_ALGORITHM_ES384,
+#endif
+#ifndef T_COSE_DISABLE_ES512
+    T_COSE_ALGORITHM_ES512,
+#endif
+};
+
+
+int main(int argc, const char * argv[])
+{
+    size_t i;
+    int    errors;
+
+    (void)argc; /* Avoid unused parameter error */
+    (void)argv;
+
+    /* Before anything touches the crypto library */
+    if(tdv_alloc_hook()) {
+        fprintf(stderr, "Can't count %s crypto allocations. See tdv_alloc_%s.c\n",
+                tdv_crypto_lib_name(),
+                strcmp(tdv_crypto_lib_name(), "OpenSSL") ? "psa" : "ossl");
+        return 1;
+    }
+
+    printf("Heap allocations by %s crypto; first pass and mean of %d passes after it\n",
+           tdv_crypto_lib_name(), ALLOC_PASSES);
+    printf("  %-34s %6s %6s %7s %6s %6s  %8s %8s %9s %7s %6s\n",
+           "", "allocs", "frees", "bytes", "net", "peak",
+           "allocs", "frees", "bytes", "net", "peak");
+
+    errors = 0;
+    for(i = 0; i < sizeof(alloc_algs) / sizeof(alloc_algs[0]); i++) {
+        errors += alloc_for_alg(alloc_algs[i]);
+    }
+
+    return errors ? 1 : 0;
+}
@@ -25,6 +25,27 @@ tdv/sizes.sh encode_only_ossl
 echo " === Maximum Decode ==="
 tdv/sizes.sh decode_only_ossl
 
+# With link time optimization t_cose functions may be inlined into
+# their callers or renamed with a suffix, so the per-function list is
+# shorter and the size of the whole program's code is printed too.
+make -f tdv/Makefile.min clean > /dev/null
+make -f tdv/Makefile.min LTO=1 > /dev/null
+echo " === Mininum Encode, LTO ==="
+tdv/sizes.sh encode_only_psa
+size encode_only_psa | awk 'NR == 2 {print "program text                                  " $1}'
+echo " === Mininum Decode, LTO ==="
+tdv/sizes.sh decode_only_psa
+size decode_only_psa | awk 'NR == 2 {print "program text                                  " $1}'
+
+make -f tdv/Makefile.max clean > /dev/null
+make -f tdv/Makefile.max LTO=1 > /dev/null
+echo " === Maximum Encode, LTO ==="
+tdv/sizes.sh encode_only_ossl
+size encode_only_ossl | awk 'NR == 2 {print "program text                                  " $1}'
+echo " === Maximum Decode, LTO ==="
+tdv/sizes.sh decode_only_ossl
+size decode_only_ossl | awk 'NR == 2 {print "program text                                  " $1}'
+
 echo "===================================="
 
 
@@ -0,0 +1,363 @@
+/*
+ * batch.c, derived from decode_only_ossl.c
+ *
+ * Copyright 2019-2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+
+/**
+ * \file batch.c
+ *
+ * \brief Batch verification vs verifying one message at a time.
+ *
+ * The one-at-a-time loop is the verification in decode_only_xxx.c
+ * done for each message: t_cose_sign1_verify_init(),
+ * t_cose_sign1_set_verification_key() and t_cose_sign1_verify(), with
+ * the key picked by the caller who knows the algorithm. The batch is
+ * tdv_batch_verify() over the same messages, once with the one key
+ * and once with a key resolver.
+ *
+ * Two batches are made from the messages in bench_corpus.c. The first
+ * has only the ES256 messages so every message has the same key. The
+ * second takes the algorithms round-robin, a message of each in turn,
+ * so the key changes every message, which is the worst case for the
+ * batch.
+ *
+ * It is linked with tdv_keys_ossl.c to make batch_ossl and with
+ * tdv_keys_psa.c to make batch_psa.
+ *
+ * Usage:
+ *
+ *     batch_ossl [-b batch_size] [-r runs] [-n batches_per_run]
+ */
+
+#include "t_cose/t_cose_common.h"
+#include "t_cose/t_cose_sign1_verify.h"
+#include "t_cose/q_useful_buf.h"
+
+#include "bench.h"
+#include "bench_corpus.h"
+#include "tdv_batch.h"
+#include "tdv_keys.h"
+#include "tdv_keystore.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define BATCH_DEFAULT_SIZE      1000
+#define BATCH_DEFAULT_RUNS      3
+#define BATCH_DEFAULT_PER_RUN   5
+
+/* Most algorithms in bench_corpus.c */
+#define BATCH_MAX_ALGS          8
+
+
+struct batch_ctx {
+    struct tdv_keystore       *keys;
+    struct tdv_batch_item     *items;
+    /* Algorithm of each item, for the loop which knows it up front */
+    int32_t                   *algs;
+    size_t                     count;
+    /* For the one key batch */
+    struct t_cose_key          key;
+};
+
+
+/*
+ * The resolver for the batch. The corpus messages have no kid so the
+ * key is found by algorithm.
+ */
+static enum t_cose_err_t keystore_resolver(void                 *resolver_ctx,
+                                           int32_t               cose_algorithm_id,
+                                           struct q_useful_buf_c kid,
+                                           struct t_cose_key    *key)
+{
+    (void)kid; /* Avoid unused parameter error */
+
+    return tdv_keystore_find((const struct tdv_keystore *)resolver_ctx,
+                             cose_algorithm_id,
+                             TDV_KEYSTORE_BUILTIN,
+                             0,
+                             key);
+}
+
+
+/*
+ * Each message as decode_only_xxx.c verifies it.
+ */
+static enum t_cose_err_t loop_op(void *op_ctx)
+{
+    struct batch_ctx              *ctx = (struct batch_ctx *)op_ctx;
+    struct t_cose_sign1_verify_ctx verify_ctx;
+    struct t_cose_key              key;
+    enum t_cose_err_t              return_value;
+    size_t                         i;
+
+    for(i = 0; i < ctx->count; i++) {
+        return_value = tdv_keystore_find(ctx->keys, ctx->algs[i], TDV_KEYSTORE_BUILTIN, 0, &key);
+        if(return_value) {
+            return return_value;
+        }
+
+        t_cose_sign1_verify_init(&verify_ctx, 0);
+
+        t_cose_sign1_set_verification_key(&verify_ctx, key);
+
+        return_value = t_cose_sign1_verify(&verify_ctx,
+                                           ctx->items[i].cose_sign1,
+                                           &ctx->items[i].payload,
+                                           NULL);
+        if(return_value) {
+            return return_value;
+        }
+    }
+
+    return T_COSE_SUCCESS;
+}
+
+
+static enum t_cose_err_t batch_check(const struct batch_ctx *ctx, size_t verified)
+{
+    size_t i;
+
+    if(verified == ctx->count) {
+        return T_COSE_SUCCESS;
+    }
+    for(i = 0; i < ctx->count; i++) {
+        if(ctx->items[i].result) {
+            return ctx->items[i].result;
+        }
+    }
+    return T_COSE_ERR_FAIL;
+}
+
+
+static enum t_cose_err_t batch_key_op(void *op_ctx)
+{
+    struct batch_ctx *ctx = (struct batch_ctx *)op_ctx;
+
+    return batch_check(ctx, tdv_batch_verify(0, &ctx->key, NULL, NULL, ctx->items, ctx->count));
+}
+
+
+static enum t_cose_err_t batch_resolver_op(void *op_ctx)
+{
+    struct batch_ctx *ctx = (struct batch_ctx *)op_ctx;
+
+    return batch_check(ctx, tdv_batch_verify(0,
+                                             NULL,
+                                             keystore_resolver,
+                                             ctx->keys,
+                                             ctx->items,
+                                             ctx->count));
+}
+
+
+/*
+ * Fill the batch with the corpus messages, only those for one
+ * algorithm or else the algorithms round-robin. The corpus is grouped
+ * by algorithm, so for round-robin the next message of each algorithm
+ * is taken in turn and consecutive messages never have the same key.
+ */
+static void fill_batch(struct batch_ctx *ctx, int32_t only_alg)
+{
+    int32_t algs[BATCH_MAX_ALGS];
+    size_t  next[BATCH_MAX_ALGS];
+    size_t  num_algs;
+    size_t  a;
+    size_t  i;
+    size_t  j;
+
+    /* Each algorithm and where its first message is */
+    num_algs = 0;
+    for(j = 0; j < bench_corpus_count; j++) {
+        if(only_alg && bench_corpus[j].cose_algorithm_id != only_alg) {
+            continue;
+        }
+        for(a = 0; a < num_algs && algs[a] != bench_corpus[j].cose_algorithm_id; a++);
+        if(a == num_algs && num_algs < BATCH_MAX_ALGS) {
+            algs[num_algs] = bench_corpus[j].cose_algorithm_id;
+            next[num_algs] = j;
+            num_algs++;
+        }
+    }
+
+    for(i = 0; i < ctx->count; i++) {
+        a = i % num_algs;
+        j = next[a];
+        ctx->items[i].cose_sign1 = bench_corpus[j].cose_sign1;
+        ctx->algs[i]             = bench_corpus[j].cose_algorithm_id;
+
+        /* On to this algorithm's next message */
+        do {
+            j = (j + 1) % bench_corpus_count;
+        } while(bench_corpus[j].cose_algorithm_id != algs[a]);
+        next[a] = j;
+    }
+}
+
+
+static int compare(const struct bench_config *config,
+                   const char                *batch_name,
+                   struct batch_ctx          *ctx,
+                   int                        one_key)
+{
+    struct bench_result result;
+    enum t_cose_err_t   return_value;
+    double              loop_msgs_per_sec;
+    double              msgs_per_sec;
+    size_t              i;
+    int                 errors;
+
+    static const struct {
+        const char  *label;
+        bench_op_fn  op;
+        int          needs_one_key;
+    } methods[] = {
+        {"one at a time",   loop_op,           0},
+        {"batch, one key",  batch_key_op,      1},
+        {"batch, resolver", batch_resolver_op, 0},
+    };
+
+    printf("\n%s, %zu messages per batch\n", batch_name, ctx->count);
+    printf("%-24s %12s %12s %8s\n", "", "msgs/sec", "us per msg", "speedup");
+
+    errors            = 0;
+    loop_msgs_per_sec = 0;
+    for(i = 0; i < sizeof(methods) / sizeof(methods[0]); i++) {
+        if(methods[i].needs_one_key && !one_key) {
+            continue;
+        }
+        return_value = bench_run(config, methods[i].op, ctx, &result);
+        if(return_value) {
+            printf("%-24s failed: %d\n", methods[i].label, return_value);
+            errors++;
+            continue;
+        }
+        msgs_per_sec = result.ops_per_sec * (double)ctx->count;
+        if(i == 0) {
+            loop_msgs_per_sec = msgs_per_sec;
+        }
+        printf("%-24s %12.1f %12.2f %7.2fx\n",
+               methods[i].label,
+               msgs_per_sec,
+               1e6 / msgs_per_sec,
+               loop_msgs_per_sec ? msgs_per_sec / loop_msgs_per_sec : 0);
+        fflush(stdout);
+    }
+
+    return errors;
+}
+
+
+static int parse_count(const char *arg, unsigned *count)
+{
+    char          *end;
+    unsigned long  value;
+
+    if(arg == NULL) {
+        return -1;
+    }
+    value = strtoul(arg, &end, 10);
+    if(*end != '\0' || value < 1 || value > 10000000) {
+        return -1;
+    }
+    *count = (unsigned)value;
+    return 0;
+}
+
+
+int main(int argc, const char * argv[])
+{
+    struct bench_config config;
+    struct tdv_keystore keys;
+    struct batch_ctx    ctx;
+    enum t_cose_err_t   return_value;
+    unsigned            batch_size;
+    int                 errors;
+    int                 i;
+
+    memset(&config, 0, sizeof(config));
+    config.runs        = BATCH_DEFAULT_RUNS;
+    config.iterations  = BATCH_DEFAULT_PER_RUN;
+    config.warmup      = 1;
+    config.max_threads = 1;
+    config.keys        = &keys;
+    batch_size         = BATCH_DEFAULT_SIZE;
+
+    for(i = 1; i < argc; i++) {
+        if(!strcmp(argv[i], "-b")) {
+            if(parse_count(argv[++i], &batch_size)) {
+                goto Usage;
+            }
+        } else if(!strcmp(argv[i], "-r")) {
+            if(parse_count(argv[++i], &config.runs)) {
+                goto Usage;
+            }
+        } else if(!strcmp(argv[i], "-n")) {
+            if(parse_count(argv[++i], &config.iterations)) {
+                goto Usage;
+            }
+        } else {
+            goto Usage;
+        }
+    }
+
+    tdv_keystore_init(&keys);
+    return_value = tdv_keystore_add_builtin(&keys);
+    if(return_value) {
+        fprintf(stderr, "can't make built-in keys: %d\n", return_value);
+        return 1;
+    }
+
+    ctx.keys  = &keys;
+    ctx.count = batch_size;
+    ctx.items = calloc(batch_size, sizeof(struct tdv_batch_item));
+    ctx.algs  = calloc(batch_size, sizeof(int32_t));
+    if(ctx.items == NULL || ctx.algs == NULL) {
+        fprintf(stderr, "out of memory\n");
+        errors = 1;
+        goto Done;
+    }
+
+    printf("Batch verification, %s crypto, %u runs of %u batches\n",
+           tdv_crypto_lib_name(), config.runs, config.iterations);
+
+    errors = 0;
+
+    fill_batch(&ctx, T_COSE_ALGORITHM_ES256);
+    return_value = tdv_keystore_find(&keys, T_COSE_ALGORITHM_ES256, TDV_KEYSTORE_BUILTIN, 0, &ctx.key);
+    if(return_value) {
+        fprintf(stderr, "no ES256 key: %d\n", return_value);
+        errors = 1;
+        goto Done;
+    }
+    errors += compare(&config, "ES256 only, same key", &ctx, 1);
+
+    fill_batch(&ctx, 0);
+    errors += compare(&config, "All algorithms round-robin, key changes every message", &ctx, 0);
+
+Done:
+    free(ctx.items);
+    free(ctx.algs);
+    tdv_keystore_free(&keys);
+    return errors ? 1 : 0;
+
+Usage:
+    fprintf(stderr,
+            "Usage: %s [-b batch_size] [-r runs] [-n batches_per_run]\n"
+            "  -b  Messages per batch, default %d\n"
+            "  -r  Timed runs, default %d\n"
+            "  -n  Batches per run, default %d\n",
+            argv[0],
+            BATCH_DEFAULT_SIZE,
+            BATCH_DEFAULT_RUNS,
+            BATCH_DEFAULT_PER_RUN);
+    return 2;
+}
@@ -0,0 +1,1201 @@
+/*
+ * bench.c, derived from encode_only_ossl.c and encode_only_psa.c
+ *
+ * Copyright 2019-2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+
+/**
+ * \file bench.c
+ *
+ * \brief Throughput and latency benchmarks for t_cose.
+ *
+ * This is the same source for every crypto library. It is linked with
+ * tdv_keys_ossl.c to make bench_ossl and with tdv_keys_psa.c to make
+ * bench_psa. The only crypto library dependent code is the making of
+ * keys.
+ *
+ * Keys come from the key store in tdv_keystore.h. Signing uses the
+ * first key given with -k for the algorithm, or the built-in test key
+ * if none was given. tdv/keys has PEM files of the built-in keys.
+ * Verification always uses the built-in keys because they are what
+ * the messages in bench_corpus.c are signed with.
+ *
+ * The operations benchmarked are the same as in encode_only_xxx.c
+ * and decode_only_xxx.c, but with the key made once outside of the
+ * timed loop and without any printing inside it. Verification is of
+ * the pre-signed messages in bench_corpus.c. Signing and verifying
+ * are also timed with the prepared signer and verifier in
+ * tdv_prepared.h.
+ *
+ * Usage:
+ *
+ *     bench_ossl [-r runs] [-n iterations] [-w warmup]
+ *                [-t threads] [-p] [-k keyfile ...] [mode ...]
+ *
+ * With no mode, the sign and verify modes are run. Run with an
+ * unknown option to get the list of modes.
+ */
+
+#include "t_cose/t_cose_common.h"
+#include "t_cose/t_cose_sign1_sign.h"
+#include "t_cose/t_cose_sign1_verify.h"
+#include "t_cose/q_useful_buf.h"
+
+#include "bench.h"
+#include "bench_corpus.h"
+#include "bench_modes.h"
+#include "tdv_alloc.h"
+#include "tdv_keys.h"
+#include "tdv_keystore.h"
+#include "tdv_perf.h"
+#include "tdv_prepared.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* Size of the output buffer for a signed message. This is the same as
+ * in two_step_sign_example() and is big enough for an ES512 signature
+ * with the example payload. */
+#define BENCH_SIGNED_COSE_SIZE 300
+
+
+/*
+ * The algorithms benchmarked. These follow the T_COSE_DISABLE_XXX
+ * defines so the benchmark builds with the same configuration as
+ * libt_cose.a.
+ */
+static const int32_t bench_algs[] = {
+    T_COSE_ALGORITHM_ES256,
+#ifndef T_COSE_DISABLE_ES384
+    T_COSE_ALGORITHM_ES384,
+#endif
+#ifndef T_COSE_DISABLE_ES512
+    T_COSE_ALGORITHM_ES512,
+#endif
+};
+
+#define BENCH_NUM_ALGS (sizeof(bench_algs) / sizeof(bench_algs[0]))
+
+
+static const char *alg_name(int32_t cose_algorithm_id)
+{
+    switch(cose_algorithm_id) {
+    case T_COSE_ALGORITHM_ES256: return "ES256";
+    case T_COSE_ALGORITHM_ES384: return "ES384";
+    case T_COSE_ALGORITHM_ES512: return "ES512";
+    default:                     return "unknown";
+    }
+}
+
+
+/**
+ * \brief Output the example payload.
+ *
+ * \param[in] cbor_encode  The encoder to add the payload to.
+ *
+ * This is the same payload as in two_step_sign_example(), a map of
+ * some label-value pairs similar to a CWT or EAT.
+ */
+static void add_example_payload(QCBOREncodeContext *cbor_encode)
+{
+    QCBOREncode_OpenMap(cbor_encode);
+    QCBOREncode_AddSZStringToMap(cbor_encode, "BeingType", "Humanoid");
+    QCBOREncode_AddSZStringToMap(cbor_encode, "Greeting", "We come in peace");
+    QCBOREncode_AddInt64ToMap(cbor_encode, "ArmCount", 2);
+    QCBOREncode_AddInt64ToMap(cbor_encode, "HeadCount", 1);
+    QCBOREncode_AddSZStringToMap(cbor_encode, "BrainSize", "medium");
+    QCBOREncode_AddBoolToMap(cbor_encode, "DrinksWater", true);
+    QCBOREncode_CloseMap(cbor_encode);
+}
+
+
+
+
+/* ------   Two-step signing   ------ */
+
+struct sign_op_ctx {
+    int32_t               cose_algorithm_id;
+    struct t_cose_key     key_pair;
+    uint8_t               signed_cose_buffer[BENCH_SIGNED_COSE_SIZE];
+    struct q_useful_buf_c signed_cose;
+};
+
+
+/*
+ * One two-step signing exactly as two_step_sign_example() does it:
+ * t_cose_sign1_encode_parameters(), the payload,
+ * t_cose_sign1_encode_signature() and QCBOREncode_Finish().
+ */
+static enum t_cose_err_t sign_op(void *op_ctx)
+{
+    struct sign_op_ctx           *ctx = (struct sign_op_ctx *)op_ctx;
+    struct t_cose_sign1_sign_ctx  sign_ctx;
+    QCBOREncodeContext            cbor_encode;
+    enum t_cose_err_t             return_value;
+    struct q_useful_buf           out_buf;
+
+    out_buf.ptr = ctx->signed_cose_buffer;
+    out_buf.len = sizeof(ctx->signed_cose_buffer);
+    QCBOREncode_Init(&cbor_encode, out_buf);
+
+    t_cose_sign1_sign_init(&sign_ctx, 0, ctx->cose_algorithm_id);
+    t_cose_sign1_set_signing_key(&sign_ctx, ctx->key_pair, NULL_Q_USEFUL_BUF_C);
+
+    return_value = t_cose_sign1_encode_parameters(&sign_ctx, &cbor_encode);
+    if(return_value) {
+        return return_value;
+    }
+
+    add_example_payload(&cbor_encode);
+
+    return_value = t_cose_sign1_encode_signature(&sign_ctx, &cbor_encode);
+    if(return_value) {
+        return return_value;
+    }
+
+    if(QCBOREncode_Finish(&cbor_encode, &ctx->signed_cose)) {
+        return T_COSE_ERR_CBOR_FORMATTING;
+    }
+
+    return T_COSE_SUCCESS;
+}
+
+
+struct prepared_sign_op_ctx {
+    struct tdv_prepared_signer signer;
+    uint8_t                    signed_cose_buffer[BENCH_SIGNED_COSE_SIZE];
+    struct q_useful_buf_c      signed_cose;
+};
+
+
+/*
+ * The same signing as sign_op() with the headers encoded once in
+ * tdv_prepared_signer_init() rather than in every op.
+ */
+static enum t_cose_err_t prepared_sign_op(void *op_ctx)
+{
+    struct prepared_sign_op_ctx *ctx = (struct prepared_sign_op_ctx *)op_ctx;
+    QCBOREncodeContext           cbor_encode;
+    enum t_cose_err_t            return_value;
+    struct q_useful_buf          out_buf;
+
+    out_buf.ptr = ctx->signed_cose_buffer;
+    out_buf.len = sizeof(ctx->signed_cose_buffer);
+    QCBOREncode_Init(&cbor_encode, out_buf);
+
+    tdv_prepared_encode_parameters(&ctx->signer, &cbor_encode);
+
+    add_example_payload(&cbor_encode);
+
+    return_value = tdv_prepared_encode_signature(&ctx->signer, &cbor_encode);
+    if(return_value) {
+        return return_value;
+    }
+
+    if(QCBOREncode_Finish(&cbor_encode, &ctx->signed_cose)) {
+        return T_COSE_ERR_CBOR_FORMATTING;
+    }
+
+    return T_COSE_SUCCESS;
+}
+
+
+/*
+ * Check a message made by a sign op verifies so a fast but wrong
+ * signer doesn't go unnoticed.
+ */
+static enum t_cose_err_t check_signed(struct t_cose_key     key_pair,
+                                      struct q_useful_buf_c signed_cose)
+{
+    struct t_cose_sign1_verify_ctx verify_ctx;
+    struct q_useful_buf_c          payload;
+
+    t_cose_sign1_verify_init(&verify_ctx, 0);
+    t_cose_sign1_set_verification_key(&verify_ctx, key_pair);
+
+    return t_cose_sign1_verify(&verify_ctx, signed_cose, &payload, NULL);
+}
+
+
+/*
+ * Print how much less a prepared op takes than the t_cose op it
+ * replaces.
+ */
+static void print_saved(const struct bench_result *t_cose, const struct bench_result *prepared)
+{
+    double saved_ns;
+
+    saved_ns = t_cose->mean_ns - prepared->mean_ns;
+    printf("%-24s %.2f us/msg (%.1f%%)\n",
+           "  saved",
+           saved_ns / 1000.0,
+           t_cose->mean_ns > 0 ? 100.0 * saved_ns / t_cose->mean_ns : 0.0);
+}
+
+
+/*
+ * Time the prepared signer for the algorithm and key in ctx and
+ * print it with how much it saves per message over two-step signing.
+ * Algorithms the prepared signer doesn't do, EdDSA, are skipped.
+ */
+static int bench_sign_prepared(const struct bench_config *config,
+                               const struct sign_op_ctx  *ctx,
+                               const struct bench_result *two_step)
+{
+    struct prepared_sign_op_ctx prepared_ctx;
+    struct bench_result         result;
+    enum t_cose_err_t           return_value;
+    char                        label[32];
+
+    snprintf(label, sizeof(label), "%s sign prepared", alg_name(ctx->cose_algorithm_id));
+
+    return_value = tdv_prepared_signer_init(&prepared_ctx.signer,
+                                            0,
+                                            ctx->cose_algorithm_id,
+                                            ctx->key_pair,
+                                            NULL_Q_USEFUL_BUF_C);
+    if(return_value == T_COSE_ERR_UNSUPPORTED_SIGNING_ALG) {
+        return 0;
+    }
+    if(return_value) {
+        printf("%-24s failed: %d\n", label, return_value);
+        return 1;
+    }
+
+    return_value = prepared_sign_op(&prepared_ctx);
+    if(return_value == T_COSE_SUCCESS) {
+        return_value = check_signed(ctx->key_pair, prepared_ctx.signed_cose);
+    }
+    if(return_value == T_COSE_SUCCESS) {
+        return_value = bench_run(config, prepared_sign_op, &prepared_ctx, &result);
+    }
+    tdv_prepared_signer_free(&prepared_ctx.signer);
+    if(return_value) {
+        printf("%-24s failed: %d\n", label, return_value);
+        return 1;
+    }
+
+    bench_print_result(label, &result);
+    print_saved(two_step, &result);
+
+    return 0;
+}
+
+
+static int bench_sign(const struct bench_config *config)
+{
+    struct sign_op_ctx  ctx;
+    struct bench_result result;
+    enum t_cose_err_t   return_value;
+    char                label[32];
+    size_t              i;
+    int                 errors;
+
+    printf("\n");
+    bench_print_header();
+
+    errors = 0;
+    for(i = 0; i < BENCH_NUM_ALGS; i++) {
+        ctx.cose_algorithm_id = bench_algs[i];
+        snprintf(label, sizeof(label), "%s sign", alg_name(bench_algs[i]));
+
+        return_value = tdv_keystore_find(config->keys,
+                                         ctx.cose_algorithm_id,
+                                         NULL,
+                                         1,
+                                         &ctx.key_pair);
+        if(return_value) {
+            printf("%-24s no key: %d\n", label, return_value);
+            errors++;
+            continue;
+        }
+
+        return_value = sign_op(&ctx);
+        if(return_value == T_COSE_SUCCESS) {
+            return_value = check_signed(ctx.key_pair, ctx.signed_cose);
+        }
+        if(return_value == T_COSE_SUCCESS) {
+            return_value = bench_run(config, sign_op, &ctx, &result);
+        }
+        if(return_value) {
+            printf("%-24s failed: %d\n", label, return_value);
+            errors++;
+        } else {
+            bench_print_result(label, &result);
+            errors += bench_sign_prepared(config, &ctx, &result);
+        }
+    }
+
+    return errors;
+}
+
+
+
+
+/* ------   Verification   ------ */
+
+struct verify_op_ctx {
+    struct t_cose_key     key_pair;
+    struct q_useful_buf_c cose_sign1;
+};
+
+
+/*
+ * One verification of a pre-signed message from bench_corpus.c. All
+ * three calls a verifier has to make for a message are timed.
+ */
+static enum t_cose_err_t verify_op(void *op_ctx)
+{
+    struct verify_op_ctx          *ctx = (struct verify_op_ctx *)op_ctx;
+    struct t_cose_sign1_verify_ctx verify_ctx;
+    struct q_useful_buf_c          payload;
+
+    t_cose_sign1_verify_init(&verify_ctx, 0);
+
+    t_cose_sign1_set_verification_key(&verify_ctx, ctx->key_pair);
+
+    return t_cose_sign1_verify(&verify_ctx, ctx->cose_sign1, &payload, NULL);
+}
+
+
+struct prepared_verify_op_ctx {
+    struct tdv_prepared_verifier verifier;
+    struct q_useful_buf_c        cose_sign1;
+};
+
+
+/*
+ * The same verification as verify_op() with the start of the
+ * Sig_structure hashed once in tdv_prepared_verifier_init().
+ */
+static enum t_cose_err_t prepared_verify_op(void *op_ctx)
+{
+    struct prepared_verify_op_ctx *ctx = (struct prepared_verify_op_ctx *)op_ctx;
+    struct q_useful_buf_c          payload;
+
+    return tdv_prepared_verify(&ctx->verifier, ctx->cose_sign1, &payload);
+}
+
+
+/*
+ * Time the prepared verifier on the message in ctx and print it with
+ * how much it saves over t_cose_sign1_verify().
+ */
+static int bench_verify_prepared(const struct bench_config     *config,
+                                 struct prepared_verify_op_ctx *ctx,
+                                 const struct bench_result     *t_cose)
+{
+    struct bench_result result;
+    enum t_cose_err_t   return_value;
+    char                label[32];
+
+    snprintf(label, sizeof(label), "%s verify prepared",
+             alg_name(ctx->verifier.cose_algorithm_id));
+
+    return_value = bench_run(config, prepared_verify_op, ctx, &result);
+    if(return_value) {
+        printf("%-24s failed: %d\n", label, return_value);
+        return 1;
+    }
+
+    bench_print_result(label, &result);
+    print_saved(t_cose, &result);
+
+    return 0;
+}
+
+
+static int bench_verify(const struct bench_config *config)
+{
+    struct verify_op_ctx          ctx;
+    struct prepared_verify_op_ctx prepared_ctx;
+    int                           have_prepared;
+    struct bench_result           result;
+    enum t_cose_err_t             return_value;
+    char                          label[32];
+    size_t                        i;
+    size_t                        j;
+    int                           errors;
+
+    printf("\n");
+    bench_print_header();
+
+    errors = 0;
+    for(i = 0; i < BENCH_NUM_ALGS; i++) {
+        return_value = tdv_keystore_find(config->keys,
+                                         bench_algs[i],
+                                         TDV_KEYSTORE_BUILTIN,
+                                         0,
+                                         &ctx.key_pair);
+        if(return_value) {
+            printf("%-24s no key: %d\n", alg_name(bench_algs[i]), return_value);
+            errors++;
+            continue;
+        }
+
+        /* Not for EdDSA */
+        have_prepared = tdv_prepared_verifier_init(&prepared_ctx.verifier,
+                                                   bench_algs[i],
+                                                   ctx.key_pair) == T_COSE_SUCCESS;
+
+        /* One line per message as the messages have different size
+         * payloads and thus different hashing cost */
+        for(j = 0; j < bench_corpus_count; j++) {
+            if(bench_corpus[j].cose_algorithm_id != bench_algs[i]) {
+                continue;
+            }
+            ctx.cose_sign1 = bench_corpus[j].cose_sign1;
+            snprintf(label, sizeof(label), "%s verify %zuB",
+                     alg_name(bench_algs[i]), ctx.cose_sign1.len);
+
+            return_value = bench_run(config, verify_op, &ctx, &result);
+            if(return_value) {
+                printf("%-24s failed: %d\n", label, return_value);
+                errors++;
+            } else {
+                bench_print_result(label, &result);
+                if(have_prepared) {
+                    prepared_ctx.cose_sign1 = ctx.cose_sign1;
+                    errors += bench_verify_prepared(config, &prepared_ctx, &result);
+                }
+            }
+        }
+
+        if(have_prepared) {
+            tdv_prepared_verifier_free(&prepared_ctx.verifier);
+        }
+    }
+
+    return errors;
+}
+
+
+
+
+/* ------   Thread scaling   ------ */
+
+/*
+ * Run op on 1, 2, 4, ... threads up to config->max_threads and print
+ * the throughput, the speedup over one thread and the efficiency,
+ * which is the speedup divided by the number of threads. Efficiency
+ * falling off well before the number of cores is the sign of lock
+ * contention or shared cache lines in t_cose or the crypto library.
+ */
+static int thread_sweep(const struct bench_config *config,
+                        const char                *label,
+                        bench_op_fn                op,
+                        void                      *op_ctxs[])
+{
+    enum t_cose_err_t return_value;
+    unsigned          num_threads;
+    double            ops_per_sec;
+    double            one_thread_ops_per_sec;
+
+    one_thread_ops_per_sec = 0;
+    num_threads = 1;
+    while(1) {
+        return_value = bench_run_threaded(config, num_threads, op, op_ctxs, &ops_per_sec);
+        if(return_value) {
+            printf("%-24s %7u failed: %d\n", label, num_threads, return_value);
+            return 1;
+        }
+        if(num_threads == 1) {
+            one_thread_ops_per_sec = ops_per_sec;
+        }
+
+        printf("%-24s %7u %12.1f %8.2f %9.1f%%\n",
+               label,
+               num_threads,
+               ops_per_sec,
+               ops_per_sec / one_thread_ops_per_sec,
+               100 * ops_per_sec / (one_thread_ops_per_sec * num_threads));
+        fflush(stdout);
+
+        if(num_threads >= config->max_threads) {
+            break;
+        }
+        num_threads *= 2;
+        if(num_threads > config->max_threads) {
+            num_threads = config->max_threads;
+        }
+    }
+
+    return 0;
+}
+
+
+/*
+ * The key is shared by all the threads as it would be in a signing
+ * or verifying server. Each thread has its own t_cose context and
+ * output buffer.
+ *
+ * For PSA / MBed Crypto, the library must be built with
+ * MBEDTLS_THREADING_C for concurrent use.
+ */
+static int bench_threads(const struct bench_config *config)
+{
+    struct sign_op_ctx   *sign_ctxs;
+    struct verify_op_ctx *verify_ctxs;
+    void                **op_ctxs;
+    struct t_cose_key     sign_key;
+    struct t_cose_key     verify_key;
+    enum t_cose_err_t     return_value;
+    struct q_useful_buf_c cose_sign1;
+    char                  label[32];
+    size_t                i;
+    size_t                j;
+    unsigned              t;
+    int                   errors;
+
+    sign_ctxs   = calloc(config->max_threads, sizeof(struct sign_op_ctx));
+    verify_ctxs = calloc(config->max_threads, sizeof(struct verify_op_ctx));
+    op_ctxs     = calloc(config->max_threads, sizeof(void *));
+    if(sign_ctxs == NULL || verify_ctxs == NULL || op_ctxs == NULL) {
+        printf("thread scaling: out of memory\n");
+        errors = 1;
+        goto Done;
+    }
+
+    printf("\n%-24s %7s %12s %8s %10s   (%u operations per thread%s)\n",
+           "", "threads", "ops/sec", "speedup", "efficiency",
+           config->iterations, config->pin_cpus ? ", pinned" : "");
+
+    errors = 0;
+    for(i = 0; i < BENCH_NUM_ALGS; i++) {
+        return_value = tdv_keystore_find(config->keys, bench_algs[i], NULL, 1, &sign_key);
+        if(!return_value) {
+            return_value = tdv_keystore_find(config->keys,
+                                             bench_algs[i],
+                                             TDV_KEYSTORE_BUILTIN,
+                                             0,
+                                             &verify_key);
+        }
+        if(return_value) {
+            printf("%-24s no key: %d\n", alg_name(bench_algs[i]), return_value);
+            errors++;
+            continue;
+        }
+
+        for(t = 0; t < config->max_threads; t++) {
+            sign_ctxs[t].cose_algorithm_id = bench_algs[i];
+            sign_ctxs[t].key_pair          = sign_key;
+            op_ctxs[t]                     = &sign_ctxs[t];
+        }
+        snprintf(label, sizeof(label), "%s sign", alg_name(bench_algs[i]));
+        errors += thread_sweep(config, label, sign_op, op_ctxs);
+
+        /* The first corpus message for the algorithm, the example
+         * map, is the one verified */
+        cose_sign1 = NULL_Q_USEFUL_BUF_C;
+        for(j = 0; j < bench_corpus_count; j++) {
+            if(bench_corpus[j].cose_algorithm_id == bench_algs[i]) {
+                cose_sign1 = bench_corpus[j].cose_sign1;
+                break;
+            }
+        }
+        for(t = 0; t < config->max_threads; t++) {
+            verify_ctxs[t].key_pair   = verify_key;
+            verify_ctxs[t].cose_sign1 = cose_sign1;
+            op_ctxs[t]                = &verify_ctxs[t];
+        }
+        snprintf(label, sizeof(label), "%s verify", alg_name(bench_algs[i]));
+        errors += thread_sweep(config, label, verify_op, op_ctxs);
+    }
+
+Done:
+    free(sign_ctxs);
+    free(verify_ctxs);
+    free(op_ctxs);
+    return errors;
+}
+
+
+
+
+/* ------   Key set up   ------ */
+
+/* Keys made at once when timing make and free separately. Small
+ * because PSA has a limited number of key slots. */
+#define BENCH_KEY_BATCH 16
+
+/* Operations to average the allocation counts over */
+#define BENCH_ALLOC_OPS 100
+
+
+struct key_op_ctx {
+    int32_t cose_algorithm_id;
+};
+
+
+/*
+ * Make and free one key as a verifier that sees a new key for every
+ * message would.
+ */
+static enum t_cose_err_t key_op(void *op_ctx)
+{
+    struct key_op_ctx *ctx = (struct key_op_ctx *)op_ctx;
+    struct t_cose_key  key_pair;
+    enum t_cose_err_t  return_value;
+
+    return_value = make_ecdsa_key_pair(ctx->cose_algorithm_id, &key_pair);
+    if(return_value) {
+        return return_value;
+    }
+    free_ecdsa_key_pair(key_pair);
+
+    return T_COSE_SUCCESS;
+}
+
+
+/*
+ * Time making and freeing keys separately. Keys are made in batches,
+ * each make timed, then the batch is freed, each free timed.
+ */
+static enum t_cose_err_t time_make_and_free(const struct bench_config *config,
+                                            int32_t                    cose_algorithm_id,
+                                            struct bench_result       *make_result,
+                                            struct bench_result       *free_result)
+{
+    struct t_cose_key  keys[BENCH_KEY_BATCH];
+    uint64_t          *make_samples;
+    uint64_t          *free_samples;
+    uint64_t           start;
+    size_t             total;
+    size_t             n;
+    size_t             batch;
+    size_t             i;
+    enum t_cose_err_t  return_value;
+
+    total = (size_t)config->runs * config->iterations;
+    make_samples = malloc(total * sizeof(uint64_t));
+    free_samples = malloc(total * sizeof(uint64_t));
+    if(make_samples == NULL || free_samples == NULL) {
+        return_value = T_COSE_ERR_INSUFFICIENT_MEMORY;
+        goto Done;
+    }
+
+    return_value = T_COSE_SUCCESS;
+    for(n = 0; n < total; n += batch) {
+        batch = total - n < BENCH_KEY_BATCH ? total - n : BENCH_KEY_BATCH;
+        for(i = 0; i < batch; i++) {
+            start = bench_now_ns();
+            return_value = make_ecdsa_key_pair(cose_algorithm_id, &keys[i]);
+            make_samples[n + i] = bench_now_ns() - start;
+            if(return_value) {
+                batch = i;
+                break;
+            }
+        }
+        for(i = 0; i < batch; i++) {
+            start = bench_now_ns();
+            free_ecdsa_key_pair(keys[i]);
+            free_samples[n + i] = bench_now_ns() - start;
+        }
+        if(return_value) {
+            goto Done;
+        }
+    }
+
+    bench_latency_stats(make_samples, total, make_result);
+    bench_latency_stats(free_samples, total, free_result);
+    /* There are no separate runs here so no run-to-run variance. A
+     * free can be too quick for the clock. */
+    make_result->ops_per_sec        = make_result->mean_ns > 0 ? 1e9 / make_result->mean_ns : 0.0;
+    make_result->ops_per_sec_stddev = 0;
+    free_result->ops_per_sec        = free_result->mean_ns > 0 ? 1e9 / free_result->mean_ns : 0.0;
+    free_result->ops_per_sec_stddev = 0;
+
+Done:
+    free(make_samples);
+    free(free_samples);
+    return return_value;
+}
+
+
+/*
+ * Mean allocations per operation. Returns -1 if allocations aren't
+ * being counted.
+ */
+static double allocs_per_op(const struct bench_config *config, bench_op_fn op, void *op_ctx)
+{
+    struct tdv_alloc_counts before;
+    struct tdv_alloc_counts after;
+    unsigned                i;
+
+    if(!config->alloc_counting) {
+        return -1;
+    }
+
+    tdv_alloc_get(&before);
+    for(i = 0; i < BENCH_ALLOC_OPS; i++) {
+        if(op(op_ctx)) {
+            return -1;
+        }
+    }
+    tdv_alloc_get(&after);
+
+    return (double)((after.allocs + after.reallocs) - (before.allocs + before.reallocs)) / BENCH_ALLOC_OPS;
+}
+
+
+/*
+ * The cost of making and freeing a key compared to signing and
+ * verifying with it. This tells when caching keys pays. A verifier
+ * that makes a key per message pays the make + free on every
+ * verification.
+ */
+static int bench_keys(const struct bench_config *config)
+{
+    struct key_op_ctx    key_ctx;
+    struct sign_op_ctx   sign_ctx;
+    struct verify_op_ctx verify_ctx;
+    struct bench_result  key_result;
+    struct bench_result  make_result;
+    struct bench_result  free_result;
+    struct bench_result  sign_result;
+    struct bench_result  verify_result;
+    enum t_cose_err_t    return_value;
+    char                 label[32];
+    const char          *name;
+    size_t               i;
+    size_t               j;
+    int                  errors;
+
+    printf("\n");
+    bench_print_header();
+
+    errors = 0;
+    for(i = 0; i < BENCH_NUM_ALGS; i++) {
+        name = alg_name(bench_algs[i]);
+
+        key_ctx.cose_algorithm_id = bench_algs[i];
+        return_value = bench_run(config, key_op, &key_ctx, &key_result);
+        if(!return_value) {
+            return_value = time_make_and_free(config, bench_algs[i], &make_result, &free_result);
+        }
+        if(!return_value) {
+            /* The built-in key so the corpus message verifies */
+            return_value = tdv_keystore_find(config->keys,
+                                             bench_algs[i],
+                                             TDV_KEYSTORE_BUILTIN,
+                                             1,
+                                             &sign_ctx.key_pair);
+        }
+        if(return_value) {
+            printf("%-24s key set up failed: %d\n", name, return_value);
+            errors++;
+            continue;
+        }
+
+        sign_ctx.cose_algorithm_id = bench_algs[i];
+        verify_ctx.key_pair        = sign_ctx.key_pair;
+        verify_ctx.cose_sign1      = NULL_Q_USEFUL_BUF_C;
+        for(j = 0; j < bench_corpus_count; j++) {
+            if(bench_corpus[j].cose_algorithm_id == bench_algs[i]) {
+                verify_ctx.cose_sign1 = bench_corpus[j].cose_sign1;
+                break;
+            }
+        }
+
+        return_value = bench_run(config, sign_op, &sign_ctx, &sign_result);
+        if(!return_value) {
+            return_value = bench_run(config, verify_op, &verify_ctx, &verify_result);
+        }
+        if(return_value) {
+            printf("%-24s sign / verify failed: %d\n", name, return_value);
+            errors++;
+            continue;
+        }
+
+        snprintf(label, sizeof(label), "%s make key", name);
+        bench_print_result(label, &make_result);
+        snprintf(label, sizeof(label), "%s free key", name);
+        bench_print_result(label, &free_result);
+        snprintf(label, sizeof(label), "%s make + free key", name);
+        bench_print_result(label, &key_result);
+        snprintf(label, sizeof(label), "%s sign", name);
+        bench_print_result(label, &sign_result);
+        snprintf(label, sizeof(label), "%s verify", name);
+        bench_print_result(label, &verify_result);
+
+        printf("%-24s make + free key is %.0f%% of a sign and %.0f%% of a verify\n",
+               "", 100 * key_result.mean_ns / sign_result.mean_ns,
+               100 * key_result.mean_ns / verify_result.mean_ns);
+        if(config->alloc_counting) {
+            printf("%-24s allocations per op: make + free key %.1f, sign %.1f, verify %.1f\n",
+                   "",
+                   allocs_per_op(config, key_op, &key_ctx),
+                   allocs_per_op(config, sign_op, &sign_ctx),
+                   allocs_per_op(config, verify_op, &verify_ctx));
+        } else {
+            printf("%-24s allocations per op: not available for %s crypto\n",
+                   "", tdv_crypto_lib_name());
+        }
+        fflush(stdout);
+    }
+
+    return errors;
+}
+
+
+
+
+/* ------   Hardware counters   ------ */
+
+/*
+ * Mean counts per operation over config->runs * config->iterations
+ * operations after the warm up. The counters are read only before
+ * and after the loop so the read() calls aren't in the counts.
+ */
+static enum t_cose_err_t count_op(const struct bench_config *config,
+                                  const struct tdv_perf     *perf,
+                                  bench_op_fn                op,
+                                  void                      *op_ctx,
+                                  double                     per_op[])
+{
+    struct tdv_perf_counts before;
+    struct tdv_perf_counts after;
+    enum t_cose_err_t      return_value;
+    uint64_t               count;
+    uint64_t               n;
+    int                    c;
+
+    for(n = 0; n < config->warmup; n++) {
+        return_value = op(op_ctx);
+        if(return_value) {
+            return return_value;
+        }
+    }
+
+    count = (uint64_t)config->runs * config->iterations;
+    tdv_perf_read(perf, &before);
+    for(n = 0; n < count; n++) {
+        return_value = op(op_ctx);
+        if(return_value) {
+            return return_value;
+        }
+    }
+    tdv_perf_read(perf, &after);
+
+    for(c = 0; c < TDV_PERF_NUM_COUNTERS; c++) {
+        per_op[c] = (double)(after.value[c] - before.value[c]) / (double)count;
+    }
+    return T_COSE_SUCCESS;
+}
+
+
+static void print_counts(const char *label, const struct tdv_perf *perf, const double per_op[])
+{
+    int c;
+
+    printf("%-24s", label);
+    for(c = 0; c < TDV_PERF_NUM_COUNTERS; c++) {
+        if(tdv_perf_have(perf, (enum tdv_perf_counter)c)) {
+            printf(" %13.1f", per_op[c]);
+        } else {
+            printf(" %13s", "n/a");
+        }
+    }
+    if(tdv_perf_have(perf, TDV_PERF_CYCLES) &&
+       tdv_perf_have(perf, TDV_PERF_INSTRUCTIONS) &&
+       per_op[TDV_PERF_CYCLES] > 0) {
+        printf(" %5.2f", per_op[TDV_PERF_INSTRUCTIONS] / per_op[TDV_PERF_CYCLES]);
+    } else {
+        printf(" %5s", "n/a");
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+
+/*
+ * Hardware counts per sign, verify and key make + free. Instructions
+ * per operation are close to the same from run to run even on a busy
+ * machine, so a regression in libt_cose.a or the crypto library shows
+ * here when it is lost in the noise of the times. Counts are of user
+ * space only, t_cose and the crypto library, not the kernel.
+ */
+static int bench_counters(const struct bench_config *config)
+{
+    struct tdv_perf      perf;
+    struct key_op_ctx    key_ctx;
+    struct sign_op_ctx   sign_ctx;
+    struct verify_op_ctx verify_ctx;
+    enum t_cose_err_t    return_value;
+    double               per_op[TDV_PERF_NUM_COUNTERS];
+    char                 label[32];
+    const char          *name;
+    size_t               i;
+    size_t               j;
+    int                  c;
+    int                  errors;
+
+    if(tdv_perf_open(&perf) == 0) {
+        tdv_perf_close(&perf);
+        printf("\nHardware counters not available; needs Linux with "
+               "perf_event_paranoid of 2 or less and a PMU\n");
+        return 0;
+    }
+
+    printf("\n%-24s", "per op");
+    for(c = 0; c < TDV_PERF_NUM_COUNTERS; c++) {
+        printf(" %13s", tdv_perf_name((enum tdv_perf_counter)c));
+    }
+    printf(" %5s\n", "IPC");
+
+    errors = 0;
+    for(i = 0; i < BENCH_NUM_ALGS; i++) {
+        name = alg_name(bench_algs[i]);
+
+        return_value = tdv_keystore_find(config->keys, bench_algs[i], NULL, 1, &sign_ctx.key_pair);
+        if(!return_value) {
+            return_value = tdv_keystore_find(config->keys,
+                                             bench_algs[i],
+                                             TDV_KEYSTORE_BUILTIN,
+                                             0,
+                                             &verify_ctx.key_pair);
+        }
+        if(return_value) {
+            printf("%-24s no key: %d\n", name, return_value);
+            errors++;
+            continue;
+        }
+        sign_ctx.cose_algorithm_id = bench_algs[i];
+        key_ctx.cose_algorithm_id  = bench_algs[i];
+        verify_ctx.cose_sign1      = NULL_Q_USEFUL_BUF_C;
+        for(j = 0; j < bench_corpus_count; j++) {
+            if(bench_corpus[j].cose_algorithm_id == bench_algs[i]) {
+                verify_ctx.cose_sign1 = bench_corpus[j].cose_sign1;
+                break;
+            }
+        }
+
+        snprintf(label, sizeof(label), "%s sign", name);
+        return_value = count_op(config, &perf, sign_op, &sign_ctx, per_op);
+        if(return_value) {
+            printf("%-24s failed: %d\n", label, return_value);
+            errors++;
+        } else {
+            print_counts(label, &perf, per_op);
+        }
+
+        snprintf(label, sizeof(label), "%s verify", name);
+        return_value = count_op(config, &perf, verify_op, &verify_ctx, per_op);
+        if(return_value) {
+            printf("%-24s failed: %d\n", label, return_value);
+            errors++;
+        } else {
+            print_counts(label, &perf, per_op);
+        }
+
+        snprintf(label, sizeof(label), "%s make + free key", name);
+        return_value = count_op(config, &perf, key_op, &key_ctx, per_op);
+        if(return_value) {
+            printf("%-24s failed: %d\n", label, return_value);
+            errors++;
+        } else {
+            print_counts(label, &perf, per_op);
+        }
+    }
+
+    tdv_perf_close(&perf);
+    return errors;
+}
+
+
+
+
+/* ------   Command line   ------ */
+
+struct bench_mode {
+    const char *name;
+    int       (*run)(const struct bench_config *config);
+    /* Run when no modes are given on the command line */
+    int         is_default;
+    /* Needs the crypto library's allocations counted */
+    int         counts_allocs;
+    const char *description;
+};
+
+static const struct bench_mode bench_modes[] = {
+    {"sign",     bench_sign,     1, 0, "two-step sign, parameters + payload + signature, and prepared"},
+    {"verify",   bench_verify,   1, 0, "verify init + set key + verify of pre-signed messages, and prepared"},
+    {"threads",  bench_threads,  0, 0, "sign and verify throughput on 1..N threads"},
+    {"sweep",    bench_sweep,    0, 0, "one-step vs two-step sign, 16B to 64MB payloads"},
+    {"phases",   bench_phases,   0, 0, "time per phase of two-step sign and verify, hash vs signature"},
+    {"keys",     bench_keys,     0, 1, "key make and free vs sign and verify, with allocations"},
+    {"counters", bench_counters, 0, 0, "cycles, instructions and cache misses per op (Linux perf)"},
+    {"async",    bench_async,    0, 0, "split-phase sign against a simulated 2 ms signer, 1..64 in flight"},
+#ifdef T_COSE_USE_OPENSSL_CRYPTO
+    {"ossl3",    bench_ossl3,    0, 0, "legacy EC_KEY vs EVP_PKEY with pre-fetched algorithms"},
+    {"presig",   bench_presig,   0, 0, "ECDSA sign with k and r made ahead by background threads"},
+#endif
+};
+
+#define BENCH_NUM_MODES (sizeof(bench_modes) / sizeof(bench_modes[0]))
+
+
+static void usage(const char *program)
+{
+    size_t i;
+
+    fprintf(stderr,
+            "Usage: %s [-r runs] [-n iterations] [-w warmup] [-t threads] [-p]\n"
+            "          [-k keyfile ...] [mode ...]\n"
+            "  -r  Timed runs per benchmark, default %d\n"
+            "  -n  Operations per run (per thread for threads), default %d\n"
+            "  -w  Untimed warm up operations, default %d\n"
+            "  -t  Maximum threads for threads, default the number of CPUs\n"
+            "  -p  Pin each thread to its own CPU for threads (Linux only)\n"
+            "  -k  Sign with the key in a PEM, DER or COSE_Key file, up to %d\n"
+            "Modes (those marked * are run if none given):\n",
+            program,
+            BENCH_DEFAULT_RUNS,
+            BENCH_DEFAULT_ITERATIONS,
+            BENCH_DEFAULT_WARMUP,
+            (int)(TDV_KEYSTORE_MAX_KEYS - BENCH_NUM_ALGS));
+    for(i = 0; i < BENCH_NUM_MODES; i++) {
+        fprintf(stderr, "  %-10s %s %s\n",
+                bench_modes[i].name,
+                bench_modes[i].is_default ? "*" : " ",
+                bench_modes[i].description);
+    }
+}
+
+
+static int parse_count(const char *arg, unsigned min, unsigned *count)
+{
+    char          *end;
+    unsigned long  value;
+
+    if(arg == NULL) {
+        return -1;
+    }
+    value = strtoul(arg, &end, 10);
+    if(*end != '\0' || value < min || value > 100000000) {
+        return -1;
+    }
+    *count = (unsigned)value;
+    return 0;
+}
+
+
+int main(int argc, const char * argv[])
+{
+    struct bench_config config;
+    struct tdv_keystore keys;
+    const char         *key_files[TDV_KEYSTORE_MAX_KEYS];
+    size_t              num_key_files;
+    enum t_cose_err_t   return_value;
+    int                 selected[BENCH_NUM_MODES];
+    int                 any_selected;
+    int                 errors;
+    int                 i;
+    size_t              m;
+
+    config.runs           = BENCH_DEFAULT_RUNS;
+    config.iterations     = BENCH_DEFAULT_ITERATIONS;
+    config.warmup         = BENCH_DEFAULT_WARMUP;
+    config.max_threads    = bench_num_cpus();
+    config.pin_cpus       = 0;
+    config.alloc_counting = 0;
+    config.keys           = &keys;
+
+    memset(selected, 0, sizeof(selected));
+    any_selected  = 0;
+    num_key_files = 0;
+
+    for(i = 1; i < argc; i++) {
+        if(!strcmp(argv[i], "-r")) {
+            if(parse_count(argv[++i], 1, &config.runs)) {
+                goto Usage;
+            }
+        } else if(!strcmp(argv[i], "-n")) {
+            if(parse_count(argv[++i], 1, &config.iterations)) {
+                goto Usage;
+            }
+        } else if(!strcmp(argv[i], "-w")) {
+            if(parse_count(argv[++i], 0, &config.warmup)) {
+                goto Usage;
+            }
+        } else if(!strcmp(argv[i], "-t")) {
+            if(parse_count(argv[++i], 1, &config.max_threads)) {
+                goto Usage;
+            }
+        } else if(!strcmp(argv[i], "-p")) {
+            config.pin_cpus = 1;
+        } else if(!strcmp(argv[i], "-k")) {
+            /* Room is left for the built-in keys */
+            if(argv[++i] == NULL ||
+               num_key_files == TDV_KEYSTORE_MAX_KEYS - BENCH_NUM_ALGS) {
+                goto Usage;
+            }
+            key_files[num_key_files++] = argv[i];
+        } else {
+            for(m = 0; m < BENCH_NUM_MODES; m++) {
+                if(!strcmp(argv[i], bench_modes[m].name)) {
+                    break;
+                }
+            }
+            if(m == BENCH_NUM_MODES) {
+                goto Usage;
+            }
+            selected[m]  = 1;
+            any_selected = 1;
+        }
+    }
+
+    /* Allocation counting slows every allocation a little so it is
+     * only turned on for the modes that report it. It has to be
+     * turned on before anything uses the crypto library. */
+    for(m = 0; m < BENCH_NUM_MODES; m++) {
+        if(bench_modes[m].counts_allocs && selected[m]) {
+            config.alloc_counting = !tdv_alloc_hook();
+            break;
+        }
+    }
+
+    /* Keys are loaded after allocation counting is turned on so that
+     * their allocations are counted like those of keys made in the
+     * keys mode. */
+    tdv_keystore_init(&keys);
+    for(m = 0; m < num_key_files; m++) {
+        return_value = tdv_keystore_add_file(&keys, key_files[m], TDV_KEYSTORE_MMAP);
+        if(return_value) {
+            fprintf(stderr, "%s: can't load key: %d\n", key_files[m], return_value);
+            tdv_keystore_free(&keys);
+            return 1;
+        }
+    }
+    return_value = tdv_keystore_add_builtin(&keys);
+    if(return_value) {
+        fprintf(stderr, "can't make built-in keys: %d\n", return_value);
+        tdv_keystore_free(&keys);
+        return 1;
+    }
+
+    printf("t_cose benchmark, %s crypto, %u runs of %u operations\n",
+           tdv_crypto_lib_name(), config.runs, config.iterations);
+
+    errors = 0;
+    for(m = 0; m < BENCH_NUM_MODES; m++) {
+        if(selected[m] || (!any_selected && bench_modes[m].is_default)) {
+            errors += bench_modes[m].run(&config);
+        }
+    }
+
+    tdv_keystore_free(&keys);
+
+    return errors ? 1 : 0;
+
+Usage:
+    usage(argv[0]);
+    return 2;
+}
@@ -0,0 +1,175 @@
+/*
+ * bench.h
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+#ifndef bench_h
+#define bench_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "t_cose/t_cose_common.h"
+
+
+/**
+ * \file bench.h
+ *
+ * \brief Timing and statistics for the tdv benchmark programs.
+ *
+ * An operation to benchmark is a function that performs one complete
+ * operation, for example signing one COSE_Sign1 message. It is run
+ * for a number of runs each of a number of iterations. Every
+ * iteration is timed individually to give the latency distribution
+ * and each run is timed as a whole to give the throughput. The
+ * spread of throughput across the runs is the run-to-run variance.
+ */
+
+
+/**
+ * An operation to benchmark. \c op_ctx is passed through from
+ * bench_run(). Return \ref T_COSE_SUCCESS or the error that stops
+ * the benchmark.
+ */
+typedef enum t_cose_err_t (*bench_op_fn)(void *op_ctx);
+
+
+struct tdv_keystore;
+
+
+/**
+ * How many times to run an operation.
+ */
+struct bench_config {
+    /* Number of timed runs */
+    unsigned runs;
+    /* Number of operations per run */
+    unsigned iterations;
+    /* Number of untimed operations before the first run */
+    unsigned warmup;
+    /* Largest number of threads for the thread scaling sweep */
+    unsigned max_threads;
+    /* Pin thread n to CPU n for the thread scaling sweep */
+    int      pin_cpus;
+    /* The crypto library's allocations are being counted with
+     * tdv_alloc.h */
+    int      alloc_counting;
+    /* Keys to sign and verify with. Shared read-only by all threads. */
+    const struct tdv_keystore *keys;
+};
+
+#define BENCH_DEFAULT_RUNS        5
+#define BENCH_DEFAULT_ITERATIONS  1000
+#define BENCH_DEFAULT_WARMUP      50
+
+
+/**
+ * The results of one benchmark. Times are in nanoseconds.
+ */
+struct bench_result {
+    /* Throughput, mean over all the runs */
+    double   ops_per_sec;
+    /* Run-to-run standard deviation of ops_per_sec */
+    double   ops_per_sec_stddev;
+    /* Latency of a single operation over all runs */
+    double   mean_ns;
+    double   median_ns;
+    double   p90_ns;
+    double   p99_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+    /* Total operations timed, runs * iterations */
+    uint64_t count;
+};
+
+
+/**
+ * \brief Read a monotonic clock.
+ *
+ * \return Nanoseconds from an arbitrary start.
+ */
+uint64_t bench_now_ns(void);
+
+
+/**
+ * \brief Time an operation.
+ *
+ * \param[in] config   Runs, iterations and warmup.
+ * \param[in] op       The operation to time.
+ * \param[in] op_ctx   Passed to \c op on every call.
+ * \param[out] result  The throughput and latency statistics.
+ *
+ * \return \ref T_COSE_ERR_INSUFFICIENT_MEMORY if the latency samples
+ *         can't be allocated or the first error returned by \c op.
+ */
+enum t_cose_err_t bench_run(const struct bench_config *config,
+                            bench_op_fn                op,
+                            void                      *op_ctx,
+                            struct bench_result       *result);
+
+
+/**
+ * \brief Time an operation running concurrently on several threads.
+ *
+ * \param[in] config       Iterations and warmup per thread and pinning.
+ * \param[in] num_threads  Number of threads to run.
+ * \param[in] op           The operation to time.
+ * \param[in] op_ctxs      One context per thread, \c num_threads of them.
+ * \param[out] ops_per_sec Total throughput of all the threads.
+ *
+ * Each thread does \c config->warmup untimed and then
+ * \c config->iterations timed operations. The op must be safe to
+ * call concurrently with a different context on each thread. Only one
+ * run is done; \c config->runs is not used.
+ *
+ * \return The first error from any of the threads.
+ */
+enum t_cose_err_t bench_run_threaded(const struct bench_config *config,
+                                     unsigned                   num_threads,
+                                     bench_op_fn                op,
+                                     void                      *op_ctxs[],
+                                     double                    *ops_per_sec);
+
+
+/**
+ * \brief The number of online CPUs.
+ */
+unsigned bench_num_cpus(void);
+
+
+/**
+ * \brief Compute statistics over latency samples.
+ *
+ * \param[in,out] samples_ns   The samples. These are sorted in place.
+ * \param[in] count            Number of samples.
+ * \param[out] result          The latency fields of this are filled in.
+ *
+ * Only the latency fields and \c count are set. This is for callers
+ * that collect their own samples rather than use bench_run().
+ */
+void bench_latency_stats(uint64_t            *samples_ns,
+                         size_t               count,
+                         struct bench_result *result);
+
+
+/**
+ * \brief Print the column header for bench_print_result().
+ */
+void bench_print_header(void);
+
+
+/**
+ * \brief Print one line of results.
+ *
+ * \param[in] label   Label for the line, e.g., "ES256 sign".
+ * \param[in] result  The results to print.
+ */
+void bench_print_result(const char *label, const struct bench_result *result);
+
+
+#endif /* bench_h */
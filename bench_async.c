@@ -0,0 +1,328 @@
+/*
+ * bench_async.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+/* For clock_gettime() */
+#define _POSIX_C_SOURCE 200809L
+
+#include "t_cose/t_cose_common.h"
+#include "t_cose/t_cose_sign1_verify.h"
+#include "t_cose/q_useful_buf.h"
+
+#include "bench_modes.h"
+#include "tdv_async.h"
+#include "tdv_keystore.h"
+#include "tdv_prepared.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+/**
+ * \file bench_async.c
+ *
+ * \brief Throughput of split-phase signing against a slow signer.
+ *
+ * One thread signs ES256 messages through the simulated signer in
+ * tdv_async.h, which takes ASYNC_LATENCY_US per signature. It keeps
+ * 1, 2, 4, ... up to ASYNC_MAX_DEPTH messages in flight, each with
+ * its own encoder and buffer. When a callback says one has completed
+ * it is finished and another started in its place.
+ *
+ * Depth 1 is the same as blocking in the crypto call. With the
+ * signatures themselves much faster than the latency, throughput
+ * goes up with depth until the signer's threads are busy or the one
+ * signing thread is. The latency of each message from start to
+ * finish is printed too, to show it stays at about the signer's
+ * latency.
+ */
+
+
+#define ASYNC_LATENCY_US     2000
+#define ASYNC_MAX_DEPTH      64
+#define ASYNC_PAYLOAD_SIZE   200
+
+
+struct async_slot {
+    QCBOREncodeContext       cbor_encode;
+    uint8_t                  buffer[ASYNC_PAYLOAD_SIZE + 200];
+    struct tdv_async_request request;
+    uint64_t                 start_ns;
+    int                      in_flight;
+};
+
+
+/* Completions counted by the callback and waited for by the signing
+ * thread */
+struct async_wait {
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    uint64_t        completions;
+};
+
+
+static void async_done(void *done_ctx)
+{
+    struct async_wait *wait = (struct async_wait *)done_ctx;
+
+    pthread_mutex_lock(&wait->mutex);
+    wait->completions++;
+    pthread_cond_signal(&wait->cond);
+    pthread_mutex_unlock(&wait->mutex);
+}
+
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+
+struct async_run {
+    const struct tdv_prepared_signer *signer;
+    struct tdv_async_sim             *sim;
+    struct async_wait                *wait;
+    struct q_useful_buf_c             payload;
+};
+
+
+/*
+ * Encode the start of a message and submit it.
+ */
+static enum t_cose_err_t start_message(const struct async_run *run, struct async_slot *slot)
+{
+    enum t_cose_err_t return_value;
+
+    QCBOREncode_Init(&slot->cbor_encode, (struct q_useful_buf){slot->buffer, sizeof(slot->buffer)});
+    tdv_prepared_encode_parameters(run->signer, &slot->cbor_encode);
+    QCBOREncode_AddBytes(&slot->cbor_encode, run->payload);
+
+    slot->start_ns = now_ns();
+    return_value = tdv_async_sign_start(run->signer,
+                                        &slot->cbor_encode,
+                                        tdv_async_sim_submit,
+                                        run->sim,
+                                        async_done,
+                                        run->wait,
+                                        &slot->request);
+    slot->in_flight = return_value == T_COSE_SUCCESS;
+
+    return return_value;
+}
+
+
+/*
+ * Sign count messages keeping depth in flight. The latency of each
+ * is put in samples_ns and the last message made in last.
+ */
+static enum t_cose_err_t run_depth(const struct async_run *run,
+                                   struct async_slot      *slots,
+                                   unsigned                depth,
+                                   unsigned                count,
+                                   uint64_t               *samples_ns,
+                                   struct q_useful_buf_c  *last)
+{
+    enum t_cose_err_t return_value = T_COSE_SUCCESS;
+    unsigned          started;
+    unsigned          finished;
+    unsigned          i;
+    uint64_t          consumed;
+
+    pthread_mutex_lock(&run->wait->mutex);
+    run->wait->completions = 0;
+    pthread_mutex_unlock(&run->wait->mutex);
+    consumed = 0;
+
+    started = 0;
+    for(i = 0; i < depth && started < count; i++) {
+        return_value = start_message(run, &slots[i]);
+        if(return_value) {
+            goto Done;
+        }
+        started++;
+    }
+
+    finished = 0;
+    while(finished < count) {
+        /* A completion whose callback hasn't come yet may have been
+         * finished already, so wait only while none are new */
+        pthread_mutex_lock(&run->wait->mutex);
+        while(run->wait->completions <= consumed) {
+            pthread_cond_wait(&run->wait->cond, &run->wait->mutex);
+        }
+        pthread_mutex_unlock(&run->wait->mutex);
+
+        for(i = 0; i < depth; i++) {
+            if(!slots[i].in_flight || !tdv_async_is_done(&slots[i].request)) {
+                continue;
+            }
+            slots[i].in_flight = 0;
+            consumed++;
+
+            return_value = tdv_async_sign_finish(&slots[i].request, &slots[i].cbor_encode);
+            if(return_value == T_COSE_SUCCESS &&
+               QCBOREncode_Finish(&slots[i].cbor_encode, last)) {
+                return_value = T_COSE_ERR_CBOR_FORMATTING;
+            }
+            if(return_value) {
+                goto Done;
+            }
+            samples_ns[finished++] = now_ns() - slots[i].start_ns;
+
+            if(started < count) {
+                return_value = start_message(run, &slots[i]);
+                if(return_value) {
+                    goto Done;
+                }
+                started++;
+            }
+        }
+    }
+
+Done:
+    /* Wait for the callback of every message started, not just for
+     * them to be done, so none comes late and is counted in the next
+     * run. Then the slots can be reused too. */
+    pthread_mutex_lock(&run->wait->mutex);
+    while(run->wait->completions < started) {
+        pthread_cond_wait(&run->wait->cond, &run->wait->mutex);
+    }
+    pthread_mutex_unlock(&run->wait->mutex);
+    for(i = 0; i < depth; i++) {
+        slots[i].in_flight = 0;
+    }
+    return return_value;
+}
+
+
+static enum t_cose_err_t check_signed(struct t_cose_key key_pair, struct q_useful_buf_c cose_sign1)
+{
+    struct t_cose_sign1_verify_ctx verify_ctx;
+    struct q_useful_buf_c          payload;
+
+    t_cose_sign1_verify_init(&verify_ctx, 0);
+    t_cose_sign1_set_verification_key(&verify_ctx, key_pair);
+
+    return t_cose_sign1_verify(&verify_ctx, cose_sign1, &payload, NULL);
+}
+
+
+/*
+ * Public function. See bench_modes.h
+ */
+int bench_async(const struct bench_config *config)
+{
+    struct tdv_prepared_signer signer;
+    struct tdv_async_sim       sim;
+    struct async_wait          wait;
+    struct async_run           run;
+    struct async_slot         *slots = NULL;
+    uint64_t                  *samples_ns = NULL;
+    struct t_cose_key          key_pair;
+    struct bench_result        result;
+    struct q_useful_buf_c      last;
+    enum t_cose_err_t          return_value;
+    uint8_t                    payload[ASYNC_PAYLOAD_SIZE];
+    unsigned                   num_threads;
+    unsigned                   count;
+    unsigned                   depth;
+    uint64_t                   start_ns;
+    double                     ops_per_sec;
+    double                     depth_1_ops_per_sec;
+    int                        errors;
+
+    num_threads = bench_num_cpus();
+    if(num_threads > TDV_ASYNC_SIM_MAX_THREADS) {
+        num_threads = TDV_ASYNC_SIM_MAX_THREADS;
+    }
+    count = config->iterations < ASYNC_MAX_DEPTH ? ASYNC_MAX_DEPTH : config->iterations;
+
+    printf("\nES256 split-phase sign, %u us simulated signer latency, %u signer threads, %u messages per depth\n",
+           ASYNC_LATENCY_US, num_threads, count);
+
+    return_value = tdv_keystore_find(config->keys, T_COSE_ALGORITHM_ES256, NULL, 1, &key_pair);
+    if(return_value) {
+        printf("async: no key: %d\n", return_value);
+        return 1;
+    }
+    return_value = tdv_prepared_signer_init(&signer, 0, T_COSE_ALGORITHM_ES256, key_pair, NULL_Q_USEFUL_BUF_C);
+    if(return_value) {
+        printf("async: prepared signer failed: %d\n", return_value);
+        return 1;
+    }
+
+    errors = 0;
+    slots      = calloc(ASYNC_MAX_DEPTH, sizeof(struct async_slot));
+    samples_ns = calloc(count, sizeof(uint64_t));
+    if(slots == NULL || samples_ns == NULL) {
+        printf("async: out of memory\n");
+        errors++;
+        goto Done;
+    }
+
+    return_value = tdv_async_sim_start(&sim, ASYNC_LATENCY_US, num_threads);
+    if(return_value) {
+        printf("async: simulated signer failed: %d\n", return_value);
+        errors++;
+        goto Done;
+    }
+    pthread_mutex_init(&wait.mutex, NULL);
+    pthread_cond_init(&wait.cond, NULL);
+
+    memset(payload, 'x', sizeof(payload));
+    run.signer  = &signer;
+    run.sim     = &sim;
+    run.wait    = &wait;
+    run.payload = (struct q_useful_buf_c){payload, sizeof(payload)};
+
+    printf("%-8s %12s %9s %10s %10s %10s\n",
+           "depth", "msgs/s", "speedup", "mean ms", "median ms", "p99 ms");
+
+    depth_1_ops_per_sec = 0;
+    for(depth = 1; depth <= ASYNC_MAX_DEPTH; depth *= 2) {
+        start_ns = now_ns();
+        return_value = run_depth(&run, slots, depth, count, samples_ns, &last);
+        if(return_value == T_COSE_SUCCESS) {
+            ops_per_sec = (double)count * 1e9 / (double)(now_ns() - start_ns);
+            return_value = check_signed(key_pair, last);
+        }
+        if(return_value) {
+            printf("%-8u failed: %d\n", depth, return_value);
+            errors++;
+            break;
+        }
+        if(depth == 1) {
+            depth_1_ops_per_sec = ops_per_sec;
+        }
+
+        bench_latency_stats(samples_ns, count, &result);
+        printf("%-8u %12.1f %8.1fx %10.3f %10.3f %10.3f\n",
+               depth,
+               ops_per_sec,
+               depth_1_ops_per_sec > 0 ? ops_per_sec / depth_1_ops_per_sec : 0.0,
+               result.mean_ns / 1e6,
+               result.median_ns / 1e6,
+               result.p99_ns / 1e6);
+    }
+
+    tdv_async_sim_stop(&sim);
+    pthread_mutex_destroy(&wait.mutex);
+    pthread_cond_destroy(&wait.cond);
+
+Done:
+    free(slots);
+    free(samples_ns);
+    tdv_prepared_signer_free(&signer);
+    return errors;
+}
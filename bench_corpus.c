@@ -0,0 +1,565 @@
+/*
+ * bench_corpus.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+
+/**
+ * \file bench_corpus.c
+ *
+ * \brief Pre-signed COSE_Sign1 messages. See bench_corpus.h.
+ *
+ * There are four messages per algorithm with different payloads: the
+ * example map that two_step_sign_example() makes, a small text
+ * string, an EAT-like token with integer labels and 1KB of opaque
+ * bytes. The payload sizes cover small attestation tokens through
+ * small documents.
+ *
+ * ECDSA signatures are randomized so these messages will not compare
+ * equal to a message freshly signed by t_cose, but they verify the
+ * same.
+ */
+
+#include "bench_corpus.h"
+
+
+/* example map from two_step_sign_example(), 172 bytes */
+static const uint8_t cose_sign1_es256_example[] = {
+    0xd2, 0x84, 0x43, 0xa1, 0x01, 0x26, 0xa0, 0x58, 0x61, 0xa6, 0x69, 0x42,
+    0x65, 0x69, 0x6e, 0x67, 0x54, 0x79, 0x70, 0x65, 0x68, 0x48, 0x75, 0x6d,
+    0x61, 0x6e, 0x6f, 0x69, 0x64, 0x68, 0x47, 0x72, 0x65, 0x65, 0x74, 0x69,
+    0x6e, 0x67, 0x70, 0x57, 0x65, 0x20, 0x63, 0x6f, 0x6d, 0x65, 0x20, 0x69,
+    0x6e, 0x20, 0x70, 0x65, 0x61, 0x63, 0x65, 0x68, 0x41, 0x72, 0x6d, 0x43,
+    0x6f, 0x75, 0x6e, 0x74, 0x02, 0x69, 0x48, 0x65, 0x61, 0x64, 0x43, 0x6f,
+    0x75, 0x6e, 0x74, 0x01, 0x69, 0x42, 0x72, 0x61, 0x69, 0x6e, 0x53, 0x69,
+    0x7a, 0x65, 0x66, 0x6d, 0x65, 0x64, 0x69, 0x75, 0x6d, 0x6b, 0x44, 0x72,
+    0x69, 0x6e, 0x6b, 0x73, 0x57, 0x61, 0x74, 0x65, 0x72, 0xf5, 0x58, 0x40,
+    0x48, 0x21, 0xa9, 0x54, 0x4f, 0x36, 0x48, 0x70, 0x3e, 0x59, 0x8a, 0x80,
+    0xc5, 0xa9, 0x30, 0x72, 0x6f, 0xa8, 0xaf, 0x6a, 0x39, 0xe8, 0x34, 0x4d,
+    0x0f, 0x69, 0xa5, 0x50, 0x50, 0x29, 0xc3, 0x94, 0xb5, 0xee, 0xf3, 0x18,
+    0x23, 0x4d, 0x14, 0x62, 0x3b, 0x0a, 0x49, 0xe3, 0x21, 0x06, 0xc1, 0x6b,
+    0x7c, 0x1c, 0xd3, 0x8f, 0xda, 0xf0, 0x58, 0x23, 0x88, 0x0e, 0x77, 0x14,
+    0xaf, 0x45, 0x55, 0xa3
+};
+
+/* small text string, 80 bytes */
+static const uint8_t cose_sign1_es256_small[] = {
+    0xd2, 0x84, 0x43, 0xa1, 0x01, 0x26, 0xa0, 0x46, 0x65, 0x68, 0x65, 0x6c,
+    0x6c, 0x6f, 0x58, 0x40, 0x00, 0xc2, 0x3b, 0x69, 0xdd, 0x4c, 0x38, 0x4f,
+    0xe8, 0x8e, 0xc4, 0xfa, 0x0c, 0x50, 0x54, 0x56, 0x68, 0x26, 0x55, 0x3e,
+    0xa5, 0x65, 0x91, 0x8f, 0x8d, 0xdc, 0x3a, 0xdc, 0xdb, 0x15, 0xd6, 0xad,
+    0x32, 0xc7, 0x9d, 0x95, 0xbb, 0xb3, 0x79, 0x98, 0x94, 0xa7, 0x15, 0x09,
+    0x43, 0xc1, 0xdb, 0x37, 0xe5, 0xab, 0x10, 0x31, 0x61, 0xca, 0xe0, 0xbd,
+    0x98, 0x22, 0x5e, 0x54, 0x1c, 0x0a, 0xfa, 0x7f
+};
+
+/* EAT-like token, 277 bytes */
+static const uint8_t cose_sign1_es256_eat[] = {
+    0xd2, 0x84, 0x43, 0xa1, 0x01, 0x26, 0xa0, 0x58, 0xca, 0xa6, 0x0a, 0x58,
+    0x20, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a,
+    0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16,
+    0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x19, 0x01, 0x00,
+    0x50, 0x01, 0x98, 0xf5, 0x0a, 0x4f, 0xf6, 0xc0, 0x58, 0x61, 0xc8, 0x86,
+    0x0d, 0x13, 0xa6, 0x38, 0xea, 0x3a, 0x00, 0x01, 0x24, 0xf7, 0x78, 0x19,
+    0x61, 0x63, 0x6d, 0x65, 0x2d, 0x73, 0x65, 0x63, 0x75, 0x72, 0x65, 0x2d,
+    0x65, 0x6c, 0x65, 0x6d, 0x65, 0x6e, 0x74, 0x2d, 0x72, 0x65, 0x76, 0x2d,
+    0x34, 0x06, 0x1a, 0x63, 0x4c, 0x9b, 0x00, 0x3a, 0x00, 0x01, 0x24, 0xf8,
+    0x58, 0x40, 0x00, 0x07, 0x0e, 0x15, 0x1c, 0x23, 0x2a, 0x31, 0x38, 0x3f,
+    0x46, 0x4d, 0x54, 0x5b, 0x62, 0x69, 0x70, 0x77, 0x7e, 0x85, 0x8c, 0x93,
+    0x9a, 0xa1, 0xa8, 0xaf, 0xb6, 0xbd, 0xc4, 0xcb, 0xd2, 0xd9, 0xe0, 0xe7,
+    0xee, 0xf5, 0xfc, 0x03, 0x0a, 0x11, 0x18, 0x1f, 0x26, 0x2d, 0x34, 0x3b,
+    0x42, 0x49, 0x50, 0x57, 0x5e, 0x65, 0x6c, 0x73, 0x7a, 0x81, 0x88, 0x8f,
+    0x96, 0x9d, 0xa4, 0xab, 0xb2, 0xb9, 0x3a, 0x00, 0x01, 0x24, 0xf9, 0x78,
+    0x1e, 0x66, 0x69, 0x72, 0x6d, 0x77, 0x61, 0x72, 0x65, 0x20, 0x32, 0x2e,
+    0x31, 0x33, 0x2e, 0x37, 0x20, 0x62, 0x75, 0x69, 0x6c, 0x64, 0x20, 0x32,
+    0x30, 0x32, 0x32, 0x31, 0x30, 0x31, 0x37, 0x58, 0x40, 0x06, 0xa3, 0xa6,
+    0x2a, 0x90, 0xb5, 0xed, 0xd5, 0x0f, 0xc3, 0xd9, 0x0b, 0x17, 0xc9, 0x09,
+    0xe6, 0xb6, 0x15, 0xeb, 0xf7, 0xc3, 0xb8, 0x38, 0xb4, 0x2a, 0xca, 0x1b,
+    0x53, 0x67, 0xeb, 0x80, 0x7f, 0xb0, 0xbe, 0x4c, 0xba, 0xa8, 0xb6, 0x84,
+    0x7c, 0x49, 0xaa, 0x46, 0xf7, 0xc1, 0xe6, 0x0f, 0x8a, 0xcf, 0xd7, 0x70,
+    0x03, 0x7c, 0x69, 0x42, 0x75, 0xf9, 0xca, 0x21, 0x5f, 0xa0, 0x12, 0x52,
+    0x18
+};
+
+/* 1KB opaque payload, 1100 bytes */
+static const uint8_t cose_sign1_es256_1k[] = {
+    0xd2, 0x84, 0x43, 0xa1, 0x01, 0x26, 0xa0, 0x59, 0x04, 0x00, 0x07, 0x26,
+    0x45, 0x64, 0x83, 0xa2, 0xc1, 0xe0, 0xff, 0x1e, 0x3d, 0x5c, 0x7b, 0x9a,
+    0xb9, 0xd8, 0xf7, 0x16, 0x35, 0x54, 0x73, 0x92, 0xb1, 0xd0, 0xef, 0x0e,
+    0x2d, 0x4c, 0x6b, 0x8a, 0xa9, 0xc8, 0xe7, 0x06, 0x25, 0x44, 0x63, 0x82,
+    0xa1, 0xc0, 0xdf, 0xfe, 0x1d, 0x3c, 0x5b, 0x7a, 0x99, 0xb8, 0xd7, 0xf6,
+    0x15, 0x34, 0x53, 0x72, 0x91, 0xb0, 0xcf, 0xee, 0x0d, 0x2c, 0x4b, 0x6a,
+    0x89, 0xa8, 0xc7, 0xe6, 0x05, 0x24, 0x43, 0x62, 0x81, 0xa0, 0xbf, 0xde,
+    0xfd, 0x1c, 0x3b, 0x5a, 0x79, 0x98, 0xb7, 0xd6, 0xf5, 0x14, 0x33, 0x52,
+    0x71, 0x90, 0xaf, 0xce, 0xed, 0x0c, 0x2b, 0x4a, 0x69, 0x88, 0xa7, 0xc6,
+    0xe5, 0x04, 0x23, 0x42, 0x61, 0x80, 0x9f, 0xbe, 0xdd, 0xfc, 0x1b, 0x3a,
+    0x59, 0x78, 0x97, 0xb6, 0xd5, 0xf4, 0x13, 0x32, 0x51, 0x70, 0x8f, 0xae,
+    0xcd, 0xec, 0x0b, 0x2a, 0x49, 0x68, 0x87, 0xa6, 0xc5, 0xe4, 0x03, 0x22,
+    0x41, 0x60, 0x7f, 0x9e, 0xbd, 0xdc, 0xfb, 0x1a, 0x39, 0x58, 0x77, 0x96,
+    0xb5, 0xd4, 0xf3, 0x12, 0x31, 0x50, 0x6f, 0x8e, 0xad, 0xcc, 0xeb, 0x0a,
+    0x29, 0x48, 0x67, 0x86, 0xa5, 0xc4, 0xe3, 0x02, 0x21, 0x40, 0x5f, 0x7e,
+    0x9d, 0xbc, 0xdb, 0xfa, 0x19, 0x38, 0x57, 0x76, 0x95, 0xb4, 0xd3, 0xf2,
+    0x11, 0x30, 0x4f, 0x6e, 0x8d, 0xac, 0xcb, 0xea, 0x09, 0x28, 0x47, 0x66,
+    0x85, 0xa4, 0xc3, 0xe2, 0x01, 0x20, 0x3f, 0x5e, 0x7d, 0x9c, 0xbb, 0xda,
+    0xf9, 0x18, 0x37, 0x56, 0x75, 0x94, 0xb3, 0xd2, 0xf1, 0x10, 0x2f, 0x4e,
+    0x6d, 0x8c, 0xab, 0xca, 0xe9, 0x08, 0x27, 0x46, 0x65, 0x84, 0xa3, 0xc2,
+    0xe1, 0x00, 0x1f, 0x3e, 0x5d, 0x7c, 0x9b, 0xba, 0xd9, 0xf8, 0x17, 0x36,
+    0x55, 0x74, 0x93, 0xb2, 0xd1, 0xf0, 0x0f, 0x2e, 0x4d, 0x6c, 0x8b, 0xaa,
+    0xc9, 0xe8, 0x07, 0x26, 0x45, 0x64, 0x83, 0xa2, 0xc1, 0xe0, 0xff, 0x1e,
+    0x3d, 0x5c, 0x7b, 0x9a, 0xb9, 0xd8, 0xf7, 0x16, 0x35, 0x54, 0x73, 0x92,
+    0xb1, 0xd0, 0xef, 0x0e, 0x2d, 0x4c, 0x6b, 0x8a, 0xa9, 0xc8, 0xe7, 0x06,
+    0x25, 0x44, 0x63, 0x82, 0xa1, 0xc0, 0xdf, 0xfe, 0x1d, 0x3c, 0x5b, 0x7a,
+    0x99, 0xb8, 0xd7, 0xf6, 0x15, 0x34, 0x53, 0x72, 0x91, 0xb0, 0xcf, 0xee,
+    0x0d, 0x2c, 0x4b, 0x6a, 0x89, 0xa8, 0xc7, 0xe6, 0x05, 0x24, 0x43, 0x62,
+    0x81, 0xa0, 0xbf, 0xde, 0xfd, 0x1c, 0x3b, 0x5a, 0x79, 0x98, 0xb7, 0xd6,
+    0xf5, 0x14, 0x33, 0x52, 0x71, 0x90, 0xaf, 0xce, 0xed, 0x0c, 0x2b, 0x4a,
+    0x69, 0x88, 0xa7, 0xc6, 0xe5, 0x04, 0x23, 0x42, 0x61, 0x80, 0x9f, 0xbe,
+    0xdd, 0xfc, 0x1b, 0x3a, 0x59, 0x78, 0x97, 0xb6, 0xd5, 0xf4, 0x13, 0x32,
+    0x51, 0x70, 0x8f, 0xae, 0xcd, 0xec, 0x0b, 0x2a, 0x49, 0x68, 0x87, 0xa6,
+    0xc5, 0xe4, 0x03, 0x22, 0x41, 0x60, 0x7f, 0x9e, 0xbd, 0xdc, 0xfb, 0x1a,
+    0x39, 0x58, 0x77, 0x96, 0xb5, 0xd4, 0xf3, 0x12, 0x31, 0x50, 0x6f, 0x8e,
+    0xad, 0xcc, 0xeb, 0x0a, 0x29, 0x48, 0x67, 0x86, 0xa5, 0xc4, 0xe3, 0x02,
+    0x21, 0x40, 0x5f, 0x7e, 0x9d, 0xbc, 0xdb, 0xfa, 0x19, 0x38, 0x57, 0x76,
+    0x95, 0xb4, 0xd3, 0xf2, 0x11, 0x30, 0x4f, 0x6e, 0x8d, 0xac, 0xcb, 0xea,
+    0x09, 0x28, 0x47, 0x66, 0x85, 0xa4, 0xc3, 0xe2, 0x01, 0x20, 0x3f, 0x5e,
+    0x7d, 0x9c, 0xbb, 0xda, 0xf9, 0x18, 0x37, 0x56, 0x75, 0x94, 0xb3, 0xd2,
+    0xf1, 0x10, 0x2f, 0x4e, 0x6d, 0x8c, 0xab, 0xca, 0xe9, 0x08, 0x27, 0x46,
+    0x65, 0x84, 0xa3, 0xc2, 0xe1, 0x00, 0x1f, 0x3e, 0x5d, 0x7c, 0x9b, 0xba,
+    0xd9, 0xf8, 0x17, 0x36, 0x55, 0x74, 0x93, 0xb2, 0xd1, 0xf0, 0x0f, 0x2e,
+    0x4d, 0x6c, 0x8b, 0xaa, 0xc9, 0xe8, 0x07, 0x26, 0x45, 0x64, 0x83, 0xa2,
+    0xc1, 0xe0, 0xff, 0x1e, 0x3d, 0x5c, 0x7b, 0x9a, 0xb9, 0xd8, 0xf7, 0x16,
+    0x35, 0x54, 0x73, 0x92, 0xb1, 0xd0, 0xef, 0x0e, 0x2d, 0x4c, 0x6b, 0x8a,
+    0xa9, 0xc8, 0xe7, 0x06, 0x25, 0x44, 0x63, 0x82, 0xa1, 0xc0, 0xdf, 0xfe,
+    0x1d, 0x3c, 0x5b, 0x7a, 0x99, 0xb8, 0xd7, 0xf6, 0x15, 0x34, 0x53, 0x72,
+    0x91, 0xb0, 0xcf, 0xee, 0x0d, 0x2c, 0x4b, 0x6a, 0x89, 0xa8, 0xc7, 0xe6,
+    0x05, 0x24, 0x43, 0x62, 0x81, 0xa0, 0xbf, 0xde, 0xfd, 0x1c, 0x3b, 0x5a,
+    0x79, 0x98, 0xb7, 0xd6, 0xf5, 0x14, 0x33, 0x52, 0x71, 0x90, 0xaf, 0xce,
+    0xed, 0x0c, 0x2b, 0x4a, 0x69, 0x88, 0xa7, 0xc6, 0xe5, 0x04, 0x23, 0x42,
+    0x61, 0x80, 0x9f, 0xbe, 0xdd, 0xfc, 0x1b, 0x3a, 0x59, 0x78, 0x97, 0xb6,
+    0xd5, 0xf4, 0x13, 0x32, 0x51, 0x70, 0x8f, 0xae, 0xcd, 0xec, 0x0b, 0x2a,
+    0x49, 0x68, 0x87, 0xa6, 0xc5, 0xe4, 0x03, 0x22, 0x41, 0x60, 0x7f, 0x9e,
+    0xbd, 0xdc, 0xfb, 0x1a, 0x39, 0x58, 0x77, 0x96, 0xb5, 0xd4, 0xf3, 0x12,
+    0x31, 0x50, 0x6f, 0x8e, 0xad, 0xcc, 0xeb, 0x0a, 0x29, 0x48, 0x67, 0x86,
+    0xa5, 0xc4, 0xe3, 0x02, 0x21, 0x40, 0x5f, 0x7e, 0x9d, 0xbc, 0xdb, 0xfa,
+    0x19, 0x38, 0x57, 0x76, 0x95, 0xb4, 0xd3, 0xf2, 0x11, 0x30, 0x4f, 0x6e,
+    0x8d, 0xac, 0xcb, 0xea, 0x09, 0x28, 0x47, 0x66, 0x85, 0xa4, 0xc3, 0xe2,
+    0x01, 0x20, 0x3f, 0x5e, 0x7d, 0x9c, 0xbb, 0xda, 0xf9, 0x18, 0x37, 0x56,
+    0x75, 0x94, 0xb3, 0xd2, 0xf1, 0x10, 0x2f, 0x4e, 0x6d, 0x8c, 0xab, 0xca,
+    0xe9, 0x08, 0x27, 0x46, 0x65, 0x84, 0xa3, 0xc2, 0xe1, 0x00, 0x1f, 0x3e,
+    0x5d, 0x7c, 0x9b, 0xba, 0xd9, 0xf8, 0x17, 0x36, 0x55, 0x74, 0x93, 0xb2,
+    0xd1, 0xf0, 0x0f, 0x2e, 0x4d, 0x6c, 0x8b, 0xaa, 0xc9, 0xe8, 0x07, 0x26,
+    0x45, 0x64, 0x83, 0xa2, 0xc1, 0xe0, 0xff, 0x1e, 0x3d, 0x5c, 0x7b, 0x9a,
+    0xb9, 0xd8, 0xf7, 0x16, 0x35, 0x54, 0x73, 0x92, 0xb1, 0xd0, 0xef, 0x0e,
+    0x2d, 0x4c, 0x6b, 0x8a, 0xa9, 0xc8, 0xe7, 0x06, 0x25, 0x44, 0x63, 0x82,
+    0xa1, 0xc0, 0xdf, 0xfe, 0x1d, 0x3c, 0x5b, 0x7a, 0x99, 0xb8, 0xd7, 0xf6,
+    0x15, 0x34, 0x53, 0x72, 0x91, 0xb0, 0xcf, 0xee, 0x0d, 0x2c, 0x4b, 0x6a,
+    0x89, 0xa8, 0xc7, 0xe6, 0x05, 0x24, 0x43, 0x62, 0x81, 0xa0, 0xbf, 0xde,
+    0xfd, 0x1c, 0x3b, 0x5a, 0x79, 0x98, 0xb7, 0xd6, 0xf5, 0x14, 0x33, 0x52,
+    0x71, 0x90, 0xaf, 0xce, 0xed, 0x0c, 0x2b, 0x4a, 0x69, 0x88, 0xa7, 0xc6,
+    0xe5, 0x04, 0x23, 0x42, 0x61, 0x80, 0x9f, 0xbe, 0xdd, 0xfc, 0x1b, 0x3a,
+    0x59, 0x78, 0x97, 0xb6, 0xd5, 0xf4, 0x13, 0x32, 0x51, 0x70, 0x8f, 0xae,
+    0xcd, 0xec, 0x0b, 0x2a, 0x49, 0x68, 0x87, 0xa6, 0xc5, 0xe4, 0x03, 0x22,
+    0x41, 0x60, 0x7f, 0x9e, 0xbd, 0xdc, 0xfb, 0x1a, 0x39, 0x58, 0x77, 0x96,
+    0xb5, 0xd4, 0xf3, 0x12, 0x31, 0x50, 0x6f, 0x8e, 0xad, 0xcc, 0xeb, 0x0a,
+    0x29, 0x48, 0x67, 0x86, 0xa5, 0xc4, 0xe3, 0x02, 0x21, 0x40, 0x5f, 0x7e,
+    0x9d, 0xbc, 0xdb, 0xfa, 0x19, 0x38, 0x57, 0x76, 0x95, 0xb4, 0xd3, 0xf2,
+    0x11, 0x30, 0x4f, 0x6e, 0x8d, 0xac, 0xcb, 0xea, 0x09, 0x28, 0x47, 0x66,
+    0x85, 0xa4, 0xc3, 0xe2, 0x01, 0x20, 0x3f, 0x5e, 0x7d, 0x9c, 0xbb, 0xda,
+    0xf9, 0x18, 0x37, 0x56, 0x75, 0x94, 0xb3, 0xd2, 0xf1, 0x10, 0x2f, 0x4e,
+    0x6d, 0x8c, 0xab, 0xca, 0xe9, 0x08, 0x27, 0x46, 0x65, 0x84, 0xa3, 0xc2,
+    0xe1, 0x00, 0x1f, 0x3e, 0x5d, 0x7c, 0x9b, 0xba, 0xd9, 0xf8, 0x17, 0x36,
+    0x55, 0x74, 0x93, 0xb2, 0xd1, 0xf0, 0x0f, 0x2e, 0x4d, 0x6c, 0x8b, 0xaa,
+    0xc9, 0xe8, 0x58, 0x40, 0xb2, 0x17, 0x0d, 0xc5, 0xd3, 0x25, 0x23, 0x2d,
+    0xe7, 0x7a, 0xba, 0xe0, 0xaf, 0xbf, 0x04, 0x96, 0xb5, 0x09, 0x57, 0xcd,
+    0xaa, 0x9b, 0x18, 0xd1, 0x5e, 0xab, 0x44, 0x1b, 0x6a, 0xc7, 0x3b, 0xcb,
+    0xad, 0x63, 0x81, 0x0a, 0x63, 0xcb, 0xfa, 0x5e, 0xfa, 0x2b, 0x53, 0x58,
+    0xe7, 0xe8, 0xb6, 0xec, 0x1e, 0x36, 0xe8, 0xf3, 0x49, 0x83, 0xaf, 0xf6,
+    0x2f, 0xea, 0x7e, 0x57, 0x9e, 0x85, 0x77, 0x99
+};
+
+
+#ifndef T_COSE_DISABLE_ES384
+/* example map from two_step_sign_example(), 205 bytes */
+static const uint8_t cose_sign1_es384_example[] = {
+    0xd2, 0x84, 0x44, 0xa1, 0x01, 0x38, 0x22, 0xa0, 0x58, 0x61, 0xa6, 0x69,
+    0x42, 0x65, 0x69, 0x6e, 0x67, 0x54, 0x79, 0x70, 0x65, 0x68, 0x48, 0x75,
+    0x6d, 0x61, 0x6e, 0x6f, 0x69, 0x64, 0x68, 0x47, 0x72, 0x65, 0x65, 0x74,
+    0x69, 0x6e, 0x67, 0x70, 0x57, 0x65, 0x20, 0x63, 0x6f, 0x6d, 0x65, 0x20,
+    0x69, 0x6e, 0x20, 0x70, 0x65, 0x61, 0x63, 0x65, 0x68, 0x41, 0x72, 0x6d,
+    0x43, 0x6f, 0x75, 0x6e, 0x74, 0x02, 0x69, 0x48, 0x65, 0x61, 0x64, 0x43,
+    0x6f, 0x75, 0x6e, 0x74, 0x01, 0x69, 0x42, 0x72, 0x61, 0x69, 0x6e, 0x53,
+    0x69, 0x7a, 0x65, 0x66, 0x6d, 0x65, 0x64, 0x69, 0x75, 0x6d, 0x6b, 0x44,
+    0x72, 0x69, 0x6e, 0x6b, 0x73, 0x57, 0x61, 0x74, 0x65, 0x72, 0xf5, 0x58,
+    0x60, 0x5b, 0xad, 0xa9, 0x17, 0xd6, 0x08, 0x9a, 0x09, 0x7a, 0x85, 0xcb,
+    0xc0, 0xb0, 0xcb, 0xd6, 0x60, 0x63, 0xd7, 0x1a, 0xdc, 0xb3, 0xa5, 0x97,
+    0x74, 0xb7, 0x21, 0x3c, 0x81, 0xbd, 0x3d, 0xb6, 0x56, 0xd6, 0x20, 0x04,
+    0x5e, 0x1e, 0x75, 0xe6, 0xf6, 0xfc, 0x34, 0xd9, 0x20, 0xa9, 0x5b, 0xa3,
+    0x98, 0xfe, 0xbc, 0xf7, 0x85, 0x92, 0xc5, 0x87, 0x23, 0xdf, 0xa9, 0x7f,
+    0xf1, 0x4a, 0x31, 0x9f, 0x99, 0xee, 0x58, 0x72, 0x43, 0xce, 0x03, 0xc1,
+    0x27, 0x60, 0x36, 0xbd, 0x40, 0x74, 0x52, 0xf9, 0x7e, 0xb0, 0xa5, 0x62,
+    0xcc, 0xa5, 0xcf, 0xdc, 0xa7, 0xb9, 0xa9, 0xd7, 0xaf, 0x54, 0x08, 0x94,
+    0x67
+};
+
+/* small text string, 113 bytes */
+static const uint8_t cose_sign1_es384_small[] = {
+    0xd2, 0x84, 0x44, 0xa1, 0x01, 0x38, 0x22, 0xa0, 0x46, 0x65, 0x68, 0x65,
+    0x6c, 0x6c, 0x6f, 0x58, 0x60, 0x8e, 0x93, 0x32, 0x44, 0x2c, 0x8a, 0x8e,
+    0x61, 0x61, 0x55, 0x45, 0xa9, 0x4b, 0x5c, 0x34, 0x01, 0x72, 0xd9, 0x6e,
+    0x94, 0xe2, 0xa5, 0x7a, 0x19, 0x13, 0x7a, 0xca, 0x92, 0x3f, 0xf9, 0x62,
+    0xf2, 0xf5, 0x7a, 0x23, 0xee, 0xfe, 0x24, 0x86, 0xc7, 0x27, 0xa2, 0x5c,
+    0x7a, 0xcb, 0x97, 0x41, 0x17, 0x55, 0x05, 0x40, 0x67, 0x90, 0x24, 0xe1,
+    0x09, 0x67, 0x23, 0x9b, 0x70, 0x61, 0x49, 0x45, 0x7c, 0x7a, 0xcb, 0xc7,
+    0x22, 0xd3, 0x2e, 0x0a, 0x89, 0x40, 0x0f, 0x1c, 0x20, 0x23, 0x12, 0x86,
+    0x94, 0x11, 0x4b, 0xb7, 0x79, 0x6e, 0x7a, 0xed, 0xf3, 0xaa, 0x6a, 0xe6,
+    0x72, 0x59, 0xe4, 0x27, 0x92
+};
+
+/* EAT-like token, 310 bytes */
+static const uint8_t cose_sign1_es384_eat[] = {
+    0xd2, 0x84, 0x44, 0xa1, 0x01, 0x38, 0x22, 0xa0, 0x58, 0xca, 0xa6, 0x0a,
+    0x58, 0x20, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
+    0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15,
+    0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x19, 0x01,
+    0x00, 0x50, 0x01, 0x98, 0xf5, 0x0a, 0x4f, 0xf6, 0xc0, 0x58, 0x61, 0xc8,
+    0x86, 0x0d, 0x13, 0xa6, 0x38, 0xea, 0x3a, 0x00, 0x01, 0x24, 0xf7, 0x78,
+    0x19, 0x61, 0x63, 0x6d, 0x65, 0x2d, 0x73, 0x65, 0x63, 0x75, 0x72, 0x65,
+    0x2d, 0x65, 0x6c, 0x65, 0x6d, 0x65, 0x6e, 0x74, 0x2d, 0x72, 0x65, 0x76,
+    0x2d, 0x34, 0x06, 0x1a, 0x63, 0x4c, 0x9b, 0x00, 0x3a, 0x00, 0x01, 0x24,
+    0xf8, 0x58, 0x40, 0x00, 0x07, 0x0e, 0x15, 0x1c, 0x23, 0x2a, 0x31, 0x38,
+    0x3f, 0x46, 0x4d, 0x54, 0x5b, 0x62, 0x69, 0x70, 0x77, 0x7e, 0x85, 0x8c,
+    0x93, 0x9a, 0xa1, 0xa8, 0xaf, 0xb6, 0xbd, 0xc4, 0xcb, 0xd2, 0xd9, 0xe0,
+    0xe7, 0xee, 0xf5, 0xfc, 0x03, 0x0a, 0x11, 0x18, 0x1f, 0x26, 0x2d, 0x34,
+    0x3b, 0x42, 0x49, 0x50, 0x57, 0x5e, 0x65, 0x6c, 0x73, 0x7a, 0x81, 0x88,
+    0x8f, 0x96, 0x9d, 0xa4, 0xab, 0xb2, 0xb9, 0x3a, 0x00, 0x01, 0x24, 0xf9,
+    0x78, 0x1e, 0x66, 0x69, 0x72, 0x6d, 0x77, 0x61, 0x72, 0x65, 0x20, 0x32,
+    0x2e, 0x31, 0x33, 0x2e, 0x37, 0x20, 0x62, 0x75, 0x69, 0x6c, 0x64, 0x20,
+    0x32, 0x30, 0x32, 0x32, 0x31, 0x30, 0x31, 0x37, 0x58, 0x60, 0x72, 0x91,
+    0xb1, 0xac, 0x85, 0x12, 0x78, 0x83, 0x48, 0x89, 0x48, 0xd5, 0xb1, 0x63,
+    0x01, 0xef, 0x80, 0xab, 0xb2, 0x82, 0x31, 0x42, 0x9d, 0xfa, 0xfb, 0x70,
+    0xb3, 0xed, 0x0b, 0x19, 0xce, 0x62, 0x31, 0x91, 0x34, 0x66, 0x81, 0x4c,
+    0xb3, 0x69, 0xd7, 0xae, 0x24, 0x45, 0xe7, 0x67, 0xbb, 0x74, 0xd0, 0xc5,
+    0x95, 0x96, 0x93, 0xb3, 0x84, 0xf8, 0x14, 0xdf, 0x30, 0xa8, 0xeb, 0x88,
+    0x30, 0xca, 0xf8, 0x8e, 0xcc, 0x60, 0x3f, 0xc1, 0x96, 0x4b, 0x6a, 0xc6,
+    0xa1, 0x98, 0x1b, 0x54, 0x73, 0xfc, 0x73, 0xad, 0x36, 0xf2, 0x9b, 0x33,
+    0x48, 0x57, 0x7b, 0x68, 0xd8, 0x3d, 0x98, 0xd3, 0x19, 0x18
+};
+
+/* 1KB opaque payload, 1133 bytes */
+static const uint8_t cose_sign1_es384_1k[] = {
+    0xd2, 0x84, 0x44, 0xa1, 0x01, 0x38, 0x22, 0xa0, 0x59, 0x04, 0x00, 0x07,
+    0x26, 0x45, 0x64, 0x83, 0xa2, 0xc1, 0xe0, 0xff, 0x1e, 0x3d, 0x5c, 0x7b,
+    0x9a, 0xb9, 0xd8, 0xf7, 0x16, 0x35, 0x54, 0x73, 0x92, 0xb1, 0xd0, 0xef,
+    0x0e, 0x2d, 0x4c, 0x6b, 0x8a, 0xa9, 0xc8, 0xe7, 0x06, 0x25, 0x44, 0x63,
+    0x82, 0xa1, 0xc0, 0xdf, 0xfe, 0x1d, 0x3c, 0x5b, 0x7a, 0x99, 0xb8, 0xd7,
+    0xf6, 0x15, 0x34, 0x53, 0x72, 0x91, 0xb0, 0xcf, 0xee, 0x0d, 0x2c, 0x4b,
+    0x6a, 0x89, 0xa8, 0xc7, 0xe6, 0x05, 0x24, 0x43, 0x62, 0x81, 0xa0, 0xbf,
+    0xde, 0xfd, 0x1c, 0x3b, 0x5a, 0x79, 0x98, 0xb7, 0xd6, 0xf5, 0x14, 0x33,
+    0x52, 0x71, 0x90, 0xaf, 0xce, 0xed, 0x0c, 0x2b, 0x4a, 0x69, 0x88, 0xa7,
+    0xc6, 0xe5, 0x04, 0x23, 0x42, 0x61, 0x80, 0x9f, 0xbe, 0xdd, 0xfc, 0x1b,
+    0x3a, 0x59, 0x78, 0x97, 0xb6, 0xd5, 0xf4, 0x13, 0x32, 0x51, 0x70, 0x8f,
+    0xae, 0xcd, 0xec, 0x0b, 0x2a, 0x49, 0x68, 0x87, 0xa6, 0xc5, 0xe4, 0x03,
+    0x22, 0x41, 0x60, 0x7f, 0x9e, 0xbd, 0xdc, 0xfb, 0x1a, 0x39, 0x58, 0x77,
+    0x96, 0xb5, 0xd4, 0xf3, 0x12, 0x31, 0x50, 0x6f, 0x8e, 0xad, 0xcc, 0xeb,
+    0x0a, 0x29, 0x48, 0x67, 0x86, 0xa5, 0xc4, 0xe3, 0x02, 0x21, 0x40, 0x5f,
+    0x7e, 0x9d, 0xbc, 0xdb, 0xfa, 0x19, 0x38, 0x57, 0x76, 0x95, 0xb4, 0xd3,
+    0xf2, 0x11, 0x30, 0x4f, 0x6e, 0x8d, 0xac, 0xcb, 0xea, 0x09, 0x28, 0x47,
+    0x66, 0x85, 0xa4, 0xc3, 0xe2, 0x01, 0x20, 0x3f, 0x5e, 0x7d, 0x9c, 0xbb,
+    0xda, 0xf9, 0x18, 0x37, 0x56, 0x75, 0x94, 0xb3, 0xd2, 0xf1, 0x10, 0x2f,
+    0x4e, 0x6d, 0x8c, 0xab, 0xca, 0xe9, 0x08, 0x27, 0x46, 0x65, 0x84, 0xa3,
+    0xc2, 0xe1, 0x00, 0x1f, 0x3e, 0x5d, 0x7c, 0x9b, 0xba, 0xd9, 0xf8, 0x17,
+    0x36, 0x55, 0x74, 0x93, 0xb2, 0xd1, 0xf0, 0x0f, 0x2e, 0x4d, 0x6c, 0x8b,
+    0xaa, 0xc9, 0xe8, 0x07, 0x26, 0x45, 0x64, 0x83, 0xa2, 0xc1, 0xe0, 0xff,
+    0x1e, 0x3d, 0x5c, 0x7b, 0x9a, 0xb9, 0xd8, 0xf7, 0x16, 0x35, 0x54, 0x73,
+    0x92, 0xb1, 0xd0, 0xef, 0x0e, 0x2d, 0x4c, 0x6b, 0x8a, 0xa9, 0xc8, 0xe7,
+    0x06, 0x25, 0x44, 0x63, 0x82, 0xa1, 0xc0, 0xdf, 0xfe, 0x1d, 0x3c, 0x5b,
+    0x7a, 0x99, 0xb8, 0xd7, 0xf6, 0x15, 0x34, 0x53, 0x72, 0x91, 0xb0, 0xcf,
+    0xee, 0x0d, 0x2c, 0x4b, 0x6a, 0x89, 0xa8, 0xc7, 0xe6, 0x05, 0x24, 0x43,
+    0x62, 0x81, 0xa0, 0xbf, 0xde, 0xfd, 0x1c, 0x3b, 0x5a, 0x79, 0x98, 0xb7,
+    0xd6, 0xf5, 0x14, 0x33, 0x52, 0x71, 0x90, 0xaf, 0xce, 0xed, 0x0c, 0x2b,
+    0x4a, 0x69, 0x88, 0xa7, 0xc6, 0xe5, 0x04, 0x23, 0x42, 0x61, 0x80, 0x9f,
+    0xbe, 0xdd, 0xfc, 0x1b, 0x3a, 0x59, 0x78, 0x97, 0xb6, 0xd5, 0xf4, 0x13,
+    0x32, 0x51, 0x70, 0x8f, 0xae, 0xcd, 0xec, 0x0b, 0x2a, 0x49, 0x68, 0x87,
+    0xa6, 0xc5, 0xe4, 0x03, 0x22, 0x41, 0x60, 0x7f, 0x9e, 0xbd, 0xdc, 0xfb,
+    0x1a, 0x39, 0x58, 0x77, 0x96, 0xb5, 0xd4, 0xf3, 0x12, 0x31, 0x50, 0x6f,
+    0x8e, 0xad, 0xcc, 0xeb, 0x0a, 0x29, 0x48, 0x67, 0x86, 0xa5, 0xc4, 0xe3,
+    0x02, 0x21, 0x40, 0x5f, 0x7e, 0x9d, 0xbc, 0xdb, 0xfa, 0x19, 0x38, 0x57,
+    0x76, 0x95, 0xb4, 0xd3, 0xf2, 0x11, 0x30, 0x4f, 0x6e, 0x8d, 0xac, 0xcb,
+    0xea, 0x09, 0x28, 0x47, 0x66, 0x85, 0xa4, 0xc3, 0xe2, 0x01, 0x20, 0x3f,
+    0x5e, 0x7d, 0x9c, 0xbb, 0xda, 0xf9, 0x18, 0x37, 0x56, 0x75, 0x94, 0xb3,
+    0xd2, 0xf1, 0x10, 0x2f, 0x4e, 0x6d, 0x8c, 0xab, 0xca, 0xe9, 0x08, 0x27,
+    0x46, 0x65, 0x84, 0xa3, 0xc2, 0xe1, 0x00, 0x1f, 0x3e, 0x5d, 0x7c, 0x9b,
+    0xba, 0xd9, 0xf8, 0x17, 0x36, 0x55, 0x74, 0x93, 0xb2, 0xd1, 0xf0, 0x0f,
+    0x2e, 0x4d, 0x6c, 0x8b, 0xaa, 0xc9, 0xe8, 0x07, 0x26, 0x45, 0x64, 0x83,
+    0xa2, 0xc1, 0xe0, 0xff, 0x1e, 0x3d, 0x5c, 0x7b, 0x9a, 0xb9, 0xd8, 0xf7,
+    0x16, 0x35, 0x54, 0x73, 0x92, 0xb1, 0xd0, 0xef, 0x0e, 0x2d, 0x4c, 0x6b,
+    0x8a, 0xa9, 0xc8, 0xe7, 0x06, 0x25, 0x44, 0x63, 0x82, 0xa1, 0xc0, 0xdf,
+    0xfe, 0x1d, 0x3c, 0x5b, 0x7a, 0x99, 0xb8, 0xd7, 0xf6, 0x15, 0x34, 0x53,
+    0x72, 0x91, 0xb0, 0xcf, 0xee, 0x0d, 0x2c, 0x4b, 0x6a, 0x89, 0xa8, 0xc7,
+    0xe6, 0x05, 0x24, 0x43, 0x62, 0x81, 0xa0, 0xbf, 0xde, 0xfd, 0x1c, 0x3b,
+    0x5a, 0x79, 0x98, 0xb7, 0xd6, 0xf5, 0x14, 0x33, 0x52, 0x71, 0x90, 0xaf,
+    0xce, 0xed, 0x0c, 0x2b, 0x4a, 0x69, 0x88, 0xa7, 0xc6, 0xe5, 0x04, 0x23,
+    0x42, 0x61, 0x80, 0x9f, 0xbe, 0xdd, 0xfc, 0x1b, 0x3a, 0x59, 0x78, 0x97,
+    0xb6, 0xd5, 0xf4, 0x13, 0x32, 0x51, 0x70, 0x8f, 0xae, 0xcd, 0xec, 0x0b,
+    0x2a, 0x49, 0x68, 0x87, 0xa6, 0xc5, 0xe4, 0x03, 0x22, 0x41, 0x60, 0x7f,
+    0x9e, 0xbd, 0xdc, 0xfb, 0x1a, 0x39, 0x58, 0x77, 0x96, 0xb5, 0xd4, 0xf3,
+    0x12, 0x31, 0x50, 0x6f, 0x8e, 0xad, 0xcc, 0xeb, 0x0a, 0x29, 0x48, 0x67,
+    0x86, 0xa5, 0xc4, 0xe3, 0x02, 0x21, 0x40, 0x5f, 0x7e, 0x9d, 0xbc, 0xdb,
+    0xfa, 0x19, 0x38, 0x57, 0x76, 0x95, 0xb4, 0xd3, 0xf2, 0x11, 0x30, 0x4f,
+    0x6e, 0x8d, 0xac, 0xcb, 0xea, 0x09, 0x28, 0x47, 0x66, 0x85, 0xa4, 0xc3,
+    0xe2, 0x01, 0x20, 0x3f, 0x5e, 0x7d, 0x9c, 0xbb, 0xda, 0xf9, 0x18, 0x37,
+    0x56, 0x75, 0x94, 0xb3, 0xd2, 0xf1, 0x10, 0x2f, 0x4e, 0x6d, 0x8c, 0xab,
+    0xca, 0xe9, 0x08, 0x27, 0x46, 0x65, 0x84, 0xa3, 0xc2, 0xe1, 0x00, 0x1f,
+    0x3e, 0x5d, 0x7c, 0x9b, 0xba, 0xd9, 0xf8, 0x17, 0x36, 0x55, 0x74, 0x93,
+    0xb2, 0xd1, 0xf0, 0x0f, 0x2e, 0x4d, 0x6c, 0x8b, 0xaa, 0xc9, 0xe8, 0x07,
+    0x26, 0x45, 0x64, 0x83, 0xa2, 0xc1, 0xe0, 0xff, 0x1e, 0x3d, 0x5c, 0x7b,
+    0x9a, 0xb9, 0xd8, 0xf7, 0x16, 0x35, 0x54, 0x73, 0x92, 0xb1, 0xd0, 0xef,
+    0x0e, 0x2d, 0x4c, 0x6b, 0x8a, 0xa9, 0xc8, 0xe7, 0x06, 0x25, 0x44, 0x63,
+    0x82, 0xa1, 0xc0, 0xdf, 0xfe, 0x1d, 0x3c, 0x5b, 0x7a, 0x99, 0xb8, 0xd7,
+    0xf6, 0x15, 0x34, 0x53, 0x72, 0x91, 0xb0, 0xcf, 0xee, 0x0d, 0x2c, 0x4b,
+    0x6a, 0x89, 0xa8, 0xc7, 0xe6, 0x05, 0x24, 0x43, 0x62, 0x81, 0xa0, 0xbf,
+    0xde, 0xfd, 0x1c, 0x3b, 0x5a, 0x79, 0x98, 0xb7, 0xd6, 0xf5, 0x14, 0x33,
+    0x52, 0x71, 0x90, 0xaf, 0xce, 0xed, 0x0c, 0x2b, 0x4a, 0x69, 0x88, 0xa7,
+    0xc6, 0xe5, 0x04, 0x23, 0x42, 0x61, 0x80, 0x9f, 0xbe, 0xdd, 0xfc, 0x1b,
+    0x3a, 0x59, 0x78, 0x97, 0xb6, 0xd5, 0xf4, 0x13, 0x32, 0x51, 0x70, 0x8f,
+    0xae, 0xcd, 0xec, 0x0b, 0x2a, 0x49, 0x68, 0x87, 0xa6, 0xc5, 0xe4, 0x03,
+    0x22, 0x41, 0x60, 0x7f, 0x9e, 0xbd, 0xdc, 0xfb, 0x1a, 0x39, 0x58, 0x77,
+    0x96, 0xb5, 0xd4, 0xf3, 0x12, 0x31, 0x50, 0x6f, 0x8e, 0xad, 0xcc, 0xeb,
+    0x0a, 0x29, 0x48, 0x67, 0x86, 0xa5, 0xc4, 0xe3, 0x02, 0x21, 0x40, 0x5f,
+    0x7e, 0x9d, 0xbc, 0xdb, 0xfa, 0x19, 0x38, 0x57, 0x76, 0x95, 0xb4, 0xd3,
+    0xf2, 0x11, 0x30, 0x4f, 0x6e, 0x8d, 0xac, 0xcb, 0xea, 0x09, 0x28, 0x47,
+    0x66, 0x85, 0xa4, 0xc3, 0xe2, 0x01, 0x20, 0x3f, 0x5e, 0x7d, 0x9c, 0xbb,
+    0xda, 0xf9, 0x18, 0x37, 0x56, 0x75, 0x94, 0xb3, 0xd2, 0xf1, 0x10, 0x2f,
+    0x4e, 0x6d, 0x8c, 0xab, 0xca, 0xe9, 0x08, 0x27, 0x46, 0x65, 0x84, 0xa3,
+    0xc2, 0xe1, 0x00, 0x1f, 0x3e, 0x5d, 0x7c, 0x9b, 0xba, 0xd9, 0xf8, 0x17,
+    0x36, 0x55, 0x74, 0x93, 0xb2, 0xd1, 0xf0, 0x0f, 0x2e, 0x4d, 0x6c, 0x8b,
+    0xaa, 0xc9, 0xe8, 0x58, 0x60, 0x19, 0xe8, 0x1c, 0x58, 0x06, 0x39, 0xeb,
+    0xe5, 0x07, 0xc6, 0xda, 0x55, 0x3c, 0x6a, 0x20, 0xc3, 0xc2, 0xec, 0x01,
+    0xec, 0xd7, 0xeb, 0xe0, 0x3b, 0x37, 0x21, 0xe1, 0x57, 0x82, 0x4f, 0x3d,
+    0xdd, 0x70, 0x13, 0xf8, 0x0b, 0x46, 0xc5, 0xd1, 0x65, 0x3d, 0x62, 0x17,
+    0xcd, 0xc2, 0x16, 0x22, 0x2a, 0x8e, 0x58, 0x9a, 0xb0, 0xdd, 0xf7, 0x92,
+    0xc7, 0x49, 0xa9, 0x76, 0xc4, 0x1d, 0x8f, 0x3f, 0xa5, 0x1d, 0xde, 0xaa,
+    0x81, 0x1c, 0xec, 0x0f, 0x85, 0x9c, 0x6b, 0x37, 0x75, 0xdd, 0xfc, 0x15,
+    0x2a, 0x8d, 0x50, 0xee, 0xbe, 0x45, 0xb4, 0xe1, 0x39, 0xc3, 0xb6, 0xd8,
+    0xa3, 0x74, 0x70, 0x91, 0xa6
+};
+#endif /* T_COSE_DISABLE_ES384 */
+
+
+#ifndef T_COSE_DISABLE_ES512
+/* example map from two_step_sign_example(), 241 bytes */
+static const uint8_t cose_sign1_es512_example[] = {
+    0xd2, 0x84, 0x44, 0xa1, 0x01, 0x38, 0x23, 0xa0, 0x58, 0x61, 0xa6, 0x69,
+    0x42, 0x65, 0x69, 0x6e, 0x67, 0x54, 0x79, 0x70, 0x65, 0x68, 0x48, 0x75,
+    0x6d, 0x61, 0x6e, 0x6f, 0x69, 0x64, 0x68, 0x47, 0x72, 0x65, 0x65, 0x74,
+    0x69, 0x6e, 0x67, 0x70, 0x57, 0x65, 0x20, 0x63, 0x6f, 0x6d, 0x65, 0x20,
+    0x69, 0x6e, 0x20, 0x70, 0x65, 0x61, 0x63, 0x65, 0x68, 0x41, 0x72, 0x6d,
+    0x43, 0x6f, 0x75, 0x6e, 0x74, 0x02, 0x69, 0x48, 0x65, 0x61, 0x64, 0x43,
+    0x6f, 0x75, 0x6e, 0x74, 0x01, 0x69, 0x42, 0x72, 0x61, 0x69, 0x6e, 0x53,
+    0x69, 0x7a, 0x65, 0x66, 0x6d, 0x65, 0x64, 0x69, 0x75, 0x6d, 0x6b, 0x44,
+    0x72, 0x69, 0x6e, 0x6b, 0x73, 0x57, 0x61, 0x74, 0x65, 0x72, 0xf5, 0x58,
+    0x84, 0x00, 0x26, 0xb8, 0x2a, 0x0a, 0xfa, 0x7a, 0xbd, 0x48, 0x3d, 0x2d,
+    0x95, 0x73, 0x7d, 0xe5, 0xdf, 0x73, 0x9f, 0x22, 0xd8, 0xed, 0x8f, 0x0f,
+    0x30, 0x53, 0x19, 0x9e, 0x3c, 0x32, 0xdc, 0xac, 0xd8, 0x90, 0x2b, 0xb8,
+    0x91, 0x09, 0x96, 0x18, 0xf2, 0xd3, 0xac, 0xde, 0x4f, 0xc4, 0x4f, 0xe3,
+    0x81, 0x59, 0x4a, 0xb7, 0xf9, 0x7a, 0x68, 0xa5, 0x72, 0x7d, 0x52, 0xe7,
+    0x5c, 0x26, 0x72, 0x2a, 0x34, 0xbf, 0x27, 0x00, 0x1f, 0x36, 0xa2, 0x65,
+    0x57, 0x9a, 0x9d, 0xa8, 0x1c, 0x60, 0x34, 0x96, 0x59, 0xf9, 0x7c, 0x79,
+    0x88, 0xe5, 0x20, 0xa8, 0xf6, 0xd3, 0x42, 0x5e, 0x9a, 0x4c, 0xed, 0xb5,
+    0x19, 0xd7, 0x9a, 0xac, 0x69, 0x64, 0x99, 0xeb, 0x1b, 0xf1, 0x6b, 0x2c,
+    0x9e, 0x63, 0x12, 0x1e, 0xba, 0x52, 0x75, 0xd8, 0x0a, 0xa4, 0xbb, 0xc7,
+    0x80, 0x58, 0xca, 0x37, 0x9e, 0x34, 0x23, 0x5e, 0x4c, 0x59, 0x5c, 0x83,
+    0xd3
+};
+
+/* small text string, 149 bytes */
+static const uint8_t cose_sign1_es512_small[] = {
+    0xd2, 0x84, 0x44, 0xa1, 0x01, 0x38, 0x23, 0xa0, 0x46, 0x65, 0x68, 0x65,
+    0x6c, 0x6c, 0x6f, 0x58, 0x84, 0x00, 0xf8, 0x7e, 0x75, 0x61, 0x6a, 0x4a,
+    0x39, 0x2c, 0xac, 0x42, 0x12, 0x76, 0x6b, 0x8d, 0x7d, 0xc8, 0x94, 0x56,
+    0x4d, 0x2f, 0xf3, 0x54, 0x67, 0x19, 0x6b, 0xc2, 0xe3, 0x1f, 0xb6, 0x19,
+    0xd1, 0x2b, 0x26, 0x3e, 0x24, 0x7d, 0x58, 0xab, 0x1c, 0x39, 0x53, 0xd5,
+    0x95, 0x4c, 0xf1, 0xff, 0xf8, 0xad, 0x66, 0xcd, 0xaf, 0xaf, 0x5b, 0xc2,
+    0x4a, 0x43, 0xae, 0x02, 0x54, 0x74, 0xb4, 0x39, 0xb1, 0x4a, 0xc4, 0x01,
+    0xcd, 0xd9, 0x66, 0x7b, 0x05, 0x69, 0x5d, 0x06, 0x42, 0x8b, 0x95, 0x86,
+    0x8d, 0x03, 0x01, 0xd9, 0x93, 0x25, 0x47, 0x1c, 0x80, 0x0b, 0x5b, 0x54,
+    0xfd, 0x2e, 0x5c, 0x39, 0xfc, 0xd4, 0x1f, 0x86, 0xf0, 0x02, 0x41, 0xad,
+    0x5a, 0x44, 0x1d, 0x0b, 0xaf, 0x42, 0xc2, 0x89, 0x14, 0x7f, 0xa2, 0xef,
+    0x6f, 0x80, 0x5d, 0x27, 0x4d, 0xb6, 0x94, 0x44, 0x13, 0x4d, 0xfe, 0x50,
+    0xf2, 0xd6, 0x39, 0xc6, 0x26
+};
+
+/* EAT-like token, 346 bytes */
+static const uint8_t cose_sign1_es512_eat[] = {
+    0xd2, 0x84, 0x44, 0xa1, 0x01, 0x38, 0x23, 0xa0, 0x58, 0xca, 0xa6, 0x0a,
+    0x58, 0x20, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
+    0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15,
+    0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x19, 0x01,
+    0x00, 0x50, 0x01, 0x98, 0xf5, 0x0a, 0x4f, 0xf6, 0xc0, 0x58, 0x61, 0xc8,
+    0x86, 0x0d, 0x13, 0xa6, 0x38, 0xea, 0x3a, 0x00, 0x01, 0x24, 0xf7, 0x78,
+    0x19, 0x61, 0x63, 0x6d, 0x65, 0x2d, 0x73, 0x65, 0x63, 0x75, 0x72, 0x65,
+    0x2d, 0x65, 0x6c, 0x65, 0x6d, 0x65, 0x6e, 0x74, 0x2d, 0x72, 0x65, 0x76,
+    0x2d, 0x34, 0x06, 0x1a, 0x63, 0x4c, 0x9b, 0x00, 0x3a, 0x00, 0x01, 0x24,
+    0xf8, 0x58, 0x40, 0x00, 0x07, 0x0e, 0x15, 0x1c, 0x23, 0x2a, 0x31, 0x38,
+    0x3f, 0x46, 0x4d, 0x54, 0x5b, 0x62, 0x69, 0x70, 0x77, 0x7e, 0x85, 0x8c,
+    0x93, 0x9a, 0xa1, 0xa8, 0xaf, 0xb6, 0xbd, 0xc4, 0xcb, 0xd2, 0xd9, 0xe0,
+    0xe7, 0xee, 0xf5, 0xfc, 0x03, 0x0a, 0x11, 0x18, 0x1f, 0x26, 0x2d, 0x34,
+    0x3b, 0x42, 0x49, 0x50, 0x57, 0x5e, 0x65, 0x6c, 0x73, 0x7a, 0x81, 0x88,
+    0x8f, 0x96, 0x9d, 0xa4, 0xab, 0xb2, 0xb9, 0x3a, 0x00, 0x01, 0x24, 0xf9,
+    0x78, 0x1e, 0x66, 0x69, 0x72, 0x6d, 0x77, 0x61, 0x72, 0x65, 0x20, 0x32,
+    0x2e, 0x31, 0x33, 0x2e, 0x37, 0x20, 0x62, 0x75, 0x69, 0x6c, 0x64, 0x20,
+    0x32, 0x30, 0x32, 0x32, 0x31, 0x30, 0x31, 0x37, 0x58, 0x84, 0x00, 0xbf,
+    0x5b, 0xb3, 0x91, 0xe9, 0xf9, 0xcf, 0x7b, 0xbc, 0xf1, 0x44, 0xf3, 0x45,
+    0x9c, 0xef, 0xc8, 0x81, 0x16, 0x18, 0xca, 0x4f, 0xd1, 0x3c, 0x79, 0xdf,
+    0x1e, 0x61, 0xce, 0x28, 0x64, 0xf8, 0x99, 0x2f, 0x6d, 0x2f, 0xe7, 0x4a,
+    0x50, 0xf5, 0x7e, 0x11, 0x3a, 0x13, 0xf9, 0x0c, 0x03, 0x81, 0x6e, 0xe2,
+    0x03, 0x7b, 0xff, 0x3e, 0x9a, 0xb9, 0xf3, 0xbb, 0x0e, 0x54, 0xcb, 0x7b,
+    0x25, 0x04, 0x2b, 0x44, 0x01, 0xdf, 0xe1, 0x06, 0x2b, 0xf2, 0xd4, 0xa7,
+    0x09, 0x82, 0xaf, 0x50, 0x27, 0x90, 0x23, 0x4a, 0x5a, 0x1a, 0xa5, 0x89,
+    0xb2, 0x3f, 0xb5, 0x0d, 0x9c, 0x8c, 0x94, 0xcf, 0x96, 0x31, 0xea, 0x85,
+    0xcf, 0x93, 0xd7, 0xf9, 0x9f, 0x76, 0x2e, 0x79, 0x3b, 0x04, 0xf3, 0x58,
+    0x06, 0x9d, 0xb0, 0x20, 0xed, 0x86, 0xd1, 0x59, 0xb5, 0x08, 0x71, 0x5f,
+    0xc3, 0xd8, 0xd4, 0x50, 0xfe, 0x52, 0x51, 0x91, 0xff, 0x5a
+};
+
+/* 1KB opaque payload, 1169 bytes */
+static const uint8_t cose_sign1_es512_1k[] = {
+    0xd2, 0x84, 0x44, 0xa1, 0x01, 0x38, 0x23, 0xa0, 0x59, 0x04, 0x00, 0x07,
+    0x26, 0x45, 0x64, 0x83, 0xa2, 0xc1, 0xe0, 0xff, 0x1e, 0x3d, 0x5c, 0x7b,
+    0x9a, 0xb9, 0xd8, 0xf7, 0x16, 0x35, 0x54, 0x73, 0x92, 0xb1, 0xd0, 0xef,
+    0x0e, 0x2d, 0x4c, 0x6b, 0x8a, 0xa9, 0xc8, 0xe7, 0x06, 0x25, 0x44, 0x63,
+    0x82, 0xa1, 0xc0, 0xdf, 0xfe, 0x1d, 0x3c, 0x5b, 0x7a, 0x99, 0xb8, 0xd7,
+    0xf6, 0x15, 0x34, 0x53, 0x72, 0x91, 0xb0, 0xcf, 0xee, 0x0d, 0x2c, 0x4b,
+    0x6a, 0x89, 0xa8, 0xc7, 0xe6, 0x05, 0x24, 0x43, 0x62, 0x81, 0xa0, 0xbf,
+    0xde, 0xfd, 0x1c, 0x3b, 0x5a, 0x79, 0x98, 0xb7, 0xd6, 0xf5, 0x14, 0x33,
+    0x52, 0x71, 0x90, 0xaf, 0xce, 0xed, 0x0c, 0x2b, 0x4a, 0x69, 0x88, 0xa7,
+    0xc6, 0xe5, 0x04, 0x23, 0x42, 0x61, 0x80, 0x9f, 0xbe, 0xdd, 0xfc, 0x1b,
+    0x3a, 0x59, 0x78, 0x97, 0xb6, 0xd5, 0xf4, 0x13, 0x32, 0x51, 0x70, 0x8f,
+    0xae, 0xcd, 0xec, 0x0b, 0x2a, 0x49, 0x68, 0x87, 0xa6, 0xc5, 0xe4, 0x03,
+    0x22, 0x41, 0x60, 0x7f, 0x9e, 0xbd, 0xdc, 0xfb, 0x1a, 0x39, 0x58, 0x77,
+    0x96, 0xb5, 0xd4, 0xf3, 0x12, 0x31, 0x50, 0x6f, 0x8e, 0xad, 0xcc, 0xeb,
+    0x0a, 0x29, 0x48, 0x67, 0x86, 0xa5, 0xc4, 0xe3, 0x02, 0x21, 0x40, 0x5f,
+    0x7e, 0x9d, 0xbc, 0xdb, 0xfa, 0x19, 0x38, 0x57, 0x76, 0x95, 0xb4, 0xd3,
+    0xf2, 0x11, 0x30, 0x4f, 0x6e, 0x8d, 0xac, 0xcb, 0xea, 0x09, 0x28, 0x47,
+    0x66, 0x85, 0xa4, 0xc3, 0xe2, 0x01, 0x20, 0x3f, 0x5e, 0x7d, 0x9c, 0xbb,
+    0xda, 0xf9, 0x18, 0x37, 0x56, 0x75, 0x94, 0xb3, 0xd2, 0xf1, 0x10, 0x2f,
+    0x4e, 0x6d, 0x8c, 0xab, 0xca, 0xe9, 0x08, 0x27, 0x46, 0x65, 0x84, 0xa3,
+    0xc2, 0xe1, 0x00, 0x1f, 0x3e, 0x5d, 0x7c, 0x9b, 0xba, 0xd9, 0xf8, 0x17,
+    0x36, 0x55, 0x74, 0x93, 0xb2, 0xd1, 0xf0, 0x0f, 0x2e, 0x4d, 0x6c, 0x8b,
+    0xaa, 0xc9, 0xe8, 0x07, 0x26, 0x45, 0x64, 0x83, 0xa2, 0xc1, 0xe0, 0xff,
+    0x1e, 0x3d, 0x5c, 0x7b, 0x9a, 0xb9, 0xd8, 0xf7, 0x16, 0x35, 0x54, 0x73,
+    0x92, 0xb1, 0xd0, 0xef, 0x0e, 0x2d, 0x4c, 0x6b, 0x8a, 0xa9, 0xc8, 0xe7,
+    0x06, 0x25, 0x44, 0x63, 0x82, 0xa1, 0xc0, 0xdf, 0xfe, 0x1d, 0x3c, 0x5b,
+    0x7a, 0x99, 0xb8, 0xd7, 0xf6, 0x15, 0x34, 0x53, 0x72, 0x91, 0xb0, 0xcf,
+    0xee, 0x0d, 0x2c, 0x4b, 0x6a, 0x89, 0xa8, 0xc7, 0xe6, 0x05, 0x24, 0x43,
+    0x62, 0x81, 0xa0, 0xbf, 0xde, 0xfd, 0x1c, 0x3b, 0x5a, 0x79, 0x98, 0xb7,
+    0xd6, 0xf5, 0x14, 0x33, 0x52, 0x71, 0x90, 0xaf, 0xce, 0xed, 0x0c, 0x2b,
+    0x4a, 0x69, 0x88, 0xa7, 0xc6, 0xe5, 0x04, 0x23, 0x42, 0x61, 0x80, 0x9f,
+    0xbe, 0xdd, 0xfc, 0x1b, 0x3a, 0x59, 0x78, 0x97, 0xb6, 0xd5, 0xf4, 0x13,
+    0x32, 0x51, 0x70, 0x8f, 0xae, 0xcd, 0xec, 0x0b, 0x2a, 0x49, 0x68, 0x87,
+    0xa6, 0xc5, 0xe4, 0x03, 0x22, 0x41, 0x60, 0x7f, 0x9e, 0xbd, 0xdc, 0xfb,
+    0x1a, 0x39, 0x58, 0x77, 0x96, 0xb5, 0xd4, 0xf3, 0x12, 0x31, 0x50, 0x6f,
+    0x8e, 0xad, 0xcc, 0xeb, 0x0a, 0x29, 0x48, 0x67, 0x86, 0xa5, 0xc4, 0xe3,
+    0x02, 0x21, 0x40, 0x5f, 0x7e, 0x9d, 0xbc, 0xdb, 0xfa, 0x19, 0x38, 0x57,
+    0x76, 0x95, 0xb4, 0xd3, 0xf2, 0x11, 0x30, 0x4f, 0x6e, 0x8d, 0xac, 0xcb,
+    0xea, 0x09, 0x28, 0x47, 0x66, 0x85, 0xa4, 0xc3, 0xe2, 0x01, 0x20, 0x3f,
+    0x5e, 0x7d, 0x9c, 0xbb, 0xda, 0xf9, 0x18, 0x37, 0x56, 0x75, 0x94, 0xb3,
+    0xd2, 0xf1, 0x10, 0x2f, 0x4e, 0x6d, 0x8c, 0xab, 0xca, 0xe9, 0x08, 0x27,
+    0x46, 0x65, 0x84, 0xa3, 0xc2, 0xe1, 0x00, 0x1f, 0x3e, 0x5d, 0x7c, 0x9b,
+    0xba, 0xd9, 0xf8, 0x17, 0x36, 0x55, 0x74, 0x93, 0xb2, 0xd1, 0xf0, 0x0f,
+    0x2e, 0x4d, 0x6c, 0x8b, 0xaa, 0xc9, 0xe8, 0x07, 0x26, 0x45, 0x64, 0x83,
+    0xa2, 0xc1, 0xe0, 0xff, 0x1e, 0x3d, 0x5c, 0x7b, 0x9a, 0xb9, 0xd8, 0xf7,
+    0x16, 0x35, 0x54, 0x73, 0x92, 0xb1, 0xd0, 0xef, 0x0e, 0x2d, 0x4c, 0x6b,
+    0x8a, 0xa9, 0xc8, 0xe7, 0x06, 0x25, 0x44, 0x63, 0x82, 0xa1, 0xc0, 0xdf,
+    0xfe, 0x1d, 0x3c, 0x5b, 0x7a, 0x99, 0xb8, 0xd7, 0xf6, 0x15, 0x34, 0x53,
+    0x72, 0x91, 0xb0, 0xcf, 0xee, 0x0d, 0x2c, 0x4b, 0x6a, 0x89, 0xa8, 0xc7,
+    0xe6, 0x05, 0x24, 0x43, 0x62, 0x81, 0xa0, 0xbf, 0xde, 0xfd, 0x1c, 0x3b,
+    0x5a, 0x79, 0x98, 0xb7, 0xd6, 0xf5, 0x14, 0x33, 0x52, 0x71, 0x90, 0xaf,
+    0xce, 0xed, 0x0c, 0x2b, 0x4a, 0x69, 0x88, 0xa7, 0xc6, 0xe5, 0x04, 0x23,
+    0x42, 0x61, 0x80, 0x9f, 0xbe, 0xdd, 0xfc, 0x1b, 0x3a, 0x59, 0x78, 0x97,
+    0xb6, 0xd5, 0xf4, 0x13, 0x32, 0x51, 0x70, 0x8f, 0xae, 0xcd, 0xec, 0x0b,
+    0x2a, 0x49, 0x68, 0x87, 0xa6, 0xc5, 0xe4, 0x03, 0x22, 0x41, 0x60, 0x7f,
+    0x9e, 0xbd, 0xdc, 0xfb, 0x1a, 0x39, 0x58, 0x77, 0x96, 0xb5, 0xd4, 0xf3,
+    0x12, 0x31, 0x50, 0x6f, 0x8e, 0xad, 0xcc, 0xeb, 0x0a, 0x29, 0x48, 0x67,
+    0x86, 0xa5, 0xc4, 0xe3, 0x02, 0x21, 0x40, 0x5f, 0x7e, 0x9d, 0xbc, 0xdb,
+    0xfa, 0x19, 0x38, 0x57, 0x76, 0x95, 0xb4, 0xd3, 0xf2, 0x11, 0x30, 0x4f,
+    0x6e, 0x8d, 0xac, 0xcb, 0xea, 0x09, 0x28, 0x47, 0x66, 0x85, 0xa4, 0xc3,
+    0xe2, 0x01, 0x20, 0x3f, 0x5e, 0x7d, 0x9c, 0xbb, 0xda, 0xf9, 0x18, 0x37,
+    0x56, 0x75, 0x94, 0xb3, 0xd2, 0xf1, 0x10, 0x2f, 0x4e, 0x6d, 0x8c, 0xab,
+    0xca, 0xe9, 0x08, 0x27, 0x46, 0x65, 0x84, 0xa3, 0xc2, 0xe1, 0x00, 0x1f,
+    0x3e, 0x5d, 0x7c, 0x9b, 0xba, 0xd9, 0xf8, 0x17, 0x36, 0x55, 0x74, 0x93,
+    0xb2, 0xd1, 0xf0, 0x0f, 0x2e, 0x4d, 0x6c, 0x8b, 0xaa, 0xc9, 0xe8, 0x07,
+    0x26, 0x45, 0x64, 0x83, 0xa2, 0xc1, 0xe0, 0xff, 0x1e, 0x3d, 0x5c, 0x7b,
+    0x9a, 0xb9, 0xd8, 0xf7, 0x16, 0x35, 0x54, 0x73, 0x92, 0xb1, 0xd0, 0xef,
+    0x0e, 0x2d, 0x4c, 0x6b, 0x8a, 0xa9, 0xc8, 0xe7, 0x06, 0x25, 0x44, 0x63,
+    0x82, 0xa1, 0xc0, 0xdf, 0xfe, 0x1d, 0x3c, 0x5b, 0x7a, 0x99, 0xb8, 0xd7,
+    0xf6, 0x15, 0x34, 0x53, 0x72, 0x91, 0xb0, 0xcf, 0xee, 0x0d, 0x2c, 0x4b,
+    0x6a, 0x89, 0xa8, 0xc7, 0xe6, 0x05, 0x24, 0x43, 0x62, 0x81, 0xa0, 0xbf,
+    0xde, 0xfd, 0x1c, 0x3b, 0x5a, 0x79, 0x98, 0xb7, 0xd6, 0xf5, 0x14, 0x33,
+    0x52, 0x71, 0x90, 0xaf, 0xce, 0xed, 0x0c, 0x2b, 0x4a, 0x69, 0x88, 0xa7,
+    0xc6, 0xe5, 0x04, 0x23, 0x42, 0x61, 0x80, 0x9f, 0xbe, 0xdd, 0xfc, 0x1b,
+    0x3a, 0x59, 0x78, 0x97, 0xb6, 0xd5, 0xf4, 0x13, 0x32, 0x51, 0x70, 0x8f,
+    0xae, 0xcd, 0xec, 0x0b, 0x2a, 0x49, 0x68, 0x87, 0xa6, 0xc5, 0xe4, 0x03,
+    0x22, 0x41, 0x60, 0x7f, 0x9e, 0xbd, 0xdc, 0xfb, 0x1a, 0x39, 0x58, 0x77,
+    0x96, 0xb5, 0xd4, 0xf3, 0x12, 0x31, 0x50, 0x6f, 0x8e, 0xad, 0xcc, 0xeb,
+    0x0a, 0x29, 0x48, 0x67, 0x86, 0xa5, 0xc4, 0xe3, 0x02, 0x21, 0x40, 0x5f,
+    0x7e, 0x9d, 0xbc, 0xdb, 0xfa, 0x19, 0x38, 0x57, 0x76, 0x95, 0xb4, 0xd3,
+    0xf2, 0x11, 0x30, 0x4f, 0x6e, 0x8d, 0xac, 0xcb, 0xea, 0x09, 0x28, 0x47,
+    0x66, 0x85, 0xa4, 0xc3, 0xe2, 0x01, 0x20, 0x3f, 0x5e, 0x7d, 0x9c, 0xbb,
+    0xda, 0xf9, 0x18, 0x37, 0x56, 0x75, 0x94, 0xb3, 0xd2, 0xf1, 0x10, 0x2f,
+    0x4e, 0x6d, 0x8c, 0xab, 0xca, 0xe9, 0x08, 0x27, 0x46, 0x65, 0x84, 0xa3,
+    0xc2, 0xe1, 0x00, 0x1f, 0x3e, 0x5d, 0x7c, 0x9b, 0xba, 0xd9, 0xf8, 0x17,
+    0x36, 0x55, 0x74, 0x93, 0xb2, 0xd1, 0xf0, 0x0f, 0x2e, 0x4d, 0x6c, 0x8b,
+    0xaa, 0xc9, 0xe8, 0x58, 0x84, 0x01, 0x61, 0x70, 0x9a, 0x4c, 0xd1, 0xfe,
+    0x7a, 0x65, 0x9f, 0x2a, 0x20, 0xb7, 0x75, 0xb0, 0x91, 0x59, 0x06, 0xd2,
+    0x36, 0x36, 0xcd, 0x5d, 0x1c, 0xa2, 0x28, 0x2e, 0xa4, 0xea, 0x5b, 0xd5,
+    0x98, 0xca, 0x44, 0x4d, 0xdf, 0xc0, 0x4b, 0x67, 0x36, 0xef, 0xe6, 0xa3,
+    0xac, 0x06, 0xc8, 0x23, 0x26, 0x33, 0x82, 0xe1, 0xb3, 0x56, 0x01, 0xe1,
+    0x75, 0x0f, 0x42, 0x30, 0x8c, 0x4e, 0xdf, 0x2e, 0xab, 0xf8, 0x51, 0x01,
+    0x41, 0xf6, 0x9a, 0x2b, 0x96, 0x46, 0xe8, 0x2f, 0xd9, 0xa7, 0x0d, 0x3b,
+    0x80, 0xac, 0x37, 0x67, 0xf2, 0x2a, 0x16, 0x13, 0x5b, 0x45, 0xb3, 0x26,
+    0xdc, 0x1f, 0xda, 0xf8, 0x44, 0xf5, 0xfa, 0x80, 0x78, 0xd3, 0x9d, 0x3d,
+    0x11, 0xa5, 0xf7, 0xf2, 0xe1, 0xde, 0x94, 0x22, 0xda, 0xb7, 0xa4, 0xfb,
+    0x79, 0xe5, 0x1a, 0x41, 0xda, 0x1c, 0x14, 0xc3, 0x04, 0xe2, 0x8e, 0x46,
+    0xe3, 0x59, 0x21, 0x08, 0xa4
+};
+#endif /* T_COSE_DISABLE_ES512 */
+
+
+const struct bench_corpus_msg bench_corpus[] = {
+    {T_COSE_ALGORITHM_ES256, "example map from two_step_sign_example()",
+     {cose_sign1_es256_example, sizeof(cose_sign1_es256_example)}},
+    {T_COSE_ALGORITHM_ES256, "small text string",
+     {cose_sign1_es256_small, sizeof(cose_sign1_es256_small)}},
+    {T_COSE_ALGORITHM_ES256, "EAT-like token",
+     {cose_sign1_es256_eat, sizeof(cose_sign1_es256_eat)}},
+    {T_COSE_ALGORITHM_ES256, "1KB opaque payload",
+     {cose_sign1_es256_1k, sizeof(cose_sign1_es256_1k)}},
+#ifndef T_COSE_DISABLE_ES384
+    {T_COSE_ALGORITHM_ES384, "example map from two_step_sign_example()",
+     {cose_sign1_es384_example, sizeof(cose_sign1_es384_example)}},
+    {T_COSE_ALGORITHM_ES384, "small text string",
+     {cose_sign1_es384_small, sizeof(cose_sign1_es384_small)}},
+    {T_COSE_ALGORITHM_ES384, "EAT-like token",
+     {cose_sign1_es384_eat, sizeof(cose_sign1_es384_eat)}},
+    {T_COSE_ALGORITHM_ES384, "1KB opaque payload",
+     {cose_sign1_es384_1k, sizeof(cose_sign1_es384_1k)}},
+#endif
+#ifndef T_COSE_DISABLE_ES512
+    {T_COSE_ALGORITHM_ES512, "example map from two_step_sign_example()",
+     {cose_sign1_es512_example, sizeof(cose_sign1_es512_example)}},
+    {T_COSE_ALGORITHM_ES512, "small text string",
+     {cose_sign1_es512_small, sizeof(cose_sign1_es512_small)}},
+    {T_COSE_ALGORITHM_ES512, "EAT-like token",
+     {cose_sign1_es512_eat, sizeof(cose_sign1_es512_eat)}},
+    {T_COSE_ALGORITHM_ES512, "1KB opaque payload",
+     {cose_sign1_es512_1k, sizeof(cose_sign1_es512_1k)}},
+#endif
+};
+
+const size_t bench_corpus_count = sizeof(bench_corpus) / sizeof(bench_corpus[0]);
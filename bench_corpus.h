@@ -0,0 +1,46 @@
+/*
+ * bench_corpus.h
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+#ifndef bench_corpus_h
+#define bench_corpus_h
+
+#include "t_cose/t_cose_common.h"
+#include "t_cose/q_useful_buf.h"
+
+
+/**
+ * \file bench_corpus.h
+ *
+ * \brief Pre-signed COSE_Sign1 messages for verification benchmarks.
+ *
+ * These are valid tagged COSE_Sign1 messages signed with the fixed
+ * keys in tdv_keys_xxx.c. The protected header is just the algorithm
+ * ID, the unprotected header is empty and there is no external AAD.
+ * They verify with the key pair from make_ecdsa_key_pair() for the
+ * same algorithm.
+ *
+ * Messages for algorithms disabled with T_COSE_DISABLE_ES384 or
+ * T_COSE_DISABLE_ES512 are left out.
+ */
+
+
+struct bench_corpus_msg {
+    int32_t               cose_algorithm_id;
+    const char           *description;
+    struct q_useful_buf_c cose_sign1;
+};
+
+
+extern const struct bench_corpus_msg bench_corpus[];
+
+extern const size_t bench_corpus_count;
+
+
+#endif /* bench_corpus_h */
@@ -0,0 +1,74 @@
+/*
+ * bench_modes.h
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+#ifndef bench_modes_h
+#define bench_modes_h
+
+#include "bench.h"
+
+
+/**
+ * \file bench_modes.h
+ *
+ * \brief Benchmark modes that are in their own files.
+ *
+ * The basic modes are in bench.c. The bigger ones are each in their
+ * own bench_xxx.c and are listed here so bench.c can put them in its
+ * mode table. Each prints its own results and returns the number of
+ * errors.
+ */
+
+
+/**
+ * \brief One-step vs two-step signing over a range of payload sizes.
+ *
+ * See bench_sweep.c.
+ */
+int bench_sweep(const struct bench_config *config);
+
+
+/**
+ * \brief Time in each phase of two-step signing and of verifying,
+ *        with the hash and signature split out.
+ *
+ * See bench_phases.c.
+ */
+int bench_phases(const struct bench_config *config);
+
+
+/**
+ * \brief Throughput of split-phase signing against a simulated slow
+ *        signer with 1 to 64 messages in flight.
+ *
+ * See bench_async.c.
+ */
+int bench_async(const struct bench_config *config);
+
+
+#ifdef T_COSE_USE_OPENSSL_CRYPTO
+/**
+ * \brief Legacy EC_KEY vs OpenSSL 3 EVP_PKEY with pre-fetched
+ *        algorithms.
+ *
+ * See bench_ossl3.c. Only in bench_ossl.
+ */
+int bench_ossl3(const struct bench_config *config);
+
+
+/**
+ * \brief ECDSA signing with and without the presignature pool.
+ *
+ * See bench_presig.c. Only in bench_ossl.
+ */
+int bench_presig(const struct bench_config *config);
+#endif
+
+
+#endif /* bench_modes_h */
@@ -0,0 +1,387 @@
+/*
+ * bench_ossl3.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+#include "t_cose/t_cose_common.h"
+#include "t_cose/q_useful_buf.h"
+
+#include "bench_modes.h"
+#include "bench_corpus.h"
+#include "tdv_keystore.h"
+#include "tdv_ossl3.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "openssl/ecdsa.h"
+
+
+/**
+ * \file bench_ossl3.c
+ *
+ * \brief Legacy EC_KEY vs OpenSSL 3 EVP_PKEY signing and verifying.
+ *
+ * This is only in bench_ossl. Three ways of doing the hash and ECDSA
+ * that the t_cose OpenSSL crypto adapter does are compared:
+ *
+ *  - legacy: EC_KEY, EVP_sha256() and ECDSA_do_sign() as the adapter
+ *    and tdv_keys_ossl.c do them
+ *  - implicit: EVP_PKEY from EVP_PKEY_fromdata() with the algorithms
+ *    fetched implicitly on every call
+ *  - fetched: the same EVP_PKEY with the EVP_MD and EVP_SIGNATURE
+ *    fetched once, see tdv_ossl3.h
+ *
+ * Each is run on one thread for latency and then on 1 and on the
+ * maximum number of threads for throughput. The fetch lock shows up as
+ * lower scaling for the first two. The bytes hashed are the corpus
+ * message for the algorithm; only their length matters.
+ */
+
+
+#if TDV_OSSL3
+
+enum ossl3_path {
+    OSSL3_LEGACY,
+    OSSL3_IMPLICIT,
+    OSSL3_FETCHED,
+    OSSL3_NUM_PATHS
+};
+
+static const char *path_names[OSSL3_NUM_PATHS] = {"legacy", "implicit", "fetched"};
+
+
+/* One per thread as the signature buffer is written */
+struct ossl3_op_ctx {
+    enum ossl3_path              path;
+    int32_t                      cose_algorithm_id;
+    EC_KEY                      *ec_key;
+    EVP_PKEY                    *evp_key;
+    const struct tdv_ossl3_algs *algs;
+    struct q_useful_buf_c        tbs;
+    /* The signature to verify */
+    struct q_useful_buf_c        signature;
+    uint8_t                      signature_buffer[132];
+};
+
+
+/*
+ * What the t_cose 1.0 OpenSSL adapter does: hash with a legacy
+ * EVP_MD, then ECDSA_do_sign() on the EC_KEY and convert to the COSE
+ * format.
+ */
+static enum t_cose_err_t legacy_sign(struct ossl3_op_ctx *ctx, struct q_useful_buf_c *signature)
+{
+    const EVP_MD  *md;
+    size_t         coord_len;
+    unsigned char  hash[EVP_MAX_MD_SIZE];
+    unsigned int   hash_len;
+    ECDSA_SIG     *ecdsa_sig;
+    const BIGNUM  *r;
+    const BIGNUM  *s;
+
+    switch(ctx->cose_algorithm_id) {
+    case T_COSE_ALGORITHM_ES256: md = EVP_sha256(); coord_len = 32; break;
+    case T_COSE_ALGORITHM_ES384: md = EVP_sha384(); coord_len = 48; break;
+    case T_COSE_ALGORITHM_ES512: md = EVP_sha512(); coord_len = 66; break;
+    default:
+        return T_COSE_ERR_UNSUPPORTED_SIGNING_ALG;
+    }
+
+    if(!EVP_Digest(ctx->tbs.ptr, ctx->tbs.len, hash, &hash_len, md, NULL)) {
+        return T_COSE_ERR_HASH_GENERAL_FAIL;
+    }
+    ecdsa_sig = ECDSA_do_sign(hash, (int)hash_len, ctx->ec_key);
+    if(ecdsa_sig == NULL) {
+        return T_COSE_ERR_SIG_FAIL;
+    }
+    ECDSA_SIG_get0(ecdsa_sig, &r, &s);
+    BN_bn2binpad(r, ctx->signature_buffer, (int)coord_len);
+    BN_bn2binpad(s, ctx->signature_buffer + coord_len, (int)coord_len);
+    ECDSA_SIG_free(ecdsa_sig);
+
+    signature->ptr = ctx->signature_buffer;
+    signature->len = coord_len * 2;
+    return T_COSE_SUCCESS;
+}
+
+
+static enum t_cose_err_t legacy_verify(struct ossl3_op_ctx *ctx)
+{
+    const EVP_MD      *md;
+    size_t             coord_len;
+    unsigned char      hash[EVP_MAX_MD_SIZE];
+    unsigned int       hash_len;
+    ECDSA_SIG         *ecdsa_sig;
+    BIGNUM            *r;
+    BIGNUM            *s;
+    enum t_cose_err_t  return_value;
+
+    switch(ctx->cose_algorithm_id) {
+    case T_COSE_ALGORITHM_ES256: md = EVP_sha256(); coord_len = 32; break;
+    case T_COSE_ALGORITHM_ES384: md = EVP_sha384(); coord_len = 48; break;
+    case T_COSE_ALGORITHM_ES512: md = EVP_sha512(); coord_len = 66; break;
+    default:
+        return T_COSE_ERR_UNSUPPORTED_SIGNING_ALG;
+    }
+
+    if(!EVP_Digest(ctx->tbs.ptr, ctx->tbs.len, hash, &hash_len, md, NULL)) {
+        return T_COSE_ERR_HASH_GENERAL_FAIL;
+    }
+
+    r = BN_bin2bn(ctx->signature.ptr, (int)coord_len, NULL);
+    s = BN_bin2bn((const uint8_t *)ctx->signature.ptr + coord_len, (int)coord_len, NULL);
+    ecdsa_sig = ECDSA_SIG_new();
+    if(r == NULL || s == NULL || ecdsa_sig == NULL || !ECDSA_SIG_set0(ecdsa_sig, r, s)) {
+        BN_free(r);
+        BN_free(s);
+        ECDSA_SIG_free(ecdsa_sig);
+        return T_COSE_ERR_INSUFFICIENT_MEMORY;
+    }
+
+    if(ECDSA_do_verify(hash, (int)hash_len, ecdsa_sig, ctx->ec_key) == 1) {
+        return_value = T_COSE_SUCCESS;
+    } else {
+        return_value = T_COSE_ERR_SIG_VERIFY;
+    }
+    ECDSA_SIG_free(ecdsa_sig);
+
+    return return_value;
+}
+
+
+/*
+ * The signature made is left in ctx->signature.
+ */
+static enum t_cose_err_t ossl3_sign_op(void *op_ctx)
+{
+    struct ossl3_op_ctx *ctx = (struct ossl3_op_ctx *)op_ctx;
+    struct q_useful_buf  signature_buffer;
+
+    if(ctx->path == OSSL3_LEGACY) {
+        return legacy_sign(ctx, &ctx->signature);
+    }
+    signature_buffer.ptr = ctx->signature_buffer;
+    signature_buffer.len = sizeof(ctx->signature_buffer);
+    return tdv_ossl3_sign(ctx->path == OSSL3_FETCHED ? ctx->algs : NULL,
+                          ctx->evp_key,
+                          ctx->cose_algorithm_id,
+                          ctx->tbs,
+                          signature_buffer,
+                          &ctx->signature);
+}
+
+
+static enum t_cose_err_t ossl3_verify_op(void *op_ctx)
+{
+    struct ossl3_op_ctx *ctx = (struct ossl3_op_ctx *)op_ctx;
+
+    if(ctx->path == OSSL3_LEGACY) {
+        return legacy_verify(ctx);
+    }
+    return tdv_ossl3_verify(ctx->path == OSSL3_FETCHED ? ctx->algs : NULL,
+                            ctx->evp_key,
+                            ctx->cose_algorithm_id,
+                            ctx->tbs,
+                            ctx->signature);
+}
+
+
+/*
+ * Single thread latency then throughput on 1 and max threads for one
+ * operation on each of the paths.
+ */
+static int ossl3_compare(const struct bench_config *config,
+                         const char                *alg,
+                         const char                *op_name,
+                         bench_op_fn                op,
+                         struct ossl3_op_ctx       *ctxs,
+                         void                      *op_ctxs[])
+{
+    struct bench_result result;
+    enum t_cose_err_t   return_value;
+    double              one_thread;
+    double              all_threads;
+    char                label[32];
+    unsigned            t;
+    int                 path;
+    int                 errors;
+
+    errors = 0;
+    for(path = 0; path < OSSL3_NUM_PATHS; path++) {
+        for(t = 0; t < config->max_threads; t++) {
+            ctxs[t].path = (enum ossl3_path)path;
+        }
+        snprintf(label, sizeof(label), "%s %s %s", alg, op_name, path_names[path]);
+
+        return_value = bench_run(config, op, &ctxs[0], &result);
+        if(!return_value) {
+            return_value = bench_run_threaded(config, 1, op, op_ctxs, &one_thread);
+        }
+        if(!return_value) {
+            return_value = bench_run_threaded(config, config->max_threads, op, op_ctxs, &all_threads);
+        }
+        if(return_value) {
+            printf("%-24s failed: %d\n", label, return_value);
+            errors++;
+            continue;
+        }
+
+        bench_print_result(label, &result);
+        printf("%-24s %u threads %.1f ops/sec, %.2fx of 1 thread, %.1f%% efficiency\n",
+               "", config->max_threads, all_threads, all_threads / one_thread,
+               100 * all_threads / (one_thread * config->max_threads));
+        fflush(stdout);
+    }
+
+    return errors;
+}
+
+
+static const int32_t ossl3_algs[] = {
+    T_COSE_ALGORITHM_ES256,
+#ifndef T_COSE_DISABLE_ES384
+    T_COSE_ALGORITHM_ES384,
+#endif
+#ifndef T_COSE_DISABLE_ES512
+    T_COSE_ALGORITHM_ES512,
+#endif
+};
+
+static const char *ossl3_alg_names[] = {
+    "ES256",
+#ifndef T_COSE_DISABLE_ES384
+    "ES384",
+#endif
+#ifndef T_COSE_DISABLE_ES512
+    "ES512",
+#endif
+};
+
+
+/*
+ * Public function. See bench_modes.h
+ */
+int bench_ossl3(const struct bench_config *config)
+{
+    struct tdv_ossl3_algs algs;
+    struct ossl3_op_ctx  *ctxs;
+    void                **op_ctxs;
+    struct t_cose_key     legacy_key;
+    EVP_PKEY             *evp_key;
+    struct ossl3_op_ctx   setup;
+    struct q_useful_buf_c tbs;
+    enum t_cose_err_t     return_value;
+    size_t                i;
+    size_t                j;
+    unsigned              t;
+    int                   errors;
+
+    return_value = tdv_ossl3_algs_fetch(&algs, NULL, NULL);
+    if(return_value) {
+        printf("ossl3: fetch failed: %d\n", return_value);
+        return 1;
+    }
+
+    ctxs    = calloc(config->max_threads, sizeof(struct ossl3_op_ctx));
+    op_ctxs = calloc(config->max_threads, sizeof(void *));
+    if(ctxs == NULL || op_ctxs == NULL) {
+        printf("ossl3: out of memory\n");
+        errors = 1;
+        goto Done;
+    }
+
+    printf("\nLegacy EC_KEY vs EVP_PKEY with implicit vs pre-fetched algorithms, %s\n",
+           OPENSSL_VERSION_TEXT);
+    bench_print_header();
+
+    errors = 0;
+    for(i = 0; i < sizeof(ossl3_algs) / sizeof(ossl3_algs[0]); i++) {
+        tbs = NULL_Q_USEFUL_BUF_C;
+        for(j = 0; j < bench_corpus_count; j++) {
+            if(bench_corpus[j].cose_algorithm_id == ossl3_algs[i]) {
+                tbs = bench_corpus[j].cose_sign1;
+                break;
+            }
+        }
+
+        return_value = tdv_keystore_find(config->keys,
+                                         ossl3_algs[i],
+                                         TDV_KEYSTORE_BUILTIN,
+                                         1,
+                                         &legacy_key);
+        if(return_value) {
+            printf("%-24s no key: %d\n", ossl3_alg_names[i], return_value);
+            errors++;
+            continue;
+        }
+        return_value = make_evp_ecdsa_key_pair(NULL, ossl3_algs[i], &evp_key);
+        if(return_value) {
+            printf("%-24s make EVP key failed: %d\n", ossl3_alg_names[i], return_value);
+            errors++;
+            continue;
+        }
+
+        setup.path              = OSSL3_FETCHED;
+        setup.cose_algorithm_id = ossl3_algs[i];
+        setup.ec_key            = (EC_KEY *)legacy_key.k.key_ptr;
+        setup.evp_key           = evp_key;
+        setup.algs              = &algs;
+        setup.tbs               = tbs;
+        setup.signature         = NULL_Q_USEFUL_BUF_C;
+
+        /* A signature for the verifies. Being the same key, any path
+         * can verify it. */
+        return_value = ossl3_sign_op(&setup);
+        if(return_value) {
+            printf("%-24s sign failed: %d\n", ossl3_alg_names[i], return_value);
+            EVP_PKEY_free(evp_key);
+            errors++;
+            continue;
+        }
+
+        for(t = 0; t < config->max_threads; t++) {
+            ctxs[t]               = setup;
+            /* Point at the copy's own buffer, not the set up one */
+            ctxs[t].signature.ptr = ctxs[t].signature_buffer;
+            op_ctxs[t]            = &ctxs[t];
+        }
+        errors += ossl3_compare(config, ossl3_alg_names[i], "sign", ossl3_sign_op, ctxs, op_ctxs);
+
+        /* Signing overwrote the buffers so put the signature back */
+        for(t = 0; t < config->max_threads; t++) {
+            ctxs[t]               = setup;
+            ctxs[t].signature.ptr = ctxs[t].signature_buffer;
+        }
+        errors += ossl3_compare(config, ossl3_alg_names[i], "verify", ossl3_verify_op, ctxs, op_ctxs);
+
+        EVP_PKEY_free(evp_key);
+    }
+
+Done:
+    free(ctxs);
+    free(op_ctxs);
+    tdv_ossl3_algs_free(&algs);
+    return errors;
+}
+
+
+#else /* TDV_OSSL3 */
+
+/*
+ * Public function. See bench_modes.h
+ */
+int bench_ossl3(const struct bench_config *config)
+{
+    (void)config; /* Avoid unused parameter error */
+
+    printf("\nossl3: needs OpenSSL 3.0 or later, this is %s\n", OPENSSL_VERSION_TEXT);
+    return 0;
+}
+
+#endif /* TDV_OSSL3 */
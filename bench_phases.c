@@ -0,0 +1,348 @@
+/*
+ * bench_phases.c, derived from encode_only_ossl.c and decode_only_ossl.c
+ *
+ * Copyright 2019-2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+#include "t_cose/t_cose_common.h"
+#include "t_cose/t_cose_sign1_sign.h"
+#include "t_cose/t_cose_sign1_verify.h"
+#include "t_cose/q_useful_buf.h"
+
+#include "bench_corpus.h"
+#include "bench_modes.h"
+#include "tdv_keystore.h"
+#include "tdv_phase.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+/**
+ * \file bench_phases.c
+ *
+ * \brief Time in each phase of two-step signing and of verifying.
+ *
+ * Signing is done as two_step_sign_example() does it and each of its
+ * phases is timed: t_cose_sign1_encode_parameters(), the payload
+ * QCBOREncode_xxx() calls, t_cose_sign1_encode_signature() and
+ * QCBOREncode_Finish(). Verification of the messages in
+ * bench_corpus.c is split into the set up and t_cose_sign1_verify().
+ *
+ * When built with PHASE_TIMING=1, t_cose_sign1_encode_signature() and
+ * t_cose_sign1_verify() are further split into the hashing, the
+ * signature algorithm and the rest, which is t_cose's CBOR encoding
+ * or decoding. See tdv_phase.h.
+ *
+ * A regression then shows up in the CBOR encoding, the hashing or the
+ * crypto library. The clock is read between the phases so the times
+ * include about one clock read each, some tens of ns.
+ */
+
+
+/* Sums over all the timed iterations */
+struct phase_sums {
+    uint64_t               ns[5];
+    struct tdv_phase_times inside;
+};
+
+
+static const char *alg_name(int32_t cose_algorithm_id)
+{
+    switch(cose_algorithm_id) {
+    case T_COSE_ALGORITHM_ES256: return "ES256";
+    case T_COSE_ALGORITHM_ES384: return "ES384";
+    case T_COSE_ALGORITHM_ES512: return "ES512";
+    default:                     return "unknown";
+    }
+}
+
+
+/*
+ * Two-step signing as two_step_sign_example() does it with the time
+ * of each phase added to ns[]: set up, parameters, payload, signature
+ * and finish.
+ */
+static enum t_cose_err_t sign_phases(int32_t           cose_algorithm_id,
+                                     struct t_cose_key key_pair,
+                                     uint64_t          ns[])
+{
+    struct t_cose_sign1_sign_ctx sign_ctx;
+    QCBOREncodeContext           cbor_encode;
+    enum t_cose_err_t            return_value;
+    struct q_useful_buf_c        signed_cose;
+    uint64_t                     t[6];
+    int                          i;
+    Q_USEFUL_BUF_MAKE_STACK_UB(  signed_cose_buffer, 300);
+
+    t[0] = bench_now_ns();
+    QCBOREncode_Init(&cbor_encode, signed_cose_buffer);
+    t_cose_sign1_sign_init(&sign_ctx, 0, cose_algorithm_id);
+    t_cose_sign1_set_signing_key(&sign_ctx, key_pair, NULL_Q_USEFUL_BUF_C);
+
+    t[1] = bench_now_ns();
+    return_value = t_cose_sign1_encode_parameters(&sign_ctx, &cbor_encode);
+    if(return_value) {
+        return return_value;
+    }
+
+    t[2] = bench_now_ns();
+    QCBOREncode_OpenMap(&cbor_encode);
+    QCBOREncode_AddSZStringToMap(&cbor_encode, "BeingType", "Humanoid");
+    QCBOREncode_AddSZStringToMap(&cbor_encode, "Greeting", "We come in peace");
+    QCBOREncode_AddInt64ToMap(&cbor_encode, "ArmCount", 2);
+    QCBOREncode_AddInt64ToMap(&cbor_encode, "HeadCount", 1);
+    QCBOREncode_AddSZStringToMap(&cbor_encode, "BrainSize", "medium");
+    QCBOREncode_AddBoolToMap(&cbor_encode, "DrinksWater", true);
+    QCBOREncode_CloseMap(&cbor_encode);
+
+    t[3] = bench_now_ns();
+    return_value = t_cose_sign1_encode_signature(&sign_ctx, &cbor_encode);
+    if(return_value) {
+        return return_value;
+    }
+
+    t[4] = bench_now_ns();
+    if(QCBOREncode_Finish(&cbor_encode, &signed_cose)) {
+        return T_COSE_ERR_CBOR_FORMATTING;
+    }
+    t[5] = bench_now_ns();
+
+    for(i = 0; i < 5; i++) {
+        ns[i] += t[i + 1] - t[i];
+    }
+    return T_COSE_SUCCESS;
+}
+
+
+/*
+ * Verification of one message with the time of the set up and of
+ * t_cose_sign1_verify() added to ns[].
+ */
+static enum t_cose_err_t verify_phases(struct q_useful_buf_c cose_sign1,
+                                       struct t_cose_key     key_pair,
+                                       uint64_t              ns[])
+{
+    struct t_cose_sign1_verify_ctx verify_ctx;
+    enum t_cose_err_t              return_value;
+    struct q_useful_buf_c          payload;
+    uint64_t                       t[3];
+
+    t[0] = bench_now_ns();
+    t_cose_sign1_verify_init(&verify_ctx, 0);
+    t_cose_sign1_set_verification_key(&verify_ctx, key_pair);
+
+    t[1] = bench_now_ns();
+    return_value = t_cose_sign1_verify(&verify_ctx, cose_sign1, &payload, NULL);
+    t[2] = bench_now_ns();
+    if(return_value) {
+        return return_value;
+    }
+
+    ns[0] += t[1] - t[0];
+    ns[1] += t[2] - t[1];
+    return T_COSE_SUCCESS;
+}
+
+
+static void print_phase(const char *label, uint64_t ns, uint64_t total_ns, uint64_t count)
+{
+    printf("  %-36s %10.0f %6.1f%%\n",
+           label,
+           (double)ns / (double)count,
+           total_ns ? 100.0 * (double)ns / (double)total_ns : 0);
+}
+
+
+/*
+ * The part of an outer phase that is inside, or 0 if the clock
+ * granularity made inside come out larger.
+ */
+static uint64_t rest(uint64_t outer, uint64_t inside)
+{
+    return outer > inside ? outer - inside : 0;
+}
+
+
+static void print_sign(const char *label, const struct phase_sums *sums, uint64_t count, int have_inside)
+{
+    static const char *names[] = {
+        "sign init and set key",
+        "t_cose_sign1_encode_parameters()",
+        "payload QCBOREncode_xxx()",
+        "t_cose_sign1_encode_signature()",
+        "QCBOREncode_Finish()",
+    };
+    uint64_t total;
+    uint64_t hash_ns;
+    uint64_t sign_ns;
+    int      i;
+
+    total = 0;
+    for(i = 0; i < 5; i++) {
+        total += sums->ns[i];
+    }
+
+    printf("\n%-38s %10s %7s\n", label, "ns/op", "share");
+    for(i = 0; i < 5; i++) {
+        print_phase(names[i], sums->ns[i], total, count);
+        if(i == 3 && have_inside) {
+            hash_ns = sums->inside.ns[TDV_PHASE_HASH];
+            sign_ns = sums->inside.ns[TDV_PHASE_SIGN];
+            print_phase("  hash", hash_ns, total, count);
+            print_phase("  sign", sign_ns, total, count);
+            print_phase("  CBOR and other", rest(sums->ns[3], hash_ns + sign_ns), total, count);
+        }
+    }
+    print_phase("total", total, total, count);
+}
+
+
+static void print_verify(const char *label, const struct phase_sums *sums, uint64_t count, int have_inside)
+{
+    uint64_t total;
+    uint64_t hash_ns;
+    uint64_t verify_ns;
+
+    total = sums->ns[0] + sums->ns[1];
+
+    printf("\n%-38s %10s %7s\n", label, "ns/op", "share");
+    print_phase("verify init and set key", sums->ns[0], total, count);
+    print_phase("t_cose_sign1_verify()", sums->ns[1], total, count);
+    if(have_inside) {
+        hash_ns   = sums->inside.ns[TDV_PHASE_HASH];
+        verify_ns = sums->inside.ns[TDV_PHASE_VERIFY];
+        print_phase("  hash", hash_ns, total, count);
+        print_phase("  verify", verify_ns, total, count);
+        print_phase("  CBOR and other", rest(sums->ns[1], hash_ns + verify_ns), total, count);
+    }
+    print_phase("total", total, total, count);
+}
+
+
+static void inside_diff(struct tdv_phase_times       *sum,
+                        const struct tdv_phase_times *before,
+                        const struct tdv_phase_times *after)
+{
+    int i;
+
+    for(i = 0; i < TDV_NUM_PHASES; i++) {
+        sum->ns[i]    += after->ns[i] - before->ns[i];
+        sum->calls[i] += after->calls[i] - before->calls[i];
+    }
+}
+
+
+/*
+ * Public function. See bench_modes.h
+ */
+int bench_phases(const struct bench_config *config)
+{
+    struct t_cose_key      sign_key;
+    struct t_cose_key      verify_key;
+    struct phase_sums      sums;
+    struct tdv_phase_times before;
+    struct tdv_phase_times after;
+    enum t_cose_err_t      return_value;
+    int32_t                cose_algorithm_id;
+    uint64_t               count;
+    unsigned               n;
+    int                    have_inside;
+    int                    errors;
+    char                   label[48];
+    size_t                 i;
+    size_t                 j;
+
+    static const int32_t algs[] = {
+        T_COSE_ALGORITHM_ES256,
+#ifndef T_COSE_DISABLE_ES384
+        T_COSE_ALGORITHM_ES384,
+#endif
+#ifndef T_COSE_DISABLE_ES512
+        T_COSE_ALGORITHM_ES512,
+#endif
+    };
+
+    count       = (uint64_t)config->runs * config->iterations;
+    have_inside = !tdv_phase_get(&before);
+    if(!have_inside) {
+        printf("\nHash and signature times are not split out; build with PHASE_TIMING=1\n");
+    }
+
+    errors = 0;
+    for(i = 0; i < sizeof(algs) / sizeof(algs[0]); i++) {
+        cose_algorithm_id = algs[i];
+
+        return_value = tdv_keystore_find(config->keys, cose_algorithm_id, NULL, 1, &sign_key);
+        if(!return_value) {
+            return_value = tdv_keystore_find(config->keys,
+                                             cose_algorithm_id,
+                                             TDV_KEYSTORE_BUILTIN,
+                                             0,
+                                             &verify_key);
+        }
+        if(return_value) {
+            printf("%s no key: %d\n", alg_name(cose_algorithm_id), return_value);
+            errors++;
+            continue;
+        }
+
+        /* Signing */
+        memset(&sums, 0, sizeof(sums));
+        for(n = 0; n < config->warmup && !return_value; n++) {
+            return_value = sign_phases(cose_algorithm_id, sign_key, sums.ns);
+        }
+        memset(&sums, 0, sizeof(sums));
+        tdv_phase_get(&before);
+        for(n = 0; n < count && !return_value; n++) {
+            return_value = sign_phases(cose_algorithm_id, sign_key, sums.ns);
+        }
+        tdv_phase_get(&after);
+        inside_diff(&sums.inside, &before, &after);
+        snprintf(label, sizeof(label), "%s two-step sign", alg_name(cose_algorithm_id));
+        if(return_value) {
+            printf("%s failed: %d\n", label, return_value);
+            errors++;
+        } else {
+            if(have_inside && sums.inside.calls[TDV_PHASE_SIGN] == 0) {
+                printf("\nPHASE_TIMING is built in but t_cose's calls were not wrapped; check the link\n");
+                have_inside = 0;
+            }
+            print_sign(label, &sums, count, have_inside);
+        }
+
+        /* Verification, one per corpus message for the algorithm as
+         * they hash different amounts */
+        for(j = 0; j < bench_corpus_count; j++) {
+            if(bench_corpus[j].cose_algorithm_id != cose_algorithm_id) {
+                continue;
+            }
+            memset(&sums, 0, sizeof(sums));
+            return_value = T_COSE_SUCCESS;
+            for(n = 0; n < config->warmup && !return_value; n++) {
+                return_value = verify_phases(bench_corpus[j].cose_sign1, verify_key, sums.ns);
+            }
+            memset(&sums, 0, sizeof(sums));
+            tdv_phase_get(&before);
+            for(n = 0; n < count && !return_value; n++) {
+                return_value = verify_phases(bench_corpus[j].cose_sign1, verify_key, sums.ns);
+            }
+            tdv_phase_get(&after);
+            inside_diff(&sums.inside, &before, &after);
+            snprintf(label, sizeof(label), "%s verify %zuB",
+                     alg_name(cose_algorithm_id), bench_corpus[j].cose_sign1.len);
+            if(return_value) {
+                printf("%s failed: %d\n", label, return_value);
+                errors++;
+            } else {
+                print_verify(label, &sums, count, have_inside);
+            }
+        }
+    }
+
+    return errors;
+}
@@ -0,0 +1,247 @@
+/*
+ * bench_presig.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+/* For nanosleep() and clock_gettime() */
+#define _POSIX_C_SOURCE 200809L
+
+#include "t_cose/t_cose_common.h"
+#include "t_cose/t_cose_sign1_verify.h"
+#include "t_cose/q_useful_buf.h"
+
+#include "bench_modes.h"
+#include "tdv_keystore.h"
+#include "tdv_prepared.h"
+#include "tdv_presig.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+
+/**
+ * \file bench_presig.c
+ *
+ * \brief ECDSA signing with and without the presignature pool.
+ *
+ * This is only in bench_ossl. For ES256, ES384 and ES512 a 200 byte
+ * payload, about the size of a CWT, is signed with a prepared signer,
+ * first with t_cose_crypto_sign() and then with pairs from the pool
+ * in tdv_presig.h.
+ *
+ * The pool is made big enough for the warmup and all the timed
+ * operations and is filled before timing starts. The latency is
+ * that of the request path with a pool that never runs dry. The
+ * rate the background threads filled the pool at is also printed. It
+ * is the most signatures per second that can be kept up before the
+ * pool empties and signing falls back to the usual way, which shows
+ * as misses.
+ */
+
+
+#define PRESIG_PAYLOAD_SIZE  200
+
+/* How long to wait for the pool to fill */
+#define PRESIG_FILL_TIMEOUT_SEC  60
+
+
+struct presig_op_ctx {
+    struct tdv_prepared_signer signer;
+    struct q_useful_buf_c      payload;
+    uint8_t                    signed_cose_buffer[PRESIG_PAYLOAD_SIZE + 200];
+    struct q_useful_buf_c      signed_cose;
+};
+
+
+static enum t_cose_err_t presig_op(void *op_ctx)
+{
+    struct presig_op_ctx *ctx = (struct presig_op_ctx *)op_ctx;
+
+    return tdv_prepared_sign(&ctx->signer,
+                             ctx->payload,
+                             (struct q_useful_buf){ctx->signed_cose_buffer,
+                                                   sizeof(ctx->signed_cose_buffer)},
+                             &ctx->signed_cose);
+}
+
+
+/*
+ * Sign once and verify it with t_cose so a fast but wrong signature
+ * doesn't go unnoticed.
+ */
+static enum t_cose_err_t check_op(struct presig_op_ctx *ctx, struct t_cose_key key_pair)
+{
+    struct t_cose_sign1_verify_ctx verify_ctx;
+    struct q_useful_buf_c          payload;
+    enum t_cose_err_t              return_value;
+
+    return_value = presig_op(ctx);
+    if(return_value) {
+        return return_value;
+    }
+
+    t_cose_sign1_verify_init(&verify_ctx, 0);
+    t_cose_sign1_set_verification_key(&verify_ctx, key_pair);
+    return t_cose_sign1_verify(&verify_ctx, ctx->signed_cose, &payload, NULL);
+}
+
+
+static double now_sec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+
+/*
+ * Wait for the pool to hold size pairs. Returns the pairs per second
+ * it was filled at, or 0 if it didn't fill in time.
+ */
+static double wait_for_fill(struct tdv_presig_pool *pool, size_t size)
+{
+    const struct timespec poll = {0, 1000000};
+    double                start;
+    double                elapsed;
+
+    start = now_sec();
+    while(tdv_presig_pool_level(pool) < size) {
+        if(now_sec() - start > PRESIG_FILL_TIMEOUT_SEC) {
+            return 0;
+        }
+        nanosleep(&poll, NULL);
+    }
+    elapsed = now_sec() - start;
+
+    return elapsed > 0 ? (double)size / elapsed : 0;
+}
+
+
+static int presig_alg(const struct bench_config *config,
+                      int32_t                    cose_algorithm_id,
+                      const char                *alg_name,
+                      unsigned                   num_threads)
+{
+    struct presig_op_ctx   ctx;
+    struct tdv_presig_pool pool;
+    struct t_cose_key      key_pair;
+    struct bench_result    plain;
+    struct bench_result    result;
+    enum t_cose_err_t      return_value;
+    uint8_t                payload[PRESIG_PAYLOAD_SIZE];
+    char                   label[32];
+    size_t                 pool_size;
+    double                 fill_rate;
+    uint64_t               hits;
+    uint64_t               misses;
+    int                    errors;
+
+    return_value = tdv_keystore_find(config->keys, cose_algorithm_id, NULL, 1, &key_pair);
+    if(return_value) {
+        printf("%-24s no key: %d\n", alg_name, return_value);
+        return 1;
+    }
+
+    memset(payload, 'x', sizeof(payload));
+    ctx.payload = (struct q_useful_buf_c){payload, sizeof(payload)};
+
+    return_value = tdv_prepared_signer_init(&ctx.signer, 0, cose_algorithm_id, key_pair, NULL_Q_USEFUL_BUF_C);
+    if(return_value) {
+        printf("%-24s prepared signer failed: %d\n", alg_name, return_value);
+        return 1;
+    }
+
+    errors = 0;
+
+    snprintf(label, sizeof(label), "%s sign", alg_name);
+    return_value = bench_run(config, presig_op, &ctx, &plain);
+    if(return_value) {
+        printf("%-24s failed: %d\n", label, return_value);
+        errors++;
+        goto Done;
+    }
+    bench_print_result(label, &plain);
+
+    /* Enough for every op bench_run() does, plus the check */
+    pool_size = (size_t)config->warmup + (size_t)config->runs * config->iterations + 1;
+    if(pool_size > TDV_PRESIG_MAX_SIZE) {
+        pool_size = TDV_PRESIG_MAX_SIZE;
+    }
+    return_value = tdv_presig_pool_start(&pool, cose_algorithm_id, key_pair, pool_size, num_threads);
+    if(return_value) {
+        printf("%-24s pool failed: %d\n", alg_name, return_value);
+        errors++;
+        goto Done;
+    }
+    tdv_prepared_set_sign_fn(&ctx.signer, tdv_presig_sign, &pool);
+
+    fill_rate = wait_for_fill(&pool, pool_size);
+
+    snprintf(label, sizeof(label), "%s sign presig", alg_name);
+    return_value = check_op(&ctx, key_pair);
+    if(return_value == T_COSE_SUCCESS) {
+        return_value = bench_run(config, presig_op, &ctx, &result);
+    }
+    tdv_presig_pool_counts(&pool, &hits, &misses);
+    tdv_presig_pool_stop(&pool);
+    if(return_value) {
+        printf("%-24s failed: %d\n", label, return_value);
+        errors++;
+        goto Done;
+    }
+    bench_print_result(label, &result);
+
+    printf("%-24s %.2f us/msg (%.1f%%) mean, %.2f us p99\n",
+           "  saved",
+           (plain.mean_ns - result.mean_ns) / 1000.0,
+           plain.mean_ns > 0 ? 100.0 * (plain.mean_ns - result.mean_ns) / plain.mean_ns : 0.0,
+           (plain.p99_ns - result.p99_ns) / 1000.0);
+    printf("%-24s %llu hits, %llu misses, filled at %.0f/s on %u threads\n",
+           "  pool",
+           (unsigned long long)hits,
+           (unsigned long long)misses,
+           fill_rate,
+           num_threads);
+
+Done:
+    tdv_prepared_signer_free(&ctx.signer);
+    return errors;
+}
+
+
+/*
+ * Public function. See bench_modes.h
+ */
+int bench_presig(const struct bench_config *config)
+{
+    unsigned num_threads;
+    int      errors;
+
+    /* All but one CPU, which is left for the signer being timed */
+    num_threads = bench_num_cpus();
+    num_threads = num_threads > 1 ? num_threads - 1 : 1;
+    if(num_threads > TDV_PRESIG_MAX_THREADS) {
+        num_threads = TDV_PRESIG_MAX_THREADS;
+    }
+
+    printf("\nECDSA presignature pool, %d byte payload\n", PRESIG_PAYLOAD_SIZE);
+    bench_print_header();
+
+    errors = 0;
+    errors += presig_alg(config, T_COSE_ALGORITHM_ES256, "ES256", num_threads);
+#ifndef T_COSE_DISABLE_ES384
+    errors += presig_alg(config, T_COSE_ALGORITHM_ES384, "ES384", num_threads);
+#endif
+#ifndef T_COSE_DISABLE_ES512
+    errors += presig_alg(config, T_COSE_ALGORITHM_ES512, "ES512", num_threads);
+#endif
+
+    return errors;
+}
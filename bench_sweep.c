@@ -0,0 +1,378 @@
+/*
+ * bench_sweep.c, derived from encode_only_ossl.c
+ *
+ * Copyright 2019-2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+/* For wait4() */
+#define _DEFAULT_SOURCE
+
+#include "t_cose/t_cose_common.h"
+#include "t_cose/t_cose_sign1_sign.h"
+#include "t_cose/q_useful_buf.h"
+
+#include "bench_modes.h"
+#include "tdv_keys.h"
+#include "tdv_keystore.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+
+/**
+ * \file bench_sweep.c
+ *
+ * \brief Payload size sweep of one-step and two-step signing.
+ *
+ * The comments in encode_only_xxx.c say two-step signing uses less
+ * memory than t_cose_sign1_sign() because the payload doesn't have
+ * to be encoded into a separate buffer first. This measures it. For
+ * payload sizes from 16 bytes to 64MB, the payload is signed with
+ * both APIs as one_step_sign_example() and two_step_sign_example()
+ * do it and the throughput, peak RSS and the extra buffer needed are
+ * reported.
+ *
+ * The payload is a CBOR byte string made from application data that
+ * is already in memory. The application data and the output buffer
+ * are the same for both APIs. The one-step API needs the
+ * constructed_payload_buffer in addition; that is the "extra bytes"
+ * column.
+ *
+ * Each measurement is done in a child process so its peak RSS can be
+ * had from wait4(). A child that allocates and touches the
+ * application data and output buffer and signs an empty payload
+ * gives the baseline that is subtracted. Only ES256 is used since
+ * the payload size affects hashing, not the signature algorithm.
+ */
+
+
+/* Smallest and largest payload, multiplied by 4 each step */
+#define SWEEP_MIN_SIZE       16
+#define SWEEP_MAX_SIZE       (64 * 1024 * 1024)
+
+/* The iterations per run are reduced for big payloads so a run hashes
+ * about this much */
+#define SWEEP_BYTES_PER_RUN  (64 * 1024 * 1024)
+
+/* Room in the output for everything but the payload, including an
+ * ES512 signature */
+#define SWEEP_COSE_OVERHEAD  200
+
+/* The most a CBOR head for the byte string payload can be */
+#define SWEEP_BSTR_HEAD      9
+
+
+enum sweep_method {
+    SWEEP_BASELINE,
+    SWEEP_ONE_STEP,
+    SWEEP_TWO_STEP,
+};
+
+
+struct sweep_ctx {
+    enum sweep_method     method;
+    struct t_cose_key     key_pair;
+    /* The application data, the content of the byte string payload */
+    struct q_useful_buf_c app_data;
+    struct q_useful_buf   signed_cose_buffer;
+    /* Only for one-step */
+    struct q_useful_buf   constructed_payload_buffer;
+    size_t                extra_bytes;
+};
+
+
+/*
+ * As one_step_sign_example() does it. The payload is encoded into
+ * its own buffer and t_cose_sign1_sign() copies it into the output.
+ */
+static enum t_cose_err_t one_step_op(void *op_ctx)
+{
+    struct sweep_ctx             *ctx = (struct sweep_ctx *)op_ctx;
+    struct t_cose_sign1_sign_ctx  sign_ctx;
+    QCBOREncodeContext            cbor_encode;
+    struct q_useful_buf_c         constructed_payload;
+    struct q_useful_buf_c         signed_cose;
+
+    QCBOREncode_Init(&cbor_encode, ctx->constructed_payload_buffer);
+    QCBOREncode_AddBytes(&cbor_encode, ctx->app_data);
+    if(QCBOREncode_Finish(&cbor_encode, &constructed_payload)) {
+        return T_COSE_ERR_CBOR_FORMATTING;
+    }
+    ctx->extra_bytes = constructed_payload.len;
+
+    t_cose_sign1_sign_init(&sign_ctx, 0, T_COSE_ALGORITHM_ES256);
+    t_cose_sign1_set_signing_key(&sign_ctx, ctx->key_pair, NULL_Q_USEFUL_BUF_C);
+
+    return t_cose_sign1_sign(&sign_ctx,
+                             constructed_payload,
+                             ctx->signed_cose_buffer,
+                             &signed_cose);
+}
+
+
+/*
+ * As two_step_sign_example() does it. The payload is encoded straight
+ * into the output buffer.
+ */
+static enum t_cose_err_t two_step_op(void *op_ctx)
+{
+    struct sweep_ctx             *ctx = (struct sweep_ctx *)op_ctx;
+    struct t_cose_sign1_sign_ctx  sign_ctx;
+    QCBOREncodeContext            cbor_encode;
+    enum t_cose_err_t             return_value;
+    struct q_useful_buf_c         signed_cose;
+
+    QCBOREncode_Init(&cbor_encode, ctx->signed_cose_buffer);
+
+    t_cose_sign1_sign_init(&sign_ctx, 0, T_COSE_ALGORITHM_ES256);
+    t_cose_sign1_set_signing_key(&sign_ctx, ctx->key_pair, NULL_Q_USEFUL_BUF_C);
+
+    return_value = t_cose_sign1_encode_parameters(&sign_ctx, &cbor_encode);
+    if(return_value) {
+        return return_value;
+    }
+
+    QCBOREncode_AddBytes(&cbor_encode, ctx->app_data);
+
+    return_value = t_cose_sign1_encode_signature(&sign_ctx, &cbor_encode);
+    if(return_value) {
+        return return_value;
+    }
+
+    if(QCBOREncode_Finish(&cbor_encode, &signed_cose)) {
+        return T_COSE_ERR_CBOR_FORMATTING;
+    }
+    ctx->extra_bytes = 0;
+
+    return T_COSE_SUCCESS;
+}
+
+
+/* What the child process sends back to the parent */
+struct sweep_report {
+    enum t_cose_err_t   return_value;
+    struct bench_result result;
+    size_t              extra_bytes;
+};
+
+
+/*
+ * Runs in the child. Everything is allocated here so it shows in the
+ * child's peak RSS and not the parent's.
+ */
+static void sweep_child(const struct bench_config *config,
+                        struct sweep_ctx          *ctx,
+                        size_t                     payload_size,
+                        struct sweep_report       *report)
+{
+    struct bench_config child_config;
+    uint8_t            *app_data;
+    size_t              i;
+
+    memset(report, 0, sizeof(*report));
+
+    ctx->signed_cose_buffer.len = payload_size + SWEEP_BSTR_HEAD + SWEEP_COSE_OVERHEAD;
+    ctx->signed_cose_buffer.ptr = malloc(ctx->signed_cose_buffer.len);
+    app_data = malloc(payload_size);
+    if(ctx->signed_cose_buffer.ptr == NULL || app_data == NULL) {
+        report->return_value = T_COSE_ERR_INSUFFICIENT_MEMORY;
+        return;
+    }
+
+    /* Touch everything so it is resident as the application data and
+     * output buffer would be in a real signer */
+    for(i = 0; i < payload_size; i++) {
+        app_data[i] = (uint8_t)i;
+    }
+    memset(ctx->signed_cose_buffer.ptr, 0, ctx->signed_cose_buffer.len);
+    ctx->app_data.ptr = app_data;
+    ctx->app_data.len = payload_size;
+
+    if(ctx->method == SWEEP_BASELINE) {
+        /* One signing of an empty payload so the crypto library's
+         * code and set up are in the baseline too */
+        ctx->app_data.len    = 0;
+        report->return_value = two_step_op(ctx);
+        return;
+    }
+
+    if(ctx->method == SWEEP_ONE_STEP) {
+        /* Not touched here; the encoding touches what it uses */
+        ctx->constructed_payload_buffer.len = payload_size + SWEEP_BSTR_HEAD;
+        ctx->constructed_payload_buffer.ptr = malloc(ctx->constructed_payload_buffer.len);
+        if(ctx->constructed_payload_buffer.ptr == NULL) {
+            report->return_value = T_COSE_ERR_INSUFFICIENT_MEMORY;
+            return;
+        }
+    }
+
+    child_config = *config;
+    child_config.iterations = (unsigned)(SWEEP_BYTES_PER_RUN / payload_size);
+    if(child_config.iterations > config->iterations) {
+        child_config.iterations = config->iterations;
+    }
+    if(child_config.iterations == 0) {
+        child_config.iterations = 1;
+    }
+    if(child_config.warmup > child_config.iterations) {
+        child_config.warmup = child_config.iterations;
+    }
+
+    report->return_value = bench_run(&child_config,
+                                     ctx->method == SWEEP_ONE_STEP ? one_step_op : two_step_op,
+                                     ctx,
+                                     &report->result);
+    report->extra_bytes = ctx->extra_bytes;
+}
+
+
+/*
+ * Run one measurement in a child process. Returns the child's peak
+ * RSS in KB, or 0 on error with the error in report->return_value.
+ */
+static long sweep_in_child(const struct bench_config *config,
+                           struct sweep_ctx          *ctx,
+                           size_t                     payload_size,
+                           struct sweep_report       *report)
+{
+    int           fds[2];
+    pid_t         pid;
+    int           status;
+    struct rusage usage;
+    ssize_t       n;
+
+    report->return_value = T_COSE_ERR_FAIL;
+
+    if(pipe(fds)) {
+        return 0;
+    }
+
+    /* So buffered output isn't written twice */
+    fflush(stdout);
+
+    pid = fork();
+    if(pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return 0;
+    }
+
+    if(pid == 0) {
+        close(fds[0]);
+        sweep_child(config, ctx, payload_size, report);
+        n = write(fds[1], report, sizeof(*report));
+        _exit(n == (ssize_t)sizeof(*report) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    n = read(fds[0], report, sizeof(*report));
+    close(fds[0]);
+    if(wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status)) {
+        report->return_value = T_COSE_ERR_FAIL;
+        return 0;
+    }
+    if(n != (ssize_t)sizeof(*report)) {
+        report->return_value = T_COSE_ERR_FAIL;
+        return 0;
+    }
+
+#ifdef __APPLE__
+    /* In bytes on macOS, KB on Linux */
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+
+static void print_size(char *out, size_t out_len, size_t size)
+{
+    if(size >= 1024 * 1024) {
+        snprintf(out, out_len, "%zuMB", size / (1024 * 1024));
+    } else if(size >= 1024) {
+        snprintf(out, out_len, "%zuKB", size / 1024);
+    } else {
+        snprintf(out, out_len, "%zuB", size);
+    }
+}
+
+
+/*
+ * Public function. See bench_modes.h
+ */
+int bench_sweep(const struct bench_config *config)
+{
+    struct sweep_ctx    ctx;
+    struct sweep_report report;
+    enum t_cose_err_t   return_value;
+    size_t              payload_size;
+    long                baseline_kb;
+    long                rss_kb;
+    char                size_label[16];
+    int                 method;
+    int                 errors;
+
+    static const char *method_names[] = {"baseline", "one-step", "two-step"};
+
+    memset(&ctx, 0, sizeof(ctx));
+    return_value = tdv_keystore_find(config->keys,
+                                     T_COSE_ALGORITHM_ES256,
+                                     NULL,
+                                     1,
+                                     &ctx.key_pair);
+    if(return_value) {
+        printf("sweep: no ES256 key: %d\n", return_value);
+        return 1;
+    }
+
+    printf("\nES256 one-step vs two-step signing\n");
+    printf("%-8s %-9s %10s %9s %10s %12s %12s %12s\n",
+           "payload", "API", "ops/sec", "MB/s", "mean us",
+           "peak RSS KB", "over base KB", "extra bytes");
+
+    errors = 0;
+    for(payload_size = SWEEP_MIN_SIZE; payload_size <= SWEEP_MAX_SIZE; payload_size *= 4) {
+        print_size(size_label, sizeof(size_label), payload_size);
+
+        ctx.method  = SWEEP_BASELINE;
+        baseline_kb = sweep_in_child(config, &ctx, payload_size, &report);
+        if(report.return_value) {
+            printf("%-8s %-9s baseline failed: %d\n", size_label, "", report.return_value);
+            errors++;
+            continue;
+        }
+
+        for(method = SWEEP_ONE_STEP; method <= SWEEP_TWO_STEP; method++) {
+            ctx.method = (enum sweep_method)method;
+            rss_kb = sweep_in_child(config, &ctx, payload_size, &report);
+            if(report.return_value) {
+                printf("%-8s %-9s failed: %d\n", size_label, method_names[method], report.return_value);
+                errors++;
+                continue;
+            }
+
+            printf("%-8s %-9s %10.1f %9.1f %10.2f %12ld %12ld %12zu\n",
+                   size_label,
+                   method_names[method],
+                   report.result.ops_per_sec,
+                   report.result.ops_per_sec * (double)payload_size / (1024 * 1024),
+                   report.result.mean_ns / 1000,
+                   rss_kb,
+                   rss_kb - baseline_kb,
+                   report.extra_bytes);
+            fflush(stdout);
+        }
+    }
+
+    return errors;
+}
@@ -0,0 +1,202 @@
+/*
+ * bench_threads.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+/* For pthread_setaffinity_np() and CPU_SET() on Linux */
+#define _GNU_SOURCE
+
+#include "bench.h"
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+
+/**
+ * \file bench_threads.c
+ *
+ * \brief Run a benchmark operation on several threads at once.
+ *
+ * All the threads are started and warmed up, then released together
+ * through a start gate so the timed part has all of them running
+ * concurrently. Throughput is the total number of operations divided
+ * by the time from the release of the gate until the last thread
+ * finishes.
+ */
+
+
+struct thread_gate {
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    unsigned        waiting;
+    int             open;
+};
+
+
+struct thread_arg {
+    const struct bench_config *config;
+    bench_op_fn                op;
+    void                      *op_ctx;
+    unsigned                   cpu;
+    struct thread_gate        *gate;
+    enum t_cose_err_t          return_value;
+};
+
+
+static void pin_to_cpu(unsigned cpu)
+{
+#ifdef __linux__
+    cpu_set_t cpu_set;
+
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    /* Failure is not fatal; the results are just unpinned */
+    (void)pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+#else
+    /* No portable affinity API; macOS only has affinity hints */
+    (void)cpu;
+#endif
+}
+
+
+static void *bench_thread(void *arg_ptr)
+{
+    struct thread_arg *arg = (struct thread_arg *)arg_ptr;
+    enum t_cose_err_t  return_value;
+    unsigned           i;
+
+    if(arg->config->pin_cpus) {
+        pin_to_cpu(arg->cpu);
+    }
+
+    return_value = T_COSE_SUCCESS;
+    for(i = 0; i < arg->config->warmup && !return_value; i++) {
+        return_value = arg->op(arg->op_ctx);
+    }
+
+    /* Wait at the gate for all the other threads to be ready. A
+     * thread that failed warm up still waits so the count is right. */
+    pthread_mutex_lock(&arg->gate->mutex);
+    arg->gate->waiting++;
+    pthread_cond_broadcast(&arg->gate->cond);
+    while(!arg->gate->open) {
+        pthread_cond_wait(&arg->gate->cond, &arg->gate->mutex);
+    }
+    pthread_mutex_unlock(&arg->gate->mutex);
+
+    for(i = 0; i < arg->config->iterations && !return_value; i++) {
+        return_value = arg->op(arg->op_ctx);
+    }
+
+    arg->return_value = return_value;
+
+    return NULL;
+}
+
+
+/*
+ * Public function. See bench.h
+ */
+unsigned bench_num_cpus(void)
+{
+    long n;
+
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+    if(n < 1) {
+        return 1;
+    }
+    return (unsigned)n;
+}
+
+
+/*
+ * Public function. See bench.h
+ */
+enum t_cose_err_t bench_run_threaded(const struct bench_config *config,
+                                     unsigned                   num_threads,
+                                     bench_op_fn                op,
+                                     void                      *op_ctxs[],
+                                     double                    *ops_per_sec)
+{
+    struct thread_gate  gate;
+    struct thread_arg  *args;
+    pthread_t          *threads;
+    unsigned            num_started;
+    unsigned            num_cpus;
+    unsigned            i;
+    uint64_t            start;
+    uint64_t            end;
+    enum t_cose_err_t   return_value;
+
+    if(num_threads == 0 || config->iterations == 0) {
+        return T_COSE_ERR_INVALID_ARGUMENT;
+    }
+
+    args    = calloc(num_threads, sizeof(struct thread_arg));
+    threads = calloc(num_threads, sizeof(pthread_t));
+    if(args == NULL || threads == NULL) {
+        return_value = T_COSE_ERR_INSUFFICIENT_MEMORY;
+        goto Done;
+    }
+
+    pthread_mutex_init(&gate.mutex, NULL);
+    pthread_cond_init(&gate.cond, NULL);
+    gate.waiting = 0;
+    gate.open    = 0;
+
+    num_cpus     = bench_num_cpus();
+    return_value = T_COSE_SUCCESS;
+    for(num_started = 0; num_started < num_threads; num_started++) {
+        args[num_started].config       = config;
+        args[num_started].op           = op;
+        args[num_started].op_ctx       = op_ctxs[num_started];
+        args[num_started].cpu          = num_started % num_cpus;
+        args[num_started].gate         = &gate;
+        args[num_started].return_value = T_COSE_SUCCESS;
+        if(pthread_create(&threads[num_started], NULL, bench_thread, &args[num_started])) {
+            return_value = T_COSE_ERR_INSUFFICIENT_MEMORY;
+            break;
+        }
+    }
+
+    /* Wait for every thread that started to be warmed up, then open
+     * the gate. The gate is opened even on error so they all exit. */
+    pthread_mutex_lock(&gate.mutex);
+    while(gate.waiting < num_started) {
+        pthread_cond_wait(&gate.cond, &gate.mutex);
+    }
+    start     = bench_now_ns();
+    gate.open = 1;
+    pthread_cond_broadcast(&gate.cond);
+    pthread_mutex_unlock(&gate.mutex);
+
+    for(i = 0; i < num_started; i++) {
+        pthread_join(threads[i], NULL);
+        if(args[i].return_value && !return_value) {
+            return_value = args[i].return_value;
+        }
+    }
+    end = bench_now_ns();
+
+    pthread_cond_destroy(&gate.cond);
+    pthread_mutex_destroy(&gate.mutex);
+
+    if(!return_value) {
+        *ops_per_sec = (double)num_threads * config->iterations * 1e9 /
+                       (double)(end - start);
+    }
+
+Done:
+    free(args);
+    free(threads);
+    return return_value;
+}
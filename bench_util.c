@@ -0,0 +1,226 @@
+/*
+ * bench_util.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+/* For clock_gettime() */
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+
+/**
+ * \file bench_util.c
+ *
+ * \brief Implementation of bench.h.
+ */
+
+
+/*
+ * Public function. See bench.h
+ */
+uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+
+static int compare_uint64(const void *a, const void *b)
+{
+    const uint64_t x = *(const uint64_t *)a;
+    const uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+
+/* Nearest-rank percentile of sorted samples */
+static double percentile(const uint64_t *sorted, size_t count, unsigned pct)
+{
+    size_t rank;
+
+    rank = (count * pct + 99) / 100;
+    if(rank == 0) {
+        rank = 1;
+    }
+    return (double)sorted[rank - 1];
+}
+
+
+/*
+ * Public function. See bench.h
+ */
+void bench_latency_stats(uint64_t            *samples_ns,
+                         size_t               count,
+                         struct bench_result *result)
+{
+    size_t i;
+    double sum;
+
+    result->count = count;
+    if(count == 0) {
+        result->mean_ns   = 0;
+        result->median_ns = 0;
+        result->p90_ns    = 0;
+        result->p99_ns    = 0;
+        result->min_ns    = 0;
+        result->max_ns    = 0;
+        return;
+    }
+
+    qsort(samples_ns, count, sizeof(uint64_t), compare_uint64);
+
+    sum = 0;
+    for(i = 0; i < count; i++) {
+        sum += (double)samples_ns[i];
+    }
+
+    result->mean_ns = sum / (double)count;
+    if(count % 2) {
+        result->median_ns = (double)samples_ns[count / 2];
+    } else {
+        result->median_ns = ((double)samples_ns[count / 2 - 1] +
+                             (double)samples_ns[count / 2]) / 2;
+    }
+    result->p90_ns = percentile(samples_ns, count, 90);
+    result->p99_ns = percentile(samples_ns, count, 99);
+    result->min_ns = samples_ns[0];
+    result->max_ns = samples_ns[count - 1];
+}
+
+
+/*
+ * Public function. See bench.h
+ */
+enum t_cose_err_t bench_run(const struct bench_config *config,
+                            bench_op_fn                op,
+                            void                      *op_ctx,
+                            struct bench_result       *result)
+{
+    enum t_cose_err_t return_value;
+    uint64_t         *samples;
+    double           *run_rates;
+    uint64_t          run_start;
+    uint64_t          op_start;
+    uint64_t          op_end;
+    unsigned          run;
+    unsigned          i;
+    size_t            n;
+    double            mean_rate;
+    double            variance;
+
+    if(config->runs == 0 || config->iterations == 0) {
+        return T_COSE_ERR_INVALID_ARGUMENT;
+    }
+
+    samples   = malloc(sizeof(uint64_t) * config->runs * config->iterations);
+    run_rates = malloc(sizeof(double) * config->runs);
+    if(samples == NULL || run_rates == NULL) {
+        return_value = T_COSE_ERR_INSUFFICIENT_MEMORY;
+        goto Done;
+    }
+
+    /* Warm up caches, lazy initialization in the crypto library and
+     * such so they don't show up in the first run */
+    for(i = 0; i < config->warmup; i++) {
+        return_value = op(op_ctx);
+        if(return_value) {
+            goto Done;
+        }
+    }
+
+    n = 0;
+    for(run = 0; run < config->runs; run++) {
+        run_start = bench_now_ns();
+        op_end    = run_start;
+        for(i = 0; i < config->iterations; i++) {
+            op_start = op_end;
+            return_value = op(op_ctx);
+            op_end = bench_now_ns();
+            if(return_value) {
+                goto Done;
+            }
+            samples[n++] = op_end - op_start;
+        }
+        run_rates[run] = (double)config->iterations * 1e9 /
+                         (double)(op_end - run_start);
+    }
+
+    mean_rate = 0;
+    for(run = 0; run < config->runs; run++) {
+        mean_rate += run_rates[run];
+    }
+    mean_rate /= config->runs;
+
+    variance = 0;
+    for(run = 0; run < config->runs; run++) {
+        variance += (run_rates[run] - mean_rate) * (run_rates[run] - mean_rate);
+    }
+    if(config->runs > 1) {
+        variance /= config->runs - 1;
+    }
+
+    result->ops_per_sec        = mean_rate;
+    result->ops_per_sec_stddev = sqrt(variance);
+    bench_latency_stats(samples, n, result);
+
+    return_value = T_COSE_SUCCESS;
+
+Done:
+    free(samples);
+    free(run_rates);
+    return return_value;
+}
+
+
+/*
+ * Public function. See bench.h
+ */
+void bench_print_header(void)
+{
+    printf("%-24s %10s %6s %9s %9s %9s %9s %9s %9s\n",
+           "", "ops/sec", "+/-%",
+           "mean us", "min us", "p50 us", "p90 us", "p99 us", "max us");
+}
+
+
+/*
+ * Public function. See bench.h
+ */
+void bench_print_result(const char *label, const struct bench_result *result)
+{
+    double cv;
+
+    /* Run-to-run variance is given as the coefficient of variation so
+     * it is comparable between fast and slow operations */
+    cv = 0;
+    if(result->ops_per_sec > 0) {
+        cv = 100 * result->ops_per_sec_stddev / result->ops_per_sec;
+    }
+
+    printf("%-24s %10.1f %6.2f %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f\n",
+           label,
+           result->ops_per_sec,
+           cv,
+           result->mean_ns / 1000,
+           (double)result->min_ns / 1000,
+           result->median_ns / 1000,
+           result->p90_ns / 1000,
+           result->p99_ns / 1000,
+           (double)result->max_ns / 1000);
+    fflush(stdout);
+}
@@ -0,0 +1,120 @@
+#!/bin/sh
+
+# Instruction and cache miss counts per function from a callgrind
+# profile.
+#
+# Usage: tdv/callgrind_funs.sh [-f regex] callgrind.out ...
+#
+# The profile is read directly rather than through callgrind_annotate
+# because the format of the annotate output changes between valgrind
+# versions and the profile format hasn't.
+#
+# For each function this prints the instructions executed in the
+# function itself (self Ir), those including everything it calls
+# (incl Ir) and the simulated cache misses in the function itself:
+# level 1 instruction, level 1 data read, level 1 data write and last
+# level of any kind. The misses are 0 unless callgrind was run with
+# --cache-sim=yes.
+#
+# Recursive calls are counted again in the inclusive count of the
+# function, the way callgrind does without --separate-recs.
+#
+# With -f only functions whose name matches the regex exactly are
+# printed, for example the regex from lib_funs.sh for the functions in
+# libt_cose.a. A last line has the totals of the self counts of the
+# functions printed.
+
+filter="."
+if [ "$1" = "-f" ]; then
+    filter="^($2)$"
+    shift 2
+fi
+
+if [ $# -eq 0 ]; then
+    echo "Usage: $0 [-f regex] callgrind.out ..." >&2
+    exit 2
+fi
+
+cat "$@" |\
+awk -v filter="$filter" '
+# Name of a function from an fn= or cfn= line. Names are compressed:
+# the first time as "(id) name" and after that just "(id)".
+function fn_name(spec,    id) {
+    if(spec !~ /^\(/) {
+        return spec
+    }
+    id = substr(spec, 2, index(spec, ")") - 2)
+    if(index(spec, ") ") > 0) {
+        names[id] = substr(spec, index(spec, ") ") + 2)
+    }
+    return names[id]
+}
+
+# Add the costs on a cost line, which come after the one position,
+# to the function. Trailing costs that are zero may be left off.
+function add_cost(fn, self,    i) {
+    for(i = 2; i <= NF && i - 1 <= num_events; i++) {
+        if(self) {
+            cost[fn, event[i - 1]] += $i
+        }
+        incl[fn, event[i - 1]] += $i
+    }
+    seen[fn] = 1
+}
+
+/^events:/ {
+    num_events = NF - 1
+    for(i = 2; i <= NF; i++) {
+        event[i - 1] = $i
+    }
+    next
+}
+
+/^fn=/ {
+    fn = fn_name(substr($0, 4))
+    in_call = 0
+    next
+}
+
+/^cfn=/ {
+    fn_name(substr($0, 5))
+    next
+}
+
+/^calls=/ {
+    # The next cost line is the inclusive cost of the call
+    in_call = 1
+    next
+}
+
+/^[0-9+*-]/ {
+    if(fn == "") {
+        next
+    }
+    add_cost(fn, !in_call)
+    in_call = 0
+    next
+}
+
+END {
+    for(fn in seen) {
+        if(fn !~ filter) {
+            continue
+        }
+        ll = cost[fn, "ILmr"] + cost[fn, "DLmr"] + cost[fn, "DLmw"]
+        printf "%12d %12d %9d %9d %9d %9d  %s\n",
+               cost[fn, "Ir"], incl[fn, "Ir"],
+               cost[fn, "I1mr"], cost[fn, "D1mr"], cost[fn, "D1mw"], ll, fn
+        t_ir   += cost[fn, "Ir"]
+        t_i1   += cost[fn, "I1mr"]
+        t_d1r  += cost[fn, "D1mr"]
+        t_d1w  += cost[fn, "D1mw"]
+        t_ll   += ll
+    }
+    printf "%12d %12s %9d %9d %9d %9d  %s\n", t_ir, "-", t_i1, t_d1r, t_d1w, t_ll, "~total self"
+}' |\
+sort -r -n -k 1 |\
+awk 'BEGIN {printf "%12s %12s %9s %9s %9s %9s\n", "self Ir", "incl Ir", "I1mr", "D1mr", "D1mw", "LLmiss"}
+     /~total self$/ {total = $0; next}
+     {print}
+     END {sub(/~total self$/, "total self", total); print total}'
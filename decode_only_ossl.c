@@ -145,7 +145,8 @@ enum t_cose_err_t make_ossl_ecdsa_key_pair(int32_t            cose_algorithm_id,
         goto Done;
     }
 
-    /* Associate group with key object */
+    /* Associate group with key object. The key object gets its own
+     * copy of the group. */
     ossl_result = EC_KEY_set_group(ossl_ec_key, ossl_ec_group);
     if (!ossl_result) {
         return_value = T_COSE_ERR_SIG_FAIL;
@@ -162,13 +163,14 @@ enum t_cose_err_t make_ossl_ecdsa_key_pair(int32_t            cose_algorithm_id,
 
     /* Stuff the specific private key into the big num */
     ossl_result = BN_hex2bn(&ossl_private_key_bn, private_key);
-    if(ossl_private_key_bn == 0) {
+    if(ossl_result == 0) {
         return_value = T_COSE_ERR_SIG_FAIL;
         goto Done;
     }
 
     /* Now associate the big num with the key object so we finally
-     * have a key set up and ready for signing */
+     * have a key set up and ready for signing. This copies the big
+     * num. */
     ossl_result = EC_KEY_set_private_key(ossl_ec_key, ossl_private_key_bn);
     if (!ossl_result) {
         return_value = T_COSE_ERR_SIG_FAIL;
@@ -183,17 +185,19 @@ enum t_cose_err_t make_ossl_ecdsa_key_pair(int32_t            cose_algorithm_id,
         goto Done;
     }
 
-    /* Turn the serialized public key into an EC point */
-    ossl_pub_key_point = EC_POINT_hex2point(ossl_ec_group,
-                                            public_key,
-                                            ossl_pub_key_point,
-                                            NULL);
-    if(ossl_pub_key_point == NULL) {
+    /* Turn the serialized public key into an EC point. It is
+     * decoded into ossl_pub_key_point. The return value is not
+     * assigned to it so the point is not lost on failure. */
+    if(EC_POINT_hex2point(ossl_ec_group,
+                          public_key,
+                          ossl_pub_key_point,
+                          NULL) == NULL) {
         return_value = T_COSE_ERR_SIG_FAIL;
         goto Done;
     }
 
-    /* Associate the EC point with key object */
+    /* Associate the EC point with key object. This copies the
+     * point. */
     /* The key object has both the public and private keys in it */
     ossl_result = EC_KEY_set_public_key(ossl_ec_key, ossl_pub_key_point);
     if(ossl_result == 0) {
@@ -203,9 +207,16 @@ enum t_cose_err_t make_ossl_ecdsa_key_pair(int32_t            cose_algorithm_id,
 
     key_pair->k.key_ptr  = ossl_ec_key;
     key_pair->crypto_lib = T_COSE_CRYPTO_LIB_OPENSSL;
+    ossl_ec_key          = NULL; /* Now owned by key_pair */
     return_value         = T_COSE_SUCCESS;
 
 Done:
+    /* The key object has copies of all of these. All of the free
+     * functions do nothing with NULL. */
+    EC_KEY_free(ossl_ec_key);
+    EC_POINT_free(ossl_pub_key_point);
+    BN_clear_free(ossl_private_key_bn);
+    EC_GROUP_free(ossl_ec_group);
     return return_value;
 }
 
@@ -221,6 +232,32 @@ void free_ossl_ecdsa_key_pair(struct t_cose_key key_pair)
 }
 
 
+/*
+ * A COSE_Sign1 message signed with the prime256v1 key above. The
+ * payload is the example map that two_step_sign_example() in
+ * encode_only_xxx.c makes. It is here so the verification below runs
+ * on a real message and the code size measured is that of a
+ * successful verification. The same message is in bench_corpus.c.
+ */
+static const uint8_t signed_cose_es256[] = {
+    0xd2, 0x84, 0x43, 0xa1, 0x01, 0x26, 0xa0, 0x58, 0x61, 0xa6, 0x69, 0x42,
+    0x65, 0x69, 0x6e, 0x67, 0x54, 0x79, 0x70, 0x65, 0x68, 0x48, 0x75, 0x6d,
+    0x61, 0x6e, 0x6f, 0x69, 0x64, 0x68, 0x47, 0x72, 0x65, 0x65, 0x74, 0x69,
+    0x6e, 0x67, 0x70, 0x57, 0x65, 0x20, 0x63, 0x6f, 0x6d, 0x65, 0x20, 0x69,
+    0x6e, 0x20, 0x70, 0x65, 0x61, 0x63, 0x65, 0x68, 0x41, 0x72, 0x6d, 0x43,
+    0x6f, 0x75, 0x6e, 0x74, 0x02, 0x69, 0x48, 0x65, 0x61, 0x64, 0x43, 0x6f,
+    0x75, 0x6e, 0x74, 0x01, 0x69, 0x42, 0x72, 0x61, 0x69, 0x6e, 0x53, 0x69,
+    0x7a, 0x65, 0x66, 0x6d, 0x65, 0x64, 0x69, 0x75, 0x6d, 0x6b, 0x44, 0x72,
+    0x69, 0x6e, 0x6b, 0x73, 0x57, 0x61, 0x74, 0x65, 0x72, 0xf5, 0x58, 0x40,
+    0x48, 0x21, 0xa9, 0x54, 0x4f, 0x36, 0x48, 0x70, 0x3e, 0x59, 0x8a, 0x80,
+    0xc5, 0xa9, 0x30, 0x72, 0x6f, 0xa8, 0xaf, 0x6a, 0x39, 0xe8, 0x34, 0x4d,
+    0x0f, 0x69, 0xa5, 0x50, 0x50, 0x29, 0xc3, 0x94, 0xb5, 0xee, 0xf3, 0x18,
+    0x23, 0x4d, 0x14, 0x62, 0x3b, 0x0a, 0x49, 0xe3, 0x21, 0x06, 0xc1, 0x6b,
+    0x7c, 0x1c, 0xd3, 0x8f, 0xda, 0xf0, 0x58, 0x23, 0x88, 0x0e, 0x77, 0x14,
+    0xaf, 0x45, 0x55, 0xa3
+};
+
+
 /**
  * \brief  Print a q_useful_buf_c on stdout in hex ASCII text.
  *
@@ -303,11 +340,7 @@ int two_step_sign_example()
 
     printf("Initialized t_cose for verification and set verification key\n");
 
-    /* This code is not actually run, it is just to check code size
-     * so this is an OK way to quiet the uninitialized variable
-     * compiler warning.
-     */
-    signed_cose = NULL_Q_USEFUL_BUF_C;
+    signed_cose = Q_USEFUL_BUF_FROM_BYTE_ARRAY_LITERAL(signed_cose_es256);
 
 
     /* ------   Perform the verification   ------
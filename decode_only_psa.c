@@ -184,6 +184,32 @@ void free_psa_ecdsa_key_pair(struct t_cose_key key_pair)
 }
 
 
+/*
+ * A COSE_Sign1 message signed with the prime256v1 key above. The
+ * payload is the example map that two_step_sign_example() in
+ * encode_only_xxx.c makes. It is here so the verification below runs
+ * on a real message and the code size measured is that of a
+ * successful verification. The same message is in bench_corpus.c.
+ */
+static const uint8_t signed_cose_es256[] = {
+    0xd2, 0x84, 0x43, 0xa1, 0x01, 0x26, 0xa0, 0x58, 0x61, 0xa6, 0x69, 0x42,
+    0x65, 0x69, 0x6e, 0x67, 0x54, 0x79, 0x70, 0x65, 0x68, 0x48, 0x75, 0x6d,
+    0x61, 0x6e, 0x6f, 0x69, 0x64, 0x68, 0x47, 0x72, 0x65, 0x65, 0x74, 0x69,
+    0x6e, 0x67, 0x70, 0x57, 0x65, 0x20, 0x63, 0x6f, 0x6d, 0x65, 0x20, 0x69,
+    0x6e, 0x20, 0x70, 0x65, 0x61, 0x63, 0x65, 0x68, 0x41, 0x72, 0x6d, 0x43,
+    0x6f, 0x75, 0x6e, 0x74, 0x02, 0x69, 0x48, 0x65, 0x61, 0x64, 0x43, 0x6f,
+    0x75, 0x6e, 0x74, 0x01, 0x69, 0x42, 0x72, 0x61, 0x69, 0x6e, 0x53, 0x69,
+    0x7a, 0x65, 0x66, 0x6d, 0x65, 0x64, 0x69, 0x75, 0x6d, 0x6b, 0x44, 0x72,
+    0x69, 0x6e, 0x6b, 0x73, 0x57, 0x61, 0x74, 0x65, 0x72, 0xf5, 0x58, 0x40,
+    0x48, 0x21, 0xa9, 0x54, 0x4f, 0x36, 0x48, 0x70, 0x3e, 0x59, 0x8a, 0x80,
+    0xc5, 0xa9, 0x30, 0x72, 0x6f, 0xa8, 0xaf, 0x6a, 0x39, 0xe8, 0x34, 0x4d,
+    0x0f, 0x69, 0xa5, 0x50, 0x50, 0x29, 0xc3, 0x94, 0xb5, 0xee, 0xf3, 0x18,
+    0x23, 0x4d, 0x14, 0x62, 0x3b, 0x0a, 0x49, 0xe3, 0x21, 0x06, 0xc1, 0x6b,
+    0x7c, 0x1c, 0xd3, 0x8f, 0xda, 0xf0, 0x58, 0x23, 0x88, 0x0e, 0x77, 0x14,
+    0xaf, 0x45, 0x55, 0xa3
+};
+
+
 /**
  * \brief  Print a q_useful_buf_c on stdout in hex ASCII text.
  *
@@ -267,6 +293,8 @@ int two_step_sign_example()
 
     printf("Initialized t_cose for verification and set verification key\n");
 
+    signed_cose = Q_USEFUL_BUF_FROM_BYTE_ARRAY_LITERAL(signed_cose_es256);
+
 
     /* ------   Perform the verification   ------
      *
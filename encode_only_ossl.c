@@ -145,7 +145,8 @@ enum t_cose_err_t make_ossl_ecdsa_key_pair(int32_t            cose_algorithm_id,
         goto Done;
     }
 
-    /* Associate group with key object */
+    /* Associate group with key object. The key object gets its own
+     * copy of the group. */
     ossl_result = EC_KEY_set_group(ossl_ec_key, ossl_ec_group);
     if (!ossl_result) {
         return_value = T_COSE_ERR_SIG_FAIL;
@@ -162,13 +163,14 @@ enum t_cose_err_t make_ossl_ecdsa_key_pair(int32_t            cose_algorithm_id,
 
     /* Stuff the specific private key into the big num */
     ossl_result = BN_hex2bn(&ossl_private_key_bn, private_key);
-    if(ossl_private_key_bn == 0) {
+    if(ossl_result == 0) {
         return_value = T_COSE_ERR_SIG_FAIL;
         goto Done;
     }
 
     /* Now associate the big num with the key object so we finally
-     * have a key set up and ready for signing */
+     * have a key set up and ready for signing. This copies the big
+     * num. */
     ossl_result = EC_KEY_set_private_key(ossl_ec_key, ossl_private_key_bn);
     if (!ossl_result) {
         return_value = T_COSE_ERR_SIG_FAIL;
@@ -183,17 +185,19 @@ enum t_cose_err_t make_ossl_ecdsa_key_pair(int32_t            cose_algorithm_id,
         goto Done;
     }
 
-    /* Turn the serialized public key into an EC point */
-    ossl_pub_key_point = EC_POINT_hex2point(ossl_ec_group,
-                                            public_key,
-                                            ossl_pub_key_point,
-                                            NULL);
-    if(ossl_pub_key_point == NULL) {
+    /* Turn the serialized public key into an EC point. It is
+     * decoded into ossl_pub_key_point. The return value is not
+     * assigned to it so the point is not lost on failure. */
+    if(EC_POINT_hex2point(ossl_ec_group,
+                          public_key,
+                          ossl_pub_key_point,
+                          NULL) == NULL) {
         return_value = T_COSE_ERR_SIG_FAIL;
         goto Done;
     }
 
-    /* Associate the EC point with key object */
+    /* Associate the EC point with key object. This copies the
+     * point. */
     /* The key object has both the public and private keys in it */
     ossl_result = EC_KEY_set_public_key(ossl_ec_key, ossl_pub_key_point);
     if(ossl_result == 0) {
@@ -203,9 +207,16 @@ enum t_cose_err_t make_ossl_ecdsa_key_pair(int32_t            cose_algorithm_id,
 
     key_pair->k.key_ptr  = ossl_ec_key;
     key_pair->crypto_lib = T_COSE_CRYPTO_LIB_OPENSSL;
+    ossl_ec_key          = NULL; /* Now owned by key_pair */
     return_value         = T_COSE_SUCCESS;
 
 Done:
+    /* The key object has copies of all of these. All of the free
+     * functions do nothing with NULL. */
+    EC_KEY_free(ossl_ec_key);
+    EC_POINT_free(ossl_pub_key_point);
+    BN_clear_free(ossl_private_key_bn);
+    EC_GROUP_free(ossl_ec_group);
     return return_value;
 }
 
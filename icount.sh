@@ -0,0 +1,130 @@
+#!/bin/bash
+
+#
+# Copyright (c) 2022, Laurence Lundblade. All rights reserved.
+#
+# SPDX-License-Identifier: BSD-3-Clause
+#
+# See BSD-3-Clause license in README.md
+#
+
+# Instruction and cache miss counts of the libt_cose.a functions. Run
+# from the t_cose root like b.sh.
+#
+# For each #define permutation and each crypto library this builds
+# encode_only_xxx and decode_only_xxx, runs them under valgrind's
+# callgrind with the cache simulation on and prints the counts for
+# each function in libt_cose.a. The functions are picked out with the
+# same nm filter sizes.sh uses, see lib_funs.sh.
+#
+# Unlike times, these counts are the same on every run on any machine
+# with the same compiler and libraries, so a change of even a few
+# instructions in t_cose shows. Save the output of a run and diff
+# against it. The self counts of the t_cose functions are exact. The
+# inclusive counts of the public functions also have the crypto
+# library in them. The ECDSA signature takes a random nonce so these
+# can differ by a little from run to run for signing. The cache misses
+# are of valgrind's model of the cache, not the real one.
+#
+# Usage: tdv/icount.sh [all]
+#
+# Without "all" only the default build of each Makefile is done.
+
+
+if ! command -v valgrind > /dev/null; then
+    echo "valgrind is needed" >&2
+    exit 1
+fi
+
+
+# ----- Function for all #define permutations ------------------------
+
+# Same as in b.sh
+function stringpermutations {
+    local prefix=$1 # the prefix is the first argument
+    local theset=$2 # the set left to process is the second argument
+
+    # Output the new prefix
+    echo "$prefix"
+
+    # Loop over each item in the set adding it to the prefix
+    for i in $theset; do
+
+        # Make a new prefix by appending the item from the set to it
+        local newprefix="$prefix ${i}"
+
+        # Update the set by removing one more item from it
+        if [[ ! $theset = *[\ ]* ]]; then
+            theset=""
+        else
+            theset=${theset#* }
+        fi
+
+        if [[ ! -z "$theset" ]]; then
+           # The set is not empty, recurse to process it
+           stringpermutations "$newprefix" "$theset"
+        else
+           # The set is empty, just output the new prefix
+           echo "$newprefix"
+        fi
+    done
+}
+
+
+# ----- Build, run and report for one configuration ------------------
+
+function icount_report {
+    local makefile=$1
+    local crypto=$2
+    local options=$3
+    local fun
+    local program
+
+    echo "=== $makefile $options ==="
+    make -f $makefile clean > /dev/null
+    make -f $makefile "CMD_LINE=$options" 2>&1 >/dev/null | grep -v 'ar: creating'
+
+    fun=`tdv/lib_funs.sh`
+
+    for program in encode_only_$crypto decode_only_$crypto; do
+        echo "--- $program"
+        if [ ! -x ./$program ]; then
+            echo "build failed"
+            continue
+        fi
+        if ! valgrind --tool=callgrind --cache-sim=yes \
+                      --callgrind-out-file=/tmp/icount.$$.out \
+                      ./$program > /dev/null 2>&1; then
+            echo "run failed"
+            continue
+        fi
+        tdv/callgrind_funs.sh -f "$fun" /tmp/icount.$$.out
+    done
+    echo
+}
+
+
+# ----- All the configurations ---------------------------------------
+
+# Same as b.sh
+set="-DT_COSE_DISABLE_SHORT_CIRCUIT_SIGN"
+set+=" -DT_COSE_DISABLE_CONTENT_TYPE"
+set+=" -DT_COSE_DISABLE_ES512"
+set+=" -DT_COSE_DISABLE_ES384"
+set+=" -DT_COSE_DISABLE_EDDSA"
+set+=" -DT_COSE_DISABLE_PS256"
+set+=" -DT_COSE_DISABLE_PS384"
+set+=" -DT_COSE_DISABLE_PS512"
+
+if [ "$1" = "all" ]; then
+    stringpermutations "" "$set" > /tmp/icount.$$
+else
+    echo "" > /tmp/icount.$$
+fi
+
+while read compile_options; do
+   icount_report tdv/Makefile.min psa "$compile_options"
+   icount_report tdv/Makefile.max ossl "$compile_options"
+done < /tmp/icount.$$
+
+rm -f /tmp/icount.$$ /tmp/icount.$$.out
@@ -0,0 +1,12 @@
+#!/bin/sh
+
+# Print a regex that matches the names of the functions in
+# libt_cose.a, "name1|name2|...". Run from the t_cose root after
+# libt_cose.a is built. This is the filter sizes.sh uses to pick the
+# t_cose functions out of a linked executable and icount.sh uses to
+# pick them out of a callgrind profile.
+#
+# The last alternative is one that never matches so the regex doesn't
+# end in "|" which would match everything.
+
+nm libt_cose.a | awk '/ [TtSs] /{printf "%s|", $3 }'; echo xxxxxxxxxxxxxx
@@ -0,0 +1,153 @@
+#!/bin/bash
+
+#
+# Copyright (c) 2022, Laurence Lundblade. All rights reserved.
+#
+# SPDX-License-Identifier: BSD-3-Clause
+#
+# See BSD-3-Clause license in README.md
+#
+
+# Code size, stack and speed of every #define permutation. Run from
+# the t_cose root like b.sh.
+#
+# For each permutation of the T_COSE_DISABLE_XXX defines and each
+# crypto library this builds and records:
+#
+#   enc, dec   bytes of libt_cose.a code linked into encode_only_xxx
+#              and decode_only_xxx, the sizes.sh total
+#   stack      peak stack bytes of the encode and decode flows from
+#              stack_xxx
+#   sign/s     ES256 two-step signs and verifies per second from the
+#   verify/s   bench_xxx sign and verify modes
+#   sign cyc   ES256 cycles per sign and per verify from the bench_xxx
+#   ver cyc    counters mode, n/a where there are no hardware counters
+#
+# ES256 is reported because it is in every permutation.
+#
+# A configuration is marked * in the P column if it is Pareto-optimal
+# for its crypto library: no other configuration has all of its
+# features and is at least as small, as shallow and as fast. Speeds
+# within the noise, SPEED_TOLERANCE percent, are taken as equal.
+#
+# After the table is the cost of each feature: the mean over all pairs
+# of configurations that differ in only that define of the with minus
+# the without.
+#
+# Usage: tdv/matrix.sh [all]
+#
+# Without "all" only the defines that change the signing and
+# verification paths are permuted, 16 configurations per library.
+# With "all" it is the full set from b.sh, 256 per library, which
+# takes hours.
+
+# Speeds within this many percent are the same for the Pareto marking
+SPEED_TOLERANCE=3
+
+# Bench options. Few runs as there are many configurations.
+BENCH_OPTS="-r 3 -n 300 -w 30"
+
+
+# ----- Function for all #define permutations ------------------------
+
+# Same as in b.sh
+function stringpermutations {
+    local prefix=$1 # the prefix is the first argument
+    local theset=$2 # the set left to process is the second argument
+
+    # Output the new prefix
+    echo "$prefix"
+
+    # Loop over each item in the set adding it to the prefix
+    for i in $theset; do
+
+        # Make a new prefix by appending the item from the set to it
+        local newprefix="$prefix ${i}"
+
+        # Update the set by removing one more item from it
+        if [[ ! $theset = *[\ ]* ]]; then
+            theset=""
+        else
+            theset=${theset#* }
+        fi
+
+        if [[ ! -z "$theset" ]]; then
+           # The set is not empty, recurse to process it
+           stringpermutations "$newprefix" "$theset"
+        else
+           # The set is empty, just output the new prefix
+           echo "$newprefix"
+        fi
+    done
+}
+
+
+# ----- Build, run and record one configuration ----------------------
+
+# Appends a line to /tmp/matrix.$$.rows:
+#   crypto|options|enc|dec|stack|sign/s|verify/s|sign cyc|verify cyc
+function matrix_row {
+    local makefile=$1
+    local crypto=$2
+    local options=$3
+    local enc dec stack sign verify sign_cyc verify_cyc
+
+    echo "$makefile $options" >&2
+    make -f $makefile clean > /dev/null
+    make -f $makefile all bench_$crypto stack_$crypto "CMD_LINE=$options" 2>&1 >/dev/null | grep -v 'ar: creating' >&2
+    if [ ! -x ./bench_$crypto ] || [ ! -x ./stack_$crypto ]; then
+        echo "build failed" >&2
+        return
+    fi
+
+    enc=`tdv/sizes.sh encode_only_$crypto | awk '/^total/ {print $2}'`
+    dec=`tdv/sizes.sh decode_only_$crypto | awk '/^total/ {print $2}'`
+
+    stack=`./stack_$crypto | awk '/flow total/ && $NF > max {max = $NF} END {print max + 0}'`
+
+    ./bench_$crypto $BENCH_OPTS sign verify > /tmp/matrix.$$.bench
+    sign=`awk '$1 == "ES256" && $2 == "sign" {print $3; exit}' /tmp/matrix.$$.bench`
+    verify=`awk '$1 == "ES256" && $2 == "verify" {print $4; exit}' /tmp/matrix.$$.bench`
+
+    ./bench_$crypto $BENCH_OPTS counters > /tmp/matrix.$$.bench
+    sign_cyc=`awk '$1 == "ES256" && $2 == "sign" {print $3; exit}' /tmp/matrix.$$.bench`
+    verify_cyc=`awk '$1 == "ES256" && $2 == "verify" {print $3; exit}' /tmp/matrix.$$.bench`
+
+    echo "$crypto|$options|${enc:-0}|${dec:-0}|$stack|${sign:-0}|${verify:-0}|${sign_cyc:-n/a}|${verify_cyc:-n/a}" >> /tmp/matrix.$$.rows
+}
+
+
+# ----- All the configurations ---------------------------------------
+
+if [ "$1" = "all" ]; then
+    # Same as b.sh
+    set="-DT_COSE_DISABLE_SHORT_CIRCUIT_SIGN"
+    set+=" -DT_COSE_DISABLE_CONTENT_TYPE"
+    set+=" -DT_COSE_DISABLE_ES512"
+    set+=" -DT_COSE_DISABLE_ES384"
+    set+=" -DT_COSE_DISABLE_EDDSA"
+    set+=" -DT_COSE_DISABLE_PS256"
+    set+=" -DT_COSE_DISABLE_PS384"
+    set+=" -DT_COSE_DISABLE_PS512"
+else
+    # Same as stack.sh
+    set="-DT_COSE_DISABLE_SHORT_CIRCUIT_SIGN"
+    set+=" -DT_COSE_DISABLE_CONTENT_TYPE"
+    set+=" -DT_COSE_DISABLE_ES512"
+    set+=" -DT_COSE_DISABLE_ES384"
+fi
+
+stringpermutations "" "$set" > /tmp/matrix.$$
+rm -f /tmp/matrix.$$.rows
+
+while read compile_options; do
+   matrix_row tdv/Makefile.min psa "$compile_options"
+   matrix_row tdv/Makefile.max ossl "$compile_options"
+done < /tmp/matrix.$$
+
+
+# ----- Report -------------------------------------------------------
+
+tdv/matrix_report.sh -t $SPEED_TOLERANCE -s "$set" /tmp/matrix.$$.rows
+
+rm -f /tmp/matrix.$$ /tmp/matrix.$$.rows /tmp/matrix.$$.bench
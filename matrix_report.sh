@@ -0,0 +1,168 @@
+#!/bin/sh
+
+# The report for matrix.sh: the table of configurations with the
+# Pareto-optimal ones marked and the cost of each feature.
+#
+# Usage: tdv/matrix_report.sh [-t tolerance] -s "defines" rows
+#
+# rows has one configuration per line as matrix.sh writes them:
+#
+#   crypto|options|enc|dec|stack|sign/s|verify/s|sign cyc|verify cyc
+#
+# -s is the space-separated T_COSE_DISABLE_XXX defines that were
+# permuted. -t is the percent within which speeds are taken as equal,
+# default 3. This is separate from matrix.sh so a saved rows file can
+# be reported on again.
+
+tolerance=3
+set=""
+while [ $# -gt 1 ]; do
+    case "$1" in
+    -t) tolerance="$2"; shift 2 ;;
+    -s) set="$2"; shift 2 ;;
+    *)  break ;;
+    esac
+done
+
+if [ $# -ne 1 ] || [ -z "$set" ]; then
+    echo "Usage: $0 [-t tolerance] -s \"defines\" rows" >&2
+    exit 2
+fi
+
+awk -F'|' -v set="$set" -v tolerance="$tolerance" '
+# Short name of a define for printing
+function short(define) {
+    sub(/^-DT_COSE_DISABLE_/, "", define)
+    return define
+}
+
+# Whether configuration a has every feature b has and is no bigger
+# and no slower, and better in at least one
+function dominates(a, b,    k, better, a_off, b_off) {
+    better = 0
+    for(k = 1; k <= num_defines; k++) {
+        a_off = substr(disabled[a], k, 1)
+        b_off = substr(disabled[b], k, 1)
+        if(a_off == "1" && b_off == "0") {
+            return 0
+        }
+        if(a_off == "0" && b_off == "1") {
+            better = 1
+        }
+    }
+    if(enc[a] > enc[b] || dec[a] > dec[b] || stack[a] > stack[b]) {
+        return 0
+    }
+    if(sign[a] < sign[b] * (1 - tolerance / 100) ||
+       verify[a] < verify[b] * (1 - tolerance / 100)) {
+        return 0
+    }
+    if(enc[a] < enc[b] || dec[a] < dec[b] || stack[a] < stack[b] ||
+       sign[a] > sign[b] * (1 + tolerance / 100) ||
+       verify[a] > verify[b] * (1 + tolerance / 100)) {
+        better = 1
+    }
+    return better
+}
+
+BEGIN {
+    num_defines = split(set, define, " ")
+}
+
+{
+    n++
+    crypto[n]   = $1
+    enc[n]      = $3 + 0
+    dec[n]      = $4 + 0
+    stack[n]    = $5 + 0
+    sign[n]     = $6 + 0
+    verify[n]   = $7 + 0
+    sign_cyc[n] = $8
+    ver_cyc[n]  = $9
+
+    disabled[n] = ""
+    names[n]    = ""
+    for(k = 1; k <= num_defines; k++) {
+        if(index(" " $2 " ", " " define[k] " ") > 0) {
+            disabled[n] = disabled[n] "1"
+            names[n]    = names[n] (names[n] == "" ? "" : ",") short(define[k])
+        } else {
+            disabled[n] = disabled[n] "0"
+        }
+    }
+    if(names[n] == "") {
+        names[n] = "(none)"
+    }
+    index_of[$1, disabled[n]] = n
+
+    if(!($1 in seen_crypto)) {
+        seen_crypto[$1] = 1
+        cryptos[++num_cryptos] = $1
+    }
+}
+
+END {
+    for(c = 1; c <= num_cryptos; c++) {
+        printf "\n=== %s ===\n", cryptos[c]
+        printf "%6s %6s %6s %10s %10s %10s %10s %1s  %s\n",
+               "enc", "dec", "stack", "sign/s", "verify/s", "sign cyc", "ver cyc", "P", "disabled"
+        for(i = 1; i <= n; i++) {
+            if(crypto[i] != cryptos[c]) {
+                continue
+            }
+            optimal = "*"
+            for(j = 1; j <= n; j++) {
+                if(j != i && crypto[j] == crypto[i] && dominates(j, i)) {
+                    optimal = ""
+                    break
+                }
+            }
+            printf "%6d %6d %6d %10.1f %10.1f %10s %10s %1s  %s\n",
+                   enc[i], dec[i], stack[i], sign[i], verify[i],
+                   sign_cyc[i], ver_cyc[i], optimal, names[i]
+        }
+
+        printf "\nCost of each feature, with minus without, mean of %s pairs\n", cryptos[c]
+        printf "%-20s %6s %6s %6s %8s %8s %10s %10s\n",
+               "feature", "enc", "dec", "stack", "sign %", "verify %", "sign cyc", "ver cyc"
+        for(k = 1; k <= num_defines; k++) {
+            pairs = 0; d_enc = 0; d_dec = 0; d_stack = 0; d_sign = 0; d_verify = 0
+            cyc_pairs = 0; d_sign_cyc = 0; d_ver_cyc = 0
+            for(i = 1; i <= n; i++) {
+                if(crypto[i] != cryptos[c] || substr(disabled[i], k, 1) != "0") {
+                    continue
+                }
+                without = substr(disabled[i], 1, k - 1) "1" substr(disabled[i], k + 1)
+                if(!((cryptos[c], without) in index_of)) {
+                    continue
+                }
+                j = index_of[cryptos[c], without]
+                pairs++
+                d_enc   += enc[i] - enc[j]
+                d_dec   += dec[i] - dec[j]
+                d_stack += stack[i] - stack[j]
+                if(sign[j] > 0 && verify[j] > 0) {
+                    d_sign   += 100 * (sign[i] - sign[j]) / sign[j]
+                    d_verify += 100 * (verify[i] - verify[j]) / verify[j]
+                }
+                if(sign_cyc[i] ~ /^[0-9.]+$/ && sign_cyc[j] ~ /^[0-9.]+$/ &&
+                   ver_cyc[i] ~ /^[0-9.]+$/ && ver_cyc[j] ~ /^[0-9.]+$/) {
+                    cyc_pairs++
+                    d_sign_cyc += sign_cyc[i] - sign_cyc[j]
+                    d_ver_cyc  += ver_cyc[i] - ver_cyc[j]
+                }
+            }
+            if(pairs == 0) {
+                continue
+            }
+            printf "%-20s %6.0f %6.0f %6.0f %+7.1f%% %+7.1f%%",
+                   short(define[k]), d_enc / pairs, d_dec / pairs, d_stack / pairs,
+                   d_sign / pairs, d_verify / pairs
+            if(cyc_pairs > 0) {
+                printf " %+10.0f %+10.0f\n", d_sign_cyc / cyc_pairs, d_ver_cyc / cyc_pairs
+            } else {
+                printf " %10s %10s\n", "n/a", "n/a"
+            }
+        }
+    }
+}' "$1"
@@ -0,0 +1,101 @@
+#!/bin/bash
+
+#
+# Copyright (c) 2022, Laurence Lundblade. All rights reserved.
+#
+# SPDX-License-Identifier: BSD-3-Clause
+#
+# See BSD-3-Clause license in README.md
+#
+
+# Compiler wrapper that reuses object files across builds. It is put
+# in front of the compiler with "CC=tdv/objcache.sh cc" by perm.sh.
+#
+# An object is looked up by a hash of the compiler, the options and
+# the preprocessed source. A #define that a source file never tests
+# doesn't change its preprocessed output, so that file is compiled
+# once for all the permutations that differ only in such defines. The
+# compiler's warnings are kept with the object and printed again when
+# it is reused so nothing is lost from the build output.
+#
+# Anything other than a compile of one source to an object, a link
+# for example, is passed straight through.
+#
+# The cache is in $OBJCACHE_DIR, default /tmp/objcache. Entries are
+# written under a temporary name and renamed so parallel builds can
+# share it.
+
+compiler=$1
+shift
+
+cache_dir=${OBJCACHE_DIR:-/tmp/objcache}
+
+# Find the output and the arguments without it. Only "-c" compiles
+# with a "-o" are cached.
+compile=0
+output=""
+args=()
+while [ $# -gt 0 ]; do
+    case "$1" in
+    -c) compile=1; args+=("$1") ;;
+    -o) output=$2; shift ;;
+    *)  args+=("$1") ;;
+    esac
+    shift
+done
+
+if [ $compile -eq 0 ] || [ -z "$output" ]; then
+    exec "$compiler" "${args[@]}" ${output:+-o "$output"}
+fi
+
+if command -v sha256sum > /dev/null; then
+    hash_cmd=sha256sum
+else
+    hash_cmd="shasum -a 256"
+fi
+
+# The preprocessing is without line markers so the path of the build
+# directory isn't in the hash. The -D, -U and -I options are left out
+# of the hash as what they do is all in the preprocessed source; that
+# is what lets one object serve many permutations.
+pp_args=()
+key_args=()
+skip_next=0
+for a in "${args[@]}"; do
+    [ "$a" = "-c" ] || pp_args+=("$a")
+    if [ $skip_next -eq 1 ]; then
+        skip_next=0
+        continue
+    fi
+    case "$a" in
+    -D|-U|-I) skip_next=1 ;;
+    -D*|-U*|-I*) ;;
+    *) key_args+=("$a") ;;
+    esac
+done
+
+key=`{ echo "$compiler"
+       "$compiler" -dumpversion
+       echo "${key_args[@]}"
+       "$compiler" -E -P "${pp_args[@]}" 2>/dev/null || echo "preprocess failed $$"
+     } | $hash_cmd | awk '{print $1}'`
+
+if [ -f "$cache_dir/$key.o" ]; then
+    cat "$cache_dir/$key.err" >&2
+    cp "$cache_dir/$key.o" "$output"
+    exit 0
+fi
+
+mkdir -p "$cache_dir"
+"$compiler" "${args[@]}" -o "$output" 2> "$cache_dir/$key.err.$$"
+status=$?
+cat "$cache_dir/$key.err.$$" >&2
+if [ $status -ne 0 ]; then
+    rm -f "$cache_dir/$key.err.$$"
+    exit $status
+fi
+
+# The .err goes in first so an .o is never there without it
+mv "$cache_dir/$key.err.$$" "$cache_dir/$key.err"
+cp "$output" "$cache_dir/$key.o.$$" && mv "$cache_dir/$key.o.$$" "$cache_dir/$key.o"
+exit 0
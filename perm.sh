@@ -0,0 +1,186 @@
+#!/bin/bash
+
+#
+# Copyright (c) 2022, Laurence Lundblade. All rights reserved.
+#
+# SPDX-License-Identifier: BSD-3-Clause
+#
+# See BSD-3-Clause license in README.md
+#
+
+# The #define permutation builds and tests of b.sh, run in parallel.
+# Run from the t_cose root like b.sh.
+#
+# b.sh builds in the source tree so one configuration has to be
+# cleaned away before the next is built. Here each configuration is
+# built in its own directory, a tree of symbolic links to the sources,
+# so many are built and tested at once, one per CPU by default.
+#
+# Objects are shared between the builds with objcache.sh. A source
+# file that doesn't test a define is compiled once for every
+# permutation of it, so most of the 256 builds of each Makefile are
+# mostly links.
+#
+# The output is the same as the permutation part of b.sh, in the same
+# order: the Makefile and defines of each configuration, any compiler
+# warnings and the test SUMMARY line. A configuration that doesn't
+# build or whose tests don't all pass is counted at the end and makes
+# the exit status 1.
+#
+# Usage: tdv/perm.sh [-j jobs] [Makefile ...]
+#
+# The Makefiles are Makefile.test, Makefile.ossl and Makefile.psa if
+# none are given. The object cache is $OBJCACHE_DIR, default
+# /tmp/objcache. It is kept between runs; remove it after changing
+# compilers or system headers.
+
+root=`pwd`
+tdv=$root/tdv
+
+
+# ----- One configuration, run by xargs ------------------------------
+
+# Arguments are one line "n|makefile|options". Writes the report for
+# the configuration to $work/n.out.
+if [ "$1" = "--one" ]; then
+    work=$2
+    IFS='|' read -r n makefile options <<< "$3"
+    dir=$work/$n
+    out=$work/$n.out
+
+    # The tree of links. Only sources and Makefiles are linked so
+    # nothing built in the source tree is picked up or written
+    # through a link.
+    mkdir -p $dir
+    (cd $root && find . -path ./.git -prune -o -type d -print) |\
+        while read d; do mkdir -p "$dir/$d"; done
+    (cd $root && find . -path ./.git -prune -o -type f \
+         \( -name '*.[ch]' -o -name '*.cpp' -o -name 'Makefile*' \) -print) |\
+        while read f; do ln -s "$root/$f" "$dir/$f"; done
+
+    echo "$makefile $options" > $out
+    # Throw away stdout, but not stderr because that's were compiler
+    # warnings and errors show. Same warning flags as b.sh.
+    (cd $dir && make -f $makefile "CMD_LINE=$options $WARN_FLAGS" \
+                     "CC=$tdv/objcache.sh ${CC:-cc}" \
+                     "CXX=$tdv/objcache.sh ${CXX:-c++}" 2>&1 >/dev/null) |\
+        grep -v 'ar: creating' >> $out
+    if [ -x $dir/t_cose_test ]; then
+        (cd $dir && ./t_cose_test) | grep SUMMARY >> $out
+    else
+        echo "BUILD FAILED" >> $out
+    fi
+
+    rm -rf $dir
+    exit 0
+fi
+
+
+# ----- Options ------------------------------------------------------
+
+jobs=`getconf _NPROCESSORS_ONLN 2>/dev/null || sysctl -n hw.ncpu 2>/dev/null || echo 4`
+if [ "$1" = "-j" ]; then
+    jobs=$2
+    shift 2
+fi
+
+makefiles="$@"
+if [ -z "$makefiles" ]; then
+    makefiles="Makefile.test Makefile.ossl Makefile.psa"
+fi
+
+
+# ----- Function for all #define permutations ------------------------
+
+# Same as in b.sh
+function stringpermutations {
+    local prefix=$1 # the prefix is the first argument
+    local theset=$2 # the set left to process is the second argument
+
+    # Output the new prefix
+    echo "$prefix"
+
+    # Loop over each item in the set adding it to the prefix
+    for i in $theset; do
+
+        # Make a new prefix by appending the item from the set to it
+        local newprefix="$prefix ${i}"
+
+        # Update the set by removing one more item from it
+        if [[ ! $theset = *[\ ]* ]]; then
+            theset=""
+        else
+            theset=${theset#* }
+        fi
+
+        if [[ ! -z "$theset" ]]; then
+           # The set is not empty, recurse to process it
+           stringpermutations "$newprefix" "$theset"
+        else
+           # The set is empty, just output the new prefix
+           echo "$newprefix"
+        fi
+    done
+}
+
+
+# ----- All the configurations ---------------------------------------
+
+# The warning flags b.sh uses for the permutations
+warn_flags="-Wall"
+warn_flags+=" -Wextra"
+warn_flags+=" -Wpedantic"
+warn_flags+=" -Wshadow"
+warn_flags+=" -Wconversion"
+warn_flags+=" -Wcast-qual"
+warn_flags+=" -std=c99"
+warn_flags+=" -xc"
+warn_flags+=" -Wstrict-prototypes"
+export WARN_FLAGS="$warn_flags"
+
+# Same as b.sh
+set="-DT_COSE_DISABLE_SHORT_CIRCUIT_SIGN"
+set+=" -DT_COSE_DISABLE_CONTENT_TYPE"
+set+=" -DT_COSE_DISABLE_ES512"
+set+=" -DT_COSE_DISABLE_ES384"
+set+=" -DT_COSE_DISABLE_EDDSA"
+set+=" -DT_COSE_DISABLE_PS256"
+set+=" -DT_COSE_DISABLE_PS384"
+set+=" -DT_COSE_DISABLE_PS512"
+
+work=/tmp/perm.$$
+mkdir -p $work
+
+stringpermutations "" "$set" > $work/options
+
+n=0
+for m in $makefiles; do
+    while read compile_options; do
+        n=$((n + 1))
+        echo "$n|$m|$compile_options"
+    done < $work/options
+done > $work/jobs
+
+start=`date +%s`
+xargs -P $jobs -I {} "$tdv/perm.sh" --one $work {} < $work/jobs
+
+
+# ----- Report -------------------------------------------------------
+
+failed=0
+i=1
+while [ $i -le $n ]; do
+    cat $work/$i.out
+    # The runner prints "SUMMARY: N tests run; M tests failed" even
+    # when M is 0, so only a count of 0 is a pass
+    if ! grep -q 'SUMMARY:.* 0 tests failed' $work/$i.out; then
+        failed=$((failed + 1))
+    fi
+    i=$((i + 1))
+done
+
+echo "===================================="
+echo "$n configurations, $failed failed, $jobs jobs, $((`date +%s` - start)) seconds"
+
+rm -rf $work
+[ $failed -eq 0 ]
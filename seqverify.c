@@ -0,0 +1,324 @@
+/*
+ * seqverify.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+
+/**
+ * \file seqverify.c
+ *
+ * \brief Verify a file of COSE_Sign1 messages in place.
+ *
+ * The file is a CBOR sequence of COSE_Sign1 messages (RFC 8742). It
+ * is mapped and verified in place on a pool of threads with
+ * tdv_seq_verify(). The messages per second and bytes per second are
+ * printed, and the offset and error of each message that doesn't
+ * verify.
+ *
+ * A message with a kid is verified with the key of that name, which
+ * is the kid of a COSE_Key loaded with -k. A message without a kid is
+ * verified with the first key for its algorithm: the first one
+ * loaded with -k or else the built-in test key.
+ *
+ * -g writes a test file of the messages in bench_corpus.c over and
+ * over, with every Nth one made bad if -x is given.
+ *
+ * It is linked with tdv_keys_ossl.c to make seqverify_ossl and with
+ * tdv_keys_psa.c to make seqverify_psa.
+ *
+ * Usage:
+ *
+ *     seqverify_ossl [-t threads] [-k keyfile ...] [-f max_failures] file
+ *     seqverify_ossl -g count [-x every] file
+ */
+
+/* For clock_gettime() */
+#define _POSIX_C_SOURCE 200809L
+
+#include "t_cose/t_cose_common.h"
+#include "t_cose/q_useful_buf.h"
+
+#include "bench_corpus.h"
+#include "tdv_keys.h"
+#include "tdv_keystore.h"
+#include "tdv_seq.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+#define SEQ_DEFAULT_MAX_FAILURES 20
+
+/* Keys added by tdv_keystore_add_builtin(), one per algorithm */
+#define SEQ_BUILTIN_KEYS         3
+
+
+struct failure_ctx {
+    /* Print slots taken so far. Called from every worker thread. */
+    atomic_uint printed;
+    unsigned    max_failures;
+};
+
+
+/*
+ * The resolver for tdv_seq_verify(). Only reads the key store so it is
+ * thread safe.
+ */
+static enum t_cose_err_t keystore_resolver(void                 *resolver_ctx,
+                                           int32_t               cose_algorithm_id,
+                                           struct q_useful_buf_c kid,
+                                           struct t_cose_key    *key)
+{
+    char name[TDV_KEYSTORE_MAX_NAME];
+
+    if(q_useful_buf_c_is_null_or_empty(kid)) {
+        return tdv_keystore_find((const struct tdv_keystore *)resolver_ctx,
+                                 cose_algorithm_id,
+                                 NULL,
+                                 0,
+                                 key);
+    }
+
+    if(kid.len >= sizeof(name) || memchr(kid.ptr, '\0', kid.len) != NULL) {
+        return T_COSE_ERR_UNKNOWN_KEY;
+    }
+    memcpy(name, kid.ptr, kid.len);
+    name[kid.len] = '\0';
+
+    return tdv_keystore_find((const struct tdv_keystore *)resolver_ctx,
+                             cose_algorithm_id,
+                             name,
+                             0,
+                             key);
+}
+
+
+static void print_failure(void                        *result_ctx,
+                          uint64_t                     index,
+                          size_t                       offset,
+                          const struct tdv_batch_item *item)
+{
+    struct failure_ctx *ctx = (struct failure_ctx *)result_ctx;
+
+    if(item->result == T_COSE_SUCCESS) {
+        return;
+    }
+    /* The load first so that the count stops going up, and can't wrap,
+     * once all the slots are taken */
+    if(atomic_load_explicit(&ctx->printed, memory_order_relaxed) >= ctx->max_failures ||
+       atomic_fetch_add_explicit(&ctx->printed, 1, memory_order_relaxed) >= ctx->max_failures) {
+        return;
+    }
+    /* One call so lines from different threads don't mix */
+    printf("message %llu at offset %zu: error %d\n",
+           (unsigned long long)index, offset, item->result);
+}
+
+
+static double now_sec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+
+/*
+ * Write count messages from bench_corpus.c in turn. Every nth one has
+ * the last byte of its signature changed if bad_every isn't 0.
+ */
+static int generate(const char *file_name, unsigned count, unsigned bad_every)
+{
+    FILE                  *f;
+    struct q_useful_buf_c  msg;
+    uint8_t                last;
+    unsigned               i;
+    int                    ok;
+
+    f = fopen(file_name, "wb");
+    if(f == NULL) {
+        perror(file_name);
+        return 1;
+    }
+
+    ok = 1;
+    for(i = 0; i < count && ok; i++) {
+        msg = bench_corpus[i % bench_corpus_count].cose_sign1;
+        last = ((const uint8_t *)msg.ptr)[msg.len - 1];
+        if(bad_every && i % bad_every == bad_every - 1) {
+            last ^= 0x01;
+        }
+        ok = fwrite(msg.ptr, 1, msg.len - 1, f) == msg.len - 1 && fputc(last, f) != EOF;
+    }
+    ok = fclose(f) == 0 && ok;
+    if(!ok) {
+        perror(file_name);
+        return 1;
+    }
+
+    printf("Wrote %u messages to %s\n", count, file_name);
+    return 0;
+}
+
+
+static int parse_count(const char *arg, unsigned *count)
+{
+    char          *end;
+    unsigned long  value;
+
+    if(arg == NULL) {
+        return -1;
+    }
+    value = strtoul(arg, &end, 10);
+    if(*end != '\0' || value < 1 || value > 1000000000) {
+        return -1;
+    }
+    *count = (unsigned)value;
+    return 0;
+}
+
+
+int main(int argc, const char * argv[])
+{
+    struct tdv_keystore   keys;
+    struct tdv_seq        seq;
+    struct tdv_seq_result result;
+    struct failure_ctx    failures;
+    enum t_cose_err_t     return_value;
+    const char           *key_files[TDV_KEYSTORE_MAX_KEYS];
+    size_t                num_key_files;
+    const char           *seq_file;
+    unsigned              num_threads;
+    unsigned              generate_count;
+    unsigned              bad_every;
+    double                start;
+    double                seconds;
+    size_t                m;
+    int                   i;
+
+    num_threads           = 0;
+    generate_count        = 0;
+    bad_every             = 0;
+    num_key_files         = 0;
+    seq_file              = NULL;
+    atomic_init(&failures.printed, 0);
+    failures.max_failures = SEQ_DEFAULT_MAX_FAILURES;
+
+    for(i = 1; i < argc; i++) {
+        if(!strcmp(argv[i], "-t")) {
+            if(parse_count(argv[++i], &num_threads)) {
+                goto Usage;
+            }
+        } else if(!strcmp(argv[i], "-f")) {
+            if(parse_count(argv[++i], &failures.max_failures)) {
+                goto Usage;
+            }
+        } else if(!strcmp(argv[i], "-g")) {
+            if(parse_count(argv[++i], &generate_count)) {
+                goto Usage;
+            }
+        } else if(!strcmp(argv[i], "-x")) {
+            if(parse_count(argv[++i], &bad_every)) {
+                goto Usage;
+            }
+        } else if(!strcmp(argv[i], "-k")) {
+            /* Room is left for the built-in keys */
+            if(argv[++i] == NULL || num_key_files == TDV_KEYSTORE_MAX_KEYS - SEQ_BUILTIN_KEYS) {
+                goto Usage;
+            }
+            key_files[num_key_files++] = argv[i];
+        } else if(argv[i][0] != '-' && seq_file == NULL) {
+            seq_file = argv[i];
+        } else {
+            goto Usage;
+        }
+    }
+    if(seq_file == NULL) {
+        goto Usage;
+    }
+
+    if(generate_count) {
+        return generate(seq_file, generate_count, bad_every);
+    }
+
+    tdv_keystore_init(&keys);
+    for(m = 0; m < num_key_files; m++) {
+        return_value = tdv_keystore_add_file(&keys, key_files[m], TDV_KEYSTORE_MMAP);
+        if(return_value) {
+            fprintf(stderr, "%s: can't load key: %d\n", key_files[m], return_value);
+            tdv_keystore_free(&keys);
+            return 1;
+        }
+    }
+    return_value = tdv_keystore_add_builtin(&keys);
+    if(return_value) {
+        fprintf(stderr, "can't make built-in keys: %d\n", return_value);
+        tdv_keystore_free(&keys);
+        return 1;
+    }
+
+    if(tdv_seq_map(&seq, seq_file)) {
+        perror(seq_file);
+        tdv_keystore_free(&keys);
+        return 1;
+    }
+
+    start = now_sec();
+    return_value = tdv_seq_verify(&seq,
+                                  num_threads,
+                                  0,
+                                  NULL,
+                                  keystore_resolver,
+                                  &keys,
+                                  print_failure,
+                                  &failures,
+                                  &result);
+    seconds = now_sec() - start;
+
+    if(return_value == T_COSE_ERR_CBOR_NOT_WELL_FORMED) {
+        printf("CBOR not well formed at offset %zu, the rest of the file is not verified\n",
+               result.scan_end);
+    } else if(return_value) {
+        fprintf(stderr, "can't verify: %d\n", return_value);
+    }
+
+    printf("\n%s, %s crypto, %.1f MB\n",
+           seq_file, tdv_crypto_lib_name(), (double)seq.size / 1e6);
+    printf("%llu messages, %llu verified, %llu failed\n",
+           (unsigned long long)result.messages,
+           (unsigned long long)result.verified,
+           (unsigned long long)(result.messages - result.verified));
+    if(seconds > 0) {
+        printf("%.3f sec, %.1f msgs/sec, %.1f MB/s\n",
+               seconds,
+               (double)result.messages / seconds,
+               (double)result.bytes / 1e6 / seconds);
+    }
+
+    tdv_seq_unmap(&seq);
+    tdv_keystore_free(&keys);
+    return return_value || result.verified != result.messages ? 1 : 0;
+
+Usage:
+    fprintf(stderr,
+            "Usage: %s [-t threads] [-k keyfile ...] [-f max_failures] file\n"
+            "       %s -g count [-x every] file\n"
+            "  -t  Threads, default the number of CPUs\n"
+            "  -k  Verify with the key in a PEM, DER or COSE_Key file\n"
+            "  -f  Most failures printed, default %d\n"
+            "  -g  Write a test file of count messages\n"
+            "  -x  Make every Nth message written bad\n",
+            argv[0],
+            argv[0],
+            SEQ_DEFAULT_MAX_FAILURES);
+    return 2;
+}
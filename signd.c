@@ -0,0 +1,176 @@
+/*
+ * signd.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+
+/**
+ * \file signd.c
+ *
+ * \brief Signing service on a UNIX domain socket.
+ *
+ * The keys are loaded once, from -k files and the built-in test keys,
+ * and payloads sent over the socket are signed with them by
+ * tdv_signd.h. See there for the protocol. It runs until SIGINT or
+ * SIGTERM and then prints how many requests it signed and in how many
+ * batches.
+ *
+ * signload is a load generator for it.
+ *
+ * It is linked with tdv_keys_ossl.c to make signd_ossl and with
+ * tdv_keys_psa.c to make signd_psa.
+ *
+ * Usage:
+ *
+ *     signd_ossl [-s socket] [-t threads] [-b max_batch] [-k keyfile ...]
+ */
+
+/* For sigwait() and pthread_sigmask() */
+#define _POSIX_C_SOURCE 200809L
+
+#include "t_cose/t_cose_common.h"
+
+#include "tdv_keys.h"
+#include "tdv_keystore.h"
+#include "tdv_signd.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define SIGND_DEFAULT_SOCKET    "/tmp/tdv_signd.sock"
+#define SIGND_DEFAULT_BATCH     64
+
+/* Keys added by tdv_keystore_add_builtin(), one per algorithm */
+#define SIGND_BUILTIN_KEYS      3
+
+
+static int parse_count(const char *arg, unsigned max, unsigned *count)
+{
+    char          *end;
+    unsigned long  value;
+
+    if(arg == NULL) {
+        return -1;
+    }
+    value = strtoul(arg, &end, 10);
+    if(*end != '\0' || value < 1 || value > max) {
+        return -1;
+    }
+    *count = (unsigned)value;
+    return 0;
+}
+
+
+int main(int argc, const char * argv[])
+{
+    struct tdv_keystore keys;
+    struct tdv_signd    signd;
+    enum t_cose_err_t   return_value;
+    const char         *key_files[TDV_KEYSTORE_MAX_KEYS];
+    size_t              num_key_files;
+    const char         *socket_path;
+    unsigned            num_threads;
+    unsigned            max_batch;
+    sigset_t            signals;
+    int                 signal_number;
+    uint64_t            requests;
+    uint64_t            batches;
+    uint64_t            connections;
+    size_t              m;
+    int                 i;
+
+    socket_path   = SIGND_DEFAULT_SOCKET;
+    num_threads   = 0;
+    max_batch     = SIGND_DEFAULT_BATCH;
+    num_key_files = 0;
+
+    for(i = 1; i < argc; i++) {
+        if(!strcmp(argv[i], "-s")) {
+            if(argv[++i] == NULL) {
+                goto Usage;
+            }
+            socket_path = argv[i];
+        } else if(!strcmp(argv[i], "-t")) {
+            if(parse_count(argv[++i], TDV_SIGND_MAX_THREADS, &num_threads)) {
+                goto Usage;
+            }
+        } else if(!strcmp(argv[i], "-b")) {
+            if(parse_count(argv[++i], TDV_SIGND_MAX_BATCH, &max_batch)) {
+                goto Usage;
+            }
+        } else if(!strcmp(argv[i], "-k")) {
+            /* Room is left for the built-in keys */
+            if(argv[++i] == NULL || num_key_files == TDV_KEYSTORE_MAX_KEYS - SIGND_BUILTIN_KEYS) {
+                goto Usage;
+            }
+            key_files[num_key_files++] = argv[i];
+        } else {
+            goto Usage;
+        }
+    }
+
+    tdv_keystore_init(&keys);
+    for(m = 0; m < num_key_files; m++) {
+        return_value = tdv_keystore_add_file(&keys, key_files[m], 0);
+        if(return_value) {
+            fprintf(stderr, "%s: can't load key: %d\n", key_files[m], return_value);
+            tdv_keystore_free(&keys);
+            return 1;
+        }
+    }
+    return_value = tdv_keystore_add_builtin(&keys);
+    if(return_value) {
+        fprintf(stderr, "can't make built-in keys: %d\n", return_value);
+        tdv_keystore_free(&keys);
+        return 1;
+    }
+
+    /* Blocked before the threads start so only sigwait() gets them */
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    return_value = tdv_signd_start(&signd, socket_path, &keys, num_threads, max_batch);
+    if(return_value) {
+        fprintf(stderr, "%s: can't start: %d\n", socket_path, return_value);
+        tdv_keystore_free(&keys);
+        return 1;
+    }
+    printf("Signing on %s, %s crypto, %zu keys, %u threads, batches of up to %u\n",
+           socket_path, tdv_crypto_lib_name(), keys.count, signd.num_threads, max_batch);
+    fflush(stdout);
+
+    sigwait(&signals, &signal_number);
+
+    tdv_signd_counts(&signd, &requests, &batches, &connections);
+    tdv_signd_stop(&signd);
+    tdv_keystore_free(&keys);
+
+    printf("%llu requests in %llu batches (%.1f per batch) on %llu connections\n",
+           (unsigned long long)requests,
+           (unsigned long long)batches,
+           batches ? (double)requests / (double)batches : 0.0,
+           (unsigned long long)connections);
+    return 0;
+
+Usage:
+    fprintf(stderr,
+            "Usage: %s [-s socket] [-t threads] [-b max_batch] [-k keyfile ...]\n"
+            "  -s  Socket path, default %s\n"
+            "  -t  Worker threads, default the number of CPUs\n"
+            "  -b  Most requests signed as a batch, default %d\n"
+            "  -k  Sign with the key in a PEM, DER or COSE_Key file\n",
+            argv[0],
+            SIGND_DEFAULT_SOCKET,
+            SIGND_DEFAULT_BATCH);
+    return 2;
+}
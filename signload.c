@@ -0,0 +1,542 @@
+/*
+ * signload.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+
+/**
+ * \file signload.c
+ *
+ * \brief Load generator for signd.
+ *
+ * For each number of connections and each batch size given, that many
+ * threads each connect to signd and send a batch of requests with one
+ * write, read all the responses and repeat until each has sent its
+ * count. The throughput of all the connections together and the
+ * latency of each request, from the write of its batch to its
+ * response, are printed.
+ *
+ * The requests are signed with the built-in key for the algorithm by
+ * default, which this also has, so the first response at each point
+ * is verified with t_cose_sign1_verify().
+ *
+ * A batch is written in one go before any responses are read, so
+ * batch times the request size is kept to what the socket buffers
+ * hold.
+ *
+ * Usage:
+ *
+ *     signload_ossl [-s socket] [-c conns,...] [-b batch,...] [-n count]
+ *                   [-p payload_size] [-a ES256|ES384|ES512] [-K key]
+ */
+
+/* For clock_gettime() and pthread_barrier_t */
+#define _POSIX_C_SOURCE 200809L
+
+#include "t_cose/t_cose_common.h"
+#include "t_cose/t_cose_sign1_verify.h"
+#include "t_cose/q_useful_buf.h"
+
+#include "bench.h"
+#include "tdv_keys.h"
+#include "tdv_keystore.h"
+#include "tdv_signd.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+
+#define LOAD_DEFAULT_SOCKET   "/tmp/tdv_signd.sock"
+#define LOAD_DEFAULT_COUNT    2000
+#define LOAD_DEFAULT_PAYLOAD  200
+
+/* Most values in a -c or -b list */
+#define LOAD_MAX_POINTS       16
+
+#define LOAD_MAX_CONNS        256
+
+/* Most bytes of requests written at once */
+#define LOAD_MAX_WRITE        65536
+
+/* Receive buffer. A whole response always fits with room for more. */
+#define LOAD_RECV_SIZE        (2 * (4 + TDV_SIGND_MAX_FRAME))
+
+
+struct load_point {
+    const char        *socket_path;
+    /* batch copies of the request frame */
+    const uint8_t     *requests;
+    size_t             request_len;
+    unsigned           batch;
+    unsigned           count;
+    /* The connections start sending together */
+    pthread_barrier_t  start;
+};
+
+
+struct load_conn {
+    struct load_point       *point;
+    uint64_t                *samples_ns;
+    size_t                   num_samples;
+    uint64_t                 failures;
+    /* The first response, for checking. Only kept by the first
+     * connection. */
+    uint8_t                 *first;
+    size_t                   first_len;
+    /* Error message if the connection failed */
+    const char              *error;
+};
+
+
+static int send_all(int fd, const uint8_t *buf, size_t len)
+{
+    ssize_t n;
+
+    while(len > 0) {
+        n = send(fd, buf, len, MSG_NOSIGNAL);
+        if(n < 0 && errno == EINTR) {
+            continue;
+        }
+        if(n <= 0) {
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+
+static int connect_socket(const char *socket_path)
+{
+    struct sockaddr_un addr;
+    int                fd;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(strlen(socket_path) >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    strcpy(addr.sun_path, socket_path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0) {
+        return -1;
+    }
+    if(connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+
+/*
+ * Send batches and read their responses until count requests have
+ * been answered.
+ */
+static void run_conn(struct load_conn *conn, int fd, uint8_t *recv_buf)
+{
+    const struct load_point *point = conn->point;
+    enum t_cose_err_t        result;
+    struct q_useful_buf_c    cose_sign1;
+    uint64_t                 start_ns;
+    size_t                   recv_len;
+    size_t                   pos;
+    size_t                   frame_len;
+    ssize_t                  n;
+    unsigned                 sent;
+    unsigned                 answered;
+
+    recv_len = 0;
+    for(sent = 0; sent < point->count; sent += point->batch) {
+        start_ns = bench_now_ns();
+        if(send_all(fd, point->requests, point->request_len * point->batch)) {
+            conn->error = "send failed";
+            return;
+        }
+
+        answered = 0;
+        while(answered < point->batch) {
+            n = read(fd, recv_buf + recv_len, LOAD_RECV_SIZE - recv_len);
+            if(n < 0 && errno == EINTR) {
+                continue;
+            }
+            if(n <= 0) {
+                conn->error = "connection closed";
+                return;
+            }
+            recv_len += (size_t)n;
+
+            pos = 0;
+            while(answered < point->batch) {
+                frame_len = tdv_signd_get_response((struct q_useful_buf_c){recv_buf + pos, recv_len - pos},
+                                                   &result,
+                                                   &cose_sign1);
+                if(frame_len == SIZE_MAX) {
+                    conn->error = "bad response";
+                    return;
+                }
+                if(frame_len == 0) {
+                    break;
+                }
+                conn->samples_ns[conn->num_samples++] = bench_now_ns() - start_ns;
+                if(result) {
+                    conn->failures++;
+                } else if(conn->first != NULL && conn->first_len == 0) {
+                    memcpy(conn->first, cose_sign1.ptr, cose_sign1.len);
+                    conn->first_len = cose_sign1.len;
+                }
+                pos += frame_len;
+                answered++;
+            }
+            memmove(recv_buf, recv_buf + pos, recv_len - pos);
+            recv_len -= pos;
+        }
+    }
+}
+
+
+static void *conn_thread(void *arg)
+{
+    struct load_conn *conn = (struct load_conn *)arg;
+    uint8_t          *recv_buf;
+    int               fd;
+
+    fd       = connect_socket(conn->point->socket_path);
+    recv_buf = malloc(LOAD_RECV_SIZE);
+    if(fd < 0) {
+        conn->error = "can't connect";
+    } else if(recv_buf == NULL) {
+        conn->error = "out of memory";
+    }
+
+    /* All wait here, even on failure, so the barrier is released */
+    pthread_barrier_wait(&conn->point->start);
+
+    if(conn->error == NULL) {
+        run_conn(conn, fd, recv_buf);
+    }
+
+    if(fd >= 0) {
+        close(fd);
+    }
+    free(recv_buf);
+    return NULL;
+}
+
+
+static enum t_cose_err_t check_signed(struct t_cose_key key, const uint8_t *cose_sign1, size_t len)
+{
+    struct t_cose_sign1_verify_ctx verify_ctx;
+    struct q_useful_buf_c          payload;
+
+    t_cose_sign1_verify_init(&verify_ctx, 0);
+    t_cose_sign1_set_verification_key(&verify_ctx, key);
+
+    return t_cose_sign1_verify(&verify_ctx, (struct q_useful_buf_c){cose_sign1, len}, &payload, NULL);
+}
+
+
+/*
+ * Run one number of connections and batch size and print a line.
+ * Returns 0 on success.
+ */
+static int run_point(struct load_point       *point,
+                     unsigned                 num_conns,
+                     const struct t_cose_key *verify_key)
+{
+    struct load_conn    conns[LOAD_MAX_CONNS];
+    pthread_t           threads[LOAD_MAX_CONNS];
+    uint64_t           *samples_ns;
+    uint64_t            failures;
+    struct bench_result result;
+    enum t_cose_err_t   verify_result;
+    uint64_t            start_ns;
+    double              seconds;
+    size_t              total;
+    size_t              per_conn;
+    unsigned            started;
+    unsigned            c;
+    int                 errors;
+
+    errors = 0;
+    /* Whole batches are sent so the count is rounded up */
+    per_conn   = ((size_t)point->count + point->batch - 1) / point->batch * point->batch;
+    samples_ns = malloc(num_conns * per_conn * sizeof(uint64_t));
+    if(samples_ns == NULL) {
+        printf("%-6u %-6u out of memory\n", num_conns, point->batch);
+        return 1;
+    }
+    memset(conns, 0, sizeof(conns[0]) * num_conns);
+    conns[0].first = malloc(TDV_SIGND_MAX_FRAME);
+
+    pthread_barrier_init(&point->start, NULL, num_conns + 1);
+    for(started = 0; started < num_conns; started++) {
+        conns[started].point      = point;
+        conns[started].samples_ns = samples_ns + started * per_conn;
+        if(pthread_create(&threads[started], NULL, conn_thread, &conns[started])) {
+            break;
+        }
+    }
+    if(started < num_conns) {
+        /* The barrier can't be released so this is the end */
+        fprintf(stderr, "can't start thread %u\n", started);
+        exit(1);
+    }
+
+    pthread_barrier_wait(&point->start);
+    start_ns = bench_now_ns();
+    for(c = 0; c < num_conns; c++) {
+        pthread_join(threads[c], NULL);
+    }
+    seconds = (double)(bench_now_ns() - start_ns) / 1e9;
+    pthread_barrier_destroy(&point->start);
+
+    total    = 0;
+    failures = 0;
+    for(c = 0; c < num_conns; c++) {
+        if(conns[c].error != NULL) {
+            printf("%-6u %-6u connection %u: %s\n", num_conns, point->batch, c, conns[c].error);
+            errors++;
+        }
+        /* Compact the samples so the stats are over those taken */
+        memmove(samples_ns + total, conns[c].samples_ns, conns[c].num_samples * sizeof(uint64_t));
+        total    += conns[c].num_samples;
+        failures += conns[c].failures;
+    }
+
+    verify_result = T_COSE_SUCCESS;
+    if(verify_key != NULL && conns[0].first_len) {
+        verify_result = check_signed(*verify_key, conns[0].first, conns[0].first_len);
+    }
+
+    bench_latency_stats(samples_ns, total, &result);
+    printf("%-6u %-6u %12.1f %10.3f %10.3f %10.3f %10.3f",
+           num_conns,
+           point->batch,
+           seconds > 0 ? (double)total / seconds : 0.0,
+           result.mean_ns / 1e6,
+           result.median_ns / 1e6,
+           result.p90_ns / 1e6,
+           result.p99_ns / 1e6);
+    if(failures) {
+        printf("  %llu failed", (unsigned long long)failures);
+        errors++;
+    }
+    if(verify_result) {
+        printf("  verify failed: %d", verify_result);
+        errors++;
+    }
+    printf("\n");
+
+    free(conns[0].first);
+    free(samples_ns);
+    return errors;
+}
+
+
+static int parse_count(const char *arg, unsigned max, unsigned *count)
+{
+    char          *end;
+    unsigned long  value;
+
+    if(arg == NULL) {
+        return -1;
+    }
+    value = strtoul(arg, &end, 10);
+    if(*end != '\0' || value < 1 || value > max) {
+        return -1;
+    }
+    *count = (unsigned)value;
+    return 0;
+}
+
+
+/*
+ * Parse a comma-separated list of numbers from 1 to max.
+ */
+static int parse_list(const char *arg, unsigned max, unsigned *values, unsigned *num_values)
+{
+    const char    *p;
+    char          *end;
+    unsigned long  value;
+
+    if(arg == NULL) {
+        return -1;
+    }
+    *num_values = 0;
+    p = arg;
+    for(;;) {
+        value = strtoul(p, &end, 10);
+        if(end == p || value < 1 || value > max || *num_values == LOAD_MAX_POINTS) {
+            return -1;
+        }
+        values[(*num_values)++] = (unsigned)value;
+        if(*end == '\0') {
+            return 0;
+        }
+        if(*end != ',') {
+            return -1;
+        }
+        p = end + 1;
+    }
+}
+
+
+int main(int argc, const char * argv[])
+{
+    struct load_point   point;
+    struct tdv_keystore keys;
+    struct t_cose_key   verify_key;
+    const char         *key_name;
+    const char         *alg_name;
+    int32_t             cose_algorithm_id;
+    unsigned            conn_counts[LOAD_MAX_POINTS] = {1, 4, 16, 64};
+    unsigned            num_conn_counts = 4;
+    unsigned            batches[LOAD_MAX_POINTS] = {1, 8, 32};
+    unsigned            num_batches = 3;
+    unsigned            payload_size;
+    uint8_t            *payload;
+    uint8_t            *requests;
+    size_t              request_len;
+    unsigned            c;
+    unsigned            b;
+    unsigned            p;
+    int                 have_key;
+    int                 errors;
+    int                 i;
+
+    point.socket_path = LOAD_DEFAULT_SOCKET;
+    point.count       = LOAD_DEFAULT_COUNT;
+    payload_size      = LOAD_DEFAULT_PAYLOAD;
+    alg_name          = "ES256";
+    key_name          = TDV_KEYSTORE_BUILTIN;
+
+    for(i = 1; i < argc; i++) {
+        if(!strcmp(argv[i], "-s")) {
+            if(argv[++i] == NULL) {
+                goto Usage;
+            }
+            point.socket_path = argv[i];
+        } else if(!strcmp(argv[i], "-c")) {
+            if(parse_list(argv[++i], LOAD_MAX_CONNS, conn_counts, &num_conn_counts)) {
+                goto Usage;
+            }
+        } else if(!strcmp(argv[i], "-b")) {
+            if(parse_list(argv[++i], TDV_SIGND_MAX_BATCH, batches, &num_batches)) {
+                goto Usage;
+            }
+        } else if(!strcmp(argv[i], "-n")) {
+            if(parse_count(argv[++i], 10000000, &point.count)) {
+                goto Usage;
+            }
+        } else if(!strcmp(argv[i], "-p")) {
+            if(parse_count(argv[++i], TDV_SIGND_MAX_PAYLOAD, &payload_size)) {
+                goto Usage;
+            }
+        } else if(!strcmp(argv[i], "-a")) {
+            if(argv[++i] == NULL) {
+                goto Usage;
+            }
+            alg_name = argv[i];
+        } else if(!strcmp(argv[i], "-K")) {
+            if(argv[++i] == NULL) {
+                goto Usage;
+            }
+            key_name = argv[i];
+        } else {
+            goto Usage;
+        }
+    }
+
+    if(!strcmp(alg_name, "ES256")) {
+        cose_algorithm_id = T_COSE_ALGORITHM_ES256;
+    } else if(!strcmp(alg_name, "ES384")) {
+        cose_algorithm_id = T_COSE_ALGORITHM_ES384;
+    } else if(!strcmp(alg_name, "ES512")) {
+        cose_algorithm_id = T_COSE_ALGORITHM_ES512;
+    } else {
+        goto Usage;
+    }
+
+    /* The built-in keys to check the responses with */
+    tdv_keystore_init(&keys);
+    have_key = !strcmp(key_name, TDV_KEYSTORE_BUILTIN) &&
+               tdv_keystore_add_builtin(&keys) == T_COSE_SUCCESS &&
+               tdv_keystore_find(&keys, cose_algorithm_id, TDV_KEYSTORE_BUILTIN, 0, &verify_key) == T_COSE_SUCCESS;
+
+    payload     = malloc(payload_size);
+    requests    = malloc(LOAD_MAX_WRITE);
+    request_len = 0;
+    if(payload != NULL && requests != NULL) {
+        memset(payload, 'x', payload_size);
+        request_len = tdv_signd_put_request((struct q_useful_buf){requests, LOAD_MAX_WRITE},
+                                            cose_algorithm_id,
+                                            key_name,
+                                            (struct q_useful_buf_c){payload, payload_size});
+    }
+    if(request_len == 0) {
+        fprintf(stderr, "can't make request\n");
+        return 1;
+    }
+    for(b = 0; b < num_batches; b++) {
+        if(batches[b] * request_len > LOAD_MAX_WRITE) {
+            fprintf(stderr, "batch of %u with a %u byte payload is more than %d bytes\n",
+                    batches[b], payload_size, LOAD_MAX_WRITE);
+            return 2;
+        }
+    }
+    point.requests    = requests;
+    point.request_len = request_len;
+
+    printf("%s, %s key \"%s\", %u byte payload, %u requests per connection\n",
+           point.socket_path, alg_name, key_name, payload_size, point.count);
+    printf("%-6s %-6s %12s %10s %10s %10s %10s\n",
+           "conns", "batch", "msgs/s", "mean ms", "median ms", "p90 ms", "p99 ms");
+
+    errors = 0;
+    for(c = 0; c < num_conn_counts; c++) {
+        for(b = 0; b < num_batches; b++) {
+            point.batch = batches[b];
+            for(p = 1; p < point.batch; p++) {
+                memcpy(requests + p * request_len, requests, request_len);
+            }
+            errors += run_point(&point, conn_counts[c], have_key ? &verify_key : NULL);
+        }
+    }
+
+    free(payload);
+    free(requests);
+    tdv_keystore_free(&keys);
+    return errors ? 1 : 0;
+
+Usage:
+    fprintf(stderr,
+            "Usage: %s [-s socket] [-c conns,...] [-b batch,...] [-n count]\n"
+            "          [-p payload_size] [-a ES256|ES384|ES512] [-K key]\n"
+            "  -s  Socket path, default %s\n"
+            "  -c  Numbers of connections, default 1,4,16,64\n"
+            "  -b  Requests written at once, default 1,8,32\n"
+            "  -n  Requests per connection, default %d\n"
+            "  -p  Payload size, default %d\n"
+            "  -a  Algorithm, default ES256\n"
+            "  -K  Key name, default %s\n",
+            argv[0],
+            LOAD_DEFAULT_SOCKET,
+            LOAD_DEFAULT_COUNT,
+            LOAD_DEFAULT_PAYLOAD,
+            TDV_KEYSTORE_BUILTIN);
+    return 2;
+}
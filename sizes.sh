@@ -5,7 +5,14 @@
 # by the separate ".o" files in the ".a". This can work on ".o" files,
 # but only those are to be part of libqcbor.a
 
-fun=`nm libt_cose.a | awk '/ [TtSs] /{printf "%s|", $3 }'; echo xxxxxxxxxxxxxx`
+fun=`$(dirname $0)/lib_funs.sh`
+
+# -U is defined symbols only for the macOS nm. GNU nm calls it
+# --defined-only.
+defined_only=-U
+if nm --version 2>/dev/null | grep -q GNU; then
+    defined_only=--defined-only
+fi
 
 # It is not possible to get the size of the last symbol because nm
 # doesn't output the end of the last item in the list.  This is
@@ -13,7 +20,7 @@ fun=`nm libt_cose.a | awk '/ [TtSs] /{printf "%s|", $3 }'; echo xxxxxxxxxxxxxx`
 # only one function of the whole linked library left off.
 
 
-nm -n -t d -U $1 |\
+nm -n -t d $defined_only $1 |\
 grep ' [TtSs] ' |\
 awk 'NR!=1{printf "%-45s %4s\n", name, $1 - offset }
      {offset=$1; name=$3}' |\
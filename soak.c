@@ -0,0 +1,313 @@
+/*
+ * soak.c, derived from encode_only_ossl.c and decode_only_ossl.c
+ *
+ * Copyright 2019-2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+
+/**
+ * \file soak.c
+ *
+ * \brief Long-running key create / sign / verify / free soak test.
+ *
+ * This repeats the whole life of a key the way a long-running signer
+ * that re-creates its keys does: make the key, sign a message with
+ * it, verify the message and free the key. Every so many cycles the
+ * resident set size of the process and the number of keys the crypto
+ * library holds are printed. It is linked with tdv_keys_ossl.c to make
+ * soak_ossl and with tdv_keys_psa.c to make soak_psa.
+ *
+ * Usage:
+ *
+ *     soak_ossl [-n cycles] [-s sample_every] [-l limit_kb] [alg ...]
+ *
+ * The algorithms are ES256, ES384 and ES512 and are used in turn. The
+ * default is all of them for one million cycles.
+ *
+ * The first sample is the baseline. It is taken after the first
+ * sample_every cycles so the lazy set up in the crypto library and
+ * the growth of the C library's heap arenas are not counted. The run
+ * fails if RSS grew by more than limit_kb over the baseline by the
+ * end or if the crypto library holds more keys than it did at the
+ * baseline. Either means something is not being freed. A leak of a
+ * few hundred bytes per key is clearly visible within a million
+ * cycles.
+ *
+ * RSS is the current RSS from /proc/self/statm on Linux. Elsewhere it
+ * is the peak RSS from getrusage(), which also grows with a leak.
+ */
+
+/* For clock_gettime() */
+#define _POSIX_C_SOURCE 200809L
+
+#include "t_cose/t_cose_common.h"
+#include "t_cose/t_cose_sign1_sign.h"
+#include "t_cose/t_cose_sign1_verify.h"
+#include "t_cose/q_useful_buf.h"
+
+#include "tdv_keys.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+
+#define SOAK_DEFAULT_CYCLES       1000000
+#define SOAK_DEFAULT_SAMPLE_EVERY 50000
+#define SOAK_DEFAULT_LIMIT_KB     1024
+
+
+/*
+ * Resident set size in KB or -1 if it can't be had.
+ */
+static long rss_kb(void)
+{
+    struct rusage usage;
+    FILE         *statm;
+    long          pages;
+    int           got;
+
+    statm = fopen("/proc/self/statm", "r");
+    if(statm != NULL) {
+        /* The second field is the resident pages */
+        got = fscanf(statm, "%*s %ld", &pages);
+        fclose(statm);
+        if(got == 1) {
+            return pages * (sysconf(_SC_PAGESIZE) / 1024);
+        }
+    }
+
+    if(getrusage(RUSAGE_SELF, &usage)) {
+        return -1;
+    }
+#ifdef __APPLE__
+    /* In bytes on macOS, KB on Linux */
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+
+static double now_sec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+
+/*
+ * One full life of a key. The key is freed on all paths.
+ */
+static enum t_cose_err_t soak_cycle(int32_t cose_algorithm_id)
+{
+    struct t_cose_key              key_pair;
+    struct t_cose_sign1_sign_ctx   sign_ctx;
+    struct t_cose_sign1_verify_ctx verify_ctx;
+    enum t_cose_err_t              return_value;
+    struct q_useful_buf_c          signed_cose;
+    struct q_useful_buf_c          payload;
+    Q_USEFUL_BUF_MAKE_STACK_UB(    signed_cose_buffer, 300);
+
+    static const struct q_useful_buf_c message =
+        Q_USEFUL_BUF_FROM_SZ_LITERAL("We come in peace");
+
+    return_value = make_ecdsa_key_pair(cose_algorithm_id, &key_pair);
+    if(return_value) {
+        return return_value;
+    }
+
+    t_cose_sign1_sign_init(&sign_ctx, 0, cose_algorithm_id);
+    t_cose_sign1_set_signing_key(&sign_ctx, key_pair, NULL_Q_USEFUL_BUF_C);
+    return_value = t_cose_sign1_sign(&sign_ctx,
+                                     message,
+                                     signed_cose_buffer,
+                                     &signed_cose);
+    if(return_value) {
+        goto Done;
+    }
+
+    t_cose_sign1_verify_init(&verify_ctx, 0);
+    t_cose_sign1_set_verification_key(&verify_ctx, key_pair);
+    return_value = t_cose_sign1_verify(&verify_ctx, signed_cose, &payload, NULL);
+    if(return_value) {
+        goto Done;
+    }
+
+    if(q_useful_buf_compare(payload, message)) {
+        return_value = T_COSE_ERR_FAIL;
+    }
+
+Done:
+    free_ecdsa_key_pair(key_pair);
+    return return_value;
+}
+
+
+static const struct {
+    const char *name;
+    int32_t     cose_algorithm_id;
+} soak_algs[] = {
+    {"ES256", T_COSE_ALGORITHM_ES256},
+#ifndef T_COSE_DISABLE_ES384
+    {"ES384", T_COSE_ALGORITHM_ES384},
+#endif
+#ifndef T_COSE_DISABLE_ES512
+    {"ES512", T_COSE_ALGORITHM_ES512},
+#endif
+};
+
+#define SOAK_NUM_ALGS (sizeof(soak_algs) / sizeof(soak_algs[0]))
+
+
+static int parse_count(const char *arg, unsigned long *count)
+{
+    char          *end;
+    unsigned long  value;
+
+    if(arg == NULL) {
+        return -1;
+    }
+    value = strtoul(arg, &end, 10);
+    if(*end != '\0' || value < 1) {
+        return -1;
+    }
+    *count = value;
+    return 0;
+}
+
+
+int main(int argc, const char * argv[])
+{
+    int32_t           algs[SOAK_NUM_ALGS];
+    size_t            num_algs;
+    unsigned long     cycles;
+    unsigned long     sample_every;
+    unsigned long     limit_kb;
+    unsigned long     cycle;
+    enum t_cose_err_t return_value;
+    double            start;
+    long              rss;
+    long              base_rss;
+    int               keys;
+    int               base_keys;
+    int               i;
+    size_t            a;
+
+    cycles       = SOAK_DEFAULT_CYCLES;
+    sample_every = SOAK_DEFAULT_SAMPLE_EVERY;
+    limit_kb     = SOAK_DEFAULT_LIMIT_KB;
+    num_algs     = 0;
+
+    for(i = 1; i < argc; i++) {
+        if(!strcmp(argv[i], "-n")) {
+            if(parse_count(argv[++i], &cycles)) {
+                goto Usage;
+            }
+        } else if(!strcmp(argv[i], "-s")) {
+            if(parse_count(argv[++i], &sample_every)) {
+                goto Usage;
+            }
+        } else if(!strcmp(argv[i], "-l")) {
+            if(parse_count(argv[++i], &limit_kb)) {
+                goto Usage;
+            }
+        } else {
+            for(a = 0; a < SOAK_NUM_ALGS; a++) {
+                if(!strcmp(argv[i], soak_algs[a].name)) {
+                    break;
+                }
+            }
+            if(a == SOAK_NUM_ALGS || num_algs == SOAK_NUM_ALGS) {
+                goto Usage;
+            }
+            algs[num_algs++] = soak_algs[a].cose_algorithm_id;
+        }
+    }
+    if(num_algs == 0) {
+        for(a = 0; a < SOAK_NUM_ALGS; a++) {
+            algs[num_algs++] = soak_algs[a].cose_algorithm_id;
+        }
+    }
+
+    printf("Soak test, %s crypto, %lu key create / sign / verify / free cycles\n",
+           tdv_crypto_lib_name(), cycles);
+    printf("%12s %9s %10s %10s %6s\n", "cycles", "seconds", "RSS KB", "growth KB", "keys");
+    fflush(stdout);
+
+    base_rss  = 0;
+    base_keys = 0;
+    rss       = 0;
+    keys      = 0;
+    start     = now_sec();
+
+    for(cycle = 1; cycle <= cycles; cycle++) {
+        return_value = soak_cycle(algs[(cycle - 1) % num_algs]);
+        if(return_value) {
+            printf("cycle %lu failed: %d\n", cycle, return_value);
+            return 1;
+        }
+
+        if(cycle % sample_every && cycle != cycles) {
+            continue;
+        }
+
+        rss  = rss_kb();
+        keys = tdv_crypto_keys_in_use();
+        if(cycle == sample_every) {
+            base_rss  = rss;
+            base_keys = keys;
+        }
+        printf("%12lu %9.1f %10ld %10ld ", cycle, now_sec() - start, rss, rss - base_rss);
+        if(keys < 0) {
+            printf("%6s\n", "-");
+        } else {
+            printf("%6d\n", keys);
+        }
+        fflush(stdout);
+    }
+
+    if(cycles <= sample_every) {
+        printf("Too few cycles for a baseline sample; no verdict\n");
+        return 0;
+    }
+    if(rss < 0) {
+        printf("Can't get RSS on this platform; no verdict\n");
+        return 0;
+    }
+    if(rss - base_rss > (long)limit_kb) {
+        printf("FAIL: RSS grew %ld KB, limit %lu KB, about %.1f bytes per cycle\n",
+               rss - base_rss, limit_kb,
+               (double)(rss - base_rss) * 1024 / (double)(cycles - sample_every));
+        return 1;
+    }
+    if(keys > base_keys) {
+        printf("FAIL: %d keys are still held, %d at the baseline\n", keys, base_keys);
+        return 1;
+    }
+    printf("PASS: RSS grew %ld KB, limit %lu KB\n", rss - base_rss, limit_kb);
+    return 0;
+
+Usage:
+    fprintf(stderr,
+            "Usage: %s [-n cycles] [-s sample_every] [-l limit_kb] [alg ...]\n"
+            "  -n  Key create / sign / verify / free cycles, default %d\n"
+            "  -s  Print RSS and keys held every this many cycles, default %d\n"
+            "  -l  Most RSS growth in KB after the first sample, default %d\n"
+            "  alg ES256, ES384 or ES512, default all of them in turn\n",
+            argv[0],
+            SOAK_DEFAULT_CYCLES,
+            SOAK_DEFAULT_SAMPLE_EVERY,
+            SOAK_DEFAULT_LIMIT_KB);
+    return 2;
+}
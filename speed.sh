@@ -0,0 +1,134 @@
+#!/bin/bash
+
+#
+# Copyright (c) 2022, Laurence Lundblade. All rights reserved.
+#
+# SPDX-License-Identifier: BSD-3-Clause
+#
+# See BSD-3-Clause license in README.md
+#
+
+# Code size against speed for each build profile. Run from the t_cose
+# root like b.sh.
+#
+# For each crypto library libt_cose.a and bench_xxx are built with
+# each profile:
+#
+#   Os    the default, for size
+#   O2    for speed
+#   O3    -O3 -march=native; only for this kind of CPU
+#   PGO   -O2 with profile guided optimization trained by running
+#         the bench_xxx sign and verify modes
+#
+# and the code size of libt_cose.a and the ES256 sign and verify
+# ops/sec are printed with the change from Os. The size is of the
+# whole library, all the code that could be linked, not of one
+# program as in sizes.sh.
+#
+# PGO works with gcc and clang. With clang the raw profile is merged
+# with llvm-profdata, which has to be on the path or found with xcrun.
+#
+# Usage: tdv/speed.sh
+
+# Bench options for the comparison and for the PGO training run
+BENCH_OPTS="-r 5 -n 1000 -w 100"
+TRAIN_OPTS="-r 1 -n 2000 -w 0"
+
+PGO_DIR=/tmp/t_cose_pgo.$$
+
+
+# ----- Build and measure one profile --------------------------------
+
+# Prints "text sign/s verify/s" of the built library and bench
+function measure {
+    local crypto=$1
+    local text sign verify
+
+    text=`size libt_cose.a | awk 'NR > 1 {text += $1} END {print text}'`
+
+    ./bench_$crypto $BENCH_OPTS sign verify > /tmp/speed.$$
+    sign=`awk '$1 == "ES256" && $2 == "sign" {print $3; exit}' /tmp/speed.$$`
+    verify=`awk '$1 == "ES256" && $2 == "verify" {print $4; exit}' /tmp/speed.$$`
+
+    echo "${text:-0} ${sign:-0} ${verify:-0}"
+}
+
+
+# Build with a profile. Returns non-zero if it didn't build.
+function build {
+    local makefile=$1
+    local crypto=$2
+    shift 2
+
+    make -f $makefile clean > /dev/null
+    make -f $makefile libt_cose.a bench_$crypto "$@" 2>&1 >/dev/null | grep -v 'ar: creating'
+    [ -x ./bench_$crypto ]
+}
+
+
+# Merge clang's raw profiles so -fprofile-use finds default.profdata
+# in the directory. gcc's .gcda files are used as they are.
+function merge_profile {
+    local profdata
+
+    if ! ls $PGO_DIR/*.profraw > /dev/null 2>&1; then
+        return
+    fi
+    if command -v llvm-profdata > /dev/null; then
+        profdata=llvm-profdata
+    else
+        profdata="xcrun llvm-profdata"
+    fi
+    $profdata merge -o $PGO_DIR/default.profdata $PGO_DIR/*.profraw
+}
+
+
+function speed_report {
+    local makefile=$1
+    local crypto=$2
+    local profile base_text base_sign base_verify result
+
+    echo "=== $crypto ==="
+    printf "%-6s %10s %7s %10s %7s %10s %7s\n" \
+           "" "text" "" "sign/s" "" "verify/s" ""
+
+    for profile in Os O2 O3 PGO; do
+        case $profile in
+        Os)  build $makefile $crypto ;;
+        O2)  build $makefile $crypto OPT=O2 ;;
+        O3)  build $makefile $crypto OPT=O3 ;;
+        PGO) rm -rf $PGO_DIR
+             build $makefile $crypto OPT=O2 PGO=gen PGO_DIR=$PGO_DIR &&
+             ./bench_$crypto $TRAIN_OPTS sign verify > /dev/null &&
+             merge_profile &&
+             build $makefile $crypto OPT=O2 PGO=use PGO_DIR=$PGO_DIR ;;
+        esac
+        if [ $? -ne 0 ]; then
+            echo "$profile build failed"
+            continue
+        fi
+
+        result=(`measure $crypto`)
+        if [ $profile = Os ]; then
+            base_text=${result[0]}
+            base_sign=${result[1]}
+            base_verify=${result[2]}
+        fi
+        echo "$profile ${result[*]} $base_text $base_sign $base_verify" |\
+        awk '{printf "%-6s %10d %+6.0f%% %10.1f %+6.1f%% %10.1f %+6.1f%%\n",
+                     $1,
+                     $2, ($5 > 0 ? 100 * ($2 - $5) / $5 : 0),
+                     $3, ($6 > 0 ? 100 * ($3 - $6) / $6 : 0),
+                     $4, ($7 > 0 ? 100 * ($4 - $7) / $7 : 0)}'
+    done
+    echo
+}
+
+
+speed_report tdv/Makefile.min psa
+speed_report tdv/Makefile.max ossl
+
+# Leave no PGO or -march=native objects behind
+make -f tdv/Makefile.max clean > /dev/null
+
+rm -rf /tmp/speed.$$ $PGO_DIR
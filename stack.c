@@ -0,0 +1,512 @@
+/*
+ * stack.c, derived from encode_only_ossl.c and decode_only_ossl.c
+ *
+ * Copyright 2019-2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+
+/**
+ * \file stack.c
+ *
+ * \brief Measure peak run-time stack use of t_cose.
+ *
+ * This runs the flows in encode_only_xxx.c and decode_only_xxx.c and
+ * reports the peak stack used by each t_cose call and by each flow as
+ * a whole. It is linked with tdv_keys_ossl.c to make stack_ossl and
+ * with tdv_keys_psa.c to make stack_psa.
+ *
+ * Each measured call is run on a thread whose stack is allocated here.
+ * The thread first signs and verifies once to get the crypto
+ * library's per-thread set up out of the way, then paints the unused
+ * part of its stack with a known byte value and makes the call. When
+ * the call returns the stack is scanned from the far end for the
+ * first byte that is no longer the paint value. This gives the
+ * deepest point the stack reached, including everything the call did
+ * in QCBOR and the crypto library. The stack used by an empty call is
+ * measured the same way for each algorithm and subtracted so the
+ * thread start up and this file's own frames don't count.
+ *
+ * For the individual calls, the contexts and output buffer are not on
+ * the measured stack so the number is the cost of the call
+ * alone. For the whole flows they are locals just as in
+ * two_step_sign_example(), so the number is what a device has to
+ * budget.
+ *
+ * This complements the static per-function numbers from
+ * -fstack-usage that stack.sh and stack_chain.sh report.
+ */
+
+#include "t_cose/t_cose_common.h"
+#include "t_cose/t_cose_sign1_sign.h"
+#include "t_cose/t_cose_sign1_verify.h"
+#include "t_cose/q_useful_buf.h"
+
+#include "bench_corpus.h"
+#include "tdv_keys.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+
+/* Big enough for any of the crypto libraries. This is a maximum, not
+ * what is reported. */
+#define STACK_SIZE   (256 * 1024)
+
+#define STACK_PAINT  0xa5
+
+
+struct stack_call {
+    void     (*warm)(void *arg);
+    void      *warm_arg;
+    void     (*fn)(void *arg);
+    void      *arg;
+    uint8_t   *stack;
+    size_t     untouched;
+};
+
+
+/*
+ * Paint the unused part of the stack below the caller. A margin is
+ * left below this function's frame so it doesn't paint over
+ * itself. This doesn't call anything so there are no frames below
+ * it while it runs.
+ */
+#if defined(__GNUC__)
+__attribute__((noinline))
+#endif
+static void paint_below_here(uint8_t *stack_low)
+{
+    volatile uint8_t  here;
+    volatile uint8_t *p;
+    uint8_t          *limit;
+
+    limit = (uint8_t *)(uintptr_t)&here - 256;
+    for(p = stack_low; p < limit; p++) {
+        *p = STACK_PAINT;
+    }
+}
+
+
+static void *stack_trampoline(void *call_ptr)
+{
+    struct stack_call *call = (struct stack_call *)call_ptr;
+
+    /* The first use of the crypto library on a thread sets up thread
+     * local state like the DRBG in OpenSSL and uses a lot of
+     * stack. That happens once per thread, not per call, so it is
+     * done here before painting. */
+    if(call->warm != NULL) {
+        call->warm(call->warm_arg);
+    }
+
+    paint_below_here(call->stack);
+
+    call->fn(call->arg);
+
+    /* The stack is scanned here rather than after the thread exits
+     * because thread-local destructors in the crypto library run on
+     * this stack at exit. The stack grows down on all supported
+     * platforms so the untouched paint is at the low addresses. */
+    for(call->untouched = 0;
+        call->untouched < STACK_SIZE && call->stack[call->untouched] == STACK_PAINT;
+        call->untouched++);
+
+    return NULL;
+}
+
+
+/**
+ * \brief Run a function on a painted stack and measure the stack used.
+ *
+ * \param[in] warm      Function run before painting or NULL.
+ * \param[in] warm_arg  Argument passed to \c warm.
+ * \param[in] fn        The function to measure.
+ * \param[in] arg       Argument passed to \c fn.
+ * \param[out] used     Bytes of stack used, including thread overhead.
+ *
+ * \return 0 on success, non-zero if the thread couldn't be run.
+ */
+static int run_on_painted_stack(void  (*warm)(void *),
+                                void   *warm_arg,
+                                void  (*fn)(void *),
+                                void   *arg,
+                                size_t *used)
+{
+    void              *stack;
+    pthread_attr_t     attr;
+    pthread_t          thread;
+    struct stack_call  call;
+    int                result;
+
+    /* Page alignment is required by some pthread implementations */
+    if(posix_memalign(&stack, 4096, STACK_SIZE)) {
+        return -1;
+    }
+    memset(stack, STACK_PAINT, STACK_SIZE);
+
+    call.warm     = warm;
+    call.warm_arg = warm_arg;
+    call.fn       = fn;
+    call.arg      = arg;
+    call.stack    = (uint8_t *)stack;
+
+    result = -1;
+    if(pthread_attr_init(&attr)) {
+        goto Done;
+    }
+    if(pthread_attr_setstack(&attr, stack, STACK_SIZE) == 0 &&
+       pthread_create(&thread, &attr, stack_trampoline, &call) == 0) {
+        pthread_join(thread, NULL);
+        result = 0;
+    }
+    pthread_attr_destroy(&attr);
+    if(result) {
+        goto Done;
+    }
+
+    *used = STACK_SIZE - call.untouched;
+
+Done:
+    free(stack);
+    return result;
+}
+
+
+static void nothing(void *arg)
+{
+    (void)arg;
+}
+
+
+static size_t baseline;
+
+static void (*warm_fn)(void *);
+static void  *warm_fn_arg;
+
+
+/* Measure and print one line. Returns 1 on error so it can be summed. */
+static int measure(const char *label, void (*fn)(void *), void *arg, const enum t_cose_err_t *return_value)
+{
+    size_t used;
+
+    if(run_on_painted_stack(warm_fn, warm_fn_arg, fn, arg, &used)) {
+        printf("  %-40s couldn't run thread\n", label);
+        return 1;
+    }
+    if(return_value != NULL && *return_value != T_COSE_SUCCESS) {
+        printf("  %-40s failed: %d\n", label, *return_value);
+        return 1;
+    }
+
+    printf("  %-40s %6zu\n", label, used > baseline ? used - baseline : 0);
+    fflush(stdout);
+    return 0;
+}
+
+
+
+
+/* ------   Individual calls   ------ */
+
+/* State carried from one call to the next. This is not on the
+ * measured stacks. */
+struct encode_state {
+    int32_t                      cose_algorithm_id;
+    struct t_cose_key            key_pair;
+    struct t_cose_sign1_sign_ctx sign_ctx;
+    QCBOREncodeContext           cbor_encode;
+    uint8_t                      signed_cose_buffer[300];
+    struct q_useful_buf_c        signed_cose;
+    enum t_cose_err_t            return_value;
+};
+
+
+static void call_make_key(void *arg)
+{
+    struct encode_state *s = (struct encode_state *)arg;
+
+    s->return_value = make_ecdsa_key_pair(s->cose_algorithm_id, &s->key_pair);
+}
+
+
+static void call_sign_init(void *arg)
+{
+    struct encode_state *s = (struct encode_state *)arg;
+    struct q_useful_buf  out_buf;
+
+    out_buf.ptr = s->signed_cose_buffer;
+    out_buf.len = sizeof(s->signed_cose_buffer);
+    QCBOREncode_Init(&s->cbor_encode, out_buf);
+    t_cose_sign1_sign_init(&s->sign_ctx, 0, s->cose_algorithm_id);
+    t_cose_sign1_set_signing_key(&s->sign_ctx, s->key_pair, NULL_Q_USEFUL_BUF_C);
+    s->return_value = T_COSE_SUCCESS;
+}
+
+
+static void call_encode_parameters(void *arg)
+{
+    struct encode_state *s = (struct encode_state *)arg;
+
+    s->return_value = t_cose_sign1_encode_parameters(&s->sign_ctx, &s->cbor_encode);
+}
+
+
+static void add_payload(QCBOREncodeContext *cbor_encode)
+{
+    QCBOREncode_OpenMap(cbor_encode);
+    QCBOREncode_AddSZStringToMap(cbor_encode, "BeingType", "Humanoid");
+    QCBOREncode_AddSZStringToMap(cbor_encode, "Greeting", "We come in peace");
+    QCBOREncode_AddInt64ToMap(cbor_encode, "ArmCount", 2);
+    QCBOREncode_AddInt64ToMap(cbor_encode, "HeadCount", 1);
+    QCBOREncode_AddSZStringToMap(cbor_encode, "BrainSize", "medium");
+    QCBOREncode_AddBoolToMap(cbor_encode, "DrinksWater", true);
+    QCBOREncode_CloseMap(cbor_encode);
+}
+
+
+static void call_payload(void *arg)
+{
+    struct encode_state *s = (struct encode_state *)arg;
+
+    add_payload(&s->cbor_encode);
+    s->return_value = T_COSE_SUCCESS;
+}
+
+
+static void call_encode_signature(void *arg)
+{
+    struct encode_state *s = (struct encode_state *)arg;
+
+    s->return_value = t_cose_sign1_encode_signature(&s->sign_ctx, &s->cbor_encode);
+}
+
+
+static void call_finish(void *arg)
+{
+    struct encode_state *s = (struct encode_state *)arg;
+
+    if(QCBOREncode_Finish(&s->cbor_encode, &s->signed_cose)) {
+        s->return_value = T_COSE_ERR_CBOR_FORMATTING;
+    } else {
+        s->return_value = T_COSE_SUCCESS;
+    }
+}
+
+
+struct verify_state {
+    struct t_cose_key     key_pair;
+    struct q_useful_buf_c cose_sign1;
+    struct q_useful_buf_c payload;
+    enum t_cose_err_t     return_value;
+};
+
+
+static void call_verify(void *arg)
+{
+    struct verify_state           *s = (struct verify_state *)arg;
+    struct t_cose_sign1_verify_ctx verify_ctx;
+
+    /* The verify context is small and must be live only for the
+     * call so it is on the measured stack here. It is counted in the
+     * result. */
+    t_cose_sign1_verify_init(&verify_ctx, 0);
+    t_cose_sign1_set_verification_key(&verify_ctx, s->key_pair);
+    s->return_value = t_cose_sign1_verify(&verify_ctx, s->cose_sign1, &s->payload, NULL);
+}
+
+
+
+
+/* ------   Whole flows   ------ */
+
+struct flow_state {
+    struct t_cose_key     key_pair;
+    int32_t               cose_algorithm_id;
+    struct q_useful_buf_c cose_sign1;
+    enum t_cose_err_t     return_value;
+};
+
+
+/*
+ * Everything in two_step_sign_example() except key making and
+ * printing, with the same locals.
+ */
+static void flow_encode(void *arg)
+{
+    struct flow_state             *f = (struct flow_state *)arg;
+    struct t_cose_sign1_sign_ctx   sign_ctx;
+    Q_USEFUL_BUF_MAKE_STACK_UB(    signed_cose_buffer, 300);
+    struct q_useful_buf_c          signed_cose;
+    QCBOREncodeContext             cbor_encode;
+
+    QCBOREncode_Init(&cbor_encode, signed_cose_buffer);
+    t_cose_sign1_sign_init(&sign_ctx, 0, f->cose_algorithm_id);
+    t_cose_sign1_set_signing_key(&sign_ctx, f->key_pair, NULL_Q_USEFUL_BUF_C);
+
+    f->return_value = t_cose_sign1_encode_parameters(&sign_ctx, &cbor_encode);
+    if(f->return_value) {
+        return;
+    }
+    add_payload(&cbor_encode);
+    f->return_value = t_cose_sign1_encode_signature(&sign_ctx, &cbor_encode);
+    if(f->return_value) {
+        return;
+    }
+    if(QCBOREncode_Finish(&cbor_encode, &signed_cose)) {
+        f->return_value = T_COSE_ERR_CBOR_FORMATTING;
+    }
+}
+
+
+/*
+ * Everything in the decode_only_xxx.c two_step_sign_example() except
+ * key making and printing, with the same locals.
+ */
+static void flow_decode(void *arg)
+{
+    struct flow_state             *f = (struct flow_state *)arg;
+    struct q_useful_buf_c          payload;
+    struct t_cose_sign1_verify_ctx verify_ctx;
+
+    t_cose_sign1_verify_init(&verify_ctx, 0);
+    t_cose_sign1_set_verification_key(&verify_ctx, f->key_pair);
+    f->return_value = t_cose_sign1_verify(&verify_ctx, f->cose_sign1, &payload, NULL);
+}
+
+
+
+
+/*
+ * Sign and verify once so the per-thread set up in the crypto library
+ * is done before measuring.
+ */
+static void warm_up(void *arg)
+{
+    struct flow_state f = *(struct flow_state *)arg;
+
+    flow_encode(&f);
+    flow_decode(&f);
+}
+
+
+
+
+static const int32_t stack_algs[] = {
+    T_COSE_ALGORITHM_ES256,
+#ifndef T_COSE_DISABLE_ES384
+    T_COSE_ALGORITHM_ES384,
+#endif
+#ifndef T_COSE_DISABLE_ES512
+    T_COSE_ALGORITHM_ES512,
+#endif
+};
+
+
+static const char *alg_name(int32_t cose_algorithm_id)
+{
+    switch(cose_algorithm_id) {
+    case T_COSE_ALGORITHM_ES256: return "ES256";
+    case T_COSE_ALGORITHM_ES384: return "ES384";
+    case T_COSE_ALGORITHM_ES512: return "ES512";
+    default:                     return "unknown";
+    }
+}
+
+
+static int stack_for_alg(int32_t cose_algorithm_id)
+{
+    struct encode_state *e;
+    struct verify_state  v;
+    struct flow_state    f;
+    struct flow_state    warm;
+    size_t               j;
+    int                  errors;
+
+    /* Big, so not on the stack of main() */
+    e = calloc(1, sizeof(struct encode_state));
+    if(e == NULL) {
+        return 1;
+    }
+
+    printf("%s\n", alg_name(cose_algorithm_id));
+
+    /* A separate key for warming up each measuring thread */
+    warm.cose_algorithm_id = cose_algorithm_id;
+    warm.cose_sign1        = NULL_Q_USEFUL_BUF_C;
+    for(j = 0; j < bench_corpus_count; j++) {
+        if(bench_corpus[j].cose_algorithm_id == cose_algorithm_id) {
+            warm.cose_sign1 = bench_corpus[j].cose_sign1;
+            break;
+        }
+    }
+    if(make_ecdsa_key_pair(cose_algorithm_id, &warm.key_pair)) {
+        printf("  make key failed\n");
+        free(e);
+        return 1;
+    }
+    warm_fn     = warm_up;
+    warm_fn_arg = &warm;
+
+    /* The baseline is measured with the same warm up because the warm
+     * up leaves the area just below the painting frame dirty */
+    if(run_on_painted_stack(warm_fn, warm_fn_arg, nothing, NULL, &baseline)) {
+        printf("  couldn't run thread\n");
+        free_ecdsa_key_pair(warm.key_pair);
+        free(e);
+        return 1;
+    }
+
+    errors = 0;
+    e->cose_algorithm_id = cose_algorithm_id;
+    errors += measure("make_ecdsa_key_pair()", call_make_key, e, &e->return_value);
+    if(errors) {
+        goto Done;
+    }
+    errors += measure("init and set signing key", call_sign_init, e, &e->return_value);
+    errors += measure("t_cose_sign1_encode_parameters()", call_encode_parameters, e, &e->return_value);
+    errors += measure("payload QCBOREncode_xxx()", call_payload, e, &e->return_value);
+    errors += measure("t_cose_sign1_encode_signature()", call_encode_signature, e, &e->return_value);
+    errors += measure("QCBOREncode_Finish()", call_finish, e, &e->return_value);
+
+    v.key_pair   = e->key_pair;
+    v.cose_sign1 = warm.cose_sign1;
+    errors += measure("t_cose_sign1_verify() with context", call_verify, &v, &v.return_value);
+
+    f.key_pair          = e->key_pair;
+    f.cose_algorithm_id = cose_algorithm_id;
+    f.cose_sign1        = v.cose_sign1;
+    errors += measure("encode_only flow total", flow_encode, &f, &f.return_value);
+    errors += measure("decode_only flow total", flow_decode, &f, &f.return_value);
+
+    free_ecdsa_key_pair(e->key_pair);
+
+Done:
+    free_ecdsa_key_pair(warm.key_pair);
+    free(e);
+    return errors;
+}
+
+
+int main(int argc, const char * argv[])
+{
+    size_t i;
+    int    errors;
+
+    (void)argc; /* Avoid unused parameter error */
+    (void)argv;
+
+    printf("Peak stack bytes, %s crypto\n", tdv_crypto_lib_name());
+
+    errors = 0;
+    for(i = 0; i < sizeof(stack_algs) / sizeof(stack_algs[0]); i++) {
+        errors += stack_for_alg(stack_algs[i]);
+    }
+
+    return errors ? 1 : 0;
+}
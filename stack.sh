@@ -0,0 +1,131 @@
+#!/bin/bash
+
+#
+# Copyright (c) 2022, Laurence Lundblade. All rights reserved.
+#
+# SPDX-License-Identifier: BSD-3-Clause
+#
+# See BSD-3-Clause license in README.md
+#
+
+# Stack use report. Run from the t_cose root like b.sh.
+#
+# For each #define permutation and each crypto library this builds
+# with -fstack-usage, runs stack_ossl or stack_psa for the measured
+# peak stack of each t_cose call and flow, then prints the static
+# worst-case call chain of each public t_cose function from the
+# compiler's stack usage data.
+#
+# The static numbers come from -fcallgraph-info which needs GCC 10 or
+# later. With other compilers only the per-function frame sizes from
+# the .su files are printed. Neither QCBOR nor the crypto libraries
+# are built here so calls into them are flagged U in the chain report
+# and the run-time numbers from stack_xxx are the ones to budget with.
+#
+# Usage: tdv/stack.sh [all]
+#
+# Without "all" only the default build of each Makefile is done.
+
+
+# ----- Function for all #define permutations ------------------------
+
+# Same as in b.sh
+function stringpermutations {
+    local prefix=$1 # the prefix is the first argument
+    local theset=$2 # the set left to process is the second argument
+
+    # Output the new prefix
+    echo "$prefix"
+
+    # Loop over each item in the set adding it to the prefix
+    for i in $theset; do
+
+        # Make a new prefix by appending the item from the set to it
+        local newprefix="$prefix ${i}"
+
+        # Update the set by removing one more item from it
+        if [[ ! $theset = *[\ ]* ]]; then
+            theset=""
+        else
+            theset=${theset#* }
+        fi
+
+        if [[ ! -z "$theset" ]]; then
+           # The set is not empty, recurse to process it
+           stringpermutations "$newprefix" "$theset"
+        else
+           # The set is empty, just output the new prefix
+           echo "$newprefix"
+        fi
+    done
+}
+
+
+# ----- Which compiler features are available ------------------------
+
+# Regex of the t_cose functions to report chains for; same idea as the
+# nm filter in sizes.sh
+public_fun="^(t_cose_sign1_|t_cose_crypto_)"
+
+echo "int f(void) { return 0; }" > /tmp/stack_ci.$$.c
+if cc -fcallgraph-info=su -c -o /tmp/stack_ci.$$.o /tmp/stack_ci.$$.c 2>/dev/null; then
+    stack_flags="-fstack-usage -fcallgraph-info=su"
+    have_ci=1
+else
+    stack_flags="-fstack-usage"
+    have_ci=0
+fi
+rm -f /tmp/stack_ci.$$.*
+
+
+# ----- Build, run and report for one configuration ------------------
+
+function stack_report {
+    local makefile=$1
+    local target=$2
+    local options=$3
+
+    echo "=== $makefile $options ==="
+    make -f $makefile clean > /dev/null
+    make -f $makefile $target "CMD_LINE=$options $stack_flags" 2>&1 >/dev/null | grep -v 'ar: creating'
+    if [ ! -x ./$target ]; then
+        echo "build failed"
+        return
+    fi
+
+    ./$target
+
+    echo "Static worst case, bytes (R recursion, D dynamic, U unknown callee)"
+    if [ $have_ci -eq 1 ]; then
+        tdv/stack_chain.sh -f "$public_fun" src/*.ci crypto_adapters/*.ci
+    else
+        cat src/*.su crypto_adapters/*.su |\
+        awk -F'\t' -v filter="$public_fun" '
+            {n = $1; sub(/.*:/, "", n)}
+            n ~ filter {printf "%8d %-3s %s (frame only)\n", $2, ($3 ~ /dynamic/) ? "D" : "", n}' |\
+        sort -r -n -k 1
+    fi
+    echo
+}
+
+
+# ----- All the configurations ---------------------------------------
+
+# Only the defines that change the signing and verification paths
+set="-DT_COSE_DISABLE_SHORT_CIRCUIT_SIGN"
+set+=" -DT_COSE_DISABLE_CONTENT_TYPE"
+set+=" -DT_COSE_DISABLE_ES512"
+set+=" -DT_COSE_DISABLE_ES384"
+
+if [ "$1" = "all" ]; then
+    stringpermutations "" "$set" > /tmp/stack.$$
+else
+    echo "" > /tmp/stack.$$
+fi
+
+while read compile_options; do
+   stack_report tdv/Makefile.min stack_psa "$compile_options"
+   stack_report tdv/Makefile.max stack_ossl "$compile_options"
+done < /tmp/stack.$$
+
+rm -f /tmp/stack.$$
@@ -0,0 +1,143 @@
+#!/bin/sh
+
+# Worst-case stack depth for each function from the call graphs that
+# gcc writes with -fstack-usage -fcallgraph-info=su (GCC 10 or later).
+#
+# Usage: tdv/stack_chain.sh [-f regex] file.ci ...
+#
+# Each .ci file has a node for each function with its own frame size
+# and an edge for each call it makes. The graphs of all the files are
+# joined by function name so calls from tdv into t_cose, from t_cose
+# into QCBOR and into the crypto adapter are followed. The depth of a
+# function is its own frame plus the deepest of its callees.
+#
+# The output is one line per function, deepest first, with the bytes,
+# flags and the chain of calls that gives the worst case. The flags
+# mean the number is a lower bound:
+#
+#   R  recursion, the cycle was counted once
+#   D  a frame in the chain is dynamically sized (alloca or VLA)
+#   U  a callee has no stack information, usually because it is in a
+#      library that wasn't compiled with -fstack-usage, or the call is
+#      through a function pointer
+#
+# With -f only functions whose name matches the regex are printed.
+# This can be the same regex sizes.sh uses, for example the t_cose
+# public functions.
+
+filter="."
+if [ "$1" = "-f" ]; then
+    filter="$2"
+    shift 2
+fi
+
+if [ $# -eq 0 ]; then
+    echo "Usage: $0 [-f regex] file.ci ..." >&2
+    exit 2
+fi
+
+cat "$@" |\
+awk -v filter="$filter" '
+# Get a quoted field like title: "xxx" out of a node or edge line
+function field(line, name,    s) {
+    s = substr(line, index(line, name ": \"") + length(name) + 3)
+    return substr(s, 1, index(s, "\"") - 1)
+}
+
+# Short name of a node title, which is "file:function" for functions
+# that are defined and just "function" for ones that are not
+function short(title) {
+    sub(/.*:/, "", title)
+    return title
+}
+
+# Resolve a call target to the node that defines it, if any
+function resolve(title) {
+    if(title in size) {
+        return title
+    }
+    if(short(title) in defined_as) {
+        return defined_as[short(title)]
+    }
+    return title
+}
+
+# Depth-first search memoized in depth[], chain[] and flags[]
+function walk(n,    i, c, best, best_chain, f) {
+    if(state[n] == 2) {
+        return depth[n]
+    }
+    state[n] = 1
+
+    f = ""
+    if(!(n in size)) {
+        f = "U"
+    } else if(dynamic[n]) {
+        f = "D"
+    }
+
+    best = 0
+    best_chain = ""
+    for(i = 1; i <= num_callees[n]; i++) {
+        c = resolve(callee[n, i])
+        if(state[c] == 1) {
+            # Back in a function already on the path
+            f = f "R"
+            continue
+        }
+        walk(c)
+        f = f flags[c]
+        if(state[c] == 2 && depth[c] > best) {
+            best = depth[c]
+            best_chain = " > " chain[c]
+        }
+    }
+
+    depth[n] = size[n] + best
+    chain[n] = short(n) best_chain
+    flags[n] = f
+    state[n] = 2
+    return depth[n]
+}
+
+# Remove duplicate flag letters
+function uniq_flags(f,    out) {
+    out = ""
+    if(f ~ /R/) out = out "R"
+    if(f ~ /D/) out = out "D"
+    if(f ~ /U/) out = out "U"
+    return out
+}
+
+/^node:/ {
+    t = field($0, "title")
+    l = field($0, "label")
+    if(l ~ /bytes \(/) {
+        b = l
+        sub(/ bytes \(.*/, "", b)
+        sub(/.*\\n/, "", b)
+        size[t] = b + 0
+        dynamic[t] = (l ~ /dynamic/)
+        defined_as[short(t)] = t
+    }
+    next
+}
+
+/^edge:/ {
+    s = field($0, "sourcename")
+    num_callees[s]++
+    callee[s, num_callees[s]] = field($0, "targetname")
+    next
+}
+
+END {
+    for(n in size) {
+        walk(n)
+    }
+    for(n in size) {
+        if(short(n) ~ filter) {
+            printf "%8d %-3s %s\n", depth[n], uniq_flags(flags[n]), chain[n]
+        }
+    }
+}' |\
+sort -r -n -k 1
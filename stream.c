@@ -0,0 +1,387 @@
+/*
+ * stream.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+
+/**
+ * \file stream.c
+ *
+ * \brief Sign and verify a large file as a detached payload.
+ *
+ * The file is the payload. It is signed with tdv_stream_sign_fd() and
+ * the COSE_Sign1 is verified with tdv_stream_verify_fd(), then
+ * verified again with the signature changed to check that fails. The
+ * time, the MB/s and the RSS of the process are printed for each.
+ *
+ * Memory use should not depend on the size of the file. The baseline
+ * RSS is taken after the key is made, the chunk buffer is allocated
+ * and touched and an empty payload is signed and verified so the
+ * lazy set up in the crypto library is done. The run fails if the
+ * peak RSS grew by more than the chunk size plus a little over the
+ * baseline, which would mean the payload is being held in memory.
+ *
+ * It is linked with tdv_keys_ossl.c to make stream_ossl and with
+ * tdv_keys_psa.c to make stream_psa.
+ *
+ * Usage:
+ *
+ *     stream_ossl [-m] [-c chunk_kb] [-a alg] [-o out.cose] file
+ *
+ * -m maps the file a window of chunk_kb at a time rather than reading
+ * it. The algorithm is ES256, ES384 or ES512, default ES256.
+ *
+ * A multi-GB test file can be made quickly with
+ * "truncate -s 4G big.bin", though reading a sparse file doesn't
+ * touch the disk. "dd if=/dev/urandom of=big.bin bs=1M count=4096"
+ * makes a real one.
+ */
+
+/* For clock_gettime() */
+#define _POSIX_C_SOURCE 200809L
+/* For files over 2GB on 32-bit Linux */
+#define _FILE_OFFSET_BITS 64
+
+#include "t_cose/t_cose_common.h"
+#include "t_cose/q_useful_buf.h"
+
+#include "tdv_keys.h"
+#include "tdv_stream.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+
+#define STREAM_DEFAULT_CHUNK_KB 1024
+
+/* Allowed growth of the peak RSS beyond the chunk size */
+#define STREAM_SLACK_KB         1024
+
+
+/*
+ * Current resident set size in KB or -1 if it can't be had. Only on
+ * Linux.
+ */
+static long rss_kb(void)
+{
+    FILE *statm;
+    long  pages;
+    int   got;
+
+    statm = fopen("/proc/self/statm", "r");
+    if(statm == NULL) {
+        return -1;
+    }
+    /* The second field is the resident pages */
+    got = fscanf(statm, "%*s %ld", &pages);
+    fclose(statm);
+    if(got != 1) {
+        return -1;
+    }
+    return pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+
+/*
+ * Peak resident set size in KB or -1 if it can't be had.
+ */
+static long peak_rss_kb(void)
+{
+    struct rusage usage;
+
+    if(getrusage(RUSAGE_SELF, &usage)) {
+        return -1;
+    }
+#ifdef __APPLE__
+    /* In bytes on macOS, KB on Linux */
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+
+static double now_sec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+
+/*
+ * Sign and verify an empty payload so the crypto library does its
+ * lazy set up before the baseline.
+ */
+static enum t_cose_err_t warm_up(int32_t cose_algorithm_id, struct t_cose_key key_pair)
+{
+    struct tdv_stream      stream;
+    enum t_cose_err_t      return_value;
+    struct q_useful_buf_c  cose_sign1;
+    Q_USEFUL_BUF_MAKE_STACK_UB(cose_buffer, 300);
+
+    return_value = tdv_stream_sign_start(&stream, cose_algorithm_id, NULL_Q_USEFUL_BUF_C, 0);
+    if(return_value) {
+        return return_value;
+    }
+    return_value = tdv_stream_sign_finish(&stream,
+                                          0,
+                                          key_pair,
+                                          NULL_Q_USEFUL_BUF_C,
+                                          cose_buffer,
+                                          &cose_sign1);
+    if(return_value) {
+        return return_value;
+    }
+
+    return_value = tdv_stream_verify_start(&stream, cose_sign1, NULL_Q_USEFUL_BUF_C, 0);
+    if(return_value) {
+        return return_value;
+    }
+    return tdv_stream_verify_finish(&stream, key_pair);
+}
+
+
+static void print_phase(const char *name, double seconds, uint64_t size)
+{
+    printf("%-10s %8.3f sec %9.1f MB/s   RSS %7ld KB   peak %7ld KB\n",
+           name,
+           seconds,
+           seconds > 0 ? (double)size / 1e6 / seconds : 0,
+           rss_kb(),
+           peak_rss_kb());
+    fflush(stdout);
+}
+
+
+static int parse_alg(const char *name, int32_t *cose_algorithm_id)
+{
+    if(name == NULL) {
+        return -1;
+    } else if(!strcmp(name, "ES256")) {
+        *cose_algorithm_id = T_COSE_ALGORITHM_ES256;
+    } else if(!strcmp(name, "ES384")) {
+        *cose_algorithm_id = T_COSE_ALGORITHM_ES384;
+    } else if(!strcmp(name, "ES512")) {
+        *cose_algorithm_id = T_COSE_ALGORITHM_ES512;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+
+static int parse_count(const char *arg, unsigned *count)
+{
+    char          *end;
+    unsigned long  value;
+
+    if(arg == NULL) {
+        return -1;
+    }
+    value = strtoul(arg, &end, 10);
+    if(*end != '\0' || value < 1 || value > 10000000) {
+        return -1;
+    }
+    *count = (unsigned)value;
+    return 0;
+}
+
+
+static int write_file(const char *file_name, struct q_useful_buf_c data)
+{
+    FILE *f;
+    int   ok;
+
+    f = fopen(file_name, "wb");
+    if(f == NULL) {
+        return -1;
+    }
+    ok = fwrite(data.ptr, 1, data.len, f) == data.len;
+    ok = fclose(f) == 0 && ok;
+    return ok ? 0 : -1;
+}
+
+
+int main(int argc, const char * argv[])
+{
+    struct t_cose_key      key_pair;
+    enum t_cose_err_t      return_value;
+    struct q_useful_buf    chunk_buffer;
+    struct q_useful_buf_c  cose_sign1;
+    struct stat            st;
+    int32_t                cose_algorithm_id;
+    uint32_t               stream_options;
+    unsigned               chunk_kb;
+    const char            *payload_file;
+    const char            *out_file;
+    uint64_t               size;
+    double                 start;
+    long                   baseline_kb;
+    long                   growth_kb;
+    int                    fd;
+    int                    errors;
+    int                    i;
+    Q_USEFUL_BUF_MAKE_STACK_UB(cose_buffer, 300);
+    Q_USEFUL_BUF_MAKE_STACK_UB(tampered_buffer, 300);
+
+    cose_algorithm_id = T_COSE_ALGORITHM_ES256;
+    stream_options    = 0;
+    chunk_kb          = STREAM_DEFAULT_CHUNK_KB;
+    payload_file      = NULL;
+    out_file          = NULL;
+
+    for(i = 1; i < argc; i++) {
+        if(!strcmp(argv[i], "-m")) {
+            stream_options |= TDV_STREAM_MMAP;
+        } else if(!strcmp(argv[i], "-c")) {
+            if(parse_count(argv[++i], &chunk_kb)) {
+                goto Usage;
+            }
+        } else if(!strcmp(argv[i], "-a")) {
+            if(parse_alg(argv[++i], &cose_algorithm_id)) {
+                goto Usage;
+            }
+        } else if(!strcmp(argv[i], "-o")) {
+            out_file = argv[++i];
+            if(out_file == NULL) {
+                goto Usage;
+            }
+        } else if(argv[i][0] != '-' && payload_file == NULL) {
+            payload_file = argv[i];
+        } else {
+            goto Usage;
+        }
+    }
+    if(payload_file == NULL) {
+        goto Usage;
+    }
+
+    fd = open(payload_file, O_RDONLY);
+    if(fd < 0 || fstat(fd, &st)) {
+        perror(payload_file);
+        return 1;
+    }
+    size = (uint64_t)st.st_size;
+
+    return_value = make_ecdsa_key_pair(cose_algorithm_id, &key_pair);
+    if(return_value) {
+        fprintf(stderr, "can't make key: %d\n", return_value);
+        close(fd);
+        return 1;
+    }
+
+    /* With -m only the length is used, as the window size */
+    chunk_buffer.len = (size_t)chunk_kb * 1024;
+    chunk_buffer.ptr = NULL;
+    if(!(stream_options & TDV_STREAM_MMAP)) {
+        chunk_buffer.ptr = malloc(chunk_buffer.len);
+        if(chunk_buffer.ptr == NULL) {
+            fprintf(stderr, "out of memory\n");
+            errors = 1;
+            goto Done;
+        }
+        /* Touch it so it is in the baseline */
+        memset(chunk_buffer.ptr, 0, chunk_buffer.len);
+    }
+
+    printf("Streaming detached payload, %s crypto, %s, %.1f MB, %s %u KB\n",
+           tdv_crypto_lib_name(),
+           cose_algorithm_id == T_COSE_ALGORITHM_ES256 ? "ES256" :
+           cose_algorithm_id == T_COSE_ALGORITHM_ES384 ? "ES384" : "ES512",
+           (double)size / 1e6,
+           stream_options & TDV_STREAM_MMAP ? "mmap window" : "read chunk",
+           chunk_kb);
+
+    return_value = warm_up(cose_algorithm_id, key_pair);
+    if(return_value) {
+        fprintf(stderr, "warm up failed: %d\n", return_value);
+        errors = 1;
+        goto Done;
+    }
+
+    errors      = 0;
+    baseline_kb = peak_rss_kb();
+    print_phase("baseline", 0, 0);
+
+    start = now_sec();
+    return_value = tdv_stream_sign_fd(fd,
+                                      stream_options,
+                                      0,
+                                      cose_algorithm_id,
+                                      key_pair,
+                                      NULL_Q_USEFUL_BUF_C,
+                                      chunk_buffer,
+                                      cose_buffer,
+                                      &cose_sign1);
+    if(return_value) {
+        fprintf(stderr, "sign failed: %d\n", return_value);
+        errors = 1;
+        goto Done;
+    }
+    print_phase("sign", now_sec() - start, size);
+
+    if(out_file != NULL && write_file(out_file, cose_sign1)) {
+        perror(out_file);
+        errors++;
+    }
+
+    lseek(fd, 0, SEEK_SET);
+    start = now_sec();
+    return_value = tdv_stream_verify_fd(fd, stream_options, key_pair, chunk_buffer, cose_sign1);
+    if(return_value) {
+        fprintf(stderr, "verify failed: %d\n", return_value);
+        errors++;
+    }
+    print_phase("verify", now_sec() - start, size);
+
+    /* The last byte is in the signature */
+    cose_sign1 = q_useful_buf_copy(tampered_buffer, cose_sign1);
+    ((uint8_t *)tampered_buffer.ptr)[cose_sign1.len - 1] ^= 0x01;
+    lseek(fd, 0, SEEK_SET);
+    start = now_sec();
+    return_value = tdv_stream_verify_fd(fd, stream_options, key_pair, chunk_buffer, cose_sign1);
+    if(return_value != T_COSE_ERR_SIG_VERIFY) {
+        fprintf(stderr, "tampered signature not detected: %d\n", return_value);
+        errors++;
+    }
+    print_phase("tampered", now_sec() - start, size);
+
+    growth_kb = peak_rss_kb() - baseline_kb;
+    printf("\nPeak RSS grew %ld KB for a %.1f MB payload, limit %u KB\n",
+           growth_kb, (double)size / 1e6, chunk_kb + STREAM_SLACK_KB);
+    if(baseline_kb < 0 || growth_kb > (long)(chunk_kb + STREAM_SLACK_KB)) {
+        errors++;
+    }
+
+    printf("%s\n", errors ? "FAIL" : "PASS");
+
+Done:
+    free(chunk_buffer.ptr);
+    free_ecdsa_key_pair(key_pair);
+    close(fd);
+    return errors ? 1 : 0;
+
+Usage:
+    fprintf(stderr,
+            "Usage: %s [-m] [-c chunk_kb] [-a alg] [-o out.cose] file\n"
+            "  -m  Map the file a window at a time instead of reading it\n"
+            "  -c  Read chunk or map window size in KB, default %d\n"
+            "  -a  ES256, ES384 or ES512, default ES256\n"
+            "  -o  Write the COSE_Sign1 to this file\n",
+            argv[0],
+            STREAM_DEFAULT_CHUNK_KB);
+    return 2;
+}
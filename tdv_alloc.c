@@ -0,0 +1,178 @@
+/*
+ * tdv_alloc.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+#include "tdv_alloc.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/**
+ * \file tdv_alloc.c
+ *
+ * \brief The counting allocator for tdv_alloc.h.
+ *
+ * Each block has a header with its size in front of it so frees can
+ * be counted in bytes. The header is 16 bytes to keep the alignment
+ * that malloc() gives on 64-bit machines.
+ *
+ * The hook is process-wide, so the counters are atomic for the
+ * threaded modes that run with it on.
+ */
+
+#define ALLOC_HEADER_SIZE 16
+
+
+static struct {
+    atomic_uint_fast64_t allocs;
+    atomic_uint_fast64_t reallocs;
+    atomic_uint_fast64_t frees;
+    atomic_uint_fast64_t bytes;
+    atomic_size_t        live_bytes;
+    atomic_size_t        peak_live_bytes;
+} counts;
+
+
+static void add_live(size_t size)
+{
+    size_t live;
+    size_t peak;
+
+    live = atomic_fetch_add_explicit(&counts.live_bytes, size, memory_order_relaxed) + size;
+    peak = atomic_load_explicit(&counts.peak_live_bytes, memory_order_relaxed);
+    while(live > peak &&
+          !atomic_compare_exchange_weak_explicit(&counts.peak_live_bytes, &peak, live,
+                                                 memory_order_relaxed, memory_order_relaxed));
+}
+
+
+/*
+ * Public function. See tdv_alloc.h
+ */
+void *tdv_alloc_malloc(size_t size)
+{
+    uint8_t *block;
+
+    if(size > SIZE_MAX - ALLOC_HEADER_SIZE) {
+        return NULL;
+    }
+    block = malloc(size + ALLOC_HEADER_SIZE);
+    if(block == NULL) {
+        return NULL;
+    }
+    memcpy(block, &size, sizeof(size));
+
+    atomic_fetch_add_explicit(&counts.allocs, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&counts.bytes, size, memory_order_relaxed);
+    add_live(size);
+
+    return block + ALLOC_HEADER_SIZE;
+}
+
+
+/*
+ * Public function. See tdv_alloc.h
+ */
+void *tdv_alloc_calloc(size_t count, size_t size)
+{
+    void *ptr;
+
+    if(size != 0 && count > SIZE_MAX / size) {
+        return NULL;
+    }
+    ptr = tdv_alloc_malloc(count * size);
+    if(ptr != NULL) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+
+/*
+ * Public function. See tdv_alloc.h
+ */
+void tdv_alloc_free(void *ptr)
+{
+    uint8_t *block;
+    size_t   size;
+
+    if(ptr == NULL) {
+        return;
+    }
+    block = (uint8_t *)ptr - ALLOC_HEADER_SIZE;
+    memcpy(&size, block, sizeof(size));
+
+    atomic_fetch_add_explicit(&counts.frees, 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&counts.live_bytes, size, memory_order_relaxed);
+
+    free(block);
+}
+
+
+/*
+ * Public function. See tdv_alloc.h
+ */
+void *tdv_alloc_realloc(void *ptr, size_t size)
+{
+    uint8_t *block;
+    size_t   old_size;
+
+    if(ptr == NULL) {
+        return tdv_alloc_malloc(size);
+    }
+    if(size == 0) {
+        tdv_alloc_free(ptr);
+        return NULL;
+    }
+    if(size > SIZE_MAX - ALLOC_HEADER_SIZE) {
+        return NULL;
+    }
+
+    block = (uint8_t *)ptr - ALLOC_HEADER_SIZE;
+    memcpy(&old_size, block, sizeof(old_size));
+    block = realloc(block, size + ALLOC_HEADER_SIZE);
+    if(block == NULL) {
+        return NULL;
+    }
+    memcpy(block, &size, sizeof(size));
+
+    atomic_fetch_add_explicit(&counts.reallocs, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&counts.bytes, size, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&counts.live_bytes, old_size, memory_order_relaxed);
+    add_live(size);
+
+    return block + ALLOC_HEADER_SIZE;
+}
+
+
+/*
+ * Public function. See tdv_alloc.h
+ */
+void tdv_alloc_get(struct tdv_alloc_counts *c)
+{
+    c->allocs          = atomic_load_explicit(&counts.allocs, memory_order_relaxed);
+    c->reallocs        = atomic_load_explicit(&counts.reallocs, memory_order_relaxed);
+    c->frees           = atomic_load_explicit(&counts.frees, memory_order_relaxed);
+    c->bytes           = atomic_load_explicit(&counts.bytes, memory_order_relaxed);
+    c->live_bytes      = atomic_load_explicit(&counts.live_bytes, memory_order_relaxed);
+    c->peak_live_bytes = atomic_load_explicit(&counts.peak_live_bytes, memory_order_relaxed);
+}
+
+
+/*
+ * Public function. See tdv_alloc.h
+ */
+void tdv_alloc_reset_peak(void)
+{
+    atomic_store_explicit(&counts.peak_live_bytes,
+                          atomic_load_explicit(&counts.live_bytes, memory_order_relaxed),
+                          memory_order_relaxed);
+}
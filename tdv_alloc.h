@@ -0,0 +1,95 @@
+/*
+ * tdv_alloc.h
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+#ifndef tdv_alloc_h
+#define tdv_alloc_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/**
+ * \file tdv_alloc.h
+ *
+ * \brief Count the heap allocations made by the crypto library.
+ *
+ * t_cose and QCBOR never allocate, but the crypto libraries do, for
+ * example OpenSSL allocates an ECDSA_SIG and BIGNUM temporaries on
+ * every sign. tdv_alloc_hook() routes the crypto library's
+ * allocations through counting functions so the benchmark programs
+ * can report allocations per operation.
+ *
+ * The counting functions are in tdv_alloc.c. The hook is per crypto
+ * library, in tdv_alloc_ossl.c and tdv_alloc_psa.c.
+ *
+ * The hook is for the whole process and stays on, so modes with many
+ * threads are counted too. The counters are atomic and the counts are
+ * right, but they are totals for all threads, so a count taken
+ * around an operation only belongs to it when one thread is using the
+ * crypto library.
+ */
+
+
+/**
+ * Allocation counts. These only go up, except for \c live_bytes. Take
+ * the difference of two to get the counts for what ran in between.
+ */
+struct tdv_alloc_counts {
+    /* Calls to malloc and calloc */
+    uint64_t allocs;
+    /* Calls to realloc with a non-NULL pointer */
+    uint64_t reallocs;
+    /* Calls to free with a non-NULL pointer */
+    uint64_t frees;
+    /* Total bytes requested by allocs and reallocs */
+    uint64_t bytes;
+    /* Bytes allocated and not yet freed */
+    size_t   live_bytes;
+    /* Highest live_bytes since tdv_alloc_reset_peak() */
+    size_t   peak_live_bytes;
+};
+
+
+/**
+ * \brief Make the crypto library allocate through the counting functions.
+ *
+ * \return 0 on success. Non-zero if the crypto library can't be
+ *         hooked, for example because it was built without a way to
+ *         replace its allocator or because it has already allocated.
+ *
+ * This must be called at the start of main() before anything else
+ * uses the crypto library.
+ */
+int tdv_alloc_hook(void);
+
+
+/**
+ * \brief Get the counts so far.
+ *
+ * \param[out] counts  The counts.
+ */
+void tdv_alloc_get(struct tdv_alloc_counts *counts);
+
+
+/**
+ * \brief Start tracking the peak from the current live bytes.
+ */
+void tdv_alloc_reset_peak(void);
+
+
+/* The counting allocator. These are used by tdv_alloc_hook(). They
+ * have the same semantics as the C library functions. */
+void *tdv_alloc_malloc(size_t size);
+void *tdv_alloc_calloc(size_t count, size_t size);
+void *tdv_alloc_realloc(void *ptr, size_t size);
+void  tdv_alloc_free(void *ptr);
+
+
+#endif /* tdv_alloc_h */
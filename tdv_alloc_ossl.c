@@ -0,0 +1,59 @@
+/*
+ * tdv_alloc_ossl.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+
+/**
+ * \file tdv_alloc_ossl.c
+ *
+ * \brief tdv_alloc_hook() for OpenSSL.
+ *
+ * This uses CRYPTO_set_mem_functions() rather than an LD_PRELOAD
+ * interposer so only OpenSSL's allocations are counted, not those of
+ * the C library or the benchmark program, and so it works the same
+ * with static linking and on macOS.
+ */
+
+#include "tdv_alloc.h"
+
+#include "openssl/crypto.h"
+
+
+static void *ossl_malloc(size_t size, const char *file, int line)
+{
+    (void)file;
+    (void)line;
+    return tdv_alloc_malloc(size);
+}
+
+
+static void *ossl_realloc(void *ptr, size_t size, const char *file, int line)
+{
+    (void)file;
+    (void)line;
+    return tdv_alloc_realloc(ptr, size);
+}
+
+
+static void ossl_free(void *ptr, const char *file, int line)
+{
+    (void)file;
+    (void)line;
+    tdv_alloc_free(ptr);
+}
+
+
+/*
+ * Public function. See tdv_alloc.h
+ */
+int tdv_alloc_hook(void)
+{
+    /* Fails if OpenSSL has already allocated anything */
+    return CRYPTO_set_mem_functions(ossl_malloc, ossl_realloc, ossl_free) ? 0 : 1;
+}
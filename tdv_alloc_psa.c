@@ -0,0 +1,41 @@
+/*
+ * tdv_alloc_psa.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+
+/**
+ * \file tdv_alloc_psa.c
+ *
+ * \brief tdv_alloc_hook() for Mbed TLS PSA crypto.
+ *
+ * Mbed TLS can only have its allocator replaced when it is built
+ * with MBEDTLS_PLATFORM_MEMORY and without fixed
+ * MBEDTLS_PLATFORM_CALLOC_MACRO / MBEDTLS_PLATFORM_FREE_MACRO. The
+ * default configuration doesn't have MBEDTLS_PLATFORM_MEMORY so with
+ * it the hook fails and no allocation counts are reported.
+ */
+
+#include "tdv_alloc.h"
+
+#include "mbedtls/platform.h" /* Also brings in the Mbed TLS config */
+
+
+/*
+ * Public function. See tdv_alloc.h
+ */
+int tdv_alloc_hook(void)
+{
+#if defined(MBEDTLS_PLATFORM_MEMORY) && \
+    !defined(MBEDTLS_PLATFORM_CALLOC_MACRO) && \
+    !defined(MBEDTLS_PLATFORM_FREE_MACRO)
+    return mbedtls_platform_set_calloc_free(tdv_alloc_calloc, tdv_alloc_free) ? 1 : 0;
+#else
+    return 1;
+#endif
+}
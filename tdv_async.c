@@ -0,0 +1,292 @@
+/*
+ * tdv_async.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+
+/**
+ * \file tdv_async.c
+ *
+ * \brief Implementation of tdv_async.h.
+ *
+ * This is the same for every crypto library. The simulated signer
+ * signs with t_cose_crypto_sign().
+ *
+ * The simulated signer keeps one queue of requests in the order they
+ * are due, which is the order they were submitted in as the latency
+ * is the same for all and the due time is taken under the mutex. Its
+ * threads wait for the head of the queue to be due, take it and sign
+ * it, so the latencies of any number of requests run at once and only
+ * the signing needs a thread.
+ */
+
+/* For clock_gettime() and pthread_cond_timedwait() */
+#define _POSIX_C_SOURCE 200809L
+
+#include "tdv_async.h"
+
+
+/*
+ * Public function. See tdv_async.h
+ */
+enum t_cose_err_t tdv_async_sign_start(const struct tdv_prepared_signer *signer,
+                                       QCBOREncodeContext               *cbor_encode,
+                                       tdv_async_submit_fn               submit,
+                                       void                             *backend,
+                                       tdv_async_done_fn                 done,
+                                       void                             *done_ctx,
+                                       struct tdv_async_request         *request)
+{
+    enum t_cose_err_t return_value;
+
+    request->cose_algorithm_id = signer->cose_algorithm_id;
+    request->signing_key       = signer->signing_key;
+    request->done              = done;
+    request->done_ctx          = done_ctx;
+    request->result            = T_COSE_ERR_FAIL;
+    request->signature         = NULL_Q_USEFUL_BUF_C;
+    atomic_store_explicit(&request->complete, 0, memory_order_relaxed);
+
+    return_value = tdv_prepared_encode_hash(signer,
+                                            cbor_encode,
+                                            (struct q_useful_buf){request->hash_buffer,
+                                                                  sizeof(request->hash_buffer)},
+                                            &request->hash);
+    if(return_value) {
+        return return_value;
+    }
+
+    return submit(backend, request);
+}
+
+
+/*
+ * Public function. See tdv_async.h
+ */
+enum t_cose_err_t tdv_async_sign_finish(struct tdv_async_request *request,
+                                        QCBOREncodeContext       *cbor_encode)
+{
+    if(!tdv_async_is_done(request)) {
+        return T_COSE_ERR_FAIL;
+    }
+    if(request->result) {
+        return request->result;
+    }
+
+    tdv_prepared_add_signature(cbor_encode, request->signature);
+
+    return T_COSE_SUCCESS;
+}
+
+
+/*
+ * Public function. See tdv_async.h
+ */
+void tdv_async_complete(struct tdv_async_request *request,
+                        enum t_cose_err_t         result,
+                        struct q_useful_buf_c     signature)
+{
+    tdv_async_done_fn done;
+    void             *done_ctx;
+
+    /* The request may be reused as soon as it is marked complete */
+    done     = request->done;
+    done_ctx = request->done_ctx;
+
+    if(result == T_COSE_SUCCESS) {
+        request->signature =
+            q_useful_buf_copy((struct q_useful_buf){request->signature_buffer,
+                                                    sizeof(request->signature_buffer)},
+                              signature);
+        if(q_useful_buf_c_is_null(request->signature)) {
+            result = T_COSE_ERR_SIG_BUFFER_SIZE;
+        }
+    }
+    request->result = result;
+    atomic_store_explicit(&request->complete, 1, memory_order_release);
+
+    if(done != NULL) {
+        done(done_ctx);
+    }
+}
+
+
+
+
+/* ------   Simulated slow signer   ------ */
+
+static int due_yet(const struct timespec *due)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    return now.tv_sec > due->tv_sec ||
+           (now.tv_sec == due->tv_sec && now.tv_nsec >= due->tv_nsec);
+}
+
+
+/*
+ * Sign a request that is due and complete it.
+ */
+static void sim_sign(struct tdv_async_request *request)
+{
+    enum t_cose_err_t     return_value;
+    struct q_useful_buf_c signature;
+    Q_USEFUL_BUF_MAKE_STACK_UB(signature_buffer, T_COSE_MAX_SIG_SIZE);
+
+    return_value = t_cose_crypto_sign(request->cose_algorithm_id,
+                                      request->signing_key,
+                                      request->hash,
+                                      signature_buffer,
+                                      &signature);
+
+    tdv_async_complete(request, return_value, signature);
+}
+
+
+static void *sim_thread(void *arg)
+{
+    struct tdv_async_sim     *sim = (struct tdv_async_sim *)arg;
+    struct tdv_async_request *request;
+
+    pthread_mutex_lock(&sim->mutex);
+    while(!sim->stop) {
+        request = sim->head;
+        if(request == NULL) {
+            pthread_cond_wait(&sim->cond, &sim->mutex);
+            continue;
+        }
+        if(!due_yet(&request->due)) {
+            /* The wait time is copied so it doesn't matter if another
+             * thread takes the request meanwhile */
+            pthread_cond_timedwait(&sim->cond, &sim->mutex, &request->due);
+            continue;
+        }
+
+        sim->head = request->next;
+        if(sim->head == NULL) {
+            sim->tail = NULL;
+        } else {
+            /* Another thread waits for the new head while this one
+             * signs */
+            pthread_cond_signal(&sim->cond);
+        }
+        pthread_mutex_unlock(&sim->mutex);
+
+        sim_sign(request);
+
+        pthread_mutex_lock(&sim->mutex);
+    }
+    pthread_mutex_unlock(&sim->mutex);
+
+    return NULL;
+}
+
+
+/*
+ * Public function. See tdv_async.h
+ */
+enum t_cose_err_t tdv_async_sim_start(struct tdv_async_sim *sim,
+                                      uint32_t              latency_us,
+                                      unsigned              num_threads)
+{
+    unsigned t;
+
+    if(num_threads == 0 || num_threads > TDV_ASYNC_SIM_MAX_THREADS) {
+        return T_COSE_ERR_INVALID_ARGUMENT;
+    }
+
+    sim->latency_us = latency_us;
+    sim->head       = NULL;
+    sim->tail       = NULL;
+    sim->stop       = 0;
+    pthread_mutex_init(&sim->mutex, NULL);
+    pthread_cond_init(&sim->cond, NULL);
+
+    for(t = 0; t < num_threads; t++) {
+        if(pthread_create(&sim->threads[t], NULL, sim_thread, sim)) {
+            break;
+        }
+    }
+    sim->num_threads = t;
+    if(t < num_threads) {
+        tdv_async_sim_stop(sim);
+        return T_COSE_ERR_FAIL;
+    }
+
+    return T_COSE_SUCCESS;
+}
+
+
+/*
+ * Public function. See tdv_async.h
+ */
+enum t_cose_err_t tdv_async_sim_submit(void                     *backend,
+                                       struct tdv_async_request *request)
+{
+    struct tdv_async_sim *sim = (struct tdv_async_sim *)backend;
+
+    /* The due time is taken with the mutex held so that appending
+     * keeps the queue in due order when there are many submitters */
+    pthread_mutex_lock(&sim->mutex);
+    if(sim->stop) {
+        pthread_mutex_unlock(&sim->mutex);
+        return T_COSE_ERR_FAIL;
+    }
+    clock_gettime(CLOCK_REALTIME, &request->due);
+    request->due.tv_sec  += sim->latency_us / 1000000;
+    request->due.tv_nsec += (long)(sim->latency_us % 1000000) * 1000;
+    if(request->due.tv_nsec >= 1000000000) {
+        request->due.tv_sec++;
+        request->due.tv_nsec -= 1000000000;
+    }
+    request->next = NULL;
+
+    if(sim->tail == NULL) {
+        sim->head = request;
+        /* The threads are waiting for anything at all. Later
+         * requests are due after the head so don't need a wake up. */
+        pthread_cond_signal(&sim->cond);
+    } else {
+        sim->tail->next = request;
+    }
+    sim->tail = request;
+    pthread_mutex_unlock(&sim->mutex);
+
+    return T_COSE_SUCCESS;
+}
+
+
+/*
+ * Public function. See tdv_async.h
+ */
+void tdv_async_sim_stop(struct tdv_async_sim *sim)
+{
+    struct tdv_async_request *request;
+    unsigned                  t;
+
+    pthread_mutex_lock(&sim->mutex);
+    sim->stop = 1;
+    pthread_cond_broadcast(&sim->cond);
+    pthread_mutex_unlock(&sim->mutex);
+
+    for(t = 0; t < sim->num_threads; t++) {
+        pthread_join(sim->threads[t], NULL);
+    }
+    sim->num_threads = 0;
+
+    while(sim->head != NULL) {
+        request   = sim->head;
+        sim->head = request->next;
+        tdv_async_complete(request, T_COSE_ERR_FAIL, NULL_Q_USEFUL_BUF_C);
+    }
+    sim->tail = NULL;
+
+    pthread_mutex_destroy(&sim->mutex);
+    pthread_cond_destroy(&sim->cond);
+}
@@ -0,0 +1,237 @@
+/*
+ * tdv_async.h
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+#ifndef tdv_async_h
+#define tdv_async_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "t_cose/t_cose_common.h"
+#include "t_cose/q_useful_buf.h"
+#include "qcbor/qcbor_encode.h"
+#include "t_cose_crypto.h"
+#include "tdv_prepared.h"
+
+
+/**
+ * \file tdv_async.h
+ *
+ * \brief Split-phase signing for slow signers such as HSMs.
+ *
+ * With t_cose_sign1_encode_signature() or
+ * tdv_prepared_encode_signature() the calling thread waits in the
+ * crypto call for the whole signing. For a signer that takes
+ * milliseconds, such as an HSM on the network, a thread signs only a
+ * few hundred messages a second even though it is idle almost all
+ * that time.
+ *
+ * Here signing a message is split in three:
+ *
+ *     tdv_async_sign_start()    hash and submit to the signer
+ *     tdv_async_is_done()       or a callback, when the signature is in
+ *     tdv_async_sign_finish()   add the signature to the COSE_Sign1
+ *
+ * A thread can have many messages in flight, each with its own
+ * encoder, output buffer and request, so throughput is the number in
+ * flight divided by the latency rather than one over the latency.
+ *
+ * The signer is a backend behind a submit function. It signs the
+ * request's hash with its algorithm and key on its own time and calls
+ * tdv_async_complete(). tdv_async_sim is a backend that stands in for
+ * a slow device. It makes real signatures with t_cose_crypto_sign()
+ * but only hands each one back a set latency after it was submitted.
+ * Any number of requests can be waiting out their latency at once,
+ * as with a device that has many sessions.
+ */
+
+
+/* Most threads for a tdv_async_sim */
+#define TDV_ASYNC_SIM_MAX_THREADS  16
+
+
+/**
+ * \brief Called when a request completes.
+ *
+ * \param[in] done_ctx  From tdv_async_sign_start().
+ *
+ * This is called on the backend's thread after the request is
+ * complete. By then a thread polling with tdv_async_is_done() may
+ * already have finished the request and reused it, so the request
+ * itself is not passed.
+ */
+typedef void (*tdv_async_done_fn)(void *done_ctx);
+
+
+struct tdv_async_request {
+    /* For the backend to read */
+    int32_t                   cose_algorithm_id;
+    struct t_cose_key         signing_key;
+    struct q_useful_buf_c     hash;
+
+    /* Private data structure */
+    uint8_t                   hash_buffer[T_COSE_CRYPTO_MAX_HASH_SIZE];
+    uint8_t                   signature_buffer[T_COSE_MAX_SIG_SIZE];
+    struct q_useful_buf_c     signature;
+    enum t_cose_err_t         result;
+    tdv_async_done_fn         done;
+    void                     *done_ctx;
+    atomic_int                complete;
+    /* For tdv_async_sim */
+    struct tdv_async_request *next;
+    struct timespec           due;
+};
+
+
+/**
+ * \brief Give a request to a backend.
+ *
+ * \param[in] backend   The backend's context.
+ * \param[in] request   The request. The backend must call
+ *                      tdv_async_complete() for it exactly once, on
+ *                      any thread, including when the signing fails.
+ *
+ * \return An error if the request wasn't taken. tdv_async_complete()
+ *         must not be called for it then.
+ */
+typedef enum t_cose_err_t (*tdv_async_submit_fn)(void                     *backend,
+                                                 struct tdv_async_request *request);
+
+
+/**
+ * \brief End the payload, hash and submit for signing.
+ *
+ * \param[in] signer       The prepared signer.
+ * \param[in] cbor_encode  The encoder, with the payload just added.
+ *                         It must not be used again until
+ *                         tdv_async_sign_finish().
+ * \param[in] submit       The backend's submit function.
+ * \param[in] backend      The backend.
+ * \param[in] done         Called when complete or NULL to only poll.
+ * \param[in] done_ctx     Passed to \c done.
+ * \param[out] request     The request. It must stay valid until
+ *                         tdv_async_sign_finish().
+ *
+ * \return An error hashing or from the backend's submit. If there is
+ *         an error the request is not in flight and
+ *         tdv_async_sign_finish() must not be called.
+ */
+enum t_cose_err_t tdv_async_sign_start(const struct tdv_prepared_signer *signer,
+                                       QCBOREncodeContext               *cbor_encode,
+                                       tdv_async_submit_fn               submit,
+                                       void                             *backend,
+                                       tdv_async_done_fn                 done,
+                                       void                             *done_ctx,
+                                       struct tdv_async_request         *request);
+
+
+/**
+ * \brief Whether a request has completed.
+ *
+ * \param[in] request  A request started with tdv_async_sign_start().
+ *
+ * \return 1 if it has and tdv_async_sign_finish() won't wait, 0 if
+ *         not.
+ */
+static inline int tdv_async_is_done(struct tdv_async_request *request)
+{
+    return atomic_load_explicit(&request->complete, memory_order_acquire);
+}
+
+
+/**
+ * \brief Add the signature to the COSE_Sign1.
+ *
+ * \param[in] request      A request that is done.
+ * \param[in] cbor_encode  The encoder given to tdv_async_sign_start().
+ *
+ * After this QCBOREncode_Finish() gives the COSE_Sign1 and the
+ * request can be used again.
+ *
+ * \return \ref T_COSE_ERR_FAIL if the request isn't done, or the
+ *         error from the backend's signing.
+ */
+enum t_cose_err_t tdv_async_sign_finish(struct tdv_async_request *request,
+                                        QCBOREncodeContext       *cbor_encode);
+
+
+/**
+ * \brief For backends: the signing of a request is done.
+ *
+ * \param[in] request    The request given to the submit function.
+ * \param[in] result     \ref T_COSE_SUCCESS or the error signing.
+ * \param[in] signature  The signature in the COSE format. It is copied.
+ *
+ * The request must not be used by the backend after this.
+ */
+void tdv_async_complete(struct tdv_async_request *request,
+                        enum t_cose_err_t         result,
+                        struct q_useful_buf_c     signature);
+
+
+struct tdv_async_sim {
+    /* Private data structure */
+    uint32_t                  latency_us;
+    pthread_mutex_t           mutex;
+    pthread_cond_t            cond;
+    /* Requests in order of when they are due */
+    struct tdv_async_request *head;
+    struct tdv_async_request *tail;
+    int                       stop;
+    unsigned                  num_threads;
+    pthread_t                 threads[TDV_ASYNC_SIM_MAX_THREADS];
+};
+
+
+/**
+ * \brief Start a simulated slow signer.
+ *
+ * \param[out] sim          The simulated signer.
+ * \param[in] latency_us    Time from submit to completion.
+ * \param[in] num_threads   Threads making the signatures. Only the
+ *                          signing itself uses them; the latency
+ *                          doesn't.
+ *
+ * \return \ref T_COSE_ERR_INVALID_ARGUMENT for a number of threads out
+ *         of range or \ref T_COSE_ERR_FAIL if a thread couldn't be
+ *         started.
+ */
+enum t_cose_err_t tdv_async_sim_start(struct tdv_async_sim *sim,
+                                      uint32_t              latency_us,
+                                      unsigned              num_threads);
+
+
+/**
+ * \brief The submit function of the simulated signer.
+ *
+ * \param[in] sim       The struct tdv_async_sim.
+ * \param[in] request   The request.
+ *
+ * \return \ref T_COSE_ERR_FAIL if the simulated signer is stopping.
+ */
+enum t_cose_err_t tdv_async_sim_submit(void                     *sim,
+                                       struct tdv_async_request *request);
+
+
+/**
+ * \brief Stop a simulated signer.
+ *
+ * \param[in] sim  The simulated signer.
+ *
+ * Requests still waiting out their latency are completed with
+ * \ref T_COSE_ERR_FAIL so nothing is left waiting.
+ */
+void tdv_async_sim_stop(struct tdv_async_sim *sim);
+
+
+#endif /* tdv_async_h */
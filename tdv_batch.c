@@ -0,0 +1,329 @@
+/*
+ * tdv_batch.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+
+/**
+ * \file tdv_batch.c
+ *
+ * \brief Implementation of tdv_batch.h.
+ *
+ * This is the same for every crypto library. Everything crypto
+ * library specific is behind t_cose, tdv_prepared.h and the key
+ * resolver.
+ */
+
+#include "tdv_batch.h"
+
+#include "tdv_prepared.h"
+#include "t_cose/t_cose_sign1_verify.h"
+#include "t_cose_standard_constants.h"
+#include "qcbor/qcbor_spiffy_decode.h"
+
+#include <string.h>
+
+
+/* What is set up for one protected header and kid in a batch */
+struct batch_key {
+    size_t                       protected_len;
+    uint8_t                      protected_parameters[TDV_BATCH_MAX_PROTECTED];
+    size_t                       kid_len;
+    uint8_t                      kid[TDV_BATCH_MAX_KID];
+    /* The resolver's answer, or the one key */
+    enum t_cose_err_t            result;
+    struct t_cose_key            key;
+    /* Set up if the protected header is {1: alg} for an algorithm
+     * that signs a hash. Messages are verified with it instead of
+     * t_cose_sign1_verify(). */
+    int                          prepared;
+    struct tdv_prepared_verifier verifier;
+};
+
+
+struct batch_keys {
+    size_t           count;
+    struct batch_key keys[TDV_BATCH_KEY_CACHE];
+};
+
+
+/* A message decoded once for finding its batch_key and verifying */
+struct batch_message {
+    struct q_useful_buf_c protected_parameters;
+    struct q_useful_buf_c kid;
+    struct q_useful_buf_c payload;
+    struct q_useful_buf_c signature;
+};
+
+
+/*
+ * Decode a COSE_Sign1 into its parts. The kid is only looked for in
+ * the unprotected header, and only if want_kid. Returns non-zero if
+ * it isn't a COSE_Sign1 with an attached payload; t_cose then gives
+ * the error.
+ */
+static int decode_message(struct q_useful_buf_c  cose_sign1,
+                          int                    want_kid,
+                          struct batch_message  *message)
+{
+    QCBORDecodeContext decode_context;
+    QCBORItem          items[2];
+
+    enum {KID, END};
+
+    items[KID].label.int64 = COSE_HEADER_PARAM_KID;
+    items[KID].uLabelType  = QCBOR_TYPE_INT64;
+    items[KID].uDataType   = QCBOR_TYPE_BYTE_STRING;
+    items[END].uLabelType  = QCBOR_TYPE_NONE;
+
+    /* [protected bstr, unprotected map, payload bstr, signature bstr] */
+    QCBORDecode_Init(&decode_context, cose_sign1, QCBOR_DECODE_MODE_NORMAL);
+    QCBORDecode_EnterArray(&decode_context, NULL);
+    QCBORDecode_GetByteString(&decode_context, &message->protected_parameters);
+    QCBORDecode_EnterMap(&decode_context, NULL);
+    if(want_kid) {
+        QCBORDecode_GetItemsInMap(&decode_context, items);
+    } else {
+        items[KID].uDataType = QCBOR_TYPE_NONE;
+    }
+    QCBORDecode_ExitMap(&decode_context);
+    QCBORDecode_GetByteString(&decode_context, &message->payload);
+    QCBORDecode_GetByteString(&decode_context, &message->signature);
+    QCBORDecode_ExitArray(&decode_context);
+    if(QCBORDecode_Finish(&decode_context)) {
+        return -1;
+    }
+
+    message->kid = NULL_Q_USEFUL_BUF_C;
+    if(items[KID].uDataType == QCBOR_TYPE_BYTE_STRING) {
+        message->kid = items[KID].val.string;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Find what is set up for a message's protected header and kid.
+ */
+static struct batch_key *find_key(struct batch_keys          *cache,
+                                  const struct batch_message *message)
+{
+    struct batch_key *entry;
+    size_t            i;
+
+    for(i = 0; i < cache->count; i++) {
+        entry = &cache->keys[i];
+        if(entry->protected_len == message->protected_parameters.len &&
+           entry->kid_len == message->kid.len &&
+           !memcmp(entry->protected_parameters,
+                   message->protected_parameters.ptr,
+                   message->protected_parameters.len) &&
+           (message->kid.len == 0 || !memcmp(entry->kid, message->kid.ptr, message->kid.len))) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Set up for the protected header and kid of a message seen for the
+ * first time in the batch: get the key from the resolver, or use the
+ * one key, and set up a prepared verifier for it if it can be.
+ * Returns NULL if there's no room or the message's headers can't be
+ * decoded; then the message is verified without the cache.
+ */
+static struct batch_key *add_key(struct batch_keys          *cache,
+                                 uint32_t                    option_flags,
+                                 const struct t_cose_key    *key,
+                                 tdv_batch_key_resolver      resolver,
+                                 void                       *resolver_ctx,
+                                 struct q_useful_buf_c       cose_sign1,
+                                 const struct batch_message *message)
+{
+    struct t_cose_sign1_verify_ctx decode_ctx;
+    struct t_cose_parameters       parameters;
+    struct q_useful_buf_c          payload;
+    struct batch_key              *entry;
+
+    if(cache->count == TDV_BATCH_KEY_CACHE ||
+       message->protected_parameters.len > TDV_BATCH_MAX_PROTECTED ||
+       message->kid.len > TDV_BATCH_MAX_KID) {
+        return NULL;
+    }
+
+    /* Once per entry, so t_cose decoding the headers costs little */
+    t_cose_sign1_verify_init(&decode_ctx, option_flags | T_COSE_OPT_DECODE_ONLY);
+    if(t_cose_sign1_verify(&decode_ctx, cose_sign1, &payload, &parameters)) {
+        return NULL;
+    }
+
+    entry = &cache->keys[cache->count++];
+    entry->protected_len = message->protected_parameters.len;
+    memcpy(entry->protected_parameters,
+           message->protected_parameters.ptr,
+           message->protected_parameters.len);
+    entry->kid_len = message->kid.len;
+    if(message->kid.len) {
+        memcpy(entry->kid, message->kid.ptr, message->kid.len);
+    }
+
+    if(key != NULL) {
+        entry->result = T_COSE_SUCCESS;
+        entry->key    = *key;
+    } else {
+        entry->result = (*resolver)(resolver_ctx,
+                                    parameters.cose_algorithm_id,
+                                    parameters.kid,
+                                    &entry->key);
+    }
+
+    /* The prepared verifier does none of the options */
+    entry->prepared = 0;
+    if(entry->result == T_COSE_SUCCESS && option_flags == 0 &&
+       tdv_prepared_verifier_init(&entry->verifier,
+                                  parameters.cose_algorithm_id,
+                                  entry->key) == T_COSE_SUCCESS) {
+        entry->prepared = tdv_prepared_verifier_takes(&entry->verifier,
+                                                      message->protected_parameters);
+        if(!entry->prepared) {
+            tdv_prepared_verifier_free(&entry->verifier);
+        }
+    }
+
+    return entry;
+}
+
+
+/*
+ * Verify a message that has no entry in the cache: with the one key,
+ * or after getting its algorithm and kid and asking the resolver.
+ */
+static enum t_cose_err_t verify_uncached(struct t_cose_sign1_verify_ctx *verify_ctx,
+                                         uint32_t                        option_flags,
+                                         const struct t_cose_key        *key,
+                                         tdv_batch_key_resolver          resolver,
+                                         void                           *resolver_ctx,
+                                         struct tdv_batch_item          *item)
+{
+    struct t_cose_sign1_verify_ctx decode_ctx;
+    struct t_cose_parameters       parameters;
+    struct q_useful_buf_c          payload;
+    struct t_cose_key              resolved;
+    enum t_cose_err_t              return_value;
+
+    if(key == NULL) {
+        t_cose_sign1_verify_init(&decode_ctx, option_flags | T_COSE_OPT_DECODE_ONLY);
+        return_value = t_cose_sign1_verify(&decode_ctx, item->cose_sign1, &payload, &parameters);
+        if(return_value) {
+            return return_value;
+        }
+        return_value = (*resolver)(resolver_ctx,
+                                   parameters.cose_algorithm_id,
+                                   parameters.kid,
+                                   &resolved);
+        if(return_value) {
+            return return_value;
+        }
+        key = &resolved;
+    }
+
+    t_cose_sign1_set_verification_key(verify_ctx, *key);
+    return t_cose_sign1_verify(verify_ctx, item->cose_sign1, &item->payload, NULL);
+}
+
+
+/*
+ * Public function. See tdv_batch.h
+ */
+size_t tdv_batch_verify(uint32_t                 option_flags,
+                        const struct t_cose_key *key,
+                        tdv_batch_key_resolver   resolver,
+                        void                    *resolver_ctx,
+                        struct tdv_batch_item   *items,
+                        size_t                   count)
+{
+    struct t_cose_sign1_verify_ctx verify_ctx;
+    struct batch_keys              cache;
+    struct batch_message           message;
+    struct batch_key              *entry;
+    const struct batch_key        *current;
+    size_t                         verified;
+    size_t                         i;
+
+    t_cose_sign1_verify_init(&verify_ctx, option_flags);
+    cache.count = 0;
+    /* No key set in verify_ctx yet */
+    current  = NULL;
+    verified = 0;
+
+    for(i = 0; i < count; i++) {
+        items[i].payload = NULL_Q_USEFUL_BUF_C;
+
+        entry = NULL;
+        if(!decode_message(items[i].cose_sign1, key == NULL, &message)) {
+            entry = find_key(&cache, &message);
+            if(entry == NULL) {
+                entry = add_key(&cache,
+                                option_flags,
+                                key,
+                                resolver,
+                                resolver_ctx,
+                                items[i].cose_sign1,
+                                &message);
+            }
+        }
+
+        if(entry == NULL) {
+            items[i].result = verify_uncached(&verify_ctx,
+                                              option_flags,
+                                              key,
+                                              resolver,
+                                              resolver_ctx,
+                                              &items[i]);
+            current = NULL;
+        } else if(entry->result) {
+            items[i].result = entry->result;
+        } else if(entry->prepared) {
+            /* The Sig_structure prefix is hashed already, and the
+             * message isn't decoded again */
+            items[i].result = tdv_prepared_verify_decoded(&entry->verifier,
+                                                          message.protected_parameters,
+                                                          message.payload,
+                                                          message.signature);
+            if(items[i].result == T_COSE_SUCCESS) {
+                items[i].payload = message.payload;
+            }
+        } else {
+            /* Messages with the same key are usually together so this
+             * is mostly skipped */
+            if(entry != current) {
+                t_cose_sign1_set_verification_key(&verify_ctx, entry->key);
+                current = entry;
+            }
+            items[i].result = t_cose_sign1_verify(&verify_ctx,
+                                                  items[i].cose_sign1,
+                                                  &items[i].payload,
+                                                  NULL);
+        }
+
+        if(items[i].result == T_COSE_SUCCESS) {
+            verified++;
+        }
+    }
+
+    for(i = 0; i < cache.count; i++) {
+        if(cache.keys[i].prepared) {
+            tdv_prepared_verifier_free(&cache.keys[i].verifier);
+        }
+    }
+
+    return verified;
+}
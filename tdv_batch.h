@@ -0,0 +1,125 @@
+/*
+ * tdv_batch.h
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+#ifndef tdv_batch_h
+#define tdv_batch_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "t_cose/t_cose_common.h"
+#include "t_cose/q_useful_buf.h"
+
+
+/**
+ * \file tdv_batch.h
+ *
+ * \brief Verify many COSE_Sign1 messages in one call.
+ *
+ * This is for a verifier that gets many messages at once, many of
+ * them signed by the same key. Compared with calling
+ * t_cose_sign1_verify_init(), t_cose_sign1_set_verification_key() and
+ * t_cose_sign1_verify() for each message:
+ *
+ *  - For each distinct protected header and kid in the batch a
+ *    prepared verifier from tdv_prepared.h is set up. It has the
+ *    start of the Sig_structure hashed, so each message's hash is a
+ *    copy of that midstate with tdv_hash_clone() plus the payload.
+ *    Each message is decoded once, here, rather than by t_cose.
+ *  - With a key resolver, the resolver is called once per distinct
+ *    protected header and kid, not once per message. Its answer,
+ *    including a failure, is remembered for the rest of the batch.
+ *
+ * The prepared verifier only takes a protected header of exactly
+ * {1: alg} with an algorithm that signs a hash, and no options.
+ * Other messages, for example EdDSA ones, are verified with
+ * t_cose_sign1_verify(), with the key only set again when it changes
+ * from one message to the next. Like t_cose_sign1_verify() with no
+ * options, the prepared verifier uses only the kid from the
+ * unprotected header, but it doesn't check the rest of that header.
+ *
+ * Each message gets its own result, so one bad message doesn't stop
+ * the rest of the batch.
+ */
+
+
+/* Most distinct protected header and kid pairs set up in one batch.
+ * Messages beyond this are verified with t_cose_sign1_verify() and
+ * call the resolver every time. */
+#define TDV_BATCH_KEY_CACHE      8
+
+/* Longest protected header remembered. Messages with longer ones
+ * are verified as if the cache were full. */
+#define TDV_BATCH_MAX_PROTECTED  32
+
+/* Longest kid remembered. Longer kids are verified as if the cache
+ * were full. */
+#define TDV_BATCH_MAX_KID        32
+
+
+/**
+ * \brief Find the key to verify a message with.
+ *
+ * \param[in] resolver_ctx       Passed through from
+ *                               tdv_batch_verify().
+ * \param[in] cose_algorithm_id  The algorithm from the protected
+ *                               header.
+ * \param[in] kid                The kid from the header or
+ *                               \c NULL_Q_USEFUL_BUF_C if none.
+ * \param[out] key               The key. It must stay valid until
+ *                               tdv_batch_verify() returns. It is not
+ *                               freed by tdv_batch_verify().
+ *
+ * \return \ref T_COSE_SUCCESS or an error that becomes the result of
+ *         every message with this protected header and kid.
+ */
+typedef enum t_cose_err_t (*tdv_batch_key_resolver)(void                 *resolver_ctx,
+                                                    int32_t               cose_algorithm_id,
+                                                    struct q_useful_buf_c kid,
+                                                    struct t_cose_key    *key);
+
+
+struct tdv_batch_item {
+    /* In: the message to verify */
+    struct q_useful_buf_c cose_sign1;
+    /* Out: the payload, pointing into cose_sign1 */
+    struct q_useful_buf_c payload;
+    /* Out: the result of verifying this message */
+    enum t_cose_err_t     result;
+};
+
+
+/**
+ * \brief Verify a batch of messages.
+ *
+ * \param[in] option_flags   Options for t_cose_sign1_verify_init().
+ * \param[in] key            The key for all the messages or NULL to
+ *                           use the resolver.
+ * \param[in] resolver       Finds the key for a message if \c key is
+ *                           NULL.
+ * \param[in] resolver_ctx   Passed to the resolver.
+ * \param[in,out] items      The messages and their results.
+ * \param[in] count          Number of items.
+ *
+ * The first message with each protected header and kid is also
+ * decoded with \ref T_COSE_OPT_DECODE_ONLY to get its algorithm and
+ * kid.
+ *
+ * \return The number of messages that verified.
+ */
+size_t tdv_batch_verify(uint32_t                 option_flags,
+                        const struct t_cose_key *key,
+                        tdv_batch_key_resolver   resolver,
+                        void                    *resolver_ctx,
+                        struct tdv_batch_item   *items,
+                        size_t                   count);
+
+
+#endif /* tdv_batch_h */
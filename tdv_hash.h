@@ -0,0 +1,68 @@
+/*
+ * tdv_hash.h
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+#ifndef tdv_hash_h
+#define tdv_hash_h
+
+#include "t_cose/t_cose_common.h"
+#include "t_cose_crypto.h"
+
+
+/**
+ * \file tdv_hash.h
+ *
+ * \brief Copy and discard hashes started with t_cose_crypto.h.
+ *
+ * The crypto adapter layer can start, update and finish a hash, but
+ * not copy one part way through. A copy lets a prefix that is the
+ * same for many messages be hashed once and the hash state after it,
+ * the midstate, be copied for each message.
+ *
+ * These reach into the crypto library part of struct
+ * t_cose_crypto_hash so they are per crypto library, in
+ * tdv_hash_ossl.c and tdv_hash_psa.c.
+ */
+
+
+/**
+ * \brief Copy a hash part way through.
+ *
+ * \param[in] source  A hash started with t_cose_crypto_hash_start()
+ *                    and not yet finished. It is not changed so one
+ *                    source can be copied by many threads at once.
+ * \param[out] copy   The copy. It is finished with
+ *                    t_cose_crypto_hash_finish() or discarded with
+ *                    tdv_hash_free() like any other hash.
+ *
+ * An error in the source, for example a failed update, is copied
+ * and comes out of t_cose_crypto_hash_finish() of the copy.
+ *
+ * \return \ref T_COSE_ERR_INSUFFICIENT_MEMORY or
+ *         \ref T_COSE_ERR_HASH_GENERAL_FAIL if the copy couldn't be
+ *         made. Nothing needs to be freed then.
+ */
+enum t_cose_err_t tdv_hash_clone(const struct t_cose_crypto_hash *source,
+                                 struct t_cose_crypto_hash       *copy);
+
+
+/**
+ * \brief Discard a hash that won't be finished.
+ *
+ * \param[in] hash_ctx  A hash started with t_cose_crypto_hash_start()
+ *                      or tdv_hash_clone() and not finished.
+ *
+ * t_cose_crypto_hash_finish() frees what the crypto library
+ * allocated for a hash. This does it for a hash that is never
+ * finished, such as a midstate that is only copied.
+ */
+void tdv_hash_free(struct t_cose_crypto_hash *hash_ctx);
+
+
+#endif /* tdv_hash_h */
@@ -0,0 +1,59 @@
+/*
+ * tdv_hash_ossl.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+
+/**
+ * \file tdv_hash_ossl.c
+ *
+ * \brief tdv_hash.h for OpenSSL.
+ *
+ * t_cose's OpenSSL adapter keeps an EVP_MD_CTX and the result of the
+ * last EVP_DigestUpdate() in struct t_cose_crypto_hash.
+ * EVP_MD_CTX_copy_ex() copies the digest state, which for the SHA-2
+ * digests is a few hundred bytes, and doesn't fetch the digest again
+ * as EVP_DigestInit_ex() does in OpenSSL 3.
+ */
+
+#include "tdv_hash.h"
+
+#include "openssl/evp.h"
+
+
+/*
+ * Public function. See tdv_hash.h
+ */
+enum t_cose_err_t tdv_hash_clone(const struct t_cose_crypto_hash *source,
+                                 struct t_cose_crypto_hash       *copy)
+{
+    copy->update_error = source->update_error;
+
+    copy->evp_ctx = EVP_MD_CTX_new();
+    if(copy->evp_ctx == NULL) {
+        return T_COSE_ERR_INSUFFICIENT_MEMORY;
+    }
+
+    if(!EVP_MD_CTX_copy_ex(copy->evp_ctx, source->evp_ctx)) {
+        EVP_MD_CTX_free(copy->evp_ctx);
+        copy->evp_ctx = NULL;
+        return T_COSE_ERR_HASH_GENERAL_FAIL;
+    }
+
+    return T_COSE_SUCCESS;
+}
+
+
+/*
+ * Public function. See tdv_hash.h
+ */
+void tdv_hash_free(struct t_cose_crypto_hash *hash_ctx)
+{
+    EVP_MD_CTX_free(hash_ctx->evp_ctx);
+    hash_ctx->evp_ctx = NULL;
+}
@@ -0,0 +1,56 @@
+/*
+ * tdv_hash_psa.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+
+/**
+ * \file tdv_hash_psa.c
+ *
+ * \brief tdv_hash.h for PSA / Mbed Crypto.
+ *
+ * t_cose's PSA adapter keeps a psa_hash_operation_t and the status of
+ * the last PSA call in struct t_cose_crypto_hash. The operation is
+ * copied with psa_hash_clone(). Nothing is allocated.
+ */
+
+#include "tdv_hash.h"
+
+#include "psa/crypto.h"
+
+
+/*
+ * Public function. See tdv_hash.h
+ */
+enum t_cose_err_t tdv_hash_clone(const struct t_cose_crypto_hash *source,
+                                 struct t_cose_crypto_hash       *copy)
+{
+    copy->ctx    = psa_hash_operation_init();
+    copy->status = source->status;
+    if(source->status != PSA_SUCCESS) {
+        /* Nothing to copy. The error comes out of the finish. */
+        return T_COSE_SUCCESS;
+    }
+
+    copy->status = psa_hash_clone(&source->ctx, &copy->ctx);
+    if(copy->status != PSA_SUCCESS) {
+        psa_hash_abort(&copy->ctx);
+        return T_COSE_ERR_HASH_GENERAL_FAIL;
+    }
+
+    return T_COSE_SUCCESS;
+}
+
+
+/*
+ * Public function. See tdv_hash.h
+ */
+void tdv_hash_free(struct t_cose_crypto_hash *hash_ctx)
+{
+    psa_hash_abort(&hash_ctx->ctx);
+}
@@ -0,0 +1,104 @@
+/*
+ * tdv_keys.h
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+#ifndef tdv_keys_h
+#define tdv_keys_h
+
+#include "t_cose/t_cose_common.h"
+
+
+/**
+ * \file tdv_keys.h
+ *
+ * \brief Fixed test key pairs for the tdv benchmark programs.
+ *
+ * There is one implementation of this interface per crypto library,
+ * tdv_keys_ossl.c and tdv_keys_psa.c. The benchmark programs are
+ * written against this interface so the same source is linked
+ * against either crypto library. The keys are the same hard coded
+ * keys used in encode_only_xxx.c and decode_only_xxx.c.
+ */
+
+
+/**
+ * \brief Make an ECDSA key pair for a COSE algorithm.
+ *
+ * \param[in] cose_algorithm_id  \ref T_COSE_ALGORITHM_ES256,
+ *                               \ref T_COSE_ALGORITHM_ES384 or
+ *                               \ref T_COSE_ALGORITHM_ES512.
+ * \param[out] key_pair          The key pair. This must be freed with
+ *                               free_ecdsa_key_pair().
+ *
+ * \return \ref T_COSE_ERR_UNSUPPORTED_SIGNING_ALG for other algorithms
+ *         or an error from the crypto library.
+ */
+enum t_cose_err_t make_ecdsa_key_pair(int32_t            cose_algorithm_id,
+                                      struct t_cose_key *key_pair);
+
+
+/**
+ * \brief Make an ECDSA key from its raw parts.
+ *
+ * \param[in] cose_algorithm_id  \ref T_COSE_ALGORITHM_ES256,
+ *                               \ref T_COSE_ALGORITHM_ES384 or
+ *                               \ref T_COSE_ALGORITHM_ES512. This
+ *                               picks the curve.
+ * \param[in] private_key        The private key as a big-endian
+ *                               integer or \c NULL_Q_USEFUL_BUF_C for
+ *                               a key that can only verify.
+ * \param[in] public_key         The public key as an uncompressed
+ *                               point, 0x04 || x || y, or
+ *                               \c NULL_Q_USEFUL_BUF_C to compute it
+ *                               from the private key.
+ * \param[out] key_pair          The key. This must be freed with
+ *                               free_ecdsa_key_pair().
+ *
+ * This is used by tdv_keystore.c for keys loaded from files.
+ *
+ * \return \ref T_COSE_ERR_EMPTY_KEY if neither key is given,
+ *         \ref T_COSE_ERR_UNSUPPORTED_SIGNING_ALG for other
+ *         algorithms or an error from the crypto library.
+ */
+enum t_cose_err_t make_ecdsa_key_from_raw(int32_t                cose_algorithm_id,
+                                          struct q_useful_buf_c  private_key,
+                                          struct q_useful_buf_c  public_key,
+                                          struct t_cose_key     *key_pair);
+
+
+/**
+ * \brief Free a key pair made by make_ecdsa_key_pair() or
+ *        make_ecdsa_key_from_raw().
+ *
+ * \param[in] key_pair   The key pair to close / deallocate / free.
+ */
+void free_ecdsa_key_pair(struct t_cose_key key_pair);
+
+
+/**
+ * \brief The name of the crypto library the keys are for.
+ *
+ * \return "OpenSSL" or "PSA". Used to label benchmark output.
+ */
+const char *tdv_crypto_lib_name(void);
+
+
+/**
+ * \brief The number of keys the crypto library is holding.
+ *
+ * \return The number of occupied PSA key slots or -1 if the crypto
+ *         library doesn't keep track. OpenSSL keys are only heap
+ *         memory so they show up in the heap instead.
+ *
+ * Used by soak.c to check that freeing a key gives back its slot.
+ */
+int tdv_crypto_keys_in_use(void);
+
+
+#endif /* tdv_keys_h */
@@ -0,0 +1,442 @@
+/*
+ * tdv_keys_ossl.c, derived from encode_only_ossl.c
+ *
+ * Copyright 2019-2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+
+/**
+ * \file tdv_keys_ossl.c
+ *
+ * \brief Implementation of tdv_keys.h for OpenSSL.
+ */
+
+#include "tdv_keys.h"
+#include "tdv_ossl3.h"
+
+#include "openssl/ecdsa.h"
+#include "openssl/obj_mac.h" /* for NID for EC curve */
+#include "openssl/err.h"
+#if TDV_OSSL3
+#include "openssl/core_names.h"
+#include "openssl/param_build.h"
+#endif
+
+
+/*
+ * Some hard coded keys for the test cases here.
+ */
+#define PUBLIC_KEY_prime256v1 \
+"0437ab65955fae0466673c3a2934a3" \
+"4f2f0ec2b3eec224198557998fc04b" \
+"f4b2b495d9798f2539c90d7d102b3b" \
+"bbda7fcbdb0e9b58d4e1ad2e61508d" \
+"a75f84a67b"
+
+#define PRIVATE_KEY_prime256v1 \
+"f1b7142343402f3b5de7315ea894f9" \
+"da5cf503ff7938a37ca14eb0328698" \
+"8450"
+
+
+#define PUBLIC_KEY_secp384r1 \
+"04bdd9c3f818c9cef3e11e2d40e775" \
+"beb37bc376698d71967f93337a4e03" \
+"2dffb11b505067dddb4214b56d9bce" \
+"c59177eccd8ab05f50975933b9a738" \
+"d90c0b07eb9519567ef9075807cf77" \
+"139fc1fe85608851361136806123ed" \
+"c735ce5a03e8e4"
+
+#define PRIVATE_KEY_secp384r1 \
+"03df14f4b8a43fd8ab75a6046bd2b5" \
+"eaa6fd10b2b203fd8a78d7916de20a" \
+"a241eb37ec3d4c693d23ba2b4f6e5b" \
+"66f57f"
+
+
+#define PUBLIC_KEY_secp521r1 \
+"0400e4d253175a14311fc2dd487687" \
+"70cb49b07bd15d327beb98aa33e60c" \
+"d0181b17fb8f1cbf07dbc8652ff5b7" \
+"b4452c082e0686c0fab8089071cbc5" \
+"37101d344b94c201e6424f3a18da4f" \
+"20ecabfbc84b8467c217cd67055fa5" \
+"dec7fb1ae87082302c1813caa4b7b1" \
+"cf28d94677e486fb4b317097e9307a" \
+"bdb9d50187779a3d1e682c123c"
+
+#define PRIVATE_KEY_secp521r1 \
+"0045d2d1439435fab333b1c6c8b534" \
+"f0969396ad64d5f535d65f68f2a160" \
+"6590bb15fd5322fc97a416c395745e" \
+"72c7c85198c0921ab3b8e92dd901b5" \
+"a42159adac6d"
+
+
+/**
+ * \brief Make an EC key pair in OpenSSL library form.
+ *
+ * \param[in] cose_algorithm_id  The algorithm to sign with, for example
+ *                               \ref T_COSE_ALGORITHM_ES256.
+ * \param[out] key_pair          The key pair. This must be freed.
+ *
+ * The key made here is fixed and just useful for testing.
+ */
+enum t_cose_err_t make_ossl_ecdsa_key_pair(int32_t            cose_algorithm_id,
+                                           struct t_cose_key *key_pair)
+{
+    EC_GROUP          *ossl_ec_group = NULL;
+    enum t_cose_err_t  return_value;
+    BIGNUM            *ossl_private_key_bn = NULL;
+    EC_KEY            *ossl_ec_key = NULL;
+    int                ossl_result;
+    EC_POINT          *ossl_pub_key_point = NULL;
+    int                nid;
+    const char        *public_key;
+    const char        *private_key;
+
+    switch (cose_algorithm_id) {
+    case T_COSE_ALGORITHM_ES256:
+        nid         = NID_X9_62_prime256v1;
+        public_key  = PUBLIC_KEY_prime256v1;
+        private_key =  PRIVATE_KEY_prime256v1 ;
+        break;
+
+    case T_COSE_ALGORITHM_ES384:
+        nid         = NID_secp384r1;
+        public_key  = PUBLIC_KEY_secp384r1;
+        private_key = PRIVATE_KEY_secp384r1;
+        break;
+
+    case T_COSE_ALGORITHM_ES512:
+        nid         = NID_secp521r1;
+        public_key  = PUBLIC_KEY_secp521r1;
+        private_key = PRIVATE_KEY_secp521r1;
+        break;
+
+    default:
+        return T_COSE_ERR_UNSUPPORTED_SIGNING_ALG;
+    }
+
+    /* Make a group for the particular EC algorithm */
+    ossl_ec_group = EC_GROUP_new_by_curve_name(nid);
+    if(ossl_ec_group == NULL) {
+        return_value = T_COSE_ERR_INSUFFICIENT_MEMORY;
+        goto Done;
+    }
+
+    /* Make an empty EC key object */
+    ossl_ec_key = EC_KEY_new();
+    if(ossl_ec_key == NULL) {
+        return_value = T_COSE_ERR_INSUFFICIENT_MEMORY;
+        goto Done;
+    }
+
+    /* Associate group with key object. The key object gets its own
+     * copy of the group. */
+    ossl_result = EC_KEY_set_group(ossl_ec_key, ossl_ec_group);
+    if (!ossl_result) {
+        return_value = T_COSE_ERR_SIG_FAIL;
+        goto Done;
+    }
+
+    /* Make an instance of a big number to store the private key */
+    ossl_private_key_bn = BN_new();
+    if(ossl_private_key_bn == NULL) {
+        return_value = T_COSE_ERR_INSUFFICIENT_MEMORY;
+        goto Done;
+    }
+    BN_zero(ossl_private_key_bn);
+
+    /* Stuff the specific private key into the big num */
+    ossl_result = BN_hex2bn(&ossl_private_key_bn, private_key);
+    if(ossl_result == 0) {
+        return_value = T_COSE_ERR_SIG_FAIL;
+        goto Done;
+    }
+
+    /* Now associate the big num with the key object so we finally
+     * have a key set up and ready for signing. This copies the big
+     * num. */
+    ossl_result = EC_KEY_set_private_key(ossl_ec_key, ossl_private_key_bn);
+    if (!ossl_result) {
+        return_value = T_COSE_ERR_SIG_FAIL;
+        goto Done;
+    }
+
+
+    /* Make an empty EC point into which the public key gets loaded */
+    ossl_pub_key_point = EC_POINT_new(ossl_ec_group);
+    if(ossl_pub_key_point == NULL) {
+        return_value = T_COSE_ERR_INSUFFICIENT_MEMORY;
+        goto Done;
+    }
+
+    /* Turn the serialized public key into an EC point. It is
+     * decoded into ossl_pub_key_point. The return value is not
+     * assigned to it so the point is not lost on failure. */
+    if(EC_POINT_hex2point(ossl_ec_group,
+                          public_key,
+                          ossl_pub_key_point,
+                          NULL) == NULL) {
+        return_value = T_COSE_ERR_SIG_FAIL;
+        goto Done;
+    }
+
+    /* Associate the EC point with key object. This copies the
+     * point. */
+    /* The key object has both the public and private keys in it */
+    ossl_result = EC_KEY_set_public_key(ossl_ec_key, ossl_pub_key_point);
+    if(ossl_result == 0) {
+        return_value = T_COSE_ERR_SIG_FAIL;
+        goto Done;
+    }
+
+    key_pair->k.key_ptr  = ossl_ec_key;
+    key_pair->crypto_lib = T_COSE_CRYPTO_LIB_OPENSSL;
+    ossl_ec_key          = NULL; /* Now owned by key_pair */
+    return_value         = T_COSE_SUCCESS;
+
+Done:
+    /* The key object has copies of all of these. All of the free
+     * functions do nothing with NULL. */
+    EC_KEY_free(ossl_ec_key);
+    EC_POINT_free(ossl_pub_key_point);
+    BN_clear_free(ossl_private_key_bn);
+    EC_GROUP_free(ossl_ec_group);
+    return return_value;
+}
+
+
+/**
+ * \brief  Free an OpenSSL key.
+ *
+ * \param[in] key_pair   The key pair to close / deallocate / free.
+ */
+void free_ossl_ecdsa_key_pair(struct t_cose_key key_pair)
+{
+    EC_KEY_free(key_pair.k.key_ptr);
+}
+
+
+/*
+ * Public function. See tdv_keys.h
+ */
+enum t_cose_err_t make_ecdsa_key_pair(int32_t            cose_algorithm_id,
+                                      struct t_cose_key *key_pair)
+{
+    return make_ossl_ecdsa_key_pair(cose_algorithm_id, key_pair);
+}
+
+
+/*
+ * Public function. See tdv_keys.h
+ */
+enum t_cose_err_t make_ecdsa_key_from_raw(int32_t                cose_algorithm_id,
+                                          struct q_useful_buf_c  private_key,
+                                          struct q_useful_buf_c  public_key,
+                                          struct t_cose_key     *key_pair)
+{
+    EC_KEY            *ossl_ec_key = NULL;
+    const EC_GROUP    *ossl_ec_group;
+    BIGNUM            *ossl_private_key_bn = NULL;
+    EC_POINT          *ossl_pub_key_point = NULL;
+    enum t_cose_err_t  return_value;
+    int                nid;
+
+    switch (cose_algorithm_id) {
+    case T_COSE_ALGORITHM_ES256: nid = NID_X9_62_prime256v1; break;
+    case T_COSE_ALGORITHM_ES384: nid = NID_secp384r1;        break;
+    case T_COSE_ALGORITHM_ES512: nid = NID_secp521r1;        break;
+    default:
+        return T_COSE_ERR_UNSUPPORTED_SIGNING_ALG;
+    }
+
+    if(q_useful_buf_c_is_null(private_key) && q_useful_buf_c_is_null(public_key)) {
+        return T_COSE_ERR_EMPTY_KEY;
+    }
+
+    /* The key object owns the group so it doesn't have to be freed
+     * separately */
+    ossl_ec_key = EC_KEY_new_by_curve_name(nid);
+    if(ossl_ec_key == NULL) {
+        return_value = T_COSE_ERR_INSUFFICIENT_MEMORY;
+        goto Done;
+    }
+    ossl_ec_group = EC_KEY_get0_group(ossl_ec_key);
+
+    if(!q_useful_buf_c_is_null(private_key)) {
+        ossl_private_key_bn = BN_bin2bn(private_key.ptr, (int)private_key.len, NULL);
+        if(ossl_private_key_bn == NULL) {
+            return_value = T_COSE_ERR_INSUFFICIENT_MEMORY;
+            goto Done;
+        }
+        if(!EC_KEY_set_private_key(ossl_ec_key, ossl_private_key_bn)) {
+            return_value = T_COSE_ERR_SIG_FAIL;
+            goto Done;
+        }
+    }
+
+    ossl_pub_key_point = EC_POINT_new(ossl_ec_group);
+    if(ossl_pub_key_point == NULL) {
+        return_value = T_COSE_ERR_INSUFFICIENT_MEMORY;
+        goto Done;
+    }
+    if(!q_useful_buf_c_is_null(public_key)) {
+        if(!EC_POINT_oct2point(ossl_ec_group, ossl_pub_key_point, public_key.ptr, public_key.len, NULL)) {
+            return_value = T_COSE_ERR_SIG_FAIL;
+            goto Done;
+        }
+    } else {
+        /* The public key is the private key times the generator */
+        if(!EC_POINT_mul(ossl_ec_group, ossl_pub_key_point, ossl_private_key_bn, NULL, NULL, NULL)) {
+            return_value = T_COSE_ERR_SIG_FAIL;
+            goto Done;
+        }
+    }
+    /* This copies the point */
+    if(!EC_KEY_set_public_key(ossl_ec_key, ossl_pub_key_point)) {
+        return_value = T_COSE_ERR_SIG_FAIL;
+        goto Done;
+    }
+
+    key_pair->k.key_ptr  = ossl_ec_key;
+    key_pair->crypto_lib = T_COSE_CRYPTO_LIB_OPENSSL;
+    ossl_ec_key          = NULL;
+    return_value         = T_COSE_SUCCESS;
+
+Done:
+    EC_KEY_free(ossl_ec_key);
+    EC_POINT_free(ossl_pub_key_point);
+    BN_clear_free(ossl_private_key_bn);
+    return return_value;
+}
+
+
+/*
+ * Public function. See tdv_keys.h
+ */
+void free_ecdsa_key_pair(struct t_cose_key key_pair)
+{
+    free_ossl_ecdsa_key_pair(key_pair);
+}
+
+
+#if TDV_OSSL3
+/*
+ * Public function. See tdv_ossl3.h
+ */
+enum t_cose_err_t make_evp_ecdsa_key_pair(OSSL_LIB_CTX  *lib_ctx,
+                                          int32_t        cose_algorithm_id,
+                                          EVP_PKEY     **key_pair)
+{
+    enum t_cose_err_t  return_value;
+    const char        *group_name;
+    const char        *public_key_hex;
+    const char        *private_key_hex;
+    BIGNUM            *private_key_bn = NULL;
+    unsigned char     *public_key = NULL;
+    long               public_key_len;
+    OSSL_PARAM_BLD    *param_bld = NULL;
+    OSSL_PARAM        *params = NULL;
+    EVP_PKEY_CTX      *pkey_ctx = NULL;
+
+    switch (cose_algorithm_id) {
+    case T_COSE_ALGORITHM_ES256:
+        group_name      = SN_X9_62_prime256v1;
+        public_key_hex  = PUBLIC_KEY_prime256v1;
+        private_key_hex = PRIVATE_KEY_prime256v1;
+        break;
+
+    case T_COSE_ALGORITHM_ES384:
+        group_name      = SN_secp384r1;
+        public_key_hex  = PUBLIC_KEY_secp384r1;
+        private_key_hex = PRIVATE_KEY_secp384r1;
+        break;
+
+    case T_COSE_ALGORITHM_ES512:
+        group_name      = SN_secp521r1;
+        public_key_hex  = PUBLIC_KEY_secp521r1;
+        private_key_hex = PRIVATE_KEY_secp521r1;
+        break;
+
+    default:
+        return T_COSE_ERR_UNSUPPORTED_SIGNING_ALG;
+    }
+
+    /* The same hard coded keys as make_ossl_ecdsa_key_pair(), but
+     * given to the provider as parameters instead of being set into
+     * an EC_KEY */
+    if(!BN_hex2bn(&private_key_bn, private_key_hex)) {
+        return_value = T_COSE_ERR_INSUFFICIENT_MEMORY;
+        goto Done;
+    }
+    public_key = OPENSSL_hexstr2buf(public_key_hex, &public_key_len);
+    if(public_key == NULL) {
+        return_value = T_COSE_ERR_INSUFFICIENT_MEMORY;
+        goto Done;
+    }
+
+    param_bld = OSSL_PARAM_BLD_new();
+    if(param_bld == NULL) {
+        return_value = T_COSE_ERR_INSUFFICIENT_MEMORY;
+        goto Done;
+    }
+    if(!OSSL_PARAM_BLD_push_utf8_string(param_bld, OSSL_PKEY_PARAM_GROUP_NAME, group_name, 0) ||
+       !OSSL_PARAM_BLD_push_BN(param_bld, OSSL_PKEY_PARAM_PRIV_KEY, private_key_bn) ||
+       !OSSL_PARAM_BLD_push_octet_string(param_bld, OSSL_PKEY_PARAM_PUB_KEY, public_key, (size_t)public_key_len)) {
+        return_value = T_COSE_ERR_INSUFFICIENT_MEMORY;
+        goto Done;
+    }
+    params = OSSL_PARAM_BLD_to_param(param_bld);
+    if(params == NULL) {
+        return_value = T_COSE_ERR_INSUFFICIENT_MEMORY;
+        goto Done;
+    }
+
+    pkey_ctx = EVP_PKEY_CTX_new_from_name(lib_ctx, "EC", NULL);
+    if(pkey_ctx == NULL) {
+        return_value = T_COSE_ERR_INSUFFICIENT_MEMORY;
+        goto Done;
+    }
+    *key_pair = NULL;
+    if(EVP_PKEY_fromdata_init(pkey_ctx) <= 0 ||
+       EVP_PKEY_fromdata(pkey_ctx, key_pair, EVP_PKEY_KEYPAIR, params) <= 0) {
+        return_value = T_COSE_ERR_SIG_FAIL;
+        goto Done;
+    }
+
+    return_value = T_COSE_SUCCESS;
+
+Done:
+    EVP_PKEY_CTX_free(pkey_ctx);
+    OSSL_PARAM_free(params);
+    OSSL_PARAM_BLD_free(param_bld);
+    OPENSSL_free(public_key);
+    BN_clear_free(private_key_bn);
+    return return_value;
+}
+#endif /* TDV_OSSL3 */
+
+
+/*
+ * Public function. See tdv_keys.h
+ */
+const char *tdv_crypto_lib_name(void)
+{
+    return "OpenSSL";
+}
+
+
+/*
+ * Public function. See tdv_keys.h
+ */
+int tdv_crypto_keys_in_use(void)
+{
+    return -1;
+}
@@ -0,0 +1,707 @@
+/*
+ * tdv_keystore.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+/* For open(), mmap() and such */
+#define _POSIX_C_SOURCE 200809L
+
+#include "tdv_keystore.h"
+#include "tdv_keys.h"
+
+#include "t_cose/q_useful_buf.h"
+#include "qcbor/qcbor_spiffy_decode.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+
+/**
+ * \file tdv_keystore.c
+ *
+ * \brief Implementation of tdv_keystore.h.
+ *
+ * The PEM, DER and COSE_Key formats are decoded here into the raw
+ * private and public key, then made into a key by
+ * make_ecdsa_key_from_raw() in tdv_keys_xxx.c. Decoding here rather
+ * than with the crypto library's parsers keeps this the same for
+ * OpenSSL and PSA. The DER decoding is only what is needed for EC
+ * keys, not a general ASN.1 decoder.
+ */
+
+
+/* Largest private key, P-521 */
+#define MAX_PRIVATE_KEY_SIZE 66
+
+/* Largest uncompressed public key, 0x04 || x || y for P-521 */
+#define MAX_PUBLIC_KEY_SIZE  (1 + 2 * MAX_PRIVATE_KEY_SIZE)
+
+
+/* A key decoded from one of the formats. The buffers point into the
+ * encoded key. */
+struct raw_key {
+    int32_t               cose_algorithm_id;
+    struct q_useful_buf_c private_key;
+    struct q_useful_buf_c public_key;
+    /* The kid from a COSE_Key, or NULL_Q_USEFUL_BUF_C */
+    struct q_useful_buf_c kid;
+};
+
+
+/* Size of the private key and of each of x and y */
+static size_t curve_size(int32_t cose_algorithm_id)
+{
+    switch(cose_algorithm_id) {
+    case T_COSE_ALGORITHM_ES256: return 32;
+    case T_COSE_ALGORITHM_ES384: return 48;
+    case T_COSE_ALGORITHM_ES512: return 66;
+    default:                     return 0;
+    }
+}
+
+
+
+
+/* ------   DER   ------ */
+
+#define DER_INTEGER       0x02
+#define DER_BIT_STRING    0x03
+#define DER_OCTET_STRING  0x04
+#define DER_OID           0x06
+#define DER_SEQUENCE      0x30
+#define DER_CONTEXT_0     0xa0
+#define DER_CONTEXT_1     0xa1
+
+
+/* Contents of the OIDs, without the tag and length */
+static const uint8_t oid_ec_public_key[] = {0x2a, 0x86, 0x48, 0xce, 0x3d, 0x02, 0x01};
+static const uint8_t oid_prime256v1[]    = {0x2a, 0x86, 0x48, 0xce, 0x3d, 0x03, 0x01, 0x07};
+static const uint8_t oid_secp384r1[]     = {0x2b, 0x81, 0x04, 0x00, 0x22};
+static const uint8_t oid_secp521r1[]     = {0x2b, 0x81, 0x04, 0x00, 0x23};
+
+
+/*
+ * Get the next item from der. It must have the given tag. der is
+ * advanced past it and its content returned. Returns non-zero if it
+ * is not there or the length is wrong.
+ */
+static int der_next(struct q_useful_buf_c *der, uint8_t tag, struct q_useful_buf_c *content)
+{
+    const uint8_t *p = der->ptr;
+    size_t         len = der->len;
+    size_t         item_len;
+    size_t         num_len_bytes;
+
+    if(len < 2 || p[0] != tag) {
+        return 1;
+    }
+    item_len = p[1];
+    p   += 2;
+    len -= 2;
+
+    if(item_len & 0x80) {
+        /* Long form. Keys never need more than 4 length bytes. */
+        num_len_bytes = item_len & 0x7f;
+        if(num_len_bytes == 0 || num_len_bytes > 4 || num_len_bytes > len) {
+            return 1;
+        }
+        item_len = 0;
+        while(num_len_bytes--) {
+            item_len = (item_len << 8) | *p++;
+            len--;
+        }
+    }
+    if(item_len > len) {
+        return 1;
+    }
+
+    content->ptr = p;
+    content->len = item_len;
+    der->ptr     = p + item_len;
+    der->len     = len - item_len;
+    return 0;
+}
+
+
+static int oid_is(struct q_useful_buf_c oid, const uint8_t *expected, size_t expected_len)
+{
+    return oid.len == expected_len && !memcmp(oid.ptr, expected, expected_len);
+}
+
+
+static int32_t alg_from_curve_oid(struct q_useful_buf_c oid)
+{
+    if(oid_is(oid, oid_prime256v1, sizeof(oid_prime256v1))) {
+        return T_COSE_ALGORITHM_ES256;
+    }
+    if(oid_is(oid, oid_secp384r1, sizeof(oid_secp384r1))) {
+        return T_COSE_ALGORITHM_ES384;
+    }
+    if(oid_is(oid, oid_secp521r1, sizeof(oid_secp521r1))) {
+        return T_COSE_ALGORITHM_ES512;
+    }
+    return 0;
+}
+
+
+/*
+ * The AlgorithmIdentifier in PKCS#8 and SubjectPublicKeyInfo,
+ * SEQUENCE { OID ecPublicKey, OID curve }
+ */
+static int der_ec_algorithm(struct q_useful_buf_c *der, struct raw_key *key)
+{
+    struct q_useful_buf_c alg_id;
+    struct q_useful_buf_c oid;
+
+    if(der_next(der, DER_SEQUENCE, &alg_id) ||
+       der_next(&alg_id, DER_OID, &oid) ||
+       !oid_is(oid, oid_ec_public_key, sizeof(oid_ec_public_key)) ||
+       der_next(&alg_id, DER_OID, &oid)) {
+        return 1;
+    }
+    key->cose_algorithm_id = alg_from_curve_oid(oid);
+    return key->cose_algorithm_id == 0;
+}
+
+
+/* The content of a BIT STRING holding a key starts with 0 unused bits */
+static int der_public_key(struct q_useful_buf_c bits, struct raw_key *key)
+{
+    if(bits.len < 2 || *(const uint8_t *)bits.ptr != 0) {
+        return 1;
+    }
+    key->public_key.ptr = (const uint8_t *)bits.ptr + 1;
+    key->public_key.len = bits.len - 1;
+    return 0;
+}
+
+
+/*
+ * SEC1 / RFC 5915 ECPrivateKey, the content of the outer SEQUENCE
+ * after the version.
+ *
+ *    privateKey OCTET STRING,
+ *    parameters [0] OID OPTIONAL,
+ *    publicKey  [1] BIT STRING OPTIONAL
+ *
+ * In PKCS#8 the curve is in the outer structure so parameters is
+ * usually absent.
+ */
+static int der_sec1_after_version(struct q_useful_buf_c der, struct raw_key *key)
+{
+    struct q_useful_buf_c tagged;
+    struct q_useful_buf_c item;
+
+    if(der_next(&der, DER_OCTET_STRING, &key->private_key)) {
+        return 1;
+    }
+    if(!der_next(&der, DER_CONTEXT_0, &tagged)) {
+        if(der_next(&tagged, DER_OID, &item)) {
+            return 1;
+        }
+        key->cose_algorithm_id = alg_from_curve_oid(item);
+    }
+    if(!der_next(&der, DER_CONTEXT_1, &tagged)) {
+        if(der_next(&tagged, DER_BIT_STRING, &item) || der_public_key(item, key)) {
+            return 1;
+        }
+    }
+    return key->cose_algorithm_id == 0;
+}
+
+
+static int decode_der(struct q_useful_buf_c der, struct raw_key *key)
+{
+    struct q_useful_buf_c outer;
+    struct q_useful_buf_c item;
+    struct q_useful_buf_c inner;
+
+    if(der_next(&der, DER_SEQUENCE, &outer)) {
+        return 1;
+    }
+
+    if(!der_next(&outer, DER_INTEGER, &item)) {
+        if(item.len != 1) {
+            return 1;
+        }
+        if(*(const uint8_t *)item.ptr == 1) {
+            /* SEC1 ECPrivateKey, version 1 */
+            return der_sec1_after_version(outer, key);
+        }
+        if(*(const uint8_t *)item.ptr == 0) {
+            /* PKCS#8 PrivateKeyInfo, version 0, with an ECPrivateKey
+             * in the OCTET STRING */
+            if(der_ec_algorithm(&outer, key) ||
+               der_next(&outer, DER_OCTET_STRING, &item) ||
+               der_next(&item, DER_SEQUENCE, &inner) ||
+               der_next(&inner, DER_INTEGER, &item) ||
+               item.len != 1 || *(const uint8_t *)item.ptr != 1) {
+                return 1;
+            }
+            return der_sec1_after_version(inner, key);
+        }
+        return 1;
+    }
+
+    /* SubjectPublicKeyInfo */
+    if(der_ec_algorithm(&outer, key) || der_next(&outer, DER_BIT_STRING, &item)) {
+        return 1;
+    }
+    return der_public_key(item, key);
+}
+
+
+
+
+/* ------   PEM   ------ */
+
+static int base64_value(uint8_t c)
+{
+    if(c >= 'A' && c <= 'Z') return c - 'A';
+    if(c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if(c >= '0' && c <= '9') return c - '0' + 52;
+    if(c == '+') return 62;
+    if(c == '/') return 63;
+    return -1;
+}
+
+
+/* Whether the line contains the string */
+static int line_has(const char *line, const char *line_end, const char *str)
+{
+    size_t len = strlen(str);
+
+    for(; (size_t)(line_end - line) >= len; line++) {
+        if(!memcmp(line, str, len)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+/*
+ * Find the key in PEM and base64 decode it into der_buffer. Blocks
+ * other than keys, like the "EC PARAMETERS" openssl ecparam puts
+ * first, are skipped.
+ */
+static int decode_pem(struct q_useful_buf_c pem, struct q_useful_buf der_buffer, struct q_useful_buf_c *der)
+{
+    const char *p   = pem.ptr;
+    const char *end = p + pem.len;
+    const char *line_end;
+    uint32_t    bits;
+    int         num_bits;
+    int         value;
+    size_t      len;
+
+    while(1) {
+        /* Find the next BEGIN line */
+        while(p < end && (size_t)(end - p) >= 11 && memcmp(p, "-----BEGIN ", 11)) {
+            p++;
+        }
+        if((size_t)(end - p) < 11) {
+            return 1;
+        }
+        line_end = memchr(p, '\n', (size_t)(end - p));
+        if(line_end == NULL) {
+            return 1;
+        }
+        if(line_has(p, line_end, "KEY-----")) {
+            break;
+        }
+        p = line_end;
+    }
+    if(line_has(p, line_end, "ENCRYPTED")) {
+        return 1;
+    }
+    p = line_end + 1;
+
+    len      = 0;
+    bits     = 0;
+    num_bits = 0;
+    for(; p < end && *p != '-' && *p != '='; p++) {
+        value = base64_value((uint8_t)*p);
+        if(value < 0) {
+            /* Line breaks and such */
+            continue;
+        }
+        bits = (bits << 6) | (uint32_t)value;
+        num_bits += 6;
+        if(num_bits >= 8) {
+            num_bits -= 8;
+            if(len >= der_buffer.len) {
+                return 1;
+            }
+            ((uint8_t *)der_buffer.ptr)[len++] = (uint8_t)(bits >> num_bits);
+        }
+    }
+
+    der->ptr = der_buffer.ptr;
+    der->len = len;
+    return 0;
+}
+
+
+
+
+/* ------   COSE_Key   ------ */
+
+#define COSE_KEY_KTY      1
+#define COSE_KEY_KID      2
+#define COSE_KEY_CRV     -1
+#define COSE_KEY_X       -2
+#define COSE_KEY_Y       -3
+#define COSE_KEY_D       -4
+
+#define COSE_KTY_EC2      2
+#define COSE_CRV_P256     1
+#define COSE_CRV_P384     2
+#define COSE_CRV_P521     3
+
+
+/*
+ * Decode an EC2 COSE_Key. The public key is put together from x and y
+ * into public_key_buffer.
+ */
+static int decode_cose_key(struct q_useful_buf_c  cose_key,
+                           struct q_useful_buf    public_key_buffer,
+                           struct raw_key        *key)
+{
+    QCBORDecodeContext decode_context;
+    QCBORItem          items[7];
+    size_t             size;
+    size_t             i;
+    uint8_t           *public_key;
+
+    enum {KTY, KID, CRV, X, Y, D, END};
+    static const int64_t labels[] = {COSE_KEY_KTY, COSE_KEY_KID, COSE_KEY_CRV, COSE_KEY_X, COSE_KEY_Y, COSE_KEY_D};
+
+    for(i = 0; i < END; i++) {
+        items[i].uLabelType  = QCBOR_TYPE_INT64;
+        items[i].label.int64 = labels[i];
+        items[i].uDataType   = QCBOR_TYPE_ANY;
+    }
+    items[END].uLabelType = QCBOR_TYPE_NONE;
+
+    QCBORDecode_Init(&decode_context, cose_key, QCBOR_DECODE_MODE_NORMAL);
+    QCBORDecode_EnterMap(&decode_context, NULL);
+    QCBORDecode_GetItemsInMap(&decode_context, items);
+    QCBORDecode_ExitMap(&decode_context);
+    if(QCBORDecode_Finish(&decode_context)) {
+        return 1;
+    }
+
+    if(items[KTY].uDataType != QCBOR_TYPE_INT64 || items[KTY].val.int64 != COSE_KTY_EC2 ||
+       items[CRV].uDataType != QCBOR_TYPE_INT64) {
+        return 1;
+    }
+    switch(items[CRV].val.int64) {
+    case COSE_CRV_P256: key->cose_algorithm_id = T_COSE_ALGORITHM_ES256; break;
+    case COSE_CRV_P384: key->cose_algorithm_id = T_COSE_ALGORITHM_ES384; break;
+    case COSE_CRV_P521: key->cose_algorithm_id = T_COSE_ALGORITHM_ES512; break;
+    default:            return 1;
+    }
+    size = curve_size(key->cose_algorithm_id);
+
+    if(items[KID].uDataType == QCBOR_TYPE_BYTE_STRING) {
+        key->kid = items[KID].val.string;
+    }
+    if(items[D].uDataType == QCBOR_TYPE_BYTE_STRING) {
+        key->private_key = items[D].val.string;
+    }
+
+    /* A y that is a boolean is point compression, not supported */
+    if(items[X].uDataType == QCBOR_TYPE_BYTE_STRING &&
+       items[Y].uDataType == QCBOR_TYPE_BYTE_STRING) {
+        if(items[X].val.string.len != size || items[Y].val.string.len != size ||
+           public_key_buffer.len < 1 + 2 * size) {
+            return 1;
+        }
+        public_key = public_key_buffer.ptr;
+        public_key[0] = 0x04;
+        memcpy(public_key + 1, items[X].val.string.ptr, size);
+        memcpy(public_key + 1 + size, items[Y].val.string.ptr, size);
+        key->public_key.ptr = public_key;
+        key->public_key.len = 1 + 2 * size;
+    }
+
+    return q_useful_buf_c_is_null(key->private_key) && q_useful_buf_c_is_null(key->public_key);
+}
+
+
+
+
+/* ------   The store   ------ */
+
+/*
+ * Public function. See tdv_keystore.h
+ */
+void tdv_keystore_init(struct tdv_keystore *store)
+{
+    memset(store, 0, sizeof(*store));
+}
+
+
+static void set_name(struct tdv_keystore_entry *entry, const char *name, struct q_useful_buf_c kid)
+{
+    size_t i;
+
+    if(!q_useful_buf_c_is_null_or_empty(kid)) {
+        /* Use the kid as the name if it is printable */
+        for(i = 0; i < kid.len && i < TDV_KEYSTORE_MAX_NAME - 1; i++) {
+            if(((const uint8_t *)kid.ptr)[i] < 0x20 || ((const uint8_t *)kid.ptr)[i] > 0x7e) {
+                break;
+            }
+            entry->name[i] = ((const char *)kid.ptr)[i];
+        }
+        if(i == kid.len || i == TDV_KEYSTORE_MAX_NAME - 1) {
+            entry->name[i] = '\0';
+            return;
+        }
+    }
+    snprintf(entry->name, sizeof(entry->name), "%s", name);
+}
+
+
+/*
+ * Public function. See tdv_keystore.h
+ */
+enum t_cose_err_t tdv_keystore_add_encoded(struct tdv_keystore  *store,
+                                           const char           *name,
+                                           struct q_useful_buf_c encoded)
+{
+    struct raw_key             key;
+    struct tdv_keystore_entry *entry;
+    struct q_useful_buf        der_buffer;
+    struct q_useful_buf_c      der;
+    enum t_cose_err_t          return_value;
+    uint8_t                    first;
+    size_t                     size;
+    uint8_t                    private_key[MAX_PRIVATE_KEY_SIZE];
+    Q_USEFUL_BUF_MAKE_STACK_UB(public_key_buffer, MAX_PUBLIC_KEY_SIZE);
+
+    if(store->count >= TDV_KEYSTORE_MAX_KEYS) {
+        return T_COSE_ERR_INSUFFICIENT_MEMORY;
+    }
+    if(q_useful_buf_c_is_null_or_empty(encoded)) {
+        return T_COSE_ERR_WRONG_TYPE_OF_KEY;
+    }
+
+    memset(&key, 0, sizeof(key));
+    der_buffer = NULL_Q_USEFUL_BUF;
+    return_value = T_COSE_ERR_WRONG_TYPE_OF_KEY;
+
+    /* Tell the formats apart by the first byte. DER starts with a
+     * SEQUENCE. A COSE_Key starts with a CBOR map. */
+    first = *(const uint8_t *)encoded.ptr;
+    if(first == DER_SEQUENCE) {
+        if(decode_der(encoded, &key)) {
+            goto Done;
+        }
+    } else if((first & 0xe0) == 0xa0) {
+        if(decode_cose_key(encoded, public_key_buffer, &key)) {
+            goto Done;
+        }
+    } else {
+        /* PEM decodes to less than its size */
+        der_buffer.len = encoded.len;
+        der_buffer.ptr = malloc(der_buffer.len);
+        if(der_buffer.ptr == NULL) {
+            return_value = T_COSE_ERR_INSUFFICIENT_MEMORY;
+            goto Done;
+        }
+        if(decode_pem(encoded, der_buffer, &der) || decode_der(der, &key)) {
+            goto Done;
+        }
+    }
+
+    /* PSA needs the private key to be exactly the curve size. DER
+     * integers and some encoders drop leading zeros. */
+    size = curve_size(key.cose_algorithm_id);
+    if(!q_useful_buf_c_is_null(key.private_key)) {
+        if(key.private_key.len > size) {
+            goto Done;
+        }
+        memset(private_key, 0, size - key.private_key.len);
+        memcpy(private_key + size - key.private_key.len, key.private_key.ptr, key.private_key.len);
+        key.private_key.ptr = private_key;
+        key.private_key.len = size;
+    }
+
+    entry = &store->entries[store->count];
+    return_value = make_ecdsa_key_from_raw(key.cose_algorithm_id,
+                                           key.private_key,
+                                           key.public_key,
+                                           &entry->key);
+    if(return_value) {
+        goto Done;
+    }
+    entry->cose_algorithm_id = key.cose_algorithm_id;
+    entry->can_sign          = !q_useful_buf_c_is_null(key.private_key);
+    set_name(entry, name, key.kid);
+    store->count++;
+
+Done:
+    /* Don't leave private keys lying around */
+    memset(private_key, 0, sizeof(private_key));
+    if(der_buffer.ptr != NULL) {
+        memset(der_buffer.ptr, 0, der_buffer.len);
+        free(der_buffer.ptr);
+    }
+    return return_value;
+}
+
+
+/*
+ * Public function. See tdv_keystore.h
+ */
+enum t_cose_err_t tdv_keystore_add_file(struct tdv_keystore *store,
+                                        const char          *path,
+                                        uint32_t             options)
+{
+    int                   fd;
+    struct stat           file_stat;
+    void                 *contents;
+    ssize_t               n;
+    struct q_useful_buf_c encoded;
+    enum t_cose_err_t     return_value;
+
+    fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        return T_COSE_ERR_FAIL;
+    }
+    if(fstat(fd, &file_stat) || file_stat.st_size <= 0) {
+        close(fd);
+        return T_COSE_ERR_FAIL;
+    }
+
+    if(options & TDV_KEYSTORE_MMAP) {
+        contents = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(contents == MAP_FAILED) {
+            close(fd);
+            return T_COSE_ERR_FAIL;
+        }
+    } else {
+        contents = malloc((size_t)file_stat.st_size);
+        if(contents == NULL) {
+            close(fd);
+            return T_COSE_ERR_INSUFFICIENT_MEMORY;
+        }
+        n = read(fd, contents, (size_t)file_stat.st_size);
+        if(n != file_stat.st_size) {
+            free(contents);
+            close(fd);
+            return T_COSE_ERR_FAIL;
+        }
+    }
+    close(fd);
+
+    encoded.ptr = contents;
+    encoded.len = (size_t)file_stat.st_size;
+    return_value = tdv_keystore_add_encoded(store, path, encoded);
+
+    if(options & TDV_KEYSTORE_MMAP) {
+        munmap(contents, (size_t)file_stat.st_size);
+    } else {
+        memset(contents, 0, (size_t)file_stat.st_size);
+        free(contents);
+    }
+
+    return return_value;
+}
+
+
+static const int32_t builtin_algs[] = {
+    T_COSE_ALGORITHM_ES256,
+#ifndef T_COSE_DISABLE_ES384
+    T_COSE_ALGORITHM_ES384,
+#endif
+#ifndef T_COSE_DISABLE_ES512
+    T_COSE_ALGORITHM_ES512,
+#endif
+};
+
+
+/*
+ * Public function. See tdv_keystore.h
+ */
+enum t_cose_err_t tdv_keystore_add_builtin(struct tdv_keystore *store)
+{
+    struct tdv_keystore_entry *entry;
+    enum t_cose_err_t          return_value;
+    size_t                     i;
+
+    for(i = 0; i < sizeof(builtin_algs) / sizeof(builtin_algs[0]); i++) {
+        if(store->count >= TDV_KEYSTORE_MAX_KEYS) {
+            return T_COSE_ERR_INSUFFICIENT_MEMORY;
+        }
+        entry = &store->entries[store->count];
+        return_value = make_ecdsa_key_pair(builtin_algs[i], &entry->key);
+        if(return_value) {
+            return return_value;
+        }
+        entry->cose_algorithm_id = builtin_algs[i];
+        entry->can_sign          = 1;
+        snprintf(entry->name, sizeof(entry->name), "%s", TDV_KEYSTORE_BUILTIN);
+        store->count++;
+    }
+
+    return T_COSE_SUCCESS;
+}
+
+
+/*
+ * Public function. See tdv_keystore.h
+ */
+enum t_cose_err_t tdv_keystore_find(const struct tdv_keystore *store,
+                                    int32_t                    cose_algorithm_id,
+                                    const char                *name,
+                                    int                        must_sign,
+                                    struct t_cose_key         *key)
+{
+    const struct tdv_keystore_entry *entry;
+    size_t                           i;
+
+    for(i = 0; i < store->count; i++) {
+        entry = &store->entries[i];
+        if(entry->cose_algorithm_id != cose_algorithm_id) {
+            continue;
+        }
+        if(name != NULL && strcmp(entry->name, name)) {
+            continue;
+        }
+        if(must_sign && !entry->can_sign) {
+            continue;
+        }
+        *key = entry->key;
+        return T_COSE_SUCCESS;
+    }
+
+    return T_COSE_ERR_UNKNOWN_KEY;
+}
+
+
+/*
+ * Public function. See tdv_keystore.h
+ */
+void tdv_keystore_free(struct tdv_keystore *store)
+{
+    size_t i;
+
+    for(i = 0; i < store->count; i++) {
+        free_ecdsa_key_pair(store->entries[i].key);
+    }
+    tdv_keystore_init(store);
+}
@@ -0,0 +1,299 @@
+/*
+ * tdv_ossl3.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+
+/**
+ * \file tdv_ossl3.c
+ *
+ * \brief Implementation of tdv_ossl3.h.
+ *
+ * make_evp_ecdsa_key_pair() is in tdv_keys_ossl.c with the hard coded
+ * keys.
+ */
+
+#include "tdv_ossl3.h"
+
+#if TDV_OSSL3
+
+#include "openssl/ecdsa.h"
+#include "openssl/bn.h"
+
+
+/* Largest DER encoded ECDSA signature, for P-521 */
+#define DER_SIG_MAX 141
+
+
+/*
+ * Public function. See tdv_ossl3.h
+ */
+enum t_cose_err_t tdv_ossl3_algs_fetch(struct tdv_ossl3_algs *algs,
+                                       OSSL_LIB_CTX          *lib_ctx,
+                                       const char            *propq)
+{
+    algs->lib_ctx = lib_ctx;
+    algs->sha256  = EVP_MD_fetch(lib_ctx, "SHA2-256", propq);
+    algs->sha384  = EVP_MD_fetch(lib_ctx, "SHA2-384", propq);
+    algs->sha512  = EVP_MD_fetch(lib_ctx, "SHA2-512", propq);
+    algs->ecdsa   = EVP_SIGNATURE_fetch(lib_ctx, "ECDSA", propq);
+
+    if(algs->sha256 == NULL || algs->sha384 == NULL || algs->sha512 == NULL) {
+        tdv_ossl3_algs_free(algs);
+        return T_COSE_ERR_UNSUPPORTED_HASH;
+    }
+    if(algs->ecdsa == NULL) {
+        tdv_ossl3_algs_free(algs);
+        return T_COSE_ERR_UNSUPPORTED_SIGNING_ALG;
+    }
+
+    return T_COSE_SUCCESS;
+}
+
+
+/*
+ * Public function. See tdv_ossl3.h
+ */
+void tdv_ossl3_algs_free(struct tdv_ossl3_algs *algs)
+{
+    /* These all do nothing with NULL */
+    EVP_MD_free(algs->sha256);
+    EVP_MD_free(algs->sha384);
+    EVP_MD_free(algs->sha512);
+    EVP_SIGNATURE_free(algs->ecdsa);
+
+    algs->sha256 = NULL;
+    algs->sha384 = NULL;
+    algs->sha512 = NULL;
+    algs->ecdsa  = NULL;
+}
+
+
+/*
+ * The hash and the size of r and s for an algorithm. With algs NULL
+ * the legacy EVP_MD is returned. Using it makes OpenSSL 3 fetch the
+ * implementation each time.
+ */
+static const EVP_MD *hash_for_alg(const struct tdv_ossl3_algs *algs,
+                                  int32_t                      cose_algorithm_id,
+                                  size_t                      *coord_len)
+{
+    switch(cose_algorithm_id) {
+    case T_COSE_ALGORITHM_ES256:
+        *coord_len = 32;
+        return algs ? algs->sha256 : EVP_sha256();
+
+    case T_COSE_ALGORITHM_ES384:
+        *coord_len = 48;
+        return algs ? algs->sha384 : EVP_sha384();
+
+    case T_COSE_ALGORITHM_ES512:
+        *coord_len = 66;
+        return algs ? algs->sha512 : EVP_sha512();
+
+    default:
+        return NULL;
+    }
+}
+
+
+/*
+ * Make a signing or verifying context for the key with the ECDSA
+ * implementation set explicitly, or fetched implicitly if algs is
+ * NULL.
+ *
+ * Setting it explicitly needs OpenSSL 3.2. With 3.0 and 3.1 the
+ * signature is always fetched implicitly, but the hash is still
+ * pre-fetched.
+ */
+static EVP_PKEY_CTX *pkey_ctx_init(const struct tdv_ossl3_algs *algs,
+                                   EVP_PKEY                    *key_pair,
+                                   int                          for_sign)
+{
+    EVP_PKEY_CTX *pkey_ctx;
+    int           ossl_result;
+
+    pkey_ctx = EVP_PKEY_CTX_new_from_pkey(algs ? algs->lib_ctx : NULL, key_pair, NULL);
+    if(pkey_ctx == NULL) {
+        return NULL;
+    }
+
+#if OPENSSL_VERSION_NUMBER >= 0x30200000L
+    if(algs) {
+        ossl_result = for_sign ? EVP_PKEY_sign_init_ex2(pkey_ctx, algs->ecdsa, NULL)
+                               : EVP_PKEY_verify_init_ex2(pkey_ctx, algs->ecdsa, NULL);
+    } else
+#endif
+    {
+        ossl_result = for_sign ? EVP_PKEY_sign_init(pkey_ctx)
+                               : EVP_PKEY_verify_init(pkey_ctx);
+    }
+    if(ossl_result <= 0) {
+        EVP_PKEY_CTX_free(pkey_ctx);
+        return NULL;
+    }
+
+    return pkey_ctx;
+}
+
+
+/*
+ * Public function. See tdv_ossl3.h
+ */
+enum t_cose_err_t tdv_ossl3_sign(const struct tdv_ossl3_algs *algs,
+                                 EVP_PKEY                    *key_pair,
+                                 int32_t                      cose_algorithm_id,
+                                 struct q_useful_buf_c        tbs,
+                                 struct q_useful_buf          signature_buffer,
+                                 struct q_useful_buf_c       *signature)
+{
+    enum t_cose_err_t    return_value;
+    const EVP_MD        *md;
+    size_t               coord_len;
+    unsigned char        hash[EVP_MAX_MD_SIZE];
+    unsigned int         hash_len;
+    unsigned char        der_sig[DER_SIG_MAX];
+    size_t               der_sig_len;
+    const unsigned char *der_ptr;
+    EVP_PKEY_CTX        *pkey_ctx = NULL;
+    ECDSA_SIG           *ecdsa_sig = NULL;
+    const BIGNUM        *r;
+    const BIGNUM        *s;
+
+    md = hash_for_alg(algs, cose_algorithm_id, &coord_len);
+    if(md == NULL) {
+        return T_COSE_ERR_UNSUPPORTED_SIGNING_ALG;
+    }
+    if(signature_buffer.len < coord_len * 2) {
+        return T_COSE_ERR_SIG_BUFFER_SIZE;
+    }
+
+    if(!EVP_Digest(tbs.ptr, tbs.len, hash, &hash_len, md, NULL)) {
+        return T_COSE_ERR_HASH_GENERAL_FAIL;
+    }
+
+    pkey_ctx = pkey_ctx_init(algs, key_pair, 1);
+    if(pkey_ctx == NULL) {
+        return_value = T_COSE_ERR_SIG_FAIL;
+        goto Done;
+    }
+    der_sig_len = sizeof(der_sig);
+    if(EVP_PKEY_sign(pkey_ctx, der_sig, &der_sig_len, hash, hash_len) <= 0) {
+        return_value = T_COSE_ERR_SIG_FAIL;
+        goto Done;
+    }
+
+    /* The provider gives DER. COSE wants r and s each padded to the
+     * size of the curve and concatenated. */
+    der_ptr   = der_sig;
+    ecdsa_sig = d2i_ECDSA_SIG(NULL, &der_ptr, (long)der_sig_len);
+    if(ecdsa_sig == NULL) {
+        return_value = T_COSE_ERR_SIG_FAIL;
+        goto Done;
+    }
+    ECDSA_SIG_get0(ecdsa_sig, &r, &s);
+    if(BN_bn2binpad(r, signature_buffer.ptr, (int)coord_len) < 0 ||
+       BN_bn2binpad(s, (unsigned char *)signature_buffer.ptr + coord_len, (int)coord_len) < 0) {
+        return_value = T_COSE_ERR_SIG_FAIL;
+        goto Done;
+    }
+
+    signature->ptr = signature_buffer.ptr;
+    signature->len = coord_len * 2;
+    return_value   = T_COSE_SUCCESS;
+
+Done:
+    ECDSA_SIG_free(ecdsa_sig);
+    EVP_PKEY_CTX_free(pkey_ctx);
+    return return_value;
+}
+
+
+/*
+ * Public function. See tdv_ossl3.h
+ */
+enum t_cose_err_t tdv_ossl3_verify(const struct tdv_ossl3_algs *algs,
+                                   EVP_PKEY                    *key_pair,
+                                   int32_t                      cose_algorithm_id,
+                                   struct q_useful_buf_c        tbs,
+                                   struct q_useful_buf_c        signature)
+{
+    enum t_cose_err_t    return_value;
+    const EVP_MD        *md;
+    size_t               coord_len;
+    unsigned char        hash[EVP_MAX_MD_SIZE];
+    unsigned int         hash_len;
+    unsigned char        der_sig[DER_SIG_MAX];
+    unsigned char       *der_ptr;
+    int                  der_sig_len;
+    EVP_PKEY_CTX        *pkey_ctx = NULL;
+    ECDSA_SIG           *ecdsa_sig = NULL;
+    BIGNUM              *r = NULL;
+    BIGNUM              *s = NULL;
+    int                  ossl_result;
+
+    md = hash_for_alg(algs, cose_algorithm_id, &coord_len);
+    if(md == NULL) {
+        return T_COSE_ERR_UNSUPPORTED_SIGNING_ALG;
+    }
+    if(signature.len != coord_len * 2) {
+        return T_COSE_ERR_SIG_VERIFY;
+    }
+
+    if(!EVP_Digest(tbs.ptr, tbs.len, hash, &hash_len, md, NULL)) {
+        return T_COSE_ERR_HASH_GENERAL_FAIL;
+    }
+
+    /* COSE format to DER for the provider */
+    r = BN_bin2bn(signature.ptr, (int)coord_len, NULL);
+    s = BN_bin2bn((const unsigned char *)signature.ptr + coord_len, (int)coord_len, NULL);
+    ecdsa_sig = ECDSA_SIG_new();
+    if(r == NULL || s == NULL || ecdsa_sig == NULL) {
+        return_value = T_COSE_ERR_INSUFFICIENT_MEMORY;
+        goto Done;
+    }
+    if(!ECDSA_SIG_set0(ecdsa_sig, r, s)) {
+        return_value = T_COSE_ERR_SIG_FAIL;
+        goto Done;
+    }
+    /* ecdsa_sig owns them now */
+    r = NULL;
+    s = NULL;
+
+    /* The length first so the buffer can't be overrun */
+    der_sig_len = i2d_ECDSA_SIG(ecdsa_sig, NULL);
+    if(der_sig_len <= 0 || der_sig_len > (int)sizeof(der_sig)) {
+        return_value = T_COSE_ERR_SIG_FAIL;
+        goto Done;
+    }
+    der_ptr = der_sig;
+    i2d_ECDSA_SIG(ecdsa_sig, &der_ptr);
+
+    pkey_ctx = pkey_ctx_init(algs, key_pair, 0);
+    if(pkey_ctx == NULL) {
+        return_value = T_COSE_ERR_SIG_FAIL;
+        goto Done;
+    }
+    ossl_result = EVP_PKEY_verify(pkey_ctx, der_sig, (size_t)der_sig_len, hash, hash_len);
+    if(ossl_result == 1) {
+        return_value = T_COSE_SUCCESS;
+    } else if(ossl_result == 0) {
+        return_value = T_COSE_ERR_SIG_VERIFY;
+    } else {
+        return_value = T_COSE_ERR_SIG_FAIL;
+    }
+
+Done:
+    BN_free(r);
+    BN_free(s);
+    ECDSA_SIG_free(ecdsa_sig);
+    EVP_PKEY_CTX_free(pkey_ctx);
+    return return_value;
+}
+
+#endif /* TDV_OSSL3 */
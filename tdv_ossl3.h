@@ -0,0 +1,166 @@
+/*
+ * tdv_ossl3.h
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+#ifndef tdv_ossl3_h
+#define tdv_ossl3_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "t_cose/t_cose_common.h"
+#include "t_cose/q_useful_buf.h"
+
+#include "openssl/opensslv.h"
+
+
+/**
+ * \file tdv_ossl3.h
+ *
+ * \brief ECDSA with OpenSSL 3 EVP_PKEY keys and pre-fetched
+ *        algorithms.
+ *
+ * The OpenSSL crypto adapter in t_cose and the keys made by
+ * tdv_keys_ossl.c use the EC_KEY and ECDSA_do_sign() API that is
+ * deprecated in OpenSSL 3. There it goes through legacy shims, and
+ * EVP_sha256() and such cause an implicit fetch of the algorithm
+ * implementation on every use. An implicit fetch looks up the
+ * provider's algorithm store under a lock, which is what limits
+ * throughput on many cores.
+ *
+ * This is the same hash-then-sign and hash-then-verify that the
+ * adapter does for ES256, ES384 and ES512, but with EVP_PKEY keys and
+ * with the EVP_MD and EVP_SIGNATURE objects fetched once and reused.
+ * The input is the encoded Sig_structure, the to-be-signed bytes, and
+ * the signature is the COSE format, r and s concatenated.
+ *
+ * A struct tdv_ossl3_algs holds the fetched objects for one
+ * OSSL_LIB_CTX. Make one per library context at start up. After
+ * that it is only read so it can be shared by any number of
+ * threads. The keys are also only read so they can be shared too.
+ * Passing NULL instead of a struct tdv_ossl3_algs makes the sign and
+ * verify fetch implicitly on every call like legacy code does, which
+ * is only useful for comparison.
+ *
+ * Using the fetched EVP_SIGNATURE needs OpenSSL 3.2 or later for
+ * EVP_PKEY_sign_init_ex2(). Before that only the hash is pre-fetched.
+ * All of this needs OpenSSL 3.0 or later. With older OpenSSL
+ * \ref TDV_OSSL3 is 0 and nothing here is declared.
+ */
+
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#define TDV_OSSL3 1
+#else
+#define TDV_OSSL3 0
+#endif
+
+
+#if TDV_OSSL3
+
+#include "openssl/evp.h"
+
+
+struct tdv_ossl3_algs {
+    OSSL_LIB_CTX  *lib_ctx;
+    EVP_MD        *sha256;
+    EVP_MD        *sha384;
+    EVP_MD        *sha512;
+    EVP_SIGNATURE *ecdsa;
+};
+
+
+/**
+ * \brief Fetch the algorithms for a library context.
+ *
+ * \param[out] algs     The fetched algorithms.
+ * \param[in] lib_ctx   The library context or NULL for the default
+ *                      one.
+ * \param[in] propq     Property query, for example "provider=default",
+ *                      or NULL.
+ *
+ * \return \ref T_COSE_ERR_UNSUPPORTED_HASH or
+ *         \ref T_COSE_ERR_UNSUPPORTED_SIGNING_ALG if a provider
+ *         doesn't have one of them. Nothing is left allocated on
+ *         error.
+ */
+enum t_cose_err_t tdv_ossl3_algs_fetch(struct tdv_ossl3_algs *algs,
+                                       OSSL_LIB_CTX          *lib_ctx,
+                                       const char            *propq);
+
+
+/**
+ * \brief Free the fetched algorithms.
+ *
+ * \param[in,out] algs  The algorithms from tdv_ossl3_algs_fetch().
+ */
+void tdv_ossl3_algs_free(struct tdv_ossl3_algs *algs);
+
+
+/**
+ * \brief Make an EVP_PKEY for one of the fixed test keys.
+ *
+ * \param[in] lib_ctx            The library context or NULL.
+ * \param[in] cose_algorithm_id  \ref T_COSE_ALGORITHM_ES256,
+ *                               \ref T_COSE_ALGORITHM_ES384 or
+ *                               \ref T_COSE_ALGORITHM_ES512.
+ * \param[out] key_pair          The key. Free with EVP_PKEY_free().
+ *
+ * These are the same keys as make_ecdsa_key_pair() in
+ * tdv_keys_ossl.c makes. The key is made with EVP_PKEY_fromdata()
+ * so it belongs to a provider with no legacy EC_KEY behind it.
+ */
+enum t_cose_err_t make_evp_ecdsa_key_pair(OSSL_LIB_CTX  *lib_ctx,
+                                          int32_t        cose_algorithm_id,
+                                          EVP_PKEY     **key_pair);
+
+
+/**
+ * \brief Hash and sign.
+ *
+ * \param[in] algs               Fetched algorithms or NULL.
+ * \param[in] key_pair           Key from make_evp_ecdsa_key_pair().
+ * \param[in] cose_algorithm_id  Algorithm that picks the hash.
+ * \param[in] tbs                The bytes to sign.
+ * \param[in] signature_buffer   Where to put the signature.
+ * \param[out] signature         The COSE format signature.
+ *
+ * \return \ref T_COSE_ERR_SIG_BUFFER_SIZE if the buffer is too small
+ *         or \ref T_COSE_ERR_SIG_FAIL.
+ */
+enum t_cose_err_t tdv_ossl3_sign(const struct tdv_ossl3_algs *algs,
+                                 EVP_PKEY                    *key_pair,
+                                 int32_t                      cose_algorithm_id,
+                                 struct q_useful_buf_c        tbs,
+                                 struct q_useful_buf          signature_buffer,
+                                 struct q_useful_buf_c       *signature);
+
+
+/**
+ * \brief Hash and verify.
+ *
+ * \param[in] algs               Fetched algorithms or NULL.
+ * \param[in] key_pair           Key from make_evp_ecdsa_key_pair().
+ * \param[in] cose_algorithm_id  Algorithm that picks the hash.
+ * \param[in] tbs                The bytes that were signed.
+ * \param[in] signature          The COSE format signature.
+ *
+ * \return \ref T_COSE_ERR_SIG_VERIFY if the signature doesn't
+ *         verify.
+ */
+enum t_cose_err_t tdv_ossl3_verify(const struct tdv_ossl3_algs *algs,
+                                   EVP_PKEY                    *key_pair,
+                                   int32_t                      cose_algorithm_id,
+                                   struct q_useful_buf_c        tbs,
+                                   struct q_useful_buf_c        signature);
+
+#endif /* TDV_OSSL3 */
+
+
+#endif /* tdv_ossl3_h */
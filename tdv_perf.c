@@ -0,0 +1,185 @@
+/*
+ * tdv_perf.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+
+/**
+ * \file tdv_perf.c
+ *
+ * \brief Implementation of tdv_perf.h.
+ *
+ * glibc has no wrapper for perf_event_open() so it is called with
+ * syscall().
+ */
+
+/* For syscall() */
+#define _DEFAULT_SOURCE
+
+#include "tdv_perf.h"
+
+#include <stddef.h>
+
+#ifdef __linux__
+
+#include <linux/perf_event.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+
+/* The perf_event_attr type and config of each counter */
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} perf_events[TDV_PERF_NUM_COUNTERS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                         (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+};
+
+
+/*
+ * Public function. See tdv_perf.h
+ */
+int tdv_perf_open(struct tdv_perf *perf)
+{
+    struct perf_event_attr attr;
+    int                    opened;
+    int                    i;
+
+    opened = 0;
+    for(i = 0; i < TDV_PERF_NUM_COUNTERS; i++) {
+        memset(&attr, 0, sizeof(attr));
+        attr.size           = sizeof(attr);
+        attr.type           = perf_events[i].type;
+        attr.config         = perf_events[i].config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                              PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        /* This thread on any CPU, not in a group */
+        perf->fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if(perf->fds[i] >= 0) {
+            opened++;
+        } else {
+            perf->fds[i] = -1;
+        }
+    }
+
+    return opened;
+}
+
+
+/*
+ * Public function. See tdv_perf.h
+ */
+void tdv_perf_read(const struct tdv_perf *perf, struct tdv_perf_counts *counts)
+{
+    /* value, time enabled, time running */
+    uint64_t buf[3];
+    int      i;
+
+    for(i = 0; i < TDV_PERF_NUM_COUNTERS; i++) {
+        counts->value[i] = 0;
+        if(perf->fds[i] < 0 || read(perf->fds[i], buf, sizeof(buf)) != (ssize_t)sizeof(buf)) {
+            continue;
+        }
+        if(buf[2] == 0) {
+            /* Never got a turn on the CPU's counters */
+            continue;
+        }
+        if(buf[2] < buf[1]) {
+            /* Multiplexed; scale up to the whole time */
+            counts->value[i] = (uint64_t)((double)buf[0] * (double)buf[1] / (double)buf[2]);
+        } else {
+            counts->value[i] = buf[0];
+        }
+    }
+}
+
+
+/*
+ * Public function. See tdv_perf.h
+ */
+void tdv_perf_close(struct tdv_perf *perf)
+{
+    int i;
+
+    for(i = 0; i < TDV_PERF_NUM_COUNTERS; i++) {
+        if(perf->fds[i] >= 0) {
+            close(perf->fds[i]);
+        }
+        perf->fds[i] = -1;
+    }
+}
+
+#else /* __linux__ */
+
+/*
+ * Public function. See tdv_perf.h
+ */
+int tdv_perf_open(struct tdv_perf *perf)
+{
+    int i;
+
+    for(i = 0; i < TDV_PERF_NUM_COUNTERS; i++) {
+        perf->fds[i] = -1;
+    }
+    return 0;
+}
+
+
+/*
+ * Public function. See tdv_perf.h
+ */
+void tdv_perf_read(const struct tdv_perf *perf, struct tdv_perf_counts *counts)
+{
+    int i;
+
+    (void)perf;
+    for(i = 0; i < TDV_PERF_NUM_COUNTERS; i++) {
+        counts->value[i] = 0;
+    }
+}
+
+
+/*
+ * Public function. See tdv_perf.h
+ */
+void tdv_perf_close(struct tdv_perf *perf)
+{
+    (void)perf;
+}
+
+#endif /* __linux__ */
+
+
+/*
+ * Public function. See tdv_perf.h
+ */
+const char *tdv_perf_name(enum tdv_perf_counter counter)
+{
+    static const char *names[TDV_PERF_NUM_COUNTERS] = {
+        "cycles",
+        "instructions",
+        "branch-misses",
+        "L1d-misses",
+        "LLC-misses",
+    };
+
+    if((unsigned)counter >= TDV_PERF_NUM_COUNTERS) {
+        return "unknown";
+    }
+    return names[counter];
+}
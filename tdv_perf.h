@@ -0,0 +1,131 @@
+/*
+ * tdv_perf.h
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+#ifndef tdv_perf_h
+#define tdv_perf_h
+
+#include <stdint.h>
+
+
+/**
+ * \file tdv_perf.h
+ *
+ * \brief Read the CPU's hardware performance counters.
+ *
+ * Wall-clock time on a shared machine varies from run to run by more
+ * than most regressions. The number of instructions an operation
+ * takes hardly varies at all, so a change to libt_cose.a that adds
+ * instructions shows even when the time doesn't.
+ *
+ * This uses Linux perf_event_open(). Only user space is counted, so
+ * the counters work at the default perf_event_paranoid of 2 without
+ * privileges. Each counter is opened on its own rather than as a
+ * group so that one the CPU or a virtual machine doesn't have, often
+ * the cache counters, doesn't stop the others. When there are more
+ * counters than the CPU can count at once the kernel takes turns and
+ * the counts are scaled up to the whole time.
+ *
+ * The counters are for the calling thread only.
+ *
+ * On other than Linux tdv_perf_open() always fails.
+ */
+
+
+enum tdv_perf_counter {
+    TDV_PERF_CYCLES,
+    TDV_PERF_INSTRUCTIONS,
+    TDV_PERF_BRANCH_MISSES,
+    /* Level 1 data cache read misses */
+    TDV_PERF_L1D_MISSES,
+    /* Last level cache misses */
+    TDV_PERF_LLC_MISSES,
+    TDV_PERF_NUM_COUNTERS
+};
+
+
+/**
+ * The open counters. A file descriptor of -1 is one that can't be
+ * had on this machine.
+ */
+struct tdv_perf {
+    int fds[TDV_PERF_NUM_COUNTERS];
+};
+
+
+/**
+ * Counter values. These only go up. Take the difference of two to
+ * get the counts for what ran in between.
+ */
+struct tdv_perf_counts {
+    uint64_t value[TDV_PERF_NUM_COUNTERS];
+};
+
+
+/**
+ * \brief Open and start the counters for the calling thread.
+ *
+ * \param[out] perf  The counters.
+ *
+ * \return The number of counters opened. 0 if none could be, for
+ *         example because perf_event_paranoid is 3 or more, in a
+ *         container without perf events or not on Linux.
+ *
+ * tdv_perf_close() must be called even if this returns 0.
+ */
+int tdv_perf_open(struct tdv_perf *perf);
+
+
+/**
+ * \brief Whether a counter could be opened.
+ *
+ * \param[in] perf     The counters.
+ * \param[in] counter  The counter.
+ *
+ * \return Non-zero if the counter is being counted.
+ */
+static inline int tdv_perf_have(const struct tdv_perf *perf, enum tdv_perf_counter counter)
+{
+    return perf->fds[counter] >= 0;
+}
+
+
+/**
+ * \brief Read the counters.
+ *
+ * \param[in] perf     The counters.
+ * \param[out] counts  The values. Those of counters that couldn't be
+ *                     opened or read are 0.
+ *
+ * This is one read() system call per counter, a few microseconds in
+ * all. Read before and after a loop of operations rather than around
+ * each one.
+ */
+void tdv_perf_read(const struct tdv_perf *perf, struct tdv_perf_counts *counts);
+
+
+/**
+ * \brief Close the counters.
+ *
+ * \param[in] perf  The counters.
+ */
+void tdv_perf_close(struct tdv_perf *perf);
+
+
+/**
+ * \brief The name of a counter for printing.
+ *
+ * \param[in] counter  The counter.
+ *
+ * \return A short name like "cycles".
+ */
+const char *tdv_perf_name(enum tdv_perf_counter counter);
+
+
+#endif /* tdv_perf_h */
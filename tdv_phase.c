@@ -0,0 +1,182 @@
+/*
+ * tdv_phase.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+
+/**
+ * \file tdv_phase.c
+ *
+ * \brief Implementation of tdv_phase.h.
+ *
+ * The wrappers are named for the linker's --wrap option. With
+ * -Wl,--wrap=t_cose_crypto_sign a call to t_cose_crypto_sign() from
+ * another object file goes to __wrap_t_cose_crypto_sign() and
+ * __real_t_cose_crypto_sign() is the real one.
+ */
+
+/* For clock_gettime() */
+#define _POSIX_C_SOURCE 200809L
+
+#include "tdv_phase.h"
+
+#include <string.h>
+
+#ifdef TDV_PHASE_TIMING
+
+#include "t_cose_crypto.h"
+
+#include <time.h>
+
+
+static struct tdv_phase_times phase_times;
+
+/* When the hash in progress started */
+static uint64_t hash_start_ns;
+
+
+static inline uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+
+static inline void add_time(enum tdv_phase phase, uint64_t start_ns)
+{
+    phase_times.ns[phase] += now_ns() - start_ns;
+    phase_times.calls[phase]++;
+}
+
+
+/* The real adapter functions, resolved by --wrap */
+enum t_cose_err_t __real_t_cose_crypto_hash_start(struct t_cose_crypto_hash *hash_ctx,
+                                                  int32_t                    cose_hash_alg_id);
+
+enum t_cose_err_t __real_t_cose_crypto_hash_finish(struct t_cose_crypto_hash *hash_ctx,
+                                                   struct q_useful_buf        buffer_to_hold_result,
+                                                   struct q_useful_buf_c     *hash_result);
+
+enum t_cose_err_t __real_t_cose_crypto_sign(int32_t                cose_algorithm_id,
+                                            struct t_cose_key      signing_key,
+                                            struct q_useful_buf_c  hash_to_sign,
+                                            struct q_useful_buf    signature_buffer,
+                                            struct q_useful_buf_c *signature);
+
+enum t_cose_err_t __real_t_cose_crypto_verify(int32_t               cose_algorithm_id,
+                                              struct t_cose_key     verification_key,
+                                              struct q_useful_buf_c kid,
+                                              struct q_useful_buf_c hash_to_verify,
+                                              struct q_useful_buf_c signature);
+
+
+/* These are only called by the linker's redirection so they have no
+ * declaration in a header. */
+enum t_cose_err_t __wrap_t_cose_crypto_hash_start(struct t_cose_crypto_hash *hash_ctx,
+                                                  int32_t                    cose_hash_alg_id);
+
+enum t_cose_err_t __wrap_t_cose_crypto_hash_finish(struct t_cose_crypto_hash *hash_ctx,
+                                                   struct q_useful_buf        buffer_to_hold_result,
+                                                   struct q_useful_buf_c     *hash_result);
+
+enum t_cose_err_t __wrap_t_cose_crypto_sign(int32_t                cose_algorithm_id,
+                                            struct t_cose_key      signing_key,
+                                            struct q_useful_buf_c  hash_to_sign,
+                                            struct q_useful_buf    signature_buffer,
+                                            struct q_useful_buf_c *signature);
+
+enum t_cose_err_t __wrap_t_cose_crypto_verify(int32_t               cose_algorithm_id,
+                                              struct t_cose_key     verification_key,
+                                              struct q_useful_buf_c kid,
+                                              struct q_useful_buf_c hash_to_verify,
+                                              struct q_useful_buf_c signature);
+
+
+enum t_cose_err_t __wrap_t_cose_crypto_hash_start(struct t_cose_crypto_hash *hash_ctx,
+                                                  int32_t                    cose_hash_alg_id)
+{
+    hash_start_ns = now_ns();
+    return __real_t_cose_crypto_hash_start(hash_ctx, cose_hash_alg_id);
+}
+
+
+enum t_cose_err_t __wrap_t_cose_crypto_hash_finish(struct t_cose_crypto_hash *hash_ctx,
+                                                   struct q_useful_buf        buffer_to_hold_result,
+                                                   struct q_useful_buf_c     *hash_result)
+{
+    enum t_cose_err_t return_value;
+
+    return_value = __real_t_cose_crypto_hash_finish(hash_ctx, buffer_to_hold_result, hash_result);
+    add_time(TDV_PHASE_HASH, hash_start_ns);
+    return return_value;
+}
+
+
+enum t_cose_err_t __wrap_t_cose_crypto_sign(int32_t                cose_algorithm_id,
+                                            struct t_cose_key      signing_key,
+                                            struct q_useful_buf_c  hash_to_sign,
+                                            struct q_useful_buf    signature_buffer,
+                                            struct q_useful_buf_c *signature)
+{
+    enum t_cose_err_t return_value;
+    uint64_t          start_ns;
+
+    start_ns     = now_ns();
+    return_value = __real_t_cose_crypto_sign(cose_algorithm_id,
+                                             signing_key,
+                                             hash_to_sign,
+                                             signature_buffer,
+                                             signature);
+    add_time(TDV_PHASE_SIGN, start_ns);
+    return return_value;
+}
+
+
+enum t_cose_err_t __wrap_t_cose_crypto_verify(int32_t               cose_algorithm_id,
+                                              struct t_cose_key     verification_key,
+                                              struct q_useful_buf_c kid,
+                                              struct q_useful_buf_c hash_to_verify,
+                                              struct q_useful_buf_c signature)
+{
+    enum t_cose_err_t return_value;
+    uint64_t          start_ns;
+
+    start_ns     = now_ns();
+    return_value = __real_t_cose_crypto_verify(cose_algorithm_id,
+                                               verification_key,
+                                               kid,
+                                               hash_to_verify,
+                                               signature);
+    add_time(TDV_PHASE_VERIFY, start_ns);
+    return return_value;
+}
+
+
+/*
+ * Public function. See tdv_phase.h
+ */
+int tdv_phase_get(struct tdv_phase_times *times)
+{
+    *times = phase_times;
+    return 0;
+}
+
+#else /* TDV_PHASE_TIMING */
+
+/*
+ * Public function. See tdv_phase.h
+ */
+int tdv_phase_get(struct tdv_phase_times *times)
+{
+    memset(times, 0, sizeof(*times));
+    return -1;
+}
+
+#endif /* TDV_PHASE_TIMING */
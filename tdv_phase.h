@@ -0,0 +1,81 @@
+/*
+ * tdv_phase.h
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+#ifndef tdv_phase_h
+#define tdv_phase_h
+
+#include <stdint.h>
+
+
+/**
+ * \file tdv_phase.h
+ *
+ * \brief Time spent hashing and in the signature algorithm inside
+ *        t_cose.
+ *
+ * t_cose_sign1_encode_signature() and t_cose_sign1_verify() hash the
+ * Sig_structure and then sign or verify the hash. From outside t_cose
+ * only the total is visible. The split is had by timing the calls
+ * t_cose makes to its crypto adapter, t_cose_crypto.h.
+ *
+ * When built with TDV_PHASE_TIMING defined and linked with the
+ * linker's --wrap option for those functions, the calls go through
+ * timing wrappers in tdv_phase.c that then call the real adapter.
+ * Neither t_cose nor the crypto adapter is changed. Makefile.max and
+ * Makefile.min do both with "PHASE_TIMING=1". This needs the GNU or
+ * LLVM linker; the macOS linker has no --wrap.
+ *
+ * Without TDV_PHASE_TIMING nothing is wrapped and there is no cost.
+ * tdv_phase_get() is still there but returns an error.
+ *
+ * The hash time is from the entry of t_cose_crypto_hash_start() to
+ * the return of t_cose_crypto_hash_finish(). The updates are not
+ * wrapped so the clock is read only twice per hash. The few CBOR
+ * heads t_cose encodes between the updates are counted as hashing.
+ *
+ * The times are not locked, so they are only right when one thread
+ * is using t_cose.
+ */
+
+
+enum tdv_phase {
+    /* t_cose_crypto_hash_start() to t_cose_crypto_hash_finish() */
+    TDV_PHASE_HASH,
+    /* t_cose_crypto_sign() */
+    TDV_PHASE_SIGN,
+    /* t_cose_crypto_verify() */
+    TDV_PHASE_VERIFY,
+    TDV_NUM_PHASES
+};
+
+
+/**
+ * Time in each phase. These only go up. Take the difference of two
+ * to get the times for what ran in between.
+ */
+struct tdv_phase_times {
+    uint64_t ns[TDV_NUM_PHASES];
+    uint64_t calls[TDV_NUM_PHASES];
+};
+
+
+/**
+ * \brief Get the times so far.
+ *
+ * \param[out] times  The times. All zero if timing is not built in.
+ *
+ * \return 0 if the timing is built in, non-zero if not. If it is
+ *         built in but the program was not linked with --wrap the
+ *         times stay zero.
+ */
+int tdv_phase_get(struct tdv_phase_times *times);
+
+
+#endif /* tdv_phase_h */
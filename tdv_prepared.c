@@ -0,0 +1,421 @@
+/*
+ * tdv_prepared.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+
+/**
+ * \file tdv_prepared.c
+ *
+ * \brief Implementation of tdv_prepared.h.
+ *
+ * This is the same for every crypto library. Everything crypto
+ * library specific is behind t_cose_crypto.h and tdv_hash.h.
+ */
+
+#include "tdv_prepared.h"
+
+#include "tdv_hash.h"
+#include "t_cose_standard_constants.h"
+#include "t_cose_util.h"
+#include "qcbor/qcbor_spiffy_decode.h"
+
+
+/*
+ * Encode the protected header, {1: alg}, into a buffer of
+ * TDV_PREPARED_MAX_PROTECTED bytes.
+ */
+static enum t_cose_err_t encode_protected(int32_t                cose_algorithm_id,
+                                          uint8_t               *buffer,
+                                          struct q_useful_buf_c *protected_parameters)
+{
+    QCBOREncodeContext cbor_encode;
+
+    QCBOREncode_Init(&cbor_encode,
+                     (struct q_useful_buf){buffer, TDV_PREPARED_MAX_PROTECTED});
+    QCBOREncode_OpenMap(&cbor_encode);
+    QCBOREncode_AddInt64ToMapN(&cbor_encode, COSE_HEADER_PARAM_ALG, cose_algorithm_id);
+    QCBOREncode_CloseMap(&cbor_encode);
+    if(QCBOREncode_Finish(&cbor_encode, protected_parameters)) {
+        return T_COSE_ERR_MAKING_PROTECTED;
+    }
+
+    return T_COSE_SUCCESS;
+}
+
+
+/*
+ * Hash the CBOR head of a byte string in the Sig_structure. The
+ * content is hashed separately by the caller.
+ */
+static void hash_bstr_head(struct t_cose_crypto_hash *hash_ctx, uint64_t len)
+{
+    struct q_useful_buf_c head;
+    Q_USEFUL_BUF_MAKE_STACK_UB(head_buffer, QCBOR_HEAD_BUFFER_SIZE);
+
+    head = QCBOREncode_EncodeHead(head_buffer, CBOR_MAJOR_TYPE_BYTE_STRING, 0, len);
+    t_cose_crypto_hash_update(hash_ctx, head);
+}
+
+
+/*
+ * Start the hash of the Sig_structure and hash all of it up to the
+ * payload. The external AAD is always empty.
+ */
+static enum t_cose_err_t start_prefix_hash(struct t_cose_crypto_hash *hash_ctx,
+                                           int32_t                    hash_algorithm_id,
+                                           struct q_useful_buf_c      protected_parameters)
+{
+    enum t_cose_err_t return_value;
+
+    return_value = t_cose_crypto_hash_start(hash_ctx, hash_algorithm_id);
+    if(return_value) {
+        return return_value;
+    }
+
+    /* An array of 4, the 10 byte text string context, the protected
+     * header and an empty byte string for the AAD */
+    t_cose_crypto_hash_update(hash_ctx,
+                              Q_USEFUL_BUF_FROM_SZ_LITERAL("\x84\x6A" COSE_SIG_CONTEXT_STRING_SIGNATURE1));
+    hash_bstr_head(hash_ctx, protected_parameters.len);
+    t_cose_crypto_hash_update(hash_ctx, protected_parameters);
+    t_cose_crypto_hash_update(hash_ctx, Q_USEFUL_BUF_FROM_SZ_LITERAL("\x40"));
+
+    return T_COSE_SUCCESS;
+}
+
+
+/*
+ * Hash the Sig_structure for a payload by copying the prefix hash and
+ * adding the payload to it.
+ */
+static enum t_cose_err_t hash_sig_structure(const struct t_cose_crypto_hash *prefix_hash,
+                                            struct q_useful_buf_c            payload,
+                                            struct q_useful_buf              hash_buffer,
+                                            struct q_useful_buf_c           *hash)
+{
+    struct t_cose_crypto_hash hash_ctx;
+    enum t_cose_err_t         return_value;
+
+    return_value = tdv_hash_clone(prefix_hash, &hash_ctx);
+    if(return_value) {
+        return return_value;
+    }
+
+    hash_bstr_head(&hash_ctx, payload.len);
+    t_cose_crypto_hash_update(&hash_ctx, payload);
+
+    return t_cose_crypto_hash_finish(&hash_ctx, hash_buffer, hash);
+}
+
+
+/*
+ * Public function. See tdv_prepared.h
+ */
+enum t_cose_err_t tdv_prepared_signer_init(struct tdv_prepared_signer *signer,
+                                           uint32_t                    option_flags,
+                                           int32_t                     cose_algorithm_id,
+                                           struct t_cose_key           signing_key,
+                                           struct q_useful_buf_c       kid)
+{
+    QCBOREncodeContext cbor_encode;
+    enum t_cose_err_t  return_value;
+
+    if(option_flags & ~(uint32_t)T_COSE_OPT_OMIT_CBOR_TAG) {
+        return T_COSE_ERR_INVALID_ARGUMENT;
+    }
+    if(!q_useful_buf_c_is_null(kid) && kid.len > TDV_PREPARED_MAX_KID) {
+        return T_COSE_ERR_INVALID_ARGUMENT;
+    }
+
+    signer->hash_algorithm_id = hash_alg_id_from_sig_alg_id(cose_algorithm_id);
+    if(signer->hash_algorithm_id == T_COSE_INVALID_ALGORITHM_ID) {
+        return T_COSE_ERR_UNSUPPORTED_SIGNING_ALG;
+    }
+    signer->cose_algorithm_id = cose_algorithm_id;
+    signer->option_flags      = option_flags;
+    signer->signing_key       = signing_key;
+    signer->sign_fn           = NULL;
+    signer->sign_ctx          = NULL;
+
+    return_value = encode_protected(cose_algorithm_id,
+                                    signer->protected_buffer,
+                                    &signer->protected_parameters);
+    if(return_value) {
+        return return_value;
+    }
+
+    /* t_cose leaves out an empty kid too */
+    QCBOREncode_Init(&cbor_encode,
+                     (struct q_useful_buf){signer->unprotected_buffer,
+                                           sizeof(signer->unprotected_buffer)});
+    QCBOREncode_OpenMap(&cbor_encode);
+    if(!q_useful_buf_c_is_null_or_empty(kid)) {
+        QCBOREncode_AddBytesToMapN(&cbor_encode, COSE_HEADER_PARAM_KID, kid);
+    }
+    QCBOREncode_CloseMap(&cbor_encode);
+    if(QCBOREncode_Finish(&cbor_encode, &signer->unprotected_parameters)) {
+        return T_COSE_ERR_CBOR_FORMATTING;
+    }
+
+    return start_prefix_hash(&signer->prefix_hash,
+                             signer->hash_algorithm_id,
+                             signer->protected_parameters);
+}
+
+
+/*
+ * Public function. See tdv_prepared.h
+ */
+void tdv_prepared_set_sign_fn(struct tdv_prepared_signer *signer,
+                              tdv_prepared_sign_fn        sign_fn,
+                              void                       *sign_ctx)
+{
+    signer->sign_fn  = sign_fn;
+    signer->sign_ctx = sign_ctx;
+}
+
+
+/*
+ * Public function. See tdv_prepared.h
+ */
+enum t_cose_err_t tdv_prepared_encode_parameters(const struct tdv_prepared_signer *signer,
+                                                 QCBOREncodeContext               *cbor_encode)
+{
+    if(!(signer->option_flags & T_COSE_OPT_OMIT_CBOR_TAG)) {
+        QCBOREncode_AddTag(cbor_encode, CBOR_TAG_COSE_SIGN1);
+    }
+    QCBOREncode_OpenArray(cbor_encode);
+    QCBOREncode_AddBytes(cbor_encode, signer->protected_parameters);
+    /* One item, the map, already encoded */
+    QCBOREncode_AddEncoded(cbor_encode, signer->unprotected_parameters);
+    QCBOREncode_BstrWrap(cbor_encode);
+
+    return T_COSE_SUCCESS;
+}
+
+
+/*
+ * Public function. See tdv_prepared.h
+ */
+enum t_cose_err_t tdv_prepared_encode_hash(const struct tdv_prepared_signer *signer,
+                                           QCBOREncodeContext               *cbor_encode,
+                                           struct q_useful_buf               hash_buffer,
+                                           struct q_useful_buf_c            *hash)
+{
+    struct q_useful_buf_c payload;
+
+    /* The payload without its byte string head */
+    QCBOREncode_CloseBstrWrap2(cbor_encode, false, &payload);
+    if(QCBOREncode_GetErrorState(cbor_encode) != QCBOR_SUCCESS) {
+        return T_COSE_ERR_CBOR_FORMATTING;
+    }
+
+    return hash_sig_structure(&signer->prefix_hash, payload, hash_buffer, hash);
+}
+
+
+/*
+ * Public function. See tdv_prepared.h
+ */
+void tdv_prepared_add_signature(QCBOREncodeContext    *cbor_encode,
+                                struct q_useful_buf_c  signature)
+{
+    QCBOREncode_AddBytes(cbor_encode, signature);
+    QCBOREncode_CloseArray(cbor_encode);
+}
+
+
+/*
+ * Public function. See tdv_prepared.h
+ */
+enum t_cose_err_t tdv_prepared_encode_signature(const struct tdv_prepared_signer *signer,
+                                                QCBOREncodeContext               *cbor_encode)
+{
+    enum t_cose_err_t     return_value;
+    struct q_useful_buf_c hash;
+    struct q_useful_buf_c signature;
+    Q_USEFUL_BUF_MAKE_STACK_UB(hash_buffer, T_COSE_CRYPTO_MAX_HASH_SIZE);
+    Q_USEFUL_BUF_MAKE_STACK_UB(signature_buffer, T_COSE_MAX_SIG_SIZE);
+
+    return_value = tdv_prepared_encode_hash(signer, cbor_encode, hash_buffer, &hash);
+    if(return_value) {
+        return return_value;
+    }
+
+    if(signer->sign_fn != NULL) {
+        return_value = signer->sign_fn(signer->sign_ctx,
+                                       signer->cose_algorithm_id,
+                                       signer->signing_key,
+                                       hash,
+                                       signature_buffer,
+                                       &signature);
+    } else {
+        return_value = t_cose_crypto_sign(signer->cose_algorithm_id,
+                                          signer->signing_key,
+                                          hash,
+                                          signature_buffer,
+                                          &signature);
+    }
+    if(return_value) {
+        return return_value;
+    }
+
+    tdv_prepared_add_signature(cbor_encode, signature);
+
+    return T_COSE_SUCCESS;
+}
+
+
+/*
+ * Public function. See tdv_prepared.h
+ */
+enum t_cose_err_t tdv_prepared_sign(const struct tdv_prepared_signer *signer,
+                                    struct q_useful_buf_c             payload,
+                                    struct q_useful_buf               out_buf,
+                                    struct q_useful_buf_c            *cose_sign1)
+{
+    QCBOREncodeContext cbor_encode;
+    enum t_cose_err_t  return_value;
+
+    QCBOREncode_Init(&cbor_encode, out_buf);
+
+    tdv_prepared_encode_parameters(signer, &cbor_encode);
+    /* The payload bytes are the content of the byte string */
+    QCBOREncode_AddEncoded(&cbor_encode, payload);
+    return_value = tdv_prepared_encode_signature(signer, &cbor_encode);
+    if(return_value == T_COSE_ERR_CBOR_FORMATTING) {
+        return T_COSE_ERR_TOO_SMALL;
+    }
+    if(return_value) {
+        return return_value;
+    }
+
+    if(QCBOREncode_Finish(&cbor_encode, cose_sign1)) {
+        return T_COSE_ERR_TOO_SMALL;
+    }
+
+    return T_COSE_SUCCESS;
+}
+
+
+/*
+ * Public function. See tdv_prepared.h
+ */
+void tdv_prepared_signer_free(struct tdv_prepared_signer *signer)
+{
+    tdv_hash_free(&signer->prefix_hash);
+}
+
+
+/*
+ * Public function. See tdv_prepared.h
+ */
+enum t_cose_err_t tdv_prepared_verifier_init(struct tdv_prepared_verifier *verifier,
+                                             int32_t                       cose_algorithm_id,
+                                             struct t_cose_key             verification_key)
+{
+    enum t_cose_err_t return_value;
+
+    verifier->hash_algorithm_id = hash_alg_id_from_sig_alg_id(cose_algorithm_id);
+    if(verifier->hash_algorithm_id == T_COSE_INVALID_ALGORITHM_ID) {
+        return T_COSE_ERR_UNSUPPORTED_SIGNING_ALG;
+    }
+    verifier->cose_algorithm_id = cose_algorithm_id;
+    verifier->verification_key  = verification_key;
+
+    return_value = encode_protected(cose_algorithm_id,
+                                    verifier->protected_buffer,
+                                    &verifier->protected_parameters);
+    if(return_value) {
+        return return_value;
+    }
+
+    return start_prefix_hash(&verifier->prefix_hash,
+                             verifier->hash_algorithm_id,
+                             verifier->protected_parameters);
+}
+
+
+/*
+ * Public function. See tdv_prepared.h
+ */
+enum t_cose_err_t tdv_prepared_verify(const struct tdv_prepared_verifier *verifier,
+                                      struct q_useful_buf_c               cose_sign1,
+                                      struct q_useful_buf_c              *payload)
+{
+    QCBORDecodeContext    decode_context;
+    struct q_useful_buf_c protected_parameters;
+    struct q_useful_buf_c signature;
+
+    /* [protected bstr, unprotected map, payload bstr, signature bstr] */
+    QCBORDecode_Init(&decode_context, cose_sign1, QCBOR_DECODE_MODE_NORMAL);
+    QCBORDecode_EnterArray(&decode_context, NULL);
+    QCBORDecode_GetByteString(&decode_context, &protected_parameters);
+    /* Nothing in the unprotected header is needed */
+    QCBORDecode_EnterMap(&decode_context, NULL);
+    QCBORDecode_ExitMap(&decode_context);
+    QCBORDecode_GetByteString(&decode_context, payload);
+    QCBORDecode_GetByteString(&decode_context, &signature);
+    QCBORDecode_ExitArray(&decode_context);
+    if(QCBORDecode_Finish(&decode_context)) {
+        return T_COSE_ERR_SIGN1_FORMAT;
+    }
+
+    return tdv_prepared_verify_decoded(verifier, protected_parameters, *payload, signature);
+}
+
+
+/*
+ * Public function. See tdv_prepared.h
+ */
+int tdv_prepared_verifier_takes(const struct tdv_prepared_verifier *verifier,
+                                struct q_useful_buf_c               protected_parameters)
+{
+    return !q_useful_buf_compare(protected_parameters, verifier->protected_parameters);
+}
+
+
+/*
+ * Public function. See tdv_prepared.h
+ */
+enum t_cose_err_t tdv_prepared_verify_decoded(const struct tdv_prepared_verifier *verifier,
+                                              struct q_useful_buf_c               protected_parameters,
+                                              struct q_useful_buf_c               payload,
+                                              struct q_useful_buf_c               signature)
+{
+    enum t_cose_err_t     return_value;
+    struct q_useful_buf_c hash;
+    Q_USEFUL_BUF_MAKE_STACK_UB(hash_buffer, T_COSE_CRYPTO_MAX_HASH_SIZE);
+
+    /* The prefix hash is only right for this protected header. Being
+     * exactly {1: alg} also means there are no critical parameters. */
+    if(!tdv_prepared_verifier_takes(verifier, protected_parameters)) {
+        return T_COSE_ERR_SIGN1_FORMAT;
+    }
+
+    return_value = hash_sig_structure(&verifier->prefix_hash, payload, hash_buffer, &hash);
+    if(return_value) {
+        return return_value;
+    }
+
+    return t_cose_crypto_verify(verifier->cose_algorithm_id,
+                                verifier->verification_key,
+                                NULL_Q_USEFUL_BUF_C,
+                                hash,
+                                signature);
+}
+
+
+/*
+ * Public function. See tdv_prepared.h
+ */
+void tdv_prepared_verifier_free(struct tdv_prepared_verifier *verifier)
+{
+    tdv_hash_free(&verifier->prefix_hash);
+}
@@ -0,0 +1,360 @@
+/*
+ * tdv_prepared.h
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+#ifndef tdv_prepared_h
+#define tdv_prepared_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "t_cose/t_cose_common.h"
+#include "t_cose/q_useful_buf.h"
+#include "qcbor/qcbor_encode.h"
+#include "t_cose_crypto.h"
+
+
+/**
+ * \file tdv_prepared.h
+ *
+ * \brief Sign many messages with the same algorithm, key and kid.
+ *
+ * t_cose_sign1_encode_parameters() encodes the protected and
+ * unprotected headers again for every message even when they are
+ * the same every time, as they are for a signer that always uses
+ * one key. A prepared signer encodes them once at set up and copies
+ * the encoded bytes into each message.
+ *
+ * The COSE_Sign1 made is the same as t_cose makes for the same
+ * algorithm, key and kid: the protected header is {1: alg} and the
+ * unprotected header has the kid if one is given. It verifies with
+ * t_cose_sign1_verify().
+ *
+ * The Sig_structure is hashed the way t_cose hashes it, the head of
+ * each byte string and then its content, and the hash is signed with
+ * t_cose's crypto adapter, t_cose_crypto.h. Only algorithms that sign
+ * a hash, the ECDSA and RSA ones, are supported. Short-circuit
+ * signing and external AAD are not.
+ *
+ * The start of the Sig_structure, the context string, the protected
+ * header and the empty external AAD, is the same for every message.
+ * It is hashed once at set up and the hash state after it is copied
+ * with tdv_hash_clone() for each message, so only the payload is
+ * hashed per message. For {1: alg} the prefix is 17 bytes, less than
+ * a SHA-2 block, so no block compressions are saved. What is saved is
+ * setting up the hash, which in OpenSSL 3 includes fetching the
+ * digest. A protected header with more in it saves a compression per
+ * whole block.
+ *
+ * Like two-step signing with t_cose:
+ *
+ *     tdv_prepared_signer_init(&signer, options, alg, key, kid);   once
+ *
+ *     QCBOREncode_Init(&cbor_encode, out_buf);
+ *     tdv_prepared_encode_parameters(&signer, &cbor_encode);
+ *     QCBOREncode_xxx(&cbor_encode, ...);   the payload
+ *     tdv_prepared_encode_signature(&signer, &cbor_encode);
+ *     QCBOREncode_Finish(&cbor_encode, &cose_sign1);
+ *
+ * tdv_prepared_sign() does this for a payload that is already
+ * encoded. The signer is only read after set up so it can be shared
+ * by threads if the crypto library allows the key to be.
+ * tdv_prepared_signer_free() frees the hash midstate.
+ *
+ * A prepared verifier does the same for verifying messages from a
+ * prepared signer or from t_cose with the same algorithm. A message
+ * whose protected header is not exactly {1: alg} is rejected; use
+ * t_cose_sign1_verify() for those.
+ */
+
+
+/* Largest kid */
+#define TDV_PREPARED_MAX_KID          64
+
+/* {1: alg} with any int32_t alg */
+#define TDV_PREPARED_MAX_PROTECTED    8
+
+/* {4: kid}. A map head, a label and a byte string head of at most 2
+ * bytes for a kid up to 255. */
+#define TDV_PREPARED_MAX_UNPROTECTED  (TDV_PREPARED_MAX_KID + 4)
+
+
+/**
+ * \brief Sign a hash in place of t_cose_crypto_sign().
+ *
+ * \param[in] sign_ctx           From tdv_prepared_set_sign_fn().
+ * \param[in] cose_algorithm_id  The signer's algorithm.
+ * \param[in] signing_key        The signer's key.
+ * \param[in] hash               The hash of the Sig_structure.
+ * \param[in] signature_buffer   Buffer of \ref T_COSE_MAX_SIG_SIZE
+ *                               bytes for the signature.
+ * \param[out] signature         The signature in the COSE format.
+ *
+ * The arguments and return are as for t_cose_crypto_sign(). This is
+ * called concurrently if the signer is shared by threads.
+ */
+typedef enum t_cose_err_t (*tdv_prepared_sign_fn)(void                  *sign_ctx,
+                                                  int32_t                cose_algorithm_id,
+                                                  struct t_cose_key      signing_key,
+                                                  struct q_useful_buf_c  hash,
+                                                  struct q_useful_buf    signature_buffer,
+                                                  struct q_useful_buf_c *signature);
+
+
+struct tdv_prepared_signer {
+    /* Private data structure */
+    int32_t                   cose_algorithm_id;
+    int32_t                   hash_algorithm_id;
+    uint32_t                  option_flags;
+    struct t_cose_key         signing_key;
+    /* The encoded protected header, not wrapped in a byte string */
+    struct q_useful_buf_c     protected_parameters;
+    /* The encoded unprotected header map */
+    struct q_useful_buf_c     unprotected_parameters;
+    uint8_t                   protected_buffer[TDV_PREPARED_MAX_PROTECTED];
+    uint8_t                   unprotected_buffer[TDV_PREPARED_MAX_UNPROTECTED];
+    /* The Sig_structure hashed up to the payload */
+    struct t_cose_crypto_hash prefix_hash;
+    /* Signs in place of t_cose_crypto_sign() if not NULL */
+    tdv_prepared_sign_fn      sign_fn;
+    void                     *sign_ctx;
+};
+
+
+struct tdv_prepared_verifier {
+    /* Private data structure */
+    int32_t                   cose_algorithm_id;
+    int32_t                   hash_algorithm_id;
+    struct t_cose_key         verification_key;
+    struct q_useful_buf_c     protected_parameters;
+    uint8_t                   protected_buffer[TDV_PREPARED_MAX_PROTECTED];
+    /* The Sig_structure hashed up to the payload */
+    struct t_cose_crypto_hash prefix_hash;
+};
+
+
+/**
+ * \brief Set up a prepared signer.
+ *
+ * \param[out] signer            The signer.
+ * \param[in] option_flags       \ref T_COSE_OPT_OMIT_CBOR_TAG or 0.
+ * \param[in] cose_algorithm_id  The signing algorithm.
+ * \param[in] signing_key        The key. It must stay valid as long
+ *                               as the signer is used.
+ * \param[in] kid                The kid for the unprotected header or
+ *                               \c NULL_Q_USEFUL_BUF_C for none.
+ *
+ * The headers are encoded and the start of the Sig_structure is
+ * hashed. On success tdv_prepared_signer_free() must be called when
+ * done with the signer.
+ *
+ * \return \ref T_COSE_ERR_UNSUPPORTED_SIGNING_ALG for an algorithm
+ *         that doesn't sign a hash, \ref T_COSE_ERR_INVALID_ARGUMENT
+ *         for other options or a kid bigger than
+ *         \ref TDV_PREPARED_MAX_KID, or an error starting the hash.
+ */
+enum t_cose_err_t tdv_prepared_signer_init(struct tdv_prepared_signer *signer,
+                                           uint32_t                    option_flags,
+                                           int32_t                     cose_algorithm_id,
+                                           struct t_cose_key           signing_key,
+                                           struct q_useful_buf_c       kid);
+
+
+/**
+ * \brief Sign with something other than t_cose_crypto_sign().
+ *
+ * \param[in] signer    The signer.
+ * \param[in] sign_fn   The function to sign with or NULL to go back
+ *                      to t_cose_crypto_sign().
+ * \param[in] sign_ctx  Passed to \c sign_fn.
+ *
+ * This is for signing that keeps state across messages, such as the
+ * ECDSA presignature pool in tdv_presig.h.
+ */
+void tdv_prepared_set_sign_fn(struct tdv_prepared_signer *signer,
+                              tdv_prepared_sign_fn        sign_fn,
+                              void                       *sign_ctx);
+
+
+/**
+ * \brief Output the headers and start the payload.
+ *
+ * \param[in] signer       The signer.
+ * \param[in] cbor_encode  The encoder to output to.
+ *
+ * This is t_cose_sign1_encode_parameters() with the headers copied
+ * in instead of encoded. The payload is added next with the
+ * QCBOREncode_xxx() functions.
+ *
+ * \return Always \ref T_COSE_SUCCESS. Errors are in the encoder.
+ */
+enum t_cose_err_t tdv_prepared_encode_parameters(const struct tdv_prepared_signer *signer,
+                                                 QCBOREncodeContext               *cbor_encode);
+
+
+/**
+ * \brief End the payload, sign and output the signature.
+ *
+ * \param[in] signer       The signer.
+ * \param[in] cbor_encode  The encoder, with the payload just added.
+ *
+ * \return \ref T_COSE_ERR_CBOR_FORMATTING if the encoder has an
+ *         error, for example the output buffer is too small, or an
+ *         error from hashing or signing.
+ */
+enum t_cose_err_t tdv_prepared_encode_signature(const struct tdv_prepared_signer *signer,
+                                                QCBOREncodeContext               *cbor_encode);
+
+
+/**
+ * \brief End the payload and hash the Sig_structure.
+ *
+ * \param[in] signer        The signer.
+ * \param[in] cbor_encode   The encoder, with the payload just added.
+ * \param[in] hash_buffer   Buffer of \ref T_COSE_CRYPTO_MAX_HASH_SIZE
+ *                          bytes for the hash.
+ * \param[out] hash         The hash to sign.
+ *
+ * This and tdv_prepared_add_signature() are the two halves of
+ * tdv_prepared_encode_signature() for when the signing is done
+ * elsewhere, for example asynchronously as in tdv_async.h. The
+ * encoder must not be used in between.
+ *
+ * \return As for tdv_prepared_encode_signature() without the
+ *         signing errors.
+ */
+enum t_cose_err_t tdv_prepared_encode_hash(const struct tdv_prepared_signer *signer,
+                                           QCBOREncodeContext               *cbor_encode,
+                                           struct q_useful_buf               hash_buffer,
+                                           struct q_useful_buf_c            *hash);
+
+
+/**
+ * \brief Output the signature and end the COSE_Sign1.
+ *
+ * \param[in] cbor_encode  The encoder from tdv_prepared_encode_hash().
+ * \param[in] signature    The signature of the hash, in the COSE
+ *                         format.
+ */
+void tdv_prepared_add_signature(QCBOREncodeContext    *cbor_encode,
+                                struct q_useful_buf_c  signature);
+
+
+/**
+ * \brief Sign an encoded payload.
+ *
+ * \param[in] signer       The signer.
+ * \param[in] payload      The payload.
+ * \param[in] out_buf      Buffer for the COSE_Sign1.
+ * \param[out] cose_sign1  The COSE_Sign1 in \c out_buf.
+ *
+ * \return \ref T_COSE_ERR_TOO_SMALL if \c out_buf is too small or an
+ *         error from tdv_prepared_encode_signature().
+ */
+enum t_cose_err_t tdv_prepared_sign(const struct tdv_prepared_signer *signer,
+                                    struct q_useful_buf_c             payload,
+                                    struct q_useful_buf               out_buf,
+                                    struct q_useful_buf_c            *cose_sign1);
+
+
+
+/**
+ * \brief Free a prepared signer.
+ *
+ * \param[in] signer  A signer set up by tdv_prepared_signer_init().
+ */
+void tdv_prepared_signer_free(struct tdv_prepared_signer *signer);
+
+
+/**
+ * \brief Set up a prepared verifier.
+ *
+ * \param[out] verifier           The verifier.
+ * \param[in] cose_algorithm_id   The algorithm of the messages.
+ * \param[in] verification_key    The key. It must stay valid as long
+ *                                 as the verifier is used.
+ *
+ * On success tdv_prepared_verifier_free() must be called when done
+ * with the verifier.
+ *
+ * \return \ref T_COSE_ERR_UNSUPPORTED_SIGNING_ALG for an algorithm
+ *         that doesn't sign a hash or an error starting the hash.
+ */
+enum t_cose_err_t tdv_prepared_verifier_init(struct tdv_prepared_verifier *verifier,
+                                             int32_t                       cose_algorithm_id,
+                                             struct t_cose_key             verification_key);
+
+
+/**
+ * \brief Verify a COSE_Sign1.
+ *
+ * \param[in] verifier     The verifier.
+ * \param[in] cose_sign1   The COSE_Sign1. The CBOR tag 18 is allowed
+ *                         but not required.
+ * \param[out] payload     The payload in \c cose_sign1.
+ *
+ * The unprotected header is not looked at, the same as
+ * t_cose_sign1_verify() with no options when there's no kid to use.
+ *
+ * \return \ref T_COSE_SUCCESS, \ref T_COSE_ERR_SIG_VERIFY if the
+ *         signature doesn't match, \ref T_COSE_ERR_SIGN1_FORMAT if
+ *         the message can't be decoded or its protected header is
+ *         not {1: alg}, or another error.
+ */
+enum t_cose_err_t tdv_prepared_verify(const struct tdv_prepared_verifier *verifier,
+                                      struct q_useful_buf_c               cose_sign1,
+                                      struct q_useful_buf_c              *payload);
+
+
+/**
+ * \brief Whether a verifier can verify messages with a protected
+ *        header.
+ *
+ * \param[in] verifier              The verifier.
+ * \param[in] protected_parameters  The encoded protected header, not
+ *                                  wrapped in a byte string.
+ *
+ * \return Non-zero if the protected header is exactly the {1: alg}
+ *         the verifier was set up for.
+ */
+int tdv_prepared_verifier_takes(const struct tdv_prepared_verifier *verifier,
+                                struct q_useful_buf_c               protected_parameters);
+
+
+/**
+ * \brief Verify a COSE_Sign1 that the caller has decoded.
+ *
+ * \param[in] verifier              The verifier.
+ * \param[in] protected_parameters  The protected header from the
+ *                                  message, not wrapped in a byte
+ *                                  string.
+ * \param[in] payload               The payload from the message.
+ * \param[in] signature             The signature from the message.
+ *
+ * This is tdv_prepared_verify() for a caller that decodes the message
+ * itself, for example to get the kid first as tdv_batch.h does, so it
+ * isn't decoded twice.
+ *
+ * \return As for tdv_prepared_verify().
+ */
+enum t_cose_err_t tdv_prepared_verify_decoded(const struct tdv_prepared_verifier *verifier,
+                                              struct q_useful_buf_c               protected_parameters,
+                                              struct q_useful_buf_c               payload,
+                                              struct q_useful_buf_c               signature);
+
+
+/**
+ * \brief Free a prepared verifier.
+ *
+ * \param[in] verifier  A verifier set up by tdv_prepared_verifier_init().
+ */
+void tdv_prepared_verifier_free(struct tdv_prepared_verifier *verifier);
+
+
+#endif /* tdv_prepared_h */
@@ -0,0 +1,346 @@
+/*
+ * tdv_presig.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+
+/**
+ * \file tdv_presig.c
+ *
+ * \brief Implementation of tdv_presig.h.
+ *
+ * The pool is a bounded multi-producer multi-consumer ring, the one
+ * by Dmitry Vyukov. Each slot has a sequence number that says whether
+ * it is ready to be filled or ready to be taken for the current lap
+ * of the ring. A producer or consumer claims a slot with a
+ * compare-and-swap on the put or take position and then owns it
+ * until it stores the next sequence number. Only that store
+ * publishes the slot, so a pair is never seen half written and never
+ * taken twice.
+ */
+
+/* For nanosleep() */
+#define _POSIX_C_SOURCE 200809L
+
+#include "tdv_presig.h"
+
+#include <stdlib.h>
+#include <time.h>
+
+#include "openssl/bn.h"
+#include "openssl/ecdsa.h"
+
+
+struct tdv_presig_slot {
+    atomic_size_t sequence;
+    BIGNUM       *kinv;
+    BIGNUM       *r;
+};
+
+
+/* How long a background thread sleeps when the pool is full */
+#define FULL_SLEEP_NS  100000
+
+
+/*
+ * Put a pair in the pool. Returns 0 if the pool is full.
+ */
+static int pool_put(struct tdv_presig_pool *pool, BIGNUM *kinv, BIGNUM *r)
+{
+    struct tdv_presig_slot *slot;
+    size_t                  pos;
+    size_t                  sequence;
+    intptr_t                diff;
+
+    pos = atomic_load_explicit(&pool->put_pos, memory_order_relaxed);
+    for(;;) {
+        slot     = &pool->slots[pos & pool->mask];
+        sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        diff     = (intptr_t)sequence - (intptr_t)pos;
+        if(diff == 0) {
+            /* Empty for this lap. Claim it. */
+            if(atomic_compare_exchange_weak_explicit(&pool->put_pos, &pos, pos + 1,
+                                                     memory_order_relaxed,
+                                                     memory_order_relaxed)) {
+                break;
+            }
+        } else if(diff < 0) {
+            /* Still full from the last lap */
+            return 0;
+        } else {
+            /* Another producer got it */
+            pos = atomic_load_explicit(&pool->put_pos, memory_order_relaxed);
+        }
+    }
+
+    slot->kinv = kinv;
+    slot->r    = r;
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+
+    return 1;
+}
+
+
+/*
+ * Take a pair out of the pool. The caller owns it after this. Returns
+ * 0 if the pool is empty.
+ */
+static int pool_take(struct tdv_presig_pool *pool, BIGNUM **kinv, BIGNUM **r)
+{
+    struct tdv_presig_slot *slot;
+    size_t                  pos;
+    size_t                  sequence;
+    intptr_t                diff;
+
+    pos = atomic_load_explicit(&pool->take_pos, memory_order_relaxed);
+    for(;;) {
+        slot     = &pool->slots[pos & pool->mask];
+        sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        diff     = (intptr_t)sequence - (intptr_t)(pos + 1);
+        if(diff == 0) {
+            /* Filled for this lap. Claim it. */
+            if(atomic_compare_exchange_weak_explicit(&pool->take_pos, &pos, pos + 1,
+                                                     memory_order_relaxed,
+                                                     memory_order_relaxed)) {
+                break;
+            }
+        } else if(diff < 0) {
+            /* Not filled yet */
+            return 0;
+        } else {
+            /* Another signer got it */
+            pos = atomic_load_explicit(&pool->take_pos, memory_order_relaxed);
+        }
+    }
+
+    *kinv      = slot->kinv;
+    *r         = slot->r;
+    slot->kinv = NULL;
+    slot->r    = NULL;
+    /* Ready to be filled on the next lap */
+    atomic_store_explicit(&slot->sequence, pos + pool->mask + 1, memory_order_release);
+
+    return 1;
+}
+
+
+/*
+ * A background thread. Makes pairs and puts them in the pool until
+ * stopped, sleeping while the pool is full.
+ */
+static void *fill_thread(void *arg)
+{
+    struct tdv_presig_pool *pool = (struct tdv_presig_pool *)arg;
+    const struct timespec   full_sleep = {0, FULL_SLEEP_NS};
+    BN_CTX                 *bn_ctx;
+    BIGNUM                 *kinv = NULL;
+    BIGNUM                 *r    = NULL;
+
+    bn_ctx = BN_CTX_new();
+    if(bn_ctx == NULL) {
+        return NULL;
+    }
+
+    while(!atomic_load_explicit(&pool->stop, memory_order_relaxed)) {
+        if(kinv == NULL) {
+            if(!ECDSA_sign_setup(pool->ec_key, bn_ctx, &kinv, &r)) {
+                kinv = NULL;
+                r    = NULL;
+                nanosleep(&full_sleep, NULL);
+                continue;
+            }
+        }
+        if(pool_put(pool, kinv, r)) {
+            kinv = NULL;
+            r    = NULL;
+        } else {
+            nanosleep(&full_sleep, NULL);
+        }
+    }
+
+    BN_clear_free(kinv);
+    BN_clear_free(r);
+    BN_CTX_free(bn_ctx);
+
+    return NULL;
+}
+
+
+/*
+ * Public function. See tdv_presig.h
+ */
+enum t_cose_err_t tdv_presig_pool_start(struct tdv_presig_pool *pool,
+                                        int32_t                 cose_algorithm_id,
+                                        struct t_cose_key       signing_key,
+                                        size_t                  size,
+                                        unsigned                num_threads)
+{
+    size_t   capacity;
+    size_t   i;
+    unsigned t;
+
+    switch(cose_algorithm_id) {
+    case T_COSE_ALGORITHM_ES256: pool->coord_len = 32; break;
+    case T_COSE_ALGORITHM_ES384: pool->coord_len = 48; break;
+    case T_COSE_ALGORITHM_ES512: pool->coord_len = 66; break;
+    default:
+        return T_COSE_ERR_UNSUPPORTED_SIGNING_ALG;
+    }
+    if(size == 0 || size > TDV_PRESIG_MAX_SIZE ||
+       num_threads == 0 || num_threads > TDV_PRESIG_MAX_THREADS) {
+        return T_COSE_ERR_INVALID_ARGUMENT;
+    }
+
+    capacity = 1;
+    while(capacity < size) {
+        capacity <<= 1;
+    }
+
+    pool->slots = malloc(capacity * sizeof(struct tdv_presig_slot));
+    if(pool->slots == NULL) {
+        return T_COSE_ERR_INSUFFICIENT_MEMORY;
+    }
+    for(i = 0; i < capacity; i++) {
+        atomic_init(&pool->slots[i].sequence, i);
+        pool->slots[i].kinv = NULL;
+        pool->slots[i].r    = NULL;
+    }
+
+    pool->cose_algorithm_id = cose_algorithm_id;
+    pool->ec_key            = (EC_KEY *)signing_key.k.key_ptr;
+    pool->mask              = capacity - 1;
+    atomic_init(&pool->take_pos, 0);
+    atomic_init(&pool->put_pos, 0);
+    atomic_init(&pool->hits, 0);
+    atomic_init(&pool->misses, 0);
+    atomic_init(&pool->stop, 0);
+
+    for(t = 0; t < num_threads; t++) {
+        if(pthread_create(&pool->threads[t], NULL, fill_thread, pool)) {
+            break;
+        }
+    }
+    pool->num_threads = t;
+    if(t < num_threads) {
+        tdv_presig_pool_stop(pool);
+        return T_COSE_ERR_FAIL;
+    }
+
+    return T_COSE_SUCCESS;
+}
+
+
+/*
+ * Public function. See tdv_presig.h
+ */
+void tdv_presig_pool_stop(struct tdv_presig_pool *pool)
+{
+    unsigned t;
+    BIGNUM  *kinv;
+    BIGNUM  *r;
+
+    atomic_store(&pool->stop, 1);
+    for(t = 0; t < pool->num_threads; t++) {
+        pthread_join(pool->threads[t], NULL);
+    }
+    pool->num_threads = 0;
+
+    while(pool_take(pool, &kinv, &r)) {
+        BN_clear_free(kinv);
+        BN_clear_free(r);
+    }
+    free(pool->slots);
+    pool->slots = NULL;
+}
+
+
+/*
+ * Public function. See tdv_presig.h
+ */
+enum t_cose_err_t tdv_presig_sign(void                  *pool_ctx,
+                                  int32_t                cose_algorithm_id,
+                                  struct t_cose_key      signing_key,
+                                  struct q_useful_buf_c  hash,
+                                  struct q_useful_buf    signature_buffer,
+                                  struct q_useful_buf_c *signature)
+{
+    struct tdv_presig_pool *pool = (struct tdv_presig_pool *)pool_ctx;
+    ECDSA_SIG              *ecdsa_sig = NULL;
+    BIGNUM                 *kinv;
+    BIGNUM                 *r;
+    const BIGNUM           *sig_r;
+    const BIGNUM           *sig_s;
+    enum t_cose_err_t       return_value;
+
+    if(cose_algorithm_id != pool->cose_algorithm_id ||
+       signing_key.k.key_ptr != pool->ec_key) {
+        return T_COSE_ERR_INVALID_ARGUMENT;
+    }
+    if(signature_buffer.len < 2 * (size_t)pool->coord_len) {
+        return T_COSE_ERR_SIG_BUFFER_SIZE;
+    }
+
+    if(pool_take(pool, &kinv, &r)) {
+        ecdsa_sig = ECDSA_do_sign_ex(hash.ptr, (int)hash.len, kinv, r, pool->ec_key);
+        /* Used or not, never again */
+        BN_clear_free(kinv);
+        BN_clear_free(r);
+    }
+    if(ecdsa_sig != NULL) {
+        atomic_fetch_add_explicit(&pool->hits, 1, memory_order_relaxed);
+    } else {
+        /* Empty pool, or the very unlikely s == 0 that needs a new k */
+        atomic_fetch_add_explicit(&pool->misses, 1, memory_order_relaxed);
+        ecdsa_sig = ECDSA_do_sign(hash.ptr, (int)hash.len, pool->ec_key);
+        if(ecdsa_sig == NULL) {
+            return T_COSE_ERR_SIG_FAIL;
+        }
+    }
+
+    ECDSA_SIG_get0(ecdsa_sig, &sig_r, &sig_s);
+    if(BN_bn2binpad(sig_r, signature_buffer.ptr, pool->coord_len) < 0 ||
+       BN_bn2binpad(sig_s, (uint8_t *)signature_buffer.ptr + pool->coord_len, pool->coord_len) < 0) {
+        return_value = T_COSE_ERR_SIG_FAIL;
+        goto Done;
+    }
+
+    signature->ptr = signature_buffer.ptr;
+    signature->len = 2 * (size_t)pool->coord_len;
+    return_value   = T_COSE_SUCCESS;
+
+Done:
+    ECDSA_SIG_free(ecdsa_sig);
+    return return_value;
+}
+
+
+/*
+ * Public function. See tdv_presig.h
+ */
+size_t tdv_presig_pool_level(struct tdv_presig_pool *pool)
+{
+    size_t put;
+    size_t take;
+
+    take = atomic_load_explicit(&pool->take_pos, memory_order_relaxed);
+    put  = atomic_load_explicit(&pool->put_pos, memory_order_relaxed);
+
+    return put > take ? put - take : 0;
+}
+
+
+/*
+ * Public function. See tdv_presig.h
+ */
+void tdv_presig_pool_counts(struct tdv_presig_pool *pool,
+                            uint64_t               *hits,
+                            uint64_t               *misses)
+{
+    *hits   = atomic_load_explicit(&pool->hits, memory_order_relaxed);
+    *misses = atomic_load_explicit(&pool->misses, memory_order_relaxed);
+}
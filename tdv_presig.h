@@ -0,0 +1,180 @@
+/*
+ * tdv_presig.h
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+#ifndef tdv_presig_h
+#define tdv_presig_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "t_cose/t_cose_common.h"
+#include "t_cose/q_useful_buf.h"
+
+#include "openssl/ec.h"
+
+
+/**
+ * \file tdv_presig.h
+ *
+ * \brief ECDSA signing with k and r made ahead by background threads.
+ *
+ * Most of an ECDSA signature is the scalar multiplication k*G that
+ * gives r. It doesn't depend on the message so it can be done before
+ * the message arrives. A pool is filled by background threads with
+ * pairs of k^-1 and r from ECDSA_sign_setup(). Signing takes a pair
+ * and does only s = k^-1 * (hash + r * private key) with
+ * ECDSA_do_sign_ex(). If the pool is empty the signature is made the
+ * usual way with ECDSA_do_sign() and counted as a miss.
+ *
+ * Each pair is used for exactly one signature. Using a k twice gives
+ * away the private key. The pool is a bounded ring where a pair is
+ * claimed with a compare-and-swap on the take position, so two
+ * signers can never get the same one, and the pair is taken out of
+ * its slot before the slot can be filled again. A used pair is
+ * cleared and freed. Signers don't take locks or wait for the
+ * background threads.
+ *
+ * A pair is as secret as the private key. The pool is in ordinary
+ * heap memory. It must not be used in a process that forks, as the
+ * child would get copies of the same pairs.
+ *
+ * This is for the OpenSSL crypto adapter, whose keys are EC_KEYs.
+ * ECDSA_sign_setup() and ECDSA_do_sign_ex() are deprecated in
+ * OpenSSL 3 but still there. It is only in bench_ossl.
+ *
+ * Use it with a prepared signer:
+ *
+ *     tdv_presig_pool_start(&pool, alg, key, 1024, 1);
+ *     tdv_prepared_set_sign_fn(&signer, tdv_presig_sign, &pool);
+ *     ...
+ *     tdv_presig_pool_stop(&pool);
+ */
+
+
+/* Most background threads for one pool */
+#define TDV_PRESIG_MAX_THREADS  16
+
+/* Largest pool. The size is rounded up to a power of two. */
+#define TDV_PRESIG_MAX_SIZE     (1 << 20)
+
+
+struct tdv_presig_slot;
+
+
+struct tdv_presig_pool {
+    /* Private data structure */
+    int32_t                 cose_algorithm_id;
+    EC_KEY                 *ec_key;
+    int                     coord_len;
+    struct tdv_presig_slot *slots;
+    size_t                  mask;
+    unsigned                num_threads;
+    pthread_t               threads[TDV_PRESIG_MAX_THREADS];
+    atomic_int              stop;
+    /* Each on its own cache line as the signers and the background
+     * threads write them all the time */
+    _Alignas(64) atomic_size_t take_pos;
+    _Alignas(64) atomic_size_t put_pos;
+    _Alignas(64) atomic_uint_fast64_t hits;
+    atomic_uint_fast64_t    misses;
+};
+
+
+/**
+ * \brief Make a pool and start filling it.
+ *
+ * \param[out] pool              The pool.
+ * \param[in] cose_algorithm_id  ES256, ES384 or ES512.
+ * \param[in] signing_key        The key. It must stay valid until
+ *                               tdv_presig_pool_stop() returns.
+ * \param[in] size               Number of pairs to hold. Rounded up to
+ *                               a power of two.
+ * \param[in] num_threads        Background threads to fill it with.
+ *
+ * The pool starts empty. Signing works right away but misses until
+ * the threads have filled it. tdv_presig_pool_level() tells how full
+ * it is.
+ *
+ * \return \ref T_COSE_ERR_UNSUPPORTED_SIGNING_ALG if not ECDSA,
+ *         \ref T_COSE_ERR_INVALID_ARGUMENT for a size or number of
+ *         threads out of range, \ref T_COSE_ERR_INSUFFICIENT_MEMORY or
+ *         \ref T_COSE_ERR_FAIL if a thread couldn't be started.
+ */
+enum t_cose_err_t tdv_presig_pool_start(struct tdv_presig_pool *pool,
+                                        int32_t                 cose_algorithm_id,
+                                        struct t_cose_key       signing_key,
+                                        size_t                  size,
+                                        unsigned                num_threads);
+
+
+/**
+ * \brief Stop the background threads and free the pool.
+ *
+ * \param[in] pool  The pool.
+ *
+ * The pairs not used are cleared and freed. No signing may be going
+ * on with the pool.
+ */
+void tdv_presig_pool_stop(struct tdv_presig_pool *pool);
+
+
+/**
+ * \brief Sign a hash using a pair from the pool.
+ *
+ * \param[in] pool               The pool, as a void * so this can be
+ *                               a \ref tdv_prepared_sign_fn.
+ * \param[in] cose_algorithm_id  Must be the pool's.
+ * \param[in] signing_key        Must be the pool's.
+ * \param[in] hash               The hash to sign.
+ * \param[in] signature_buffer   Buffer for the signature.
+ * \param[out] signature         The signature in the COSE format, r
+ *                               and s concatenated.
+ *
+ * This can be called from any number of threads at once.
+ *
+ * \return \ref T_COSE_ERR_INVALID_ARGUMENT if the algorithm or key are
+ *         not the pool's, \ref T_COSE_ERR_SIG_BUFFER_SIZE or
+ *         \ref T_COSE_ERR_SIG_FAIL.
+ */
+enum t_cose_err_t tdv_presig_sign(void                  *pool,
+                                  int32_t                cose_algorithm_id,
+                                  struct t_cose_key      signing_key,
+                                  struct q_useful_buf_c  hash,
+                                  struct q_useful_buf    signature_buffer,
+                                  struct q_useful_buf_c *signature);
+
+
+/**
+ * \brief About how many pairs are in the pool.
+ *
+ * \param[in] pool  The pool.
+ *
+ * Only a snapshot while signers and the background threads are
+ * running.
+ */
+size_t tdv_presig_pool_level(struct tdv_presig_pool *pool);
+
+
+/**
+ * \brief Signatures made with a pair and without.
+ *
+ * \param[in] pool      The pool.
+ * \param[out] hits     Signatures made with a pair from the pool.
+ * \param[out] misses   Signatures made the usual way because the
+ *                      pool was empty.
+ */
+void tdv_presig_pool_counts(struct tdv_presig_pool *pool,
+                            uint64_t               *hits,
+                            uint64_t               *misses);
+
+
+#endif /* tdv_presig_h */
@@ -0,0 +1,362 @@
+/*
+ * tdv_seq.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+
+/**
+ * \file tdv_seq.c
+ *
+ * \brief Implementation of tdv_seq.h.
+ *
+ * This is the same for every crypto library. Everything crypto
+ * library specific is behind t_cose and the key resolver.
+ */
+
+/* For posix_madvise() */
+#define _POSIX_C_SOURCE 200809L
+/* For files over 2GB on 32-bit Linux */
+#define _FILE_OFFSET_BITS 64
+
+#include "tdv_seq.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+/* Threads when the number of CPUs can't be had */
+#define SEQ_DEFAULT_THREADS 4
+
+/* Most threads started */
+#define SEQ_MAX_THREADS     256
+
+
+/*
+ * Public function. See tdv_seq.h
+ */
+enum t_cose_err_t tdv_seq_map(struct tdv_seq *seq, const char *file_name)
+{
+    struct stat st;
+    void       *map;
+    int         fd;
+
+    seq->map  = NULL;
+    seq->size = 0;
+
+    fd = open(file_name, O_RDONLY);
+    if(fd < 0) {
+        return T_COSE_ERR_FAIL;
+    }
+    if(fstat(fd, &st) || st.st_size < 0 || (uint64_t)st.st_size > SIZE_MAX) {
+        close(fd);
+        return T_COSE_ERR_FAIL;
+    }
+    if(st.st_size == 0) {
+        /* mmap() of nothing fails. An empty file is an empty sequence. */
+        close(fd);
+        return T_COSE_SUCCESS;
+    }
+
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    /* The mapping stays after the file is closed */
+    close(fd);
+    if(map == MAP_FAILED) {
+        return T_COSE_ERR_FAIL;
+    }
+
+    /* The threads work through the file from start to end. Only a
+     * hint so the result doesn't matter. */
+    (void)posix_madvise(map, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+
+    seq->map  = map;
+    seq->size = (size_t)st.st_size;
+
+    return T_COSE_SUCCESS;
+}
+
+
+/*
+ * Public function. See tdv_seq.h
+ */
+void tdv_seq_unmap(struct tdv_seq *seq)
+{
+    if(seq->map != NULL) {
+        munmap((void *)(uintptr_t)seq->map, seq->size);
+    }
+    seq->map  = NULL;
+    seq->size = 0;
+}
+
+
+/*
+ * Skip one CBOR data item including everything in it. Returns where
+ * the next item starts or NULL if it isn't well formed or runs past
+ * end.
+ */
+static const uint8_t *skip_item(const uint8_t *p, const uint8_t *end, unsigned depth)
+{
+    uint8_t  major_type;
+    uint8_t  additional_info;
+    uint64_t argument;
+    uint64_t count;
+    size_t   arg_len;
+
+    if(depth > TDV_SEQ_MAX_NESTING || p >= end) {
+        return NULL;
+    }
+
+    major_type      = *p >> 5;
+    additional_info = *p & 0x1f;
+    p++;
+
+    if(additional_info == 31) {
+        /* Indefinite length, items until a break */
+        if(major_type < 2 || major_type == 6 || major_type == 7) {
+            return NULL;
+        }
+        while(p < end && *p != 0xff) {
+            p = skip_item(p, end, depth + 1);
+            if(p == NULL) {
+                return NULL;
+            }
+        }
+        return p < end ? p + 1 : NULL;
+    }
+
+    if(additional_info < 24) {
+        argument = additional_info;
+    } else if(additional_info <= 27) {
+        arg_len = (size_t)1 << (additional_info - 24);
+        if((size_t)(end - p) < arg_len) {
+            return NULL;
+        }
+        argument = 0;
+        while(arg_len--) {
+            argument = (argument << 8) | *p++;
+        }
+    } else {
+        /* 28 to 30 are reserved */
+        return NULL;
+    }
+
+    switch(major_type) {
+    case 0: /* Unsigned integer */
+    case 1: /* Negative integer */
+    case 7: /* Simple values and floats */
+        return p;
+
+    case 2: /* Byte string */
+    case 3: /* Text string */
+        if(argument > (uint64_t)(end - p)) {
+            return NULL;
+        }
+        return p + argument;
+
+    case 4: /* Array */
+    case 5: /* Map */
+        /* Each item is at least a byte so this stops at end for a
+         * count that is too big */
+        for(count = 0; count < argument; count++) {
+            p = skip_item(p, end, depth + 1);
+            if(p == NULL) {
+                return NULL;
+            }
+            if(major_type == 5) {
+                p = skip_item(p, end, depth + 1);
+                if(p == NULL) {
+                    return NULL;
+                }
+            }
+        }
+        return p;
+
+    default: /* 6, tag; the tagged item follows */
+        return skip_item(p, end, depth + 1);
+    }
+}
+
+
+/*
+ * Public function. See tdv_seq.h
+ */
+enum t_cose_err_t tdv_seq_next(const struct tdv_seq  *seq,
+                               size_t                *offset,
+                               struct q_useful_buf_c *message)
+{
+    const uint8_t *start;
+    const uint8_t *next;
+
+    if(*offset >= seq->size) {
+        return T_COSE_ERR_TOO_SMALL;
+    }
+
+    start = seq->map + *offset;
+    next  = skip_item(start, seq->map + seq->size, 0);
+    if(next == NULL) {
+        return T_COSE_ERR_CBOR_NOT_WELL_FORMED;
+    }
+
+    message->ptr = start;
+    message->len = (size_t)(next - start);
+    *offset     += message->len;
+
+    return T_COSE_SUCCESS;
+}
+
+
+struct seq_pool {
+    const struct tdv_seq    *seq;
+    uint32_t                 option_flags;
+    const struct t_cose_key *key;
+    tdv_batch_key_resolver   resolver;
+    void                    *resolver_ctx;
+    tdv_seq_result_fn        result_fn;
+    void                    *result_ctx;
+
+    /* The rest is under the mutex */
+    pthread_mutex_t          mutex;
+    size_t                   next_offset;
+    uint64_t                 next_index;
+    int                      scan_error;
+    struct tdv_seq_result    totals;
+};
+
+
+/*
+ * Take the next batch of messages. Returns how many there are, 0 at
+ * the end of the file or after a scan error.
+ */
+static size_t take_batch(struct seq_pool       *pool,
+                         struct tdv_batch_item *items,
+                         size_t                *offsets,
+                         uint64_t              *first_index)
+{
+    size_t count;
+
+    pthread_mutex_lock(&pool->mutex);
+
+    *first_index = pool->next_index;
+    for(count = 0; count < TDV_SEQ_BATCH && !pool->scan_error; count++) {
+        offsets[count] = pool->next_offset;
+        if(tdv_seq_next(pool->seq, &pool->next_offset, &items[count].cose_sign1)) {
+            /* The end of the file or a message that can't be skipped.
+             * Nothing after it can be found. */
+            pool->scan_error = pool->next_offset < pool->seq->size;
+            break;
+        }
+    }
+    pool->next_index += count;
+
+    pthread_mutex_unlock(&pool->mutex);
+
+    return count;
+}
+
+
+static void *seq_thread(void *arg)
+{
+    struct seq_pool       *pool = (struct seq_pool *)arg;
+    struct tdv_batch_item  items[TDV_SEQ_BATCH];
+    size_t                 offsets[TDV_SEQ_BATCH];
+    struct tdv_seq_result  totals;
+    uint64_t               first_index;
+    size_t                 count;
+    size_t                 i;
+
+    memset(&totals, 0, sizeof(totals));
+
+    while((count = take_batch(pool, items, offsets, &first_index)) != 0) {
+        totals.verified += tdv_batch_verify(pool->option_flags,
+                                            pool->key,
+                                            pool->resolver,
+                                            pool->resolver_ctx,
+                                            items,
+                                            count);
+        totals.messages += count;
+        for(i = 0; i < count; i++) {
+            totals.bytes += items[i].cose_sign1.len;
+            if(items[i].result == T_COSE_SUCCESS) {
+                totals.payload_bytes += items[i].payload.len;
+            }
+            if(pool->result_fn != NULL) {
+                (*pool->result_fn)(pool->result_ctx, first_index + i, offsets[i], &items[i]);
+            }
+        }
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->totals.messages      += totals.messages;
+    pool->totals.verified      += totals.verified;
+    pool->totals.bytes         += totals.bytes;
+    pool->totals.payload_bytes += totals.payload_bytes;
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+
+/*
+ * Public function. See tdv_seq.h
+ */
+enum t_cose_err_t tdv_seq_verify(const struct tdv_seq    *seq,
+                                 unsigned                 num_threads,
+                                 uint32_t                 option_flags,
+                                 const struct t_cose_key *key,
+                                 tdv_batch_key_resolver   resolver,
+                                 void                    *resolver_ctx,
+                                 tdv_seq_result_fn        result_fn,
+                                 void                    *result_ctx,
+                                 struct tdv_seq_result   *result)
+{
+    struct seq_pool pool;
+    pthread_t       threads[SEQ_MAX_THREADS];
+    unsigned        started;
+    long            cpus;
+
+    if(num_threads == 0) {
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = cpus > 0 ? (unsigned)cpus : SEQ_DEFAULT_THREADS;
+    }
+    if(num_threads > SEQ_MAX_THREADS) {
+        num_threads = SEQ_MAX_THREADS;
+    }
+
+    memset(&pool, 0, sizeof(pool));
+    pool.seq          = seq;
+    pool.option_flags = option_flags;
+    pool.key          = key;
+    pool.resolver     = resolver;
+    pool.resolver_ctx = resolver_ctx;
+    pool.result_fn    = result_fn;
+    pool.result_ctx   = result_ctx;
+    pthread_mutex_init(&pool.mutex, NULL);
+
+    for(started = 0; started < num_threads; started++) {
+        if(pthread_create(&threads[started], NULL, seq_thread, &pool)) {
+            /* Go on with the threads there are */
+            break;
+        }
+    }
+    if(started == 0) {
+        pthread_mutex_destroy(&pool.mutex);
+        return T_COSE_ERR_FAIL;
+    }
+    while(started > 0) {
+        pthread_join(threads[--started], NULL);
+    }
+    pthread_mutex_destroy(&pool.mutex);
+
+    *result = pool.totals;
+    result->scan_end = pool.next_offset;
+
+    return pool.scan_error ? T_COSE_ERR_CBOR_NOT_WELL_FORMED : T_COSE_SUCCESS;
+}
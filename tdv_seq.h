@@ -0,0 +1,165 @@
+/*
+ * tdv_seq.h
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+#ifndef tdv_seq_h
+#define tdv_seq_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "t_cose/t_cose_common.h"
+#include "t_cose/q_useful_buf.h"
+
+#include "tdv_batch.h"
+
+
+/**
+ * \file tdv_seq.h
+ *
+ * \brief Verify a file of COSE_Sign1 messages in place.
+ *
+ * The file is a CBOR sequence (RFC 8742), COSE_Sign1 messages one
+ * after the other with nothing between them. It is mapped into
+ * memory and each message is verified where it is in the mapping.
+ * Nothing is read into a buffer or copied. The payloads returned are
+ * slices of the mapping and are valid until tdv_seq_unmap().
+ *
+ * Verification is done by a pool of threads. Work is handed out a
+ * batch of \ref TDV_SEQ_BATCH messages at a time. Finding where the
+ * messages in a batch start and end is done under a lock but is cheap
+ * next to verifying them. Each batch is verified with
+ * tdv_batch_verify() so the key resolver is called once per key per
+ * batch, not once per message.
+ */
+
+
+/* Messages handed to a thread at a time */
+#define TDV_SEQ_BATCH         256
+
+/* Nesting in a message deeper than this is taken as malformed */
+#define TDV_SEQ_MAX_NESTING   16
+
+
+struct tdv_seq {
+    /* The mapped file. NULL for an empty file. */
+    const uint8_t *map;
+    size_t         size;
+};
+
+
+struct tdv_seq_result {
+    /* Messages found in the file */
+    uint64_t messages;
+    /* Messages that verified */
+    uint64_t verified;
+    /* Bytes of the messages, which is the file size if the whole
+     * file was scanned */
+    uint64_t bytes;
+    /* Bytes of the payloads of the messages that verified */
+    uint64_t payload_bytes;
+    /* Where the scan stopped on CBOR that isn't well formed, or the
+     * file size */
+    size_t   scan_end;
+};
+
+
+/**
+ * \brief Called for each message after it is verified.
+ *
+ * \param[in] result_ctx  Passed through from tdv_seq_verify().
+ * \param[in] index       Number of the message in the file, from 0.
+ * \param[in] offset      Offset of the message in the file.
+ * \param[in] item        The message, its payload and its result. The
+ *                        payload is a slice of the mapping.
+ *
+ * This is called on the verifying threads, so it must be thread
+ * safe. The messages are not in order.
+ */
+typedef void (*tdv_seq_result_fn)(void                        *result_ctx,
+                                  uint64_t                     index,
+                                  size_t                       offset,
+                                  const struct tdv_batch_item *item);
+
+
+/**
+ * \brief Map a file of COSE_Sign1 messages.
+ *
+ * \param[out] seq        The mapped file.
+ * \param[in] file_name   The file.
+ *
+ * \return \ref T_COSE_ERR_FAIL if the file can't be opened or mapped.
+ */
+enum t_cose_err_t tdv_seq_map(struct tdv_seq *seq, const char *file_name);
+
+
+/**
+ * \brief Unmap a file mapped by tdv_seq_map().
+ */
+void tdv_seq_unmap(struct tdv_seq *seq);
+
+
+/**
+ * \brief Find the next message in a CBOR sequence.
+ *
+ * \param[in] seq         The mapped file.
+ * \param[in,out] offset  Where the message starts. Set to where the
+ *                        next one starts.
+ * \param[out] message    The message, a slice of the mapping.
+ *
+ * Only the CBOR heads are looked at, enough to find the end of the
+ * item. Whether it is a COSE_Sign1 is left to the verification.
+ *
+ * \return \ref T_COSE_ERR_CBOR_NOT_WELL_FORMED if the item at
+ *         \c offset isn't well formed or runs past the end of the
+ *         file, or \ref T_COSE_ERR_TOO_SMALL if \c offset is at the
+ *         end.
+ */
+enum t_cose_err_t tdv_seq_next(const struct tdv_seq  *seq,
+                               size_t                *offset,
+                               struct q_useful_buf_c *message);
+
+
+/**
+ * \brief Verify all the messages in a mapped file.
+ *
+ * \param[in] seq            The mapped file.
+ * \param[in] num_threads    Threads to verify on. 0 is the number of
+ *                           CPUs.
+ * \param[in] option_flags   Options for t_cose_sign1_verify_init().
+ * \param[in] key            As for tdv_batch_verify().
+ * \param[in] resolver       As for tdv_batch_verify(). Called on the
+ *                           verifying threads, so it must be thread
+ *                           safe.
+ * \param[in] resolver_ctx   Passed to the resolver.
+ * \param[in] result_fn      Called for each message or NULL.
+ * \param[in] result_ctx     Passed to \c result_fn.
+ * \param[out] result        Totals.
+ *
+ * A message that doesn't verify doesn't stop the others. It is
+ * counted in \c result and passed to \c result_fn with its error.
+ *
+ * \return \ref T_COSE_SUCCESS if the whole file was scanned, even if
+ *         some messages didn't verify.
+ *         \ref T_COSE_ERR_CBOR_NOT_WELL_FORMED if the scan stopped at
+ *         \c result->scan_end; the messages before it were verified.
+ *         \ref T_COSE_ERR_FAIL if no thread could be started.
+ */
+enum t_cose_err_t tdv_seq_verify(const struct tdv_seq    *seq,
+                                 unsigned                 num_threads,
+                                 uint32_t                 option_flags,
+                                 const struct t_cose_key *key,
+                                 tdv_batch_key_resolver   resolver,
+                                 void                    *resolver_ctx,
+                                 tdv_seq_result_fn        result_fn,
+                                 void                    *result_ctx,
+                                 struct tdv_seq_result   *result);
+
+
+#endif /* tdv_seq_h */
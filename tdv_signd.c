@@ -0,0 +1,795 @@
+/*
+ * tdv_signd.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+
+/**
+ * \file tdv_signd.c
+ *
+ * \brief Implementation of tdv_signd.h.
+ *
+ * A connection is either idle, and polled by the poll thread, or
+ * busy, on the queue or with a worker. Only the poll thread makes an
+ * idle connection busy and only a worker makes a busy one idle or
+ * closes it, so a connection is never read by two threads and its
+ * responses stay in order. The poll thread is woken through a pipe
+ * when a connection becomes idle again so it is polled once more.
+ */
+
+/* For MSG_NOSIGNAL */
+#define _POSIX_C_SOURCE 200809L
+
+#include "tdv_signd.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+
+/* Bytes of the length at the start of a frame */
+#define FRAME_HEAD           4
+
+/* Bytes of alg and the key name length at the start of a request */
+#define REQUEST_HEAD         5
+
+/* Bytes of the result at the start of a response */
+#define RESPONSE_HEAD        4
+
+/* Input buffer of a connection. A whole frame of the largest size
+ * always fits with room for more. */
+#define CONN_IN_SIZE         (4 * (FRAME_HEAD + TDV_SIGND_MAX_FRAME))
+
+/* Output buffer of a worker. Written out early if the next response
+ * might not fit. */
+#define WORKER_OUT_SIZE      (8 * (FRAME_HEAD + TDV_SIGND_MAX_FRAME))
+
+#define SIGND_DEFAULT_THREADS 4
+
+/* How long a worker waits for a client to read its responses before
+ * closing the connection, and how often it checks for a stop while
+ * waiting */
+#define WRITE_TIMEOUT_MS     5000
+#define WRITE_POLL_MS        100
+
+
+struct tdv_signd_key {
+    int32_t                    cose_algorithm_id;
+    char                       name[TDV_KEYSTORE_MAX_NAME];
+    struct tdv_prepared_signer signer;
+};
+
+
+struct tdv_signd_conn {
+    int                    fd;
+    /* On the queue or with a worker, so not polled */
+    int                    busy;
+    struct tdv_signd_conn *next;
+    size_t                 in_len;
+    uint8_t                in[CONN_IN_SIZE];
+};
+
+
+static uint32_t get_be32(const uint8_t *p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+
+static void put_be32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)(value >> 24);
+    p[1] = (uint8_t)(value >> 16);
+    p[2] = (uint8_t)(value >> 8);
+    p[3] = (uint8_t)value;
+}
+
+
+static int set_nonblocking(int fd)
+{
+    int flags;
+
+    flags = fcntl(fd, F_GETFL);
+    return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+
+static void wake_poll_thread(struct tdv_signd *signd)
+{
+    const uint8_t byte = 0;
+    ssize_t       n;
+
+    /* If the pipe is full it is already awake */
+    n = write(signd->wake_fds[1], &byte, 1);
+    (void)n;
+}
+
+
+static const struct tdv_signd_key *find_key(const struct tdv_signd *signd,
+                                            int32_t                 cose_algorithm_id,
+                                            const uint8_t          *name,
+                                            size_t                  name_len)
+{
+    size_t i;
+
+    for(i = 0; i < signd->num_keys; i++) {
+        if(signd->keys[i].cose_algorithm_id != cose_algorithm_id) {
+            continue;
+        }
+        if(name_len == 0 ||
+           (strlen(signd->keys[i].name) == name_len &&
+            memcmp(signd->keys[i].name, name, name_len) == 0)) {
+            return &signd->keys[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Sign a request and put the response frame in out, which has room
+ * for FRAME_HEAD + TDV_SIGND_MAX_FRAME bytes. Returns the length of
+ * the response frame.
+ */
+static size_t sign_request(const struct tdv_signd *signd,
+                           const uint8_t          *request,
+                           size_t                  request_len,
+                           uint8_t                *out)
+{
+    const struct tdv_signd_key *key;
+    enum t_cose_err_t           result;
+    struct q_useful_buf_c       payload;
+    struct q_useful_buf_c       cose_sign1;
+    size_t                      name_len;
+
+    cose_sign1 = NULL_Q_USEFUL_BUF_C;
+
+    if(request_len < REQUEST_HEAD || request_len < REQUEST_HEAD + (size_t)request[4]) {
+        result = T_COSE_ERR_INVALID_ARGUMENT;
+        goto Done;
+    }
+    name_len = request[4];
+
+    key = find_key(signd, (int32_t)get_be32(request), request + REQUEST_HEAD, name_len);
+    if(key == NULL) {
+        result = T_COSE_ERR_UNKNOWN_KEY;
+        goto Done;
+    }
+
+    payload.ptr = request + REQUEST_HEAD + name_len;
+    payload.len = request_len - REQUEST_HEAD - name_len;
+    result = tdv_prepared_sign(&key->signer,
+                               payload,
+                               (struct q_useful_buf){out + FRAME_HEAD + RESPONSE_HEAD,
+                                                     TDV_SIGND_MAX_FRAME - RESPONSE_HEAD},
+                               &cose_sign1);
+    if(result) {
+        cose_sign1 = NULL_Q_USEFUL_BUF_C;
+    }
+
+Done:
+    put_be32(out, (uint32_t)(RESPONSE_HEAD + cose_sign1.len));
+    put_be32(out + FRAME_HEAD, (uint32_t)result);
+    return FRAME_HEAD + RESPONSE_HEAD + cose_sign1.len;
+}
+
+
+static int is_stopping(struct tdv_signd *signd)
+{
+    int stop;
+
+    pthread_mutex_lock(&signd->mutex);
+    stop = signd->stop;
+    pthread_mutex_unlock(&signd->mutex);
+
+    return stop;
+}
+
+
+/*
+ * Write all of buf to a non-blocking socket, waiting for it to be
+ * writable if need be. A client that doesn't read its responses
+ * would otherwise hold the worker for good, so the wait is given up
+ * after WRITE_TIMEOUT_MS or when the service is stopping. Returns 0
+ * on success.
+ */
+static int write_all(struct tdv_signd *signd, int fd, const uint8_t *buf, size_t len)
+{
+    struct pollfd pfd;
+    ssize_t       n;
+    int           waited_ms;
+
+    waited_ms = 0;
+    while(len > 0) {
+        /* MSG_NOSIGNAL so a client that went away doesn't kill the
+         * service with SIGPIPE */
+        n = send(fd, buf, len, MSG_NOSIGNAL);
+        if(n > 0) {
+            buf += n;
+            len -= (size_t)n;
+            waited_ms = 0;
+        } else if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if(waited_ms >= WRITE_TIMEOUT_MS || is_stopping(signd)) {
+                return -1;
+            }
+            pfd.fd     = fd;
+            pfd.events = POLLOUT;
+            if(poll(&pfd, 1, WRITE_POLL_MS) < 0 && errno != EINTR) {
+                return -1;
+            }
+            waited_ms += WRITE_POLL_MS;
+        } else if(n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/*
+ * Read what there is on a connection and sign the complete requests
+ * in it a batch at a time. Returns 0 if the connection is to be
+ * closed.
+ */
+static int serve_conn(struct tdv_signd *signd, struct tdv_signd_conn *conn, uint8_t *out)
+{
+    ssize_t  n;
+    size_t   pos;
+    size_t   out_len;
+    size_t   frame_len;
+    unsigned batch;
+
+    n = read(conn->fd, conn->in + conn->in_len, CONN_IN_SIZE - conn->in_len);
+    if(n == 0) {
+        return 0;
+    }
+    if(n < 0) {
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+    conn->in_len += (size_t)n;
+
+    pos     = 0;
+    out_len = 0;
+    batch   = 0;
+    while(conn->in_len - pos >= FRAME_HEAD) {
+        frame_len = get_be32(conn->in + pos);
+        if(frame_len > TDV_SIGND_MAX_FRAME) {
+            return 0;
+        }
+        if(conn->in_len - pos - FRAME_HEAD < frame_len) {
+            break;
+        }
+
+        if(batch == signd->max_batch ||
+           WORKER_OUT_SIZE - out_len < FRAME_HEAD + TDV_SIGND_MAX_FRAME) {
+            if(write_all(signd, conn->fd, out, out_len)) {
+                return 0;
+            }
+            atomic_fetch_add_explicit(&signd->batches, 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&signd->requests, batch, memory_order_relaxed);
+            out_len = 0;
+            batch   = 0;
+        }
+
+        out_len += sign_request(signd, conn->in + pos + FRAME_HEAD, frame_len, out + out_len);
+        pos     += FRAME_HEAD + frame_len;
+        batch++;
+    }
+
+    if(batch) {
+        if(write_all(signd, conn->fd, out, out_len)) {
+            return 0;
+        }
+        atomic_fetch_add_explicit(&signd->batches, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&signd->requests, batch, memory_order_relaxed);
+    }
+
+    /* Keep the start of a request not all received yet */
+    memmove(conn->in, conn->in + pos, conn->in_len - pos);
+    conn->in_len -= pos;
+
+    return 1;
+}
+
+
+/*
+ * Close a connection and take it out of the list. Called with the
+ * mutex held.
+ */
+static void close_conn(struct tdv_signd *signd, struct tdv_signd_conn *conn)
+{
+    size_t i;
+
+    for(i = 0; i < signd->num_conns; i++) {
+        if(signd->conns[i] == conn) {
+            signd->conns[i] = signd->conns[--signd->num_conns];
+            break;
+        }
+    }
+    close(conn->fd);
+    free(conn);
+}
+
+
+static void *worker_thread(void *arg)
+{
+    struct tdv_signd      *signd = (struct tdv_signd *)arg;
+    struct tdv_signd_conn *conn;
+    uint8_t               *out;
+    int                    keep;
+
+    out = malloc(WORKER_OUT_SIZE);
+    if(out == NULL) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&signd->mutex);
+    for(;;) {
+        while(!signd->stop && signd->queue_head == NULL) {
+            pthread_cond_wait(&signd->cond, &signd->mutex);
+        }
+        if(signd->stop) {
+            break;
+        }
+        conn              = signd->queue_head;
+        signd->queue_head = conn->next;
+        if(signd->queue_head == NULL) {
+            signd->queue_tail = NULL;
+        }
+        pthread_mutex_unlock(&signd->mutex);
+
+        keep = serve_conn(signd, conn, out);
+
+        pthread_mutex_lock(&signd->mutex);
+        if(keep) {
+            conn->busy = 0;
+        } else {
+            close_conn(signd, conn);
+        }
+        wake_poll_thread(signd);
+    }
+    pthread_mutex_unlock(&signd->mutex);
+
+    free(out);
+    return NULL;
+}
+
+
+static void accept_conn(struct tdv_signd *signd)
+{
+    struct tdv_signd_conn *conn;
+    int                    fd;
+
+    fd = accept(signd->listen_fd, NULL, NULL);
+    if(fd < 0) {
+        return;
+    }
+    conn = NULL;
+    if(set_nonblocking(fd) == 0) {
+        conn = malloc(sizeof(struct tdv_signd_conn));
+    }
+    if(conn == NULL) {
+        close(fd);
+        return;
+    }
+    conn->fd     = fd;
+    conn->busy   = 0;
+    conn->next   = NULL;
+    conn->in_len = 0;
+
+    pthread_mutex_lock(&signd->mutex);
+    if(signd->num_conns == TDV_SIGND_MAX_CONNS) {
+        pthread_mutex_unlock(&signd->mutex);
+        close(fd);
+        free(conn);
+        return;
+    }
+    signd->conns[signd->num_conns++] = conn;
+    pthread_mutex_unlock(&signd->mutex);
+
+    atomic_fetch_add_explicit(&signd->connections, 1, memory_order_relaxed);
+}
+
+
+static void *poll_thread(void *arg)
+{
+    struct tdv_signd       *signd = (struct tdv_signd *)arg;
+    struct pollfd          *fds;
+    struct tdv_signd_conn **polled;
+    struct tdv_signd_conn  *conn;
+    uint8_t                 drain[64];
+    nfds_t                  nfds;
+    nfds_t                  i;
+    size_t                  c;
+
+    fds    = malloc((2 + TDV_SIGND_MAX_CONNS) * sizeof(struct pollfd));
+    polled = malloc(TDV_SIGND_MAX_CONNS * sizeof(struct tdv_signd_conn *));
+    if(fds == NULL || polled == NULL) {
+        goto Done;
+    }
+
+    for(;;) {
+        fds[0].fd     = signd->listen_fd;
+        fds[0].events = POLLIN;
+        fds[1].fd     = signd->wake_fds[0];
+        fds[1].events = POLLIN;
+        nfds = 2;
+
+        pthread_mutex_lock(&signd->mutex);
+        if(signd->stop) {
+            pthread_mutex_unlock(&signd->mutex);
+            break;
+        }
+        for(c = 0; c < signd->num_conns; c++) {
+            if(!signd->conns[c]->busy) {
+                polled[nfds - 2]  = signd->conns[c];
+                fds[nfds].fd      = signd->conns[c]->fd;
+                fds[nfds].events  = POLLIN;
+                fds[nfds].revents = 0;
+                nfds++;
+            }
+        }
+        pthread_mutex_unlock(&signd->mutex);
+
+        if(poll(fds, nfds, -1) < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        if(fds[1].revents & POLLIN) {
+            while(read(signd->wake_fds[0], drain, sizeof(drain)) > 0);
+        }
+        if(fds[0].revents & POLLIN) {
+            accept_conn(signd);
+        }
+
+        /* The polled connections weren't busy so no worker can have
+         * closed them */
+        pthread_mutex_lock(&signd->mutex);
+        for(i = 2; i < nfds; i++) {
+            if(fds[i].revents == 0) {
+                continue;
+            }
+            conn       = polled[i - 2];
+            conn->busy = 1;
+            conn->next = NULL;
+            if(signd->queue_tail == NULL) {
+                signd->queue_head = conn;
+            } else {
+                signd->queue_tail->next = conn;
+            }
+            signd->queue_tail = conn;
+            pthread_cond_signal(&signd->cond);
+        }
+        pthread_mutex_unlock(&signd->mutex);
+    }
+
+Done:
+    free(fds);
+    free(polled);
+    return NULL;
+}
+
+
+/*
+ * Remove a socket left at addr by a service that has gone. Returns 0
+ * if there is nothing there now. Anything that isn't a socket and a
+ * socket that is still being listened on, perhaps by another signd,
+ * are left alone.
+ */
+static int remove_stale_socket(const struct sockaddr_un *addr)
+{
+    struct stat st;
+    int         fd;
+    int         in_use;
+
+    if(lstat(addr->sun_path, &st)) {
+        return errno == ENOENT ? 0 : -1;
+    }
+    if(!S_ISSOCK(st.st_mode)) {
+        return -1;
+    }
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0) {
+        return -1;
+    }
+    in_use = connect(fd, (const struct sockaddr *)addr, sizeof(*addr)) == 0;
+    close(fd);
+    if(in_use) {
+        return -1;
+    }
+
+    return unlink(addr->sun_path) && errno != ENOENT ? -1 : 0;
+}
+
+
+/*
+ * Make the listening socket and the wake up pipe.
+ */
+static enum t_cose_err_t open_sockets(struct tdv_signd *signd, const char *socket_path)
+{
+    struct sockaddr_un addr;
+
+    if(pipe(signd->wake_fds)) {
+        return T_COSE_ERR_FAIL;
+    }
+    if(set_nonblocking(signd->wake_fds[0]) || set_nonblocking(signd->wake_fds[1])) {
+        return T_COSE_ERR_FAIL;
+    }
+
+    signd->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(signd->listen_fd < 0) {
+        return T_COSE_ERR_FAIL;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+
+    if(remove_stale_socket(&addr)) {
+        return T_COSE_ERR_FAIL;
+    }
+    if(bind(signd->listen_fd, (struct sockaddr *)&addr, sizeof(addr))) {
+        return T_COSE_ERR_FAIL;
+    }
+    strcpy(signd->socket_path, socket_path);
+
+    if(listen(signd->listen_fd, SOMAXCONN) || set_nonblocking(signd->listen_fd)) {
+        return T_COSE_ERR_FAIL;
+    }
+
+    return T_COSE_SUCCESS;
+}
+
+
+/*
+ * Public function. See tdv_signd.h
+ */
+enum t_cose_err_t tdv_signd_start(struct tdv_signd          *signd,
+                                  const char                *socket_path,
+                                  const struct tdv_keystore *keys,
+                                  unsigned                   num_threads,
+                                  unsigned                   max_batch)
+{
+    enum t_cose_err_t                return_value;
+    const struct tdv_keystore_entry *entry;
+    struct tdv_signd_key            *key;
+    struct q_useful_buf_c            kid;
+    long                             cpus;
+    size_t                           i;
+
+    if(max_batch == 0 || max_batch > TDV_SIGND_MAX_BATCH ||
+       strlen(socket_path) >= sizeof(signd->socket_path) ||
+       strlen(socket_path) >= sizeof(((struct sockaddr_un *)NULL)->sun_path)) {
+        return T_COSE_ERR_INVALID_ARGUMENT;
+    }
+    if(num_threads == 0) {
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = cpus > 0 ? (unsigned)cpus : SIGND_DEFAULT_THREADS;
+    }
+    if(num_threads > TDV_SIGND_MAX_THREADS) {
+        num_threads = TDV_SIGND_MAX_THREADS;
+    }
+
+    /* Everything tdv_signd_stop() looks at is set before anything
+     * can fail */
+    signd->listen_fd      = -1;
+    signd->wake_fds[0]    = -1;
+    signd->wake_fds[1]    = -1;
+    signd->socket_path[0] = '\0';
+    signd->max_batch      = max_batch;
+    signd->num_keys       = 0;
+    signd->num_conns      = 0;
+    signd->queue_head     = NULL;
+    signd->queue_tail     = NULL;
+    signd->stop           = 0;
+    signd->polling        = 0;
+    signd->num_threads    = 0;
+    atomic_init(&signd->requests, 0);
+    atomic_init(&signd->batches, 0);
+    atomic_init(&signd->connections, 0);
+    pthread_mutex_init(&signd->mutex, NULL);
+    pthread_cond_init(&signd->cond, NULL);
+
+    signd->keys = calloc(keys->count ? keys->count : 1, sizeof(struct tdv_signd_key));
+    if(signd->keys == NULL) {
+        return_value = T_COSE_ERR_INSUFFICIENT_MEMORY;
+        goto Done;
+    }
+    for(i = 0; i < keys->count; i++) {
+        entry = &keys->entries[i];
+        if(!entry->can_sign) {
+            continue;
+        }
+        key = &signd->keys[signd->num_keys];
+        key->cose_algorithm_id = entry->cose_algorithm_id;
+        strcpy(key->name, entry->name);
+        /* The built-in test keys have no kid */
+        kid = NULL_Q_USEFUL_BUF_C;
+        if(strcmp(entry->name, TDV_KEYSTORE_BUILTIN)) {
+            kid = (struct q_useful_buf_c){entry->name, strlen(entry->name)};
+        }
+        return_value = tdv_prepared_signer_init(&key->signer, 0, entry->cose_algorithm_id, entry->key, kid);
+        if(return_value) {
+            goto Done;
+        }
+        signd->num_keys++;
+    }
+    if(signd->num_keys == 0) {
+        return_value = T_COSE_ERR_UNKNOWN_KEY;
+        goto Done;
+    }
+
+    return_value = open_sockets(signd, socket_path);
+    if(return_value) {
+        goto Done;
+    }
+
+    for(; signd->num_threads < num_threads; signd->num_threads++) {
+        if(pthread_create(&signd->threads[signd->num_threads], NULL, worker_thread, signd)) {
+            return_value = T_COSE_ERR_FAIL;
+            goto Done;
+        }
+    }
+    if(pthread_create(&signd->poll_thread, NULL, poll_thread, signd)) {
+        return_value = T_COSE_ERR_FAIL;
+        goto Done;
+    }
+    signd->polling = 1;
+
+    return_value = T_COSE_SUCCESS;
+
+Done:
+    if(return_value) {
+        tdv_signd_stop(signd);
+    }
+    return return_value;
+}
+
+
+/*
+ * Public function. See tdv_signd.h
+ */
+void tdv_signd_stop(struct tdv_signd *signd)
+{
+    size_t   i;
+    unsigned t;
+
+    pthread_mutex_lock(&signd->mutex);
+    signd->stop = 1;
+    pthread_cond_broadcast(&signd->cond);
+    pthread_mutex_unlock(&signd->mutex);
+
+    if(signd->polling) {
+        wake_poll_thread(signd);
+        pthread_join(signd->poll_thread, NULL);
+        signd->polling = 0;
+    }
+    for(t = 0; t < signd->num_threads; t++) {
+        pthread_join(signd->threads[t], NULL);
+    }
+    signd->num_threads = 0;
+
+    for(i = 0; i < signd->num_conns; i++) {
+        close(signd->conns[i]->fd);
+        free(signd->conns[i]);
+    }
+    signd->num_conns = 0;
+
+    if(signd->listen_fd >= 0) {
+        close(signd->listen_fd);
+    }
+    if(signd->socket_path[0]) {
+        unlink(signd->socket_path);
+    }
+    if(signd->wake_fds[0] >= 0) {
+        close(signd->wake_fds[0]);
+        close(signd->wake_fds[1]);
+    }
+
+    for(i = 0; i < signd->num_keys; i++) {
+        tdv_prepared_signer_free(&signd->keys[i].signer);
+    }
+    free(signd->keys);
+    signd->keys     = NULL;
+    signd->num_keys = 0;
+
+    pthread_mutex_destroy(&signd->mutex);
+    pthread_cond_destroy(&signd->cond);
+}
+
+
+/*
+ * Public function. See tdv_signd.h
+ */
+void tdv_signd_counts(struct tdv_signd *signd,
+                      uint64_t         *requests,
+                      uint64_t         *batches,
+                      uint64_t         *connections)
+{
+    *requests    = atomic_load_explicit(&signd->requests, memory_order_relaxed);
+    *batches     = atomic_load_explicit(&signd->batches, memory_order_relaxed);
+    *connections = atomic_load_explicit(&signd->connections, memory_order_relaxed);
+}
+
+
+/*
+ * Public function. See tdv_signd.h
+ */
+size_t tdv_signd_put_request(struct q_useful_buf   buffer,
+                             int32_t               cose_algorithm_id,
+                             const char           *key_name,
+                             struct q_useful_buf_c payload)
+{
+    uint8_t *p = (uint8_t *)buffer.ptr;
+    size_t   name_len;
+    size_t   frame_len;
+
+    name_len = key_name != NULL ? strlen(key_name) : 0;
+    if(name_len > UINT8_MAX || payload.len > TDV_SIGND_MAX_PAYLOAD) {
+        return 0;
+    }
+    frame_len = REQUEST_HEAD + name_len + payload.len;
+    if(buffer.len < FRAME_HEAD + frame_len) {
+        return 0;
+    }
+
+    put_be32(p, (uint32_t)frame_len);
+    put_be32(p + FRAME_HEAD, (uint32_t)cose_algorithm_id);
+    p[FRAME_HEAD + 4] = (uint8_t)name_len;
+    if(name_len) {
+        memcpy(p + FRAME_HEAD + REQUEST_HEAD, key_name, name_len);
+    }
+    memcpy(p + FRAME_HEAD + REQUEST_HEAD + name_len, payload.ptr, payload.len);
+
+    return FRAME_HEAD + frame_len;
+}
+
+
+/*
+ * Public function. See tdv_signd.h
+ */
+size_t tdv_signd_get_response(struct q_useful_buf_c  received,
+                              enum t_cose_err_t     *result,
+                              struct q_useful_buf_c *cose_sign1)
+{
+    const uint8_t *p = (const uint8_t *)received.ptr;
+    size_t         frame_len;
+
+    if(received.len < FRAME_HEAD) {
+        return 0;
+    }
+    frame_len = get_be32(p);
+    if(frame_len < RESPONSE_HEAD || frame_len > TDV_SIGND_MAX_FRAME) {
+        return SIZE_MAX;
+    }
+    if(received.len - FRAME_HEAD < frame_len) {
+        return 0;
+    }
+
+    *result     = (enum t_cose_err_t)(int32_t)get_be32(p + FRAME_HEAD);
+    *cose_sign1 = NULL_Q_USEFUL_BUF_C;
+    if(*result == T_COSE_SUCCESS) {
+        cose_sign1->ptr = p + FRAME_HEAD + RESPONSE_HEAD;
+        cose_sign1->len = frame_len - RESPONSE_HEAD;
+    }
+
+    return FRAME_HEAD + frame_len;
+}
@@ -0,0 +1,206 @@
+/*
+ * tdv_signd.h
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+#ifndef tdv_signd_h
+#define tdv_signd_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "t_cose/t_cose_common.h"
+#include "t_cose/q_useful_buf.h"
+
+#include "tdv_keystore.h"
+#include "tdv_prepared.h"
+
+
+/**
+ * \file tdv_signd.h
+ *
+ * \brief A signing service on a UNIX domain socket.
+ *
+ * Each process that links libt_cose.a and signs loads and sets up
+ * the private key itself. With dozens of them on a host that is
+ * dozens of copies of the key set up and held. Here one process
+ * holds the keys, with a prepared signer for each, and signs payloads
+ * sent to it over a UNIX domain socket. It is local only, so there is
+ * no authentication other than the file permissions of the socket.
+ *
+ * The protocol is frames of a 4-byte big-endian length and then that
+ * many bytes:
+ *
+ *     request:   alg (4 bytes, big-endian, signed)
+ *                key name length (1 byte), key name
+ *                payload, the rest of the frame
+ *
+ *     response:  result (4 bytes, big-endian, an enum t_cose_err_t)
+ *                COSE_Sign1, the rest of the frame, if result is 0
+ *
+ * The key is the first one in the key store that can sign with the
+ * algorithm and has the name, or any name if the name is empty. The
+ * payload is the content of the COSE_Sign1's payload byte string.
+ * The COSE_Sign1 is made with tdv_prepared_sign(), with the key name
+ * as the kid unless it is \ref TDV_KEYSTORE_BUILTIN.
+ *
+ * A client may send many requests without waiting. The responses on
+ * a connection are in the order of its requests. A frame longer than
+ * \ref TDV_SIGND_MAX_FRAME closes the connection, as does not reading
+ * the responses for a few seconds once the socket buffer is full.
+ *
+ * One thread polls the connections. When one is readable it is put
+ * on a queue for a pool of worker threads and not polled again until
+ * a worker is done with it. A worker reads all there is and signs up
+ * to max_batch of the complete requests in it as a batch, putting the
+ * responses together in one buffer that is written with one
+ * write(). A client that sends many requests at once gets them
+ * signed with one wake up, one read and one write per batch instead
+ * of per request.
+ */
+
+
+/* Largest request or response frame after the length */
+#define TDV_SIGND_MAX_FRAME      16384
+
+/* Largest payload. Leaves room in a response for the headers and
+ * signature. */
+#define TDV_SIGND_MAX_PAYLOAD    (TDV_SIGND_MAX_FRAME - 512)
+
+/* Most worker threads */
+#define TDV_SIGND_MAX_THREADS    64
+
+/* Most requests signed as one batch */
+#define TDV_SIGND_MAX_BATCH      256
+
+/* Most connections at once. More are closed as they are accepted. */
+#define TDV_SIGND_MAX_CONNS      1024
+
+
+struct tdv_signd_conn;
+struct tdv_signd_key;
+
+
+struct tdv_signd {
+    /* Private data structure */
+    int                     listen_fd;
+    /* Written to wake the polling thread */
+    int                     wake_fds[2];
+    char                    socket_path[108];
+    unsigned                max_batch;
+
+    /* A prepared signer for each key that can sign */
+    struct tdv_signd_key   *keys;
+    size_t                  num_keys;
+
+    /* All connections and the queue of readable ones, under mutex */
+    pthread_mutex_t         mutex;
+    pthread_cond_t          cond;
+    struct tdv_signd_conn  *conns[TDV_SIGND_MAX_CONNS];
+    size_t                  num_conns;
+    struct tdv_signd_conn  *queue_head;
+    struct tdv_signd_conn  *queue_tail;
+    int                     stop;
+
+    int                     polling;
+    pthread_t               poll_thread;
+    unsigned                num_threads;
+    pthread_t               threads[TDV_SIGND_MAX_THREADS];
+
+    atomic_uint_fast64_t    requests;
+    atomic_uint_fast64_t    batches;
+    atomic_uint_fast64_t    connections;
+};
+
+
+/**
+ * \brief Start the signing service.
+ *
+ * \param[out] signd        The service.
+ * \param[in] socket_path   Path of the socket. A socket left there
+ *                          by a service that has gone is removed.
+ * \param[in] keys          The keys. They must stay valid until
+ *                          tdv_signd_stop().
+ * \param[in] num_threads   Worker threads or 0 for the number of CPUs.
+ * \param[in] max_batch     Most requests signed as a batch, up to
+ *                          \ref TDV_SIGND_MAX_BATCH.
+ *
+ * \return \ref T_COSE_ERR_UNKNOWN_KEY if there are no keys that can
+ *         sign, \ref T_COSE_ERR_FAIL if the socket can't be made,
+ *         including when something else is at \c socket_path or a
+ *         service is still listening there, or a thread can't be
+ *         started, or an error setting up a prepared signer.
+ */
+enum t_cose_err_t tdv_signd_start(struct tdv_signd          *signd,
+                                  const char                *socket_path,
+                                  const struct tdv_keystore *keys,
+                                  unsigned                   num_threads,
+                                  unsigned                   max_batch);
+
+
+/**
+ * \brief Stop the signing service.
+ *
+ * \param[in] signd  The service.
+ *
+ * Requests being signed are finished. The connections are closed and
+ * the socket is removed.
+ */
+void tdv_signd_stop(struct tdv_signd *signd);
+
+
+/**
+ * \brief Counts since the service was started.
+ *
+ * \param[in] signd         The service.
+ * \param[out] requests     Requests signed or answered with an error.
+ * \param[out] batches      Batches they were in.
+ * \param[out] connections  Connections accepted.
+ */
+void tdv_signd_counts(struct tdv_signd *signd,
+                      uint64_t         *requests,
+                      uint64_t         *batches,
+                      uint64_t         *connections);
+
+
+/**
+ * \brief Make a request frame. For clients.
+ *
+ * \param[in] buffer             Where to put the frame.
+ * \param[in] cose_algorithm_id  The algorithm to sign with.
+ * \param[in] key_name           The key name or NULL for any.
+ * \param[in] payload            The payload.
+ *
+ * \return The length of the frame, or 0 if it doesn't fit in
+ *         \c buffer or is larger than the service takes.
+ */
+size_t tdv_signd_put_request(struct q_useful_buf   buffer,
+                             int32_t               cose_algorithm_id,
+                             const char           *key_name,
+                             struct q_useful_buf_c payload);
+
+
+/**
+ * \brief Take a response frame. For clients.
+ *
+ * \param[in] received     Bytes received that start with a frame.
+ * \param[out] result      The result of signing.
+ * \param[out] cose_sign1  The COSE_Sign1 in \c received if the
+ *                         result is \ref T_COSE_SUCCESS.
+ *
+ * \return The length of the frame, 0 if all of it hasn't been
+ *         received yet or \c SIZE_MAX if it isn't a valid response.
+ */
+size_t tdv_signd_get_response(struct q_useful_buf_c  received,
+                              enum t_cose_err_t     *result,
+                              struct q_useful_buf_c *cose_sign1);
+
+
+#endif /* tdv_signd_h */
@@ -0,0 +1,473 @@
+/*
+ * tdv_stream.c
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+
+/**
+ * \file tdv_stream.c
+ *
+ * \brief Implementation of tdv_stream.h.
+ *
+ * This is the same for every crypto library. Everything crypto
+ * library specific is behind t_cose_crypto.h.
+ */
+
+/* For posix_fadvise() and posix_madvise() */
+#define _POSIX_C_SOURCE 200809L
+/* For files over 2GB on 32-bit Linux */
+#define _FILE_OFFSET_BITS 64
+
+#include "tdv_stream.h"
+
+#include "t_cose_standard_constants.h"
+#include "t_cose_util.h"
+#include "qcbor/qcbor_encode.h"
+#include "qcbor/qcbor_spiffy_decode.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+/*
+ * Hash the CBOR head of a byte string in the Sig_structure. The
+ * content is hashed separately by the caller.
+ */
+static void hash_bstr_head(struct tdv_stream *stream, uint64_t len)
+{
+    struct q_useful_buf_c head;
+    Q_USEFUL_BUF_MAKE_STACK_UB(head_buffer, QCBOR_HEAD_BUFFER_SIZE);
+
+    head = QCBOREncode_EncodeHead(head_buffer, CBOR_MAJOR_TYPE_BYTE_STRING, 0, len);
+    t_cose_crypto_hash_update(&stream->hash_ctx, head);
+}
+
+
+/*
+ * Set the algorithm, start the hash and hash the part of the
+ * Sig_structure before the payload content. The protected parameters
+ * must already be in the stream context.
+ */
+static enum t_cose_err_t stream_start(struct tdv_stream     *stream,
+                                      int32_t                cose_algorithm_id,
+                                      struct q_useful_buf_c  aad,
+                                      uint64_t               payload_len)
+{
+    enum t_cose_err_t return_value;
+
+    stream->cose_algorithm_id = cose_algorithm_id;
+    stream->hash_algorithm_id = hash_alg_id_from_sig_alg_id(cose_algorithm_id);
+    if(stream->hash_algorithm_id == T_COSE_INVALID_ALGORITHM_ID) {
+        return T_COSE_ERR_UNSUPPORTED_SIGNING_ALG;
+    }
+    stream->remaining = payload_len;
+    stream->overrun   = 0;
+
+    return_value = t_cose_crypto_hash_start(&stream->hash_ctx, stream->hash_algorithm_id);
+    if(return_value) {
+        return return_value;
+    }
+
+    /* An array of 4 and the 10 byte text string context */
+    t_cose_crypto_hash_update(&stream->hash_ctx,
+                              Q_USEFUL_BUF_FROM_SZ_LITERAL("\x84\x6A" COSE_SIG_CONTEXT_STRING_SIGNATURE1));
+
+    hash_bstr_head(stream, stream->protected_parameters.len);
+    t_cose_crypto_hash_update(&stream->hash_ctx, stream->protected_parameters);
+
+    hash_bstr_head(stream, aad.len);
+    if(aad.len) {
+        t_cose_crypto_hash_update(&stream->hash_ctx, aad);
+    }
+
+    /* The payload content comes from tdv_stream_update() */
+    hash_bstr_head(stream, payload_len);
+
+    return T_COSE_SUCCESS;
+}
+
+
+/*
+ * Public function. See tdv_stream.h
+ */
+enum t_cose_err_t tdv_stream_sign_start(struct tdv_stream     *stream,
+                                        int32_t                cose_algorithm_id,
+                                        struct q_useful_buf_c  aad,
+                                        uint64_t               payload_len)
+{
+    QCBOREncodeContext cbor_encode;
+
+    QCBOREncode_Init(&cbor_encode,
+                     (struct q_useful_buf){stream->protected_buffer,
+                                           sizeof(stream->protected_buffer)});
+    QCBOREncode_OpenMap(&cbor_encode);
+    QCBOREncode_AddInt64ToMapN(&cbor_encode, COSE_HEADER_PARAM_ALG, cose_algorithm_id);
+    QCBOREncode_CloseMap(&cbor_encode);
+    if(QCBOREncode_Finish(&cbor_encode, &stream->protected_parameters)) {
+        return T_COSE_ERR_MAKING_PROTECTED;
+    }
+
+    return stream_start(stream, cose_algorithm_id, aad, payload_len);
+}
+
+
+/*
+ * Public function. See tdv_stream.h
+ */
+enum t_cose_err_t tdv_stream_verify_start(struct tdv_stream     *stream,
+                                          struct q_useful_buf_c  cose_sign1,
+                                          struct q_useful_buf_c  aad,
+                                          uint64_t               payload_len)
+{
+    QCBORDecodeContext    decode_context;
+    struct q_useful_buf_c protected_parameters;
+    QCBORItem             items[3];
+
+    enum {ALG, CRIT, END};
+
+    /* [protected bstr, unprotected map, null, signature bstr] */
+    QCBORDecode_Init(&decode_context, cose_sign1, QCBOR_DECODE_MODE_NORMAL);
+    QCBORDecode_EnterArray(&decode_context, NULL);
+    QCBORDecode_GetByteString(&decode_context, &protected_parameters);
+    /* Nothing in the unprotected header is needed */
+    QCBORDecode_EnterMap(&decode_context, NULL);
+    QCBORDecode_ExitMap(&decode_context);
+    QCBORDecode_GetNull(&decode_context);
+    QCBORDecode_GetByteString(&decode_context, &stream->signature);
+    QCBORDecode_ExitArray(&decode_context);
+    if(QCBORDecode_Finish(&decode_context)) {
+        return T_COSE_ERR_SIGN1_FORMAT;
+    }
+
+    if(protected_parameters.len > sizeof(stream->protected_buffer)) {
+        return T_COSE_ERR_SIGN1_FORMAT;
+    }
+    stream->protected_parameters =
+        q_useful_buf_copy((struct q_useful_buf){stream->protected_buffer,
+                                                sizeof(stream->protected_buffer)},
+                          protected_parameters);
+
+    items[ALG].label.int64  = COSE_HEADER_PARAM_ALG;
+    items[ALG].uLabelType   = QCBOR_TYPE_INT64;
+    items[ALG].uDataType    = QCBOR_TYPE_ANY;
+    items[CRIT].label.int64 = COSE_HEADER_PARAM_CRIT;
+    items[CRIT].uLabelType  = QCBOR_TYPE_INT64;
+    items[CRIT].uDataType   = QCBOR_TYPE_ANY;
+    items[END].uLabelType   = QCBOR_TYPE_NONE;
+
+    QCBORDecode_Init(&decode_context, stream->protected_parameters, QCBOR_DECODE_MODE_NORMAL);
+    QCBORDecode_EnterMap(&decode_context, NULL);
+    QCBORDecode_GetItemsInMap(&decode_context, items);
+    QCBORDecode_ExitMap(&decode_context);
+    if(QCBORDecode_Finish(&decode_context)) {
+        return T_COSE_ERR_SIGN1_FORMAT;
+    }
+    if(items[CRIT].uDataType != QCBOR_TYPE_NONE) {
+        return T_COSE_ERR_UNKNOWN_CRITICAL_PARAMETER;
+    }
+    if(items[ALG].uDataType != QCBOR_TYPE_INT64 ||
+       items[ALG].val.int64 < INT32_MIN || items[ALG].val.int64 > INT32_MAX) {
+        return T_COSE_ERR_UNSUPPORTED_SIGNING_ALG;
+    }
+
+    return stream_start(stream, (int32_t)items[ALG].val.int64, aad, payload_len);
+}
+
+
+/*
+ * Public function. See tdv_stream.h
+ */
+void tdv_stream_update(struct tdv_stream *stream, struct q_useful_buf_c chunk)
+{
+    if(chunk.len > stream->remaining) {
+        stream->overrun = 1;
+        return;
+    }
+    stream->remaining -= chunk.len;
+
+    t_cose_crypto_hash_update(&stream->hash_ctx, chunk);
+}
+
+
+/*
+ * Finish the hash. Checks that all the payload and no more was
+ * given.
+ */
+static enum t_cose_err_t stream_finish(struct tdv_stream     *stream,
+                                       struct q_useful_buf    hash_buffer,
+                                       struct q_useful_buf_c *hash)
+{
+    enum t_cose_err_t return_value;
+
+    /* Always finish so the crypto library frees its hash context */
+    return_value = t_cose_crypto_hash_finish(&stream->hash_ctx, hash_buffer, hash);
+    if(return_value) {
+        return return_value;
+    }
+    if(stream->overrun || stream->remaining) {
+        return T_COSE_ERR_FAIL;
+    }
+
+    return T_COSE_SUCCESS;
+}
+
+
+/*
+ * Public function. See tdv_stream.h
+ */
+enum t_cose_err_t tdv_stream_sign_finish(struct tdv_stream     *stream,
+                                         uint32_t               option_flags,
+                                         struct t_cose_key      signing_key,
+                                         struct q_useful_buf_c  kid,
+                                         struct q_useful_buf    out_buf,
+                                         struct q_useful_buf_c *cose_sign1)
+{
+    enum t_cose_err_t     return_value;
+    QCBOREncodeContext    cbor_encode;
+    struct q_useful_buf_c hash;
+    struct q_useful_buf_c signature;
+    Q_USEFUL_BUF_MAKE_STACK_UB(hash_buffer, T_COSE_CRYPTO_MAX_HASH_SIZE);
+    Q_USEFUL_BUF_MAKE_STACK_UB(signature_buffer, T_COSE_MAX_SIG_SIZE);
+
+    return_value = stream_finish(stream, hash_buffer, &hash);
+    if(return_value) {
+        return return_value;
+    }
+
+    return_value = t_cose_crypto_sign(stream->cose_algorithm_id,
+                                      signing_key,
+                                      hash,
+                                      signature_buffer,
+                                      &signature);
+    if(return_value) {
+        return return_value;
+    }
+
+    QCBOREncode_Init(&cbor_encode, out_buf);
+    if(!(option_flags & T_COSE_OPT_OMIT_CBOR_TAG)) {
+        QCBOREncode_AddTag(&cbor_encode, CBOR_TAG_COSE_SIGN1);
+    }
+    QCBOREncode_OpenArray(&cbor_encode);
+    QCBOREncode_AddBytes(&cbor_encode, stream->protected_parameters);
+    QCBOREncode_OpenMap(&cbor_encode);
+    if(!q_useful_buf_c_is_null(kid)) {
+        QCBOREncode_AddBytesToMapN(&cbor_encode, COSE_HEADER_PARAM_KID, kid);
+    }
+    QCBOREncode_CloseMap(&cbor_encode);
+    /* The payload is detached */
+    QCBOREncode_AddNULL(&cbor_encode);
+    QCBOREncode_AddBytes(&cbor_encode, signature);
+    QCBOREncode_CloseArray(&cbor_encode);
+    if(QCBOREncode_Finish(&cbor_encode, cose_sign1)) {
+        return T_COSE_ERR_TOO_SMALL;
+    }
+
+    return T_COSE_SUCCESS;
+}
+
+
+/*
+ * Public function. See tdv_stream.h
+ */
+enum t_cose_err_t tdv_stream_verify_finish(struct tdv_stream *stream,
+                                           struct t_cose_key  verification_key)
+{
+    enum t_cose_err_t     return_value;
+    struct q_useful_buf_c hash;
+    Q_USEFUL_BUF_MAKE_STACK_UB(hash_buffer, T_COSE_CRYPTO_MAX_HASH_SIZE);
+
+    return_value = stream_finish(stream, hash_buffer, &hash);
+    if(return_value) {
+        return return_value;
+    }
+
+    return t_cose_crypto_verify(stream->cose_algorithm_id,
+                                verification_key,
+                                NULL_Q_USEFUL_BUF_C,
+                                hash,
+                                stream->signature);
+}
+
+
+static enum t_cose_err_t file_size(int fd, uint64_t *size)
+{
+    struct stat st;
+
+    if(fstat(fd, &st) || st.st_size < 0) {
+        return T_COSE_ERR_FAIL;
+    }
+    *size = (uint64_t)st.st_size;
+    return T_COSE_SUCCESS;
+}
+
+
+/*
+ * Feed the file to the hash a chunk at a time with read(). The chunk
+ * buffer is the only memory used.
+ */
+static enum t_cose_err_t feed_read(struct tdv_stream   *stream,
+                                   int                  fd,
+                                   uint64_t             size,
+                                   struct q_useful_buf  chunk_buffer)
+{
+    ssize_t bytes_read;
+    size_t  want;
+
+    if(chunk_buffer.ptr == NULL || chunk_buffer.len == 0) {
+        return T_COSE_ERR_FAIL;
+    }
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    /* Read ahead more. Only a hint so the result doesn't matter. */
+    (void)posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    while(size) {
+        want = size < chunk_buffer.len ? (size_t)size : chunk_buffer.len;
+        bytes_read = read(fd, chunk_buffer.ptr, want);
+        if(bytes_read < 0 && errno == EINTR) {
+            continue;
+        }
+        if(bytes_read <= 0) {
+            /* Error or the file got shorter */
+            return T_COSE_ERR_FAIL;
+        }
+        tdv_stream_update(stream, (struct q_useful_buf_c){chunk_buffer.ptr, (size_t)bytes_read});
+        size -= (uint64_t)bytes_read;
+    }
+
+    return T_COSE_SUCCESS;
+}
+
+
+/*
+ * Feed the file to the hash by mapping a window of it at a time.
+ * Each window is unmapped before the next is mapped so the pages of
+ * the file don't accumulate in the process's RSS. A file truncated
+ * while mapped gets SIGBUS, so this is for files that aren't being
+ * written.
+ */
+static enum t_cose_err_t feed_mmap(struct tdv_stream *stream,
+                                   int                fd,
+                                   uint64_t           size,
+                                   size_t             window_size)
+{
+    size_t   page_size;
+    uint64_t offset;
+    size_t   map_len;
+    void    *map;
+
+    /* Window offsets must be multiples of the page size */
+    page_size   = (size_t)sysconf(_SC_PAGESIZE);
+    window_size = (window_size + page_size - 1) / page_size * page_size;
+    if(window_size == 0) {
+        return T_COSE_ERR_FAIL;
+    }
+
+    for(offset = 0; offset < size; offset += map_len) {
+        map_len = size - offset < window_size ? (size_t)(size - offset) : window_size;
+        map = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE, fd, (off_t)offset);
+        if(map == MAP_FAILED) {
+            return T_COSE_ERR_FAIL;
+        }
+        /* Only a hint so the result doesn't matter */
+        (void)posix_madvise(map, map_len, POSIX_MADV_SEQUENTIAL);
+
+        tdv_stream_update(stream, (struct q_useful_buf_c){map, map_len});
+
+        munmap(map, map_len);
+    }
+
+    return T_COSE_SUCCESS;
+}
+
+
+static enum t_cose_err_t feed_fd(struct tdv_stream   *stream,
+                                 int                  fd,
+                                 uint32_t             stream_options,
+                                 uint64_t             size,
+                                 struct q_useful_buf  chunk_buffer)
+{
+    if(stream_options & TDV_STREAM_MMAP) {
+        return feed_mmap(stream, fd, size, chunk_buffer.len);
+    } else {
+        return feed_read(stream, fd, size, chunk_buffer);
+    }
+}
+
+
+/*
+ * Public function. See tdv_stream.h
+ */
+enum t_cose_err_t tdv_stream_sign_fd(int                    fd,
+                                     uint32_t               stream_options,
+                                     uint32_t               option_flags,
+                                     int32_t                cose_algorithm_id,
+                                     struct t_cose_key      signing_key,
+                                     struct q_useful_buf_c  kid,
+                                     struct q_useful_buf    chunk_buffer,
+                                     struct q_useful_buf    out_buf,
+                                     struct q_useful_buf_c *cose_sign1)
+{
+    struct tdv_stream stream;
+    enum t_cose_err_t return_value;
+    uint64_t          size;
+
+    return_value = file_size(fd, &size);
+    if(return_value) {
+        return return_value;
+    }
+
+    return_value = tdv_stream_sign_start(&stream, cose_algorithm_id, NULL_Q_USEFUL_BUF_C, size);
+    if(return_value) {
+        return return_value;
+    }
+
+    /* Always finish, even on error, so the hash context is freed */
+    return_value = feed_fd(&stream, fd, stream_options, size, chunk_buffer);
+    if(return_value) {
+        stream.overrun = 1;
+    }
+
+    return tdv_stream_sign_finish(&stream, option_flags, signing_key, kid, out_buf, cose_sign1);
+}
+
+
+/*
+ * Public function. See tdv_stream.h
+ */
+enum t_cose_err_t tdv_stream_verify_fd(int                   fd,
+                                       uint32_t              stream_options,
+                                       struct t_cose_key     verification_key,
+                                       struct q_useful_buf   chunk_buffer,
+                                       struct q_useful_buf_c cose_sign1)
+{
+    struct tdv_stream stream;
+    enum t_cose_err_t return_value;
+    uint64_t          size;
+
+    return_value = file_size(fd, &size);
+    if(return_value) {
+        return return_value;
+    }
+
+    return_value = tdv_stream_verify_start(&stream, cose_sign1, NULL_Q_USEFUL_BUF_C, size);
+    if(return_value) {
+        return return_value;
+    }
+
+    return_value = feed_fd(&stream, fd, stream_options, size, chunk_buffer);
+    if(return_value) {
+        stream.overrun = 1;
+    }
+
+    return tdv_stream_verify_finish(&stream, verification_key);
+}
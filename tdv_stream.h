@@ -0,0 +1,240 @@
+/*
+ * tdv_stream.h
+ *
+ * Copyright 2022, Laurence Lundblade
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * See BSD-3-Clause license in README.md
+ */
+
+#ifndef tdv_stream_h
+#define tdv_stream_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "t_cose/t_cose_common.h"
+#include "t_cose/q_useful_buf.h"
+#include "t_cose_crypto.h"
+
+
+/**
+ * \file tdv_stream.h
+ *
+ * \brief Sign and verify a detached payload fed in pieces.
+ *
+ * t_cose_sign1_sign() and t_cose_sign1_verify() need the whole
+ * payload in memory. That doesn't work for a firmware image of
+ * hundreds of MB. Here the payload is detached, it is not in the
+ * COSE_Sign1, and it is fed into the hash of the Sig_structure a
+ * piece at a time. Memory use is the same for any size of payload.
+ *
+ * The Sig_structure (RFC 9052 section 4.4) is hashed the same way
+ * t_cose hashes it: the CBOR head of each byte string is hashed and
+ * then its content, so the payload is never encoded. Only the length
+ * of the payload is needed at the start, for its head.
+ *
+ * The COSE_Sign1 made is the same as t_cose makes for a detached
+ * payload, the payload is CBOR null. The protected header has only
+ * the algorithm. The unprotected header has the kid if one is given.
+ *
+ * The hashing and signing are done with t_cose's crypto adapter
+ * layer, t_cose_crypto.h, so this works with any crypto library
+ * t_cose does. Only algorithms that sign a hash, the ECDSA and RSA
+ * ones, are supported. EdDSA signs the whole message and can't be
+ * streamed.
+ *
+ * Sign:
+ *
+ *     tdv_stream_sign_start(&s, alg, aad, payload_len);
+ *     tdv_stream_update(&s, chunk);   as many times as needed
+ *     tdv_stream_sign_finish(&s, options, key, kid, out_buf, &cose_sign1);
+ *
+ * Verify:
+ *
+ *     tdv_stream_verify_start(&s, cose_sign1, aad, payload_len);
+ *     tdv_stream_update(&s, chunk);   as many times as needed
+ *     tdv_stream_verify_finish(&s, key);
+ *
+ * tdv_stream_sign_fd() and tdv_stream_verify_fd() do all of this for
+ * a file.
+ */
+
+
+/* Largest protected header. The one made here is {1: alg}, but one
+ * made elsewhere may have more. */
+#define TDV_STREAM_MAX_PROTECTED 64
+
+/* Option for tdv_stream_sign_fd() and tdv_stream_verify_fd(). Map the
+ * file a window at a time instead of reading it into the chunk
+ * buffer. */
+#define TDV_STREAM_MMAP          0x01
+
+
+struct tdv_stream {
+    /* Private data structure */
+    struct t_cose_crypto_hash hash_ctx;
+    int32_t                   cose_algorithm_id;
+    int32_t                   hash_algorithm_id;
+    /* Bytes of payload still to come */
+    uint64_t                  remaining;
+    /* More payload was given than the length at the start */
+    int                       overrun;
+    uint8_t                   protected_buffer[TDV_STREAM_MAX_PROTECTED];
+    struct q_useful_buf_c     protected_parameters;
+    /* For verify. Points into the COSE_Sign1 */
+    struct q_useful_buf_c     signature;
+};
+
+
+/**
+ * \brief Start signing a detached payload.
+ *
+ * \param[out] stream             The stream context.
+ * \param[in] cose_algorithm_id   The signing algorithm, for example
+ *                                \ref T_COSE_ALGORITHM_ES256.
+ * \param[in] aad                 Externally supplied data or
+ *                                \c NULL_Q_USEFUL_BUF_C.
+ * \param[in] payload_len         Exact length of the payload that will
+ *                                be given to tdv_stream_update().
+ *
+ * \return \ref T_COSE_ERR_UNSUPPORTED_SIGNING_ALG if the algorithm
+ *         doesn't sign a hash or an error starting the hash.
+ */
+enum t_cose_err_t tdv_stream_sign_start(struct tdv_stream     *stream,
+                                        int32_t                cose_algorithm_id,
+                                        struct q_useful_buf_c  aad,
+                                        uint64_t               payload_len);
+
+
+/**
+ * \brief Start verifying a COSE_Sign1 with a detached payload.
+ *
+ * \param[out] stream       The stream context.
+ * \param[in] cose_sign1    The COSE_Sign1. It must stay valid until
+ *                          tdv_stream_verify_finish() returns.
+ * \param[in] aad           Externally supplied data or
+ *                          \c NULL_Q_USEFUL_BUF_C.
+ * \param[in] payload_len   Exact length of the payload that will be
+ *                          given to tdv_stream_update().
+ *
+ * The CBOR tag 18 is allowed but not required. The algorithm is
+ * taken from the protected header. A message with critical header
+ * parameters is rejected because none are understood here.
+ *
+ * \return \ref T_COSE_ERR_SIGN1_FORMAT if the message can't be
+ *         decoded or its payload is not detached,
+ *         \ref T_COSE_ERR_UNKNOWN_CRITICAL_PARAMETER,
+ *         \ref T_COSE_ERR_UNSUPPORTED_SIGNING_ALG or an error starting
+ *         the hash.
+ */
+enum t_cose_err_t tdv_stream_verify_start(struct tdv_stream     *stream,
+                                          struct q_useful_buf_c  cose_sign1,
+                                          struct q_useful_buf_c  aad,
+                                          uint64_t               payload_len);
+
+
+/**
+ * \brief Hash the next piece of the payload.
+ *
+ * \param[in] stream   The stream context.
+ * \param[in] chunk    The next piece. Any size including zero.
+ *
+ * Errors, including more payload than was said at the start, are
+ * returned by the finish function.
+ */
+void tdv_stream_update(struct tdv_stream *stream, struct q_useful_buf_c chunk);
+
+
+/**
+ * \brief Finish the hash, sign it and make the COSE_Sign1.
+ *
+ * \param[in] stream        The stream context.
+ * \param[in] option_flags  \ref T_COSE_OPT_OMIT_CBOR_TAG or 0.
+ * \param[in] signing_key   The key to sign with.
+ * \param[in] kid           Put in the unprotected header or
+ *                          \c NULL_Q_USEFUL_BUF_C for none.
+ * \param[in] out_buf       Buffer for the COSE_Sign1.
+ * \param[out] cose_sign1   The COSE_Sign1 in \c out_buf.
+ *
+ * \return \ref T_COSE_ERR_FAIL if the payload given was not the
+ *         length given at the start, or an error from hashing,
+ *         signing or encoding.
+ */
+enum t_cose_err_t tdv_stream_sign_finish(struct tdv_stream     *stream,
+                                         uint32_t               option_flags,
+                                         struct t_cose_key      signing_key,
+                                         struct q_useful_buf_c  kid,
+                                         struct q_useful_buf    out_buf,
+                                         struct q_useful_buf_c *cose_sign1);
+
+
+/**
+ * \brief Finish the hash and verify the signature.
+ *
+ * \param[in] stream             The stream context.
+ * \param[in] verification_key   The key to verify with.
+ *
+ * \return \ref T_COSE_SUCCESS, \ref T_COSE_ERR_SIG_VERIFY if the
+ *         signature doesn't match, \ref T_COSE_ERR_FAIL if the
+ *         payload given was not the length given at the start, or
+ *         another error.
+ */
+enum t_cose_err_t tdv_stream_verify_finish(struct tdv_stream *stream,
+                                           struct t_cose_key  verification_key);
+
+
+/**
+ * \brief Sign a file as a detached payload.
+ *
+ * \param[in] fd               An open file, read from the start to
+ *                             the end.
+ * \param[in] stream_options   \ref TDV_STREAM_MMAP or 0.
+ * \param[in] option_flags     As for tdv_stream_sign_finish().
+ * \param[in] cose_algorithm_id  The signing algorithm.
+ * \param[in] signing_key      The key to sign with.
+ * \param[in] kid              As for tdv_stream_sign_finish().
+ * \param[in] chunk_buffer     The file is read into this a piece at a
+ *                             time. With \ref TDV_STREAM_MMAP only its
+ *                             length is used, as the size of the
+ *                             window mapped.
+ * \param[in] out_buf          Buffer for the COSE_Sign1.
+ * \param[out] cose_sign1      The COSE_Sign1 in \c out_buf.
+ *
+ * The length of the payload is the size of the file when this is
+ * called. \ref T_COSE_ERR_FAIL is returned if it can't be read or
+ * mapped or changes size while being read.
+ */
+enum t_cose_err_t tdv_stream_sign_fd(int                    fd,
+                                     uint32_t               stream_options,
+                                     uint32_t               option_flags,
+                                     int32_t                cose_algorithm_id,
+                                     struct t_cose_key      signing_key,
+                                     struct q_useful_buf_c  kid,
+                                     struct q_useful_buf    chunk_buffer,
+                                     struct q_useful_buf    out_buf,
+                                     struct q_useful_buf_c *cose_sign1);
+
+
+/**
+ * \brief Verify a COSE_Sign1 whose detached payload is a file.
+ *
+ * \param[in] fd                 An open file, read from the start to
+ *                               the end.
+ * \param[in] stream_options     \ref TDV_STREAM_MMAP or 0.
+ * \param[in] verification_key   The key to verify with.
+ * \param[in] chunk_buffer       As for tdv_stream_sign_fd().
+ * \param[in] cose_sign1         The COSE_Sign1.
+ *
+ * \return As for tdv_stream_verify_start(), tdv_stream_verify_finish()
+ *         and tdv_stream_sign_fd().
+ */
+enum t_cose_err_t tdv_stream_verify_fd(int                   fd,
+                                       uint32_t              stream_options,
+                                       struct t_cose_key     verification_key,
+                                       struct q_useful_buf   chunk_buffer,
+                                       struct q_useful_buf_c cose_sign1);
+
+
+#endif /* tdv_stream_h */